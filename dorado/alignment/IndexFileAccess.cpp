@@ -1,12 +1,22 @@
 #include "IndexFileAccess.h"
 
 #include "Minimap2Index.h"
+#include "index_cache.h"
+
+#include <spdlog/spdlog.h>
 
 #include <cassert>
+#include <chrono>
 #include <sstream>
 
 namespace dorado::alignment {
 
+IndexFileAccess::IndexFileAccess() : m_index_cache_dir(get_index_cache_dir()) {}
+
+void IndexFileAccess::set_index_cache_dir(std::optional<std::filesystem::path> cache_dir) {
+    m_index_cache_dir = std::move(cache_dir);
+}
+
 const Minimap2Index* IndexFileAccess::get_compatible_index(
         const std::string& index_file,
         const Minimap2IndexOptions& indexing_options) {
@@ -85,7 +95,7 @@ IndexLoadResult IndexFileAccess::load_index(const std::string& index_file,
         return IndexLoadResult::validation_error;
     }
 
-    auto load_result = new_index->load(index_file, num_threads, false);
+    auto load_result = load_index_with_cache(*new_index, index_file, options, num_threads);
     if (load_result != IndexLoadResult::success) {
         return load_result;
     }
@@ -95,6 +105,51 @@ IndexLoadResult IndexFileAccess::load_index(const std::string& index_file,
     return IndexLoadResult::success;
 }
 
+IndexLoadResult IndexFileAccess::load_index_with_cache(Minimap2Index& index,
+                                                       const std::string& index_file,
+                                                       const Minimap2Options& options,
+                                                       int num_threads) const {
+    std::filesystem::path cached_index;
+    if (m_index_cache_dir) {
+        cached_index = get_cached_index_path(*m_index_cache_dir, index_file, options);
+    }
+    if (cached_index.empty()) {
+        return index.load(index_file, num_threads, false);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto elapsed_seconds = [start] {
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    };
+
+    if (std::filesystem::exists(cached_index)) {
+        if (index.load(cached_index.string(), num_threads, false) == IndexLoadResult::success) {
+            const auto load_seconds = elapsed_seconds();
+            const auto build_seconds = get_cached_index_build_seconds(cached_index);
+            if (build_seconds) {
+                spdlog::info("Loaded cached index for {} in {:.1f}s, saving {:.1f}s", index_file,
+                             load_seconds, *build_seconds - load_seconds);
+            } else {
+                spdlog::info("Loaded cached index for {} in {:.1f}s", index_file, load_seconds);
+            }
+            return IndexLoadResult::success;
+        }
+        spdlog::warn("Ignoring unreadable cached index {}", cached_index.string());
+    }
+
+    const auto load_result = index.load(index_file, num_threads, false);
+    if (load_result != IndexLoadResult::success) {
+        return load_result;
+    }
+    const auto build_seconds = elapsed_seconds();
+    if (write_cached_index(cached_index, *index.index(), build_seconds)) {
+        spdlog::info("Built index for {} in {:.1f}s, cached as {}", index_file, build_seconds,
+                     cached_index.string());
+    }
+    return IndexLoadResult::success;
+}
+
 std::shared_ptr<const Minimap2Index> IndexFileAccess::get_index(const std::string& index_file,
                                                                 const Minimap2Options& options) {
     std::lock_guard<std::mutex> lock(m_mutex);
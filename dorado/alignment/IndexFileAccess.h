@@ -3,9 +3,11 @@
 #include "Minimap2IndexSupportTypes.h"
 #include "Minimap2Options.h"
 
+#include <filesystem>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 
 namespace dorado::alignment {
@@ -17,6 +19,14 @@ class IndexFileAccess {
     using CompatibleIndicesLut = std::map<Minimap2MappingOptions, std::shared_ptr<Minimap2Index>>;
     using IndexKey = std::pair<std::string, Minimap2IndexOptions>;
     std::map<IndexKey, CompatibleIndicesLut> m_index_lut;
+    std::optional<std::filesystem::path> m_index_cache_dir;
+
+    // Loads the index, from the on-disk cache if it's enabled and has the index, otherwise from
+    // the file (adding it to the cache).
+    IndexLoadResult load_index_with_cache(Minimap2Index& index,
+                                          const std::string& index_file,
+                                          const Minimap2Options& options,
+                                          int num_threads) const;
 
     // Returns true if the index is loaded, will also create the index if a compatible
     // one is already loaded and return true.
@@ -42,6 +52,11 @@ class IndexFileAccess {
                                                                 const Minimap2Options& options);
 
 public:
+    IndexFileAccess();
+
+    // Overrides the cache directory set by DORADO_INDEX_CACHE_DIR, if any.
+    void set_index_cache_dir(std::optional<std::filesystem::path> cache_dir);
+
     IndexLoadResult load_index(const std::string& index_file,
                                const Minimap2Options& options,
                                int num_threads);
@@ -0,0 +1,128 @@
+#include "index_cache.h"
+
+#include "minimap2_wrappers.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// FNV-1a, which unlike std::hash gives the same key in every build.
+uint64_t hash_key(const std::string& key) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char c : key) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+fs::path get_build_seconds_path(const fs::path& cached_index) {
+    auto path = cached_index;
+    path += ".build_seconds";
+    return path;
+}
+
+}  // namespace
+
+namespace dorado::alignment {
+
+std::optional<fs::path> get_index_cache_dir() {
+    const char* env_cache_dir = std::getenv("DORADO_INDEX_CACHE_DIR");
+    if (env_cache_dir == nullptr || env_cache_dir[0] == '\0') {
+        return std::nullopt;
+    }
+    return fs::path(env_cache_dir);
+}
+
+fs::path get_cached_index_path(const fs::path& cache_dir,
+                               const std::string& reference_file,
+                               const Minimap2IndexOptions& options) {
+    std::error_code ec;
+    const auto reference_path = fs::canonical(reference_file, ec);
+    if (ec) {
+        return {};
+    }
+    const auto file_size = fs::file_size(reference_path, ec);
+    if (ec) {
+        return {};
+    }
+    const auto modified_time = fs::last_write_time(reference_path, ec);
+    if (ec) {
+        return {};
+    }
+    // Prebuilt indices load quickly already.  This also rejects files minimap2 can't open.
+    if (mm_idx_is_idx(reference_path.string().c_str()) != 0) {
+        return {};
+    }
+
+    // The junction BED isn't part of the key, since it's applied after the index is loaded.
+    const auto& mm_opts = options.index_options->get();
+    std::ostringstream key;
+    key << reference_path.string() << '\n'
+        << file_size << ' ' << modified_time.time_since_epoch().count() << '\n'
+        << mm_opts.k << ' ' << mm_opts.w << ' ' << mm_opts.flag << ' ' << mm_opts.bucket_bits
+        << ' ' << mm_opts.mini_batch_size << ' ' << mm_opts.batch_size;
+
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx",
+                  static_cast<unsigned long long>(hash_key(key.str())));
+    return cache_dir / (reference_path.filename().string() + '.' + hash + ".mmi");
+}
+
+bool write_cached_index(const fs::path& cached_index,
+                        const mm_idx_t& index,
+                        double build_seconds) {
+    std::error_code ec;
+    fs::create_directories(cached_index.parent_path(), ec);
+    if (ec) {
+        spdlog::warn("Failed to create index cache directory {}: {}",
+                     cached_index.parent_path().string(), ec.message());
+        return false;
+    }
+
+    auto temp_path = cached_index;
+    temp_path += ".tmp" + std::to_string(std::random_device{}());
+    FILE* file = std::fopen(temp_path.string().c_str(), "wb");
+    if (file == nullptr) {
+        spdlog::warn("Failed to write cached index {}", temp_path.string());
+        return false;
+    }
+    mm_idx_dump(file, &index);
+    const bool write_failed = std::ferror(file) != 0;
+    if (std::fclose(file) != 0 || write_failed) {
+        spdlog::warn("Failed to write cached index {}", temp_path.string());
+        fs::remove(temp_path, ec);
+        return false;
+    }
+
+    // Record the build time first, so that anyone who sees the index also sees it.
+    std::ofstream(get_build_seconds_path(cached_index)) << build_seconds << '\n';
+    fs::rename(temp_path, cached_index, ec);
+    if (ec) {
+        spdlog::warn("Failed to write cached index {}: {}", cached_index.string(), ec.message());
+        fs::remove(temp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+std::optional<double> get_cached_index_build_seconds(const fs::path& cached_index) {
+    std::ifstream input(get_build_seconds_path(cached_index));
+    double build_seconds = 0;
+    if (!(input >> build_seconds)) {
+        return std::nullopt;
+    }
+    return build_seconds;
+}
+
+}  // namespace dorado::alignment
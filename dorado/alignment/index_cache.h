@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Minimap2Options.h"
+
+#include <minimap.h>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace dorado::alignment {
+
+// Indices built from a FASTA/FASTQ reference can be cached on disk in minimap2's own index
+// format, so that later runs load the prebuilt index instead of rebuilding it.  Caching is
+// enabled by setting DORADO_INDEX_CACHE_DIR to the directory to use.
+std::optional<std::filesystem::path> get_index_cache_dir();
+
+// Returns the path the index for the reference and indexing options is cached at, keyed by the
+// reference's path, size and modification time.  Returns an empty path if the reference isn't
+// cacheable, i.e. it doesn't exist or is already a prebuilt index.
+std::filesystem::path get_cached_index_path(const std::filesystem::path& cache_dir,
+                                            const std::string& reference_file,
+                                            const Minimap2IndexOptions& options);
+
+// Writes the index to the cache, along with how long it took to build.  The file is written
+// under a temporary name and then renamed, so concurrent processes never see a partial index.
+// Returns false if the index could not be written.
+bool write_cached_index(const std::filesystem::path& cached_index,
+                        const mm_idx_t& index,
+                        double build_seconds);
+
+// How long the cached index took to build, if known.
+std::optional<double> get_cached_index_build_seconds(const std::filesystem::path& cached_index);
+
+}  // namespace dorado::alignment
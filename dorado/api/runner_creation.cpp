@@ -1,8 +1,10 @@
 #include "runner_creation.h"
 
 #include "basecall/BasecallerParams.h"
+#include "basecall/CpuChunkBenchmarks.h"
 #include "basecall/ModelRunner.h"
 #include "basecall/crf_utils.h"
+#include "basecall/decode/Decoder.h"
 #include "modbase/ModBaseModelConfig.h"
 
 #if DORADO_METAL_BUILD
@@ -16,6 +18,7 @@
 #include <cxxpool.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <thread>
 
 namespace dorado::api {
@@ -23,7 +26,8 @@ namespace dorado::api {
 std::pair<std::vector<basecall::RunnerPtr>, size_t> create_basecall_runners(
         basecall::BasecallerCreationParams params,
         size_t num_gpu_runners,
-        size_t num_cpu_runners) {
+        size_t num_cpu_runners,
+        size_t num_cpu_threads) {
     std::vector<basecall::RunnerPtr> runners;
 
     // Default is 1 device.  CUDA path may alter this.
@@ -34,14 +38,32 @@ std::pair<std::vector<basecall::RunnerPtr>, size_t> create_basecall_runners(
         spdlog::warn("CPU basecalling is not supported on this platform. Results may be incorrect");
 #endif  // #ifdef DORADO_TX2
 
-        if (num_cpu_runners == 0) {
-            num_cpu_runners = basecall::auto_calculate_num_runners(params.model_config,
-                                                                   params.memory_limit_fraction);
+        // Load the weights once, and have every runner share them.
+        const auto decoder = basecall::decode::create_decoder(params.device, params.model_config);
+        const auto module = basecall::load_crf_model(
+                params.model_config,
+                at::TensorOptions().dtype(decoder->dtype()).device(params.device));
+
+        auto model_config = params.model_config;
+        int intra_op_threads = 0;
+        if (num_cpu_runners == 0 || model_config.basecaller.batch_size() == 0) {
+            const int num_threads =
+                    num_cpu_threads > 0
+                            ? int(num_cpu_threads)
+                            : std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+            const auto setup =
+                    basecall::tune_cpu_runners(params, int(num_cpu_runners), num_threads, module);
+            num_cpu_runners = setup.num_runners;
+            model_config.basecaller.set_batch_size(setup.batch_size);
+            intra_op_threads = setup.intra_op_threads;
+            spdlog::debug("- CPU calling: set intra-op threads to {}", intra_op_threads);
         }
         spdlog::debug("- CPU calling: set num_cpu_runners to {}", num_cpu_runners);
         for (size_t i = 0; i < num_cpu_runners; i++) {
-            runners.push_back(
-                    std::make_unique<basecall::ModelRunner>(params.model_config, params.device));
+            auto runner =
+                    std::make_unique<basecall::ModelRunner>(model_config, params.device, module);
+            runner->set_intra_op_threads(intra_op_threads);
+            runners.push_back(std::move(runner));
         }
         if (runners.back()->batch_size() != (size_t)params.model_config.basecaller.batch_size()) {
             spdlog::debug("- CPU calling: set batch_size to {}", runners.back()->batch_size());
@@ -13,10 +13,13 @@
 
 namespace dorado::api {
 
+// CPU runners are tuned to use num_cpu_threads hardware threads between them, or all of them if
+// it's 0.
 std::pair<std::vector<basecall::RunnerPtr>, size_t> create_basecall_runners(
         basecall::BasecallerCreationParams params,
         size_t num_gpu_runners,
-        size_t num_cpu_runners);
+        size_t num_cpu_runners,
+        size_t num_cpu_threads = 0);
 
 std::vector<modbase::RunnerPtr> create_modbase_runners(
         const std::vector<std::filesystem::path>& remora_models,
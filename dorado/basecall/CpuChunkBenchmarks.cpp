@@ -0,0 +1,336 @@
+#include "CpuChunkBenchmarks.h"
+
+#include "BasecallerParams.h"
+#include "CRFModelConfig.h"
+#include "ModelRunner.h"
+#include "crf_utils.h"
+
+#include <spdlog/spdlog.h>
+#include <torch/torch.h>
+
+#if defined(WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace dorado::basecall {
+
+namespace {
+
+const std::string CSV_HEADER{"num_runners,batch_size,intra_op_threads,chunks_per_second"};
+
+// Benchmarks run on chunks this many strides long, which is much shorter than the default chunk
+// size, to keep startup time down.  Relative timings are what matter, so it doesn't need to be the
+// chunk size that will be used.
+constexpr int BENCHMARK_CHUNK_STRIDES = 288;
+
+// Timed calls per runner, after one call to warm up.
+constexpr int BENCHMARK_ITERATIONS = 2;
+
+std::string read_cpu_brand_string() {
+#if defined(WIN32)
+    char name[256] = {};
+    DWORD size = sizeof(name);
+    if (RegGetValueA(HKEY_LOCAL_MACHINE, "HARDWARE\\DESCRIPTION\\System\\CentralProcessor\\0",
+                     "ProcessorNameString", RRF_RT_REG_SZ, nullptr, name, &size) == ERROR_SUCCESS) {
+        return name;
+    }
+#elif defined(__APPLE__)
+    char name[256] = {};
+    size_t size = sizeof(name);
+    if (sysctlbyname("machdep.cpu.brand_string", name, &size, nullptr, 0) == 0) {
+        return name;
+    }
+#elif defined(__linux__)
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            const auto colon = line.find(':');
+            if (colon != std::string::npos) {
+                return line.substr(line.find_first_not_of(" \t", colon + 1));
+            }
+        }
+    }
+#endif
+    return "Unknown CPU";
+}
+
+// Replaces anything that might not be allowed in a file name.
+std::string sanitise_file_name(const std::string& name) {
+    std::string sanitised = name;
+    for (auto& c : sanitised) {
+        const bool allowed = std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '-' ||
+                             c == '_' || c == '@';
+        if (!allowed) {
+            c = '_';
+        }
+    }
+    return sanitised;
+}
+
+}  // namespace
+
+std::string get_cpu_name() {
+    return read_cpu_brand_string() + " (" + std::to_string(std::thread::hardware_concurrency()) +
+           " threads)";
+}
+
+fs::path get_cpu_benchmark_cache_dir() {
+    const char* env_cache_dir = std::getenv("DORADO_CPU_BENCHMARK_CACHE_DIR");
+    if (env_cache_dir != nullptr && env_cache_dir[0] != '\0') {
+        return fs::path(env_cache_dir);
+    }
+    std::error_code ec;
+    const auto temp_dir = fs::temp_directory_path(ec);
+    return ec ? fs::path{} : temp_dir / "dorado_cpu_benchmarks";
+}
+
+fs::path get_cpu_benchmark_cache_path(const fs::path& cache_dir,
+                                      const std::string& cpu_name,
+                                      const fs::path& model_path) {
+    // Strip any extra path elements from the model folder name.
+    const auto model_name = model_path.filename().string();
+    return cache_dir / ("cpu_benchmarks__" + sanitise_file_name(cpu_name) + "__" +
+                        sanitise_file_name(model_name) + ".csv");
+}
+
+std::vector<CpuBenchmarkResult> load_cpu_benchmarks(const fs::path& path) {
+    std::ifstream input(path);
+    std::string line;
+    if (!std::getline(input, line) || line != CSV_HEADER) {
+        return {};
+    }
+
+    std::vector<CpuBenchmarkResult> results;
+    while (std::getline(input, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream fields(line);
+        CpuBenchmarkResult result;
+        char separators[3] = {};
+        if (!(fields >> result.setup.num_runners >> separators[0] >> result.setup.batch_size >>
+              separators[1] >> result.setup.intra_op_threads >> separators[2] >>
+              result.chunks_per_second) ||
+            std::any_of(std::begin(separators), std::end(separators),
+                        [](char c) { return c != ','; })) {
+            spdlog::warn("Ignoring malformed CPU benchmarks file {}", path.string());
+            return {};
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+
+bool save_cpu_benchmarks(const fs::path& path, const std::vector<CpuBenchmarkResult>& results) {
+    std::error_code ec;
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), ec);
+    }
+
+    // Written under a temporary name and then renamed, so concurrent runs never see a partial file.
+    auto temp_path = path;
+    temp_path += ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream output(temp_path);
+        output << CSV_HEADER << '\n';
+        for (const auto& result : results) {
+            output << result.setup.num_runners << ',' << result.setup.batch_size << ','
+                   << result.setup.intra_op_threads << ',' << result.chunks_per_second << '\n';
+        }
+        if (!output) {
+            spdlog::warn("Failed to write CPU benchmarks {}", temp_path.string());
+            fs::remove(temp_path, ec);
+            return false;
+        }
+    }
+    fs::rename(temp_path, path, ec);
+    if (ec) {
+        spdlog::warn("Failed to write CPU benchmarks {}: {}", path.string(), ec.message());
+        fs::remove(temp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+std::vector<CpuRunnerSetup> get_cpu_benchmark_setups(
+        int num_threads,
+        int requested_batch_size,
+        int requested_runners,
+        const std::function<int(int batch_size)>& max_runners) {
+    const auto batch_sizes = requested_batch_size > 0 ? std::vector<int>{requested_batch_size}
+                                                      : std::vector<int>{64, 128, 256};
+
+    std::vector<CpuRunnerSetup> setups;
+    for (const int batch_size : batch_sizes) {
+        const int runner_limit = std::max(max_runners(batch_size), 1);
+        // Single threaded runners on every core, a few threads per runner, and the spare cores
+        // shared out between runners if there isn't enough memory for one runner per core.
+        std::vector<int> thread_counts{1, 2, 4};
+        const int runners_for_spare_cores =
+                requested_runners > 0 ? requested_runners : std::min(runner_limit, num_threads);
+        thread_counts.push_back(std::max(num_threads / runners_for_spare_cores, 1));
+
+        for (const int intra_op_threads : thread_counts) {
+            if (intra_op_threads > num_threads) {
+                continue;
+            }
+            const int num_runners =
+                    requested_runners > 0
+                            ? requested_runners
+                            : std::clamp(num_threads / intra_op_threads, 1, runner_limit);
+            if (intra_op_threads > 1 && num_runners * intra_op_threads > num_threads) {
+                continue;
+            }
+            const CpuRunnerSetup setup{num_runners, batch_size, intra_op_threads};
+            if (std::find(setups.begin(), setups.end(), setup) == setups.end()) {
+                setups.push_back(setup);
+            }
+        }
+    }
+    return setups;
+}
+
+const CpuBenchmarkResult& select_best_cpu_setup(const std::vector<CpuBenchmarkResult>& results) {
+    if (results.empty()) {
+        throw std::runtime_error("No CPU benchmark results to select from.");
+    }
+    return *std::max_element(results.begin(), results.end(),
+                             [](const CpuBenchmarkResult& lhs, const CpuBenchmarkResult& rhs) {
+                                 return lhs.chunks_per_second < rhs.chunks_per_second;
+                             });
+}
+
+float benchmark_cpu_setup(const CRFModelConfig& model_config,
+                          const torch::nn::ModuleHolder<torch::nn::AnyModule>& module,
+                          const CpuRunnerSetup& setup,
+                          int chunk_size) {
+    auto config = model_config;
+    config.basecaller.set_batch_size(setup.batch_size);
+    config.basecaller.set_chunk_size(chunk_size);
+    config.normalise_basecaller_params();
+
+    std::vector<std::unique_ptr<ModelRunner>> runners;
+    const auto chunk = torch::randn({config.num_features, config.basecaller.chunk_size()});
+    for (int i = 0; i < setup.num_runners; ++i) {
+        runners.push_back(std::make_unique<ModelRunner>(config, "cpu", module));
+        runners.back()->set_intra_op_threads(setup.intra_op_threads);
+        for (int j = 0; j < setup.batch_size; ++j) {
+            runners.back()->accept_chunk(j, chunk);
+        }
+    }
+
+    const int batch_size = setup.batch_size;
+    auto call_all_runners = [&runners, batch_size](int iterations) {
+        std::vector<std::thread> threads;
+        for (auto& runner : runners) {
+            threads.emplace_back([&runner, batch_size, iterations] {
+                for (int i = 0; i < iterations; ++i) {
+                    runner->call_chunks(batch_size);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    };
+
+    call_all_runners(1);
+    const auto start = std::chrono::steady_clock::now();
+    call_all_runners(BENCHMARK_ITERATIONS);
+    const std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+
+    const auto num_chunks = setup.num_runners * setup.batch_size * BENCHMARK_ITERATIONS;
+    return static_cast<float>(num_chunks) / std::max(elapsed.count(), 1e-6f);
+}
+
+CpuRunnerSetup tune_cpu_runners(const BasecallerCreationParams& params,
+                                int requested_runners,
+                                int num_threads,
+                                const torch::nn::ModuleHolder<torch::nn::AnyModule>& module) {
+    const auto& model_config = params.model_config;
+    const auto setups = get_cpu_benchmark_setups(
+            num_threads, model_config.basecaller.batch_size(), requested_runners,
+            [&model_config, &params](int batch_size) {
+                auto config = model_config;
+                config.basecaller.set_batch_size(batch_size);
+                return static_cast<int>(
+                        auto_calculate_num_runners(config, params.memory_limit_fraction));
+            });
+
+    const auto cpu_name = get_cpu_name();
+    const auto cache_dir = get_cpu_benchmark_cache_dir();
+    const auto cache_path =
+            cache_dir.empty()
+                    ? fs::path{}
+                    : get_cpu_benchmark_cache_path(cache_dir, cpu_name, model_config.model_path);
+    auto cached_results = (params.run_batchsize_benchmarks || cache_path.empty())
+                                  ? std::vector<CpuBenchmarkResult>{}
+                                  : load_cpu_benchmarks(cache_path);
+
+    const auto granularity = static_cast<int>(model_config.chunk_size_granularity());
+    const int chunk_size = std::max(
+            std::min(model_config.basecaller.chunk_size(),
+                     static_cast<int>(model_config.stride_inner()) * BENCHMARK_CHUNK_STRIDES) /
+                    granularity * granularity,
+            granularity);
+
+    std::vector<CpuBenchmarkResult> results;
+    bool benchmarked = false;
+    for (const auto& setup : setups) {
+        const auto cached =
+                std::find_if(cached_results.begin(), cached_results.end(),
+                             [&setup](const CpuBenchmarkResult& r) { return r.setup == setup; });
+        if (cached != cached_results.end()) {
+            results.push_back(*cached);
+            continue;
+        }
+
+        if (!benchmarked) {
+            spdlog::info("Calculating optimized CPU setup for \"{}\" and model {}. Benchmarking "
+                         "will run for this CPU, which may take some time.",
+                         cpu_name, model_config.model_path.filename().string());
+            benchmarked = true;
+        }
+        const float chunks_per_second =
+                benchmark_cpu_setup(model_config, module, setup, chunk_size);
+        spdlog::debug("CPU benchmark: {} runners, batch size {}, {} threads: {:.1f} chunks/s",
+                      setup.num_runners, setup.batch_size, setup.intra_op_threads,
+                      chunks_per_second);
+        results.push_back({setup, chunks_per_second});
+        cached_results.push_back(results.back());
+    }
+
+    if (benchmarked && !cache_path.empty()) {
+        save_cpu_benchmarks(cache_path, cached_results);
+    }
+    if (params.emit_batchsize_benchmarks) {
+        save_cpu_benchmarks(
+                get_cpu_benchmark_cache_path(fs::current_path(), cpu_name, model_config.model_path),
+                results);
+    }
+
+    const auto& best = select_best_cpu_setup(results);
+    spdlog::debug("CPU setup: {} runners, batch size {}, {} threads per runner",
+                  best.setup.num_runners, best.setup.batch_size, best.setup.intra_op_threads);
+    return best.setup;
+}
+
+}  // namespace dorado::basecall
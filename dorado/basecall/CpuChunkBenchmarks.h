@@ -0,0 +1,80 @@
+#pragma once
+
+#include <torch/nn.h>
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace dorado::basecall {
+
+struct CRFModelConfig;
+struct BasecallerCreationParams;
+
+// How CPU basecalling is split up: num_runners ModelRunners each call batch_size chunks at a
+// time, with intra_op_threads torch threads per call.
+struct CpuRunnerSetup {
+    int num_runners{1};
+    int batch_size{128};
+    int intra_op_threads{1};
+
+    bool operator==(const CpuRunnerSetup& other) const {
+        return num_runners == other.num_runners && batch_size == other.batch_size &&
+               intra_op_threads == other.intra_op_threads;
+    }
+};
+
+struct CpuBenchmarkResult {
+    CpuRunnerSetup setup;
+    float chunks_per_second{0};
+};
+
+// The CPU's brand string and number of hardware threads, which is what the benchmarks depend on.
+std::string get_cpu_name();
+
+// Benchmarks are cached in DORADO_CPU_BENCHMARK_CACHE_DIR if it's set, and otherwise in
+// dorado_cpu_benchmarks in the temporary directory.
+std::filesystem::path get_cpu_benchmark_cache_dir();
+
+// The file in cache_dir holding the benchmarks for the CPU and model.
+std::filesystem::path get_cpu_benchmark_cache_path(const std::filesystem::path& cache_dir,
+                                                   const std::string& cpu_name,
+                                                   const std::filesystem::path& model_path);
+
+// Benchmarks are stored as CSV, which is also what --emit-batchsize-benchmarks writes out.
+// Loading returns no results if the file is missing or malformed.
+std::vector<CpuBenchmarkResult> load_cpu_benchmarks(const std::filesystem::path& path);
+bool save_cpu_benchmarks(const std::filesystem::path& path,
+                         const std::vector<CpuBenchmarkResult>& results);
+
+// The setups worth timing on num_threads hardware threads.  A requested_batch_size or
+// requested_runners of 0 means that it should be tuned too.  max_runners gives how many runners
+// of a batch size fit in memory.
+std::vector<CpuRunnerSetup> get_cpu_benchmark_setups(
+        int num_threads,
+        int requested_batch_size,
+        int requested_runners,
+        const std::function<int(int batch_size)>& max_runners);
+
+// The highest throughput result.  Throws if there are none.
+const CpuBenchmarkResult& select_best_cpu_setup(const std::vector<CpuBenchmarkResult>& results);
+
+// Times setup on synthetic chunks of chunk_size samples, with every runner sharing module and
+// using setup.intra_op_threads torch threads.
+float benchmark_cpu_setup(const CRFModelConfig& model_config,
+                          const torch::nn::ModuleHolder<torch::nn::AnyModule>& module,
+                          const CpuRunnerSetup& setup,
+                          int chunk_size);
+
+// Picks the highest throughput setup for basecalling with the model on this CPU.  The batch size
+// and number of runners are tuned unless set, i.e. params.model_config's batch size or
+// requested_runners is non-zero.  Timings are taken from the on-disk cache when it has them all,
+// unless params.run_batchsize_benchmarks is set, and any new timings are added to the cache.
+// module is the model to benchmark, and num_threads the hardware threads it can use.
+CpuRunnerSetup tune_cpu_runners(const BasecallerCreationParams& params,
+                                int requested_runners,
+                                int num_threads,
+                                const torch::nn::ModuleHolder<torch::nn::AnyModule>& module);
+
+}  // namespace dorado::basecall
@@ -540,6 +540,7 @@ void MetalTxCaller::load_tx_model(const CRFModelConfig &model_config) {
     m_model->load_state_dict(state_dict);
     m_model->to(options.dtype().toScalarType());
     m_model->to(options.device());
+    m_model->crf->scale_weights();
     m_model->eval();
 }
 
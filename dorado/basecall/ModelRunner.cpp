@@ -4,14 +4,22 @@
 #include "decode/Decoder.h"
 #include "nn/CRFModel.h"
 
+#include <ATen/Parallel.h>
+
 namespace dorado::basecall {
 
 ModelRunner::ModelRunner(const CRFModelConfig &model_config, const std::string &device)
+        : ModelRunner(model_config, device, nullptr) {}
+
+ModelRunner::ModelRunner(const CRFModelConfig &model_config,
+                         const std::string &device,
+                         torch::nn::ModuleHolder<torch::nn::AnyModule> module)
         : m_config(model_config),
           m_decoder(decode::create_decoder(device, model_config)),
           // TODO: m_options.dtype() depends on the device as TxModel uses kHalf in cuda which is not supported on CPU
           m_options(at::TensorOptions().dtype(m_decoder->dtype()).device(device)),
-          m_module(load_crf_model(model_config, m_options)) {
+          m_module(module.is_empty() ? load_crf_model(model_config, m_options)
+                                     : std::move(module)) {
     assert(model_config.has_normalised_basecaller_params());
 
     m_decoder_options.q_shift = model_config.qbias;
@@ -28,6 +36,9 @@ ModelRunner::ModelRunner(const CRFModelConfig &model_config, const std::string &
 }
 
 std::vector<decode::DecodedChunk> ModelRunner::call_chunks(int num_chunks) {
+    if (m_intra_op_threads > 0 && at::get_num_threads() != m_intra_op_threads) {
+        at::set_num_threads(m_intra_op_threads);
+    }
     at::InferenceMode guard;
     dorado::stats::Timer timer;
     auto scores_TNC =
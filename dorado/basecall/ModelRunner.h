@@ -15,6 +15,11 @@ namespace dorado::basecall {
 class ModelRunner final : public ModelRunnerBase {
 public:
     ModelRunner(const CRFModelConfig &model_config, const std::string &device);
+    // Runs module, which can be shared with other runners since forward() only reads its
+    // weights.  Each runner still has its own input buffer, activations and decoder.
+    ModelRunner(const CRFModelConfig &model_config,
+                const std::string &device,
+                torch::nn::ModuleHolder<torch::nn::AnyModule> module);
     void accept_chunk(int chunk_idx, const at::Tensor &chunk) final;
     std::vector<decode::DecodedChunk> call_chunks(int num_chunks) final;
     const CRFModelConfig &config() const final { return m_config; };
@@ -25,6 +30,12 @@ public:
     std::string get_name() const final { return "ModelRunner"; }
     stats::NamedStats sample_stats() const final;
 
+    const torch::nn::ModuleHolder<torch::nn::AnyModule> &module() const { return m_module; }
+
+    // Number of torch intra-op threads to use for each call, set in whichever thread makes the
+    // call so that runners for different models can use different counts.  0 leaves torch's own.
+    void set_intra_op_threads(int num_threads) { m_intra_op_threads = num_threads; }
+
 private:
     const CRFModelConfig m_config;
     std::unique_ptr<decode::Decoder> m_decoder;
@@ -32,6 +43,7 @@ private:
     decode::DecoderOptions m_decoder_options;
     torch::nn::ModuleHolder<torch::nn::AnyModule> m_module{nullptr};
     at::Tensor m_input_NCT;
+    int m_intra_op_threads{0};
 
     // Performance monitoring stats.
     std::atomic<int64_t> m_num_batches_called = 0;
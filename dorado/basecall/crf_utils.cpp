@@ -254,6 +254,10 @@ ModuleHolder<AnyModule> load_lstm_model(const CRFModelConfig &model_config,
     model->to(options.dtype().toScalarType());
     model->to(options.device());
     model->eval();
+    if (options.device().is_cpu()) {
+        model->set_cpu_lstm_mode(
+                nn::get_cpu_lstm_mode_from_env(model_config.model_path.filename().string()));
+    }
 
     auto module = AnyModule(model);
     auto holder = ModuleHolder<AnyModule>(module);
@@ -267,6 +271,7 @@ ModuleHolder<AnyModule> load_tx_model(const CRFModelConfig &model_config,
     model->load_state_dict(state_dict);
     model->to(options.dtype().toScalarType());
     model->to(options.device());
+    model->crf->scale_weights();
     model->eval();
 
     auto module = AnyModule(model);
@@ -1,6 +1,7 @@
 #include "CPUDecoder.h"
 
 #include "beam_search.h"
+#include "utils/simd.h"
 
 #include <ATen/Functions.h>
 #include <ATen/TensorIndexing.h>
@@ -8,10 +9,17 @@
 #include <math.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
 #include <vector>
 
 namespace {
 
+constexpr int NUM_BASES = 4;
+
 // Operates in TNC
 at::Tensor scan(const at::Tensor& Ms,
                 const float fixed_stay_score,
@@ -35,11 +43,278 @@ at::Tensor scan(const at::Tensor& Ms,
 
     return alpha;
 }
+
+int get_num_states(int num_trans_states) {
+    if (num_trans_states % NUM_BASES != 0) {
+        throw std::runtime_error("Unexpected number of transition states in CPU decode.");
+    }
+    return num_trans_states / NUM_BASES;
+}
+
+float log_sum_exp5(float x0, float x1, float x2, float x3, float x4) {
+    const float max_x = std::max({x0, x1, x2, x3, x4});
+    return max_x + std::log(std::exp(x0 - max_x) + std::exp(x1 - max_x) + std::exp(x2 - max_x) +
+                            std::exp(x3 - max_x) + std::exp(x4 - max_x));
+}
+
+// The kernels below each compute a single timestep of the forward or backward scan for a single
+// chunk, reading the guide values for the previous step from `prev` and the transition scores for
+// the timestep from `scores` (num_states * NUM_BASES contiguous floats), and writing the new guide
+// values to `out`.
+//
+// The transition score scores[s * NUM_BASES + k] is for the step into state s from its predecessor
+// state (s / NUM_BASES) + k * (num_states / NUM_BASES).
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+void forward_step(const float* prev,
+                  const float* scores,
+                  float* out,
+                  int num_states,
+                  float fixed_stay_score) {
+    const int pred_stride = num_states / NUM_BASES;
+    for (int s = 0; s < num_states; ++s) {
+        const float* pred = prev + s / NUM_BASES;
+        const float* trans = scores + s * NUM_BASES;
+        out[s] = log_sum_exp5(prev[s] + fixed_stay_score, pred[0] + trans[0],
+                              pred[pred_stride] + trans[1], pred[2 * pred_stride] + trans[2],
+                              pred[3 * pred_stride] + trans[3]);
+    }
+}
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+void backward_step(const float* next,
+                   const float* scores,
+                   float* out,
+                   int num_states,
+                   float fixed_stay_score) {
+    const int pred_stride = num_states / NUM_BASES;
+    for (int s = 0; s < num_states; ++s) {
+        // The successors of s are the NUM_BASES consecutive states starting at succ, each reached
+        // via the transition with predecessor index k.
+        const int k = s / pred_stride;
+        const int succ = (s % pred_stride) * NUM_BASES;
+        const float* trans = scores + succ * NUM_BASES + k;
+        out[s] = log_sum_exp5(next[s] + fixed_stay_score, next[succ] + trans[0],
+                              next[succ + 1] + trans[NUM_BASES],
+                              next[succ + 2] + trans[2 * NUM_BASES],
+                              next[succ + 3] + trans[3 * NUM_BASES]);
+    }
+}
+
+#if ENABLE_AVX2_IMPL
+// Cephes-style polynomial approximations of exp and log, accurate to within a couple of ulp over
+// the ranges needed for log-sum-exp: exp of non-positive values and log of values in [1, 5].
+__attribute__((target("avx2,fma"))) inline __m256 exp_avx2(__m256 x) {
+    const __m256 kExpHi = _mm256_set1_ps(88.3762626647949f);
+    const __m256 kExpLo = _mm256_set1_ps(-88.3762626647949f);
+    const __m256 kLog2e = _mm256_set1_ps(1.44269504088896341f);
+    const __m256 kLn2Hi = _mm256_set1_ps(0.693359375f);
+    const __m256 kLn2Lo = _mm256_set1_ps(-2.12194440e-4f);
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+    const __m256 kHalf = _mm256_set1_ps(0.5f);
+
+    x = _mm256_min_ps(_mm256_max_ps(x, kExpLo), kExpHi);
+
+    // Express exp(x) as 2^n * exp(r), with |r| <= ln(2) / 2.
+    const __m256 n = _mm256_floor_ps(_mm256_fmadd_ps(x, kLog2e, kHalf));
+    __m256 r = _mm256_fnmadd_ps(n, kLn2Hi, x);
+    r = _mm256_fnmadd_ps(n, kLn2Lo, r);
+
+    __m256 y = _mm256_set1_ps(1.9875691500E-4f);
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(1.3981999507E-3f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(8.3334519073E-3f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(4.1665795894E-2f));
+    y = _mm256_fmadd_ps(y, r, _mm256_set1_ps(1.6666665459E-1f));
+    y = _mm256_fmadd_ps(y, r, kHalf);
+    y = _mm256_fmadd_ps(y, _mm256_mul_ps(r, r), _mm256_add_ps(r, kOne));
+
+    // Build 2^n directly in the exponent bits.
+    const __m256i pow2n = _mm256_slli_epi32(
+            _mm256_add_epi32(_mm256_cvttps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+}
+
+__attribute__((target("avx2,fma"))) inline __m256 log_avx2(__m256 x) {
+    const __m256 kOne = _mm256_set1_ps(1.0f);
+    const __m256 kSqrtHalf = _mm256_set1_ps(0.707106781186547524f);
+
+    // Split x into exponent e and mantissa m in [0.5, 1).
+    const __m256i bits = _mm256_castps_si256(x);
+    __m256 e = _mm256_cvtepi32_ps(
+            _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(
+            _mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f000000)));
+
+    // Shift the mantissa into [sqrt(1/2), sqrt(2)) so the polynomial is evaluated near zero.
+    const __m256 small = _mm256_cmp_ps(m, kSqrtHalf, _CMP_LT_OQ);
+    e = _mm256_sub_ps(e, _mm256_and_ps(kOne, small));
+    m = _mm256_add_ps(_mm256_sub_ps(m, kOne), _mm256_and_ps(m, small));
+
+    const __m256 z = _mm256_mul_ps(m, m);
+    __m256 y = _mm256_set1_ps(7.0376836292E-2f);
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.1514610310E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(1.1676998740E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.2420140846E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(1.4249322787E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-1.6668057665E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(2.0000714765E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(-2.4999993993E-1f));
+    y = _mm256_fmadd_ps(y, m, _mm256_set1_ps(3.3333331174E-1f));
+    y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+
+    y = _mm256_fmadd_ps(e, _mm256_set1_ps(-2.12194440e-4f), y);
+    y = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), y);
+    return _mm256_fmadd_ps(e, _mm256_set1_ps(0.693359375f), _mm256_add_ps(m, y));
+}
+
+__attribute__((target("avx2,fma"))) inline __m256 log_sum_exp5_avx2(__m256 x0,
+                                                                    __m256 x1,
+                                                                    __m256 x2,
+                                                                    __m256 x3,
+                                                                    __m256 x4) {
+    const __m256 max_x = _mm256_max_ps(_mm256_max_ps(_mm256_max_ps(x0, x1), _mm256_max_ps(x2, x3)),
+                                       x4);
+    __m256 sum = exp_avx2(_mm256_sub_ps(x0, max_x));
+    sum = _mm256_add_ps(sum, exp_avx2(_mm256_sub_ps(x1, max_x)));
+    sum = _mm256_add_ps(sum, exp_avx2(_mm256_sub_ps(x2, max_x)));
+    sum = _mm256_add_ps(sum, exp_avx2(_mm256_sub_ps(x3, max_x)));
+    sum = _mm256_add_ps(sum, exp_avx2(_mm256_sub_ps(x4, max_x)));
+    return _mm256_add_ps(max_x, log_avx2(sum));
+}
+
+// Processes 8 states per iteration.  Every model we support has at least 64 states, so the state
+// count is always a multiple of 8 and the 8 states in a block always share the same value of
+// s / pred_stride in backward_step.
+__attribute__((target("avx2,fma"))) void forward_step(const float* prev,
+                                                      const float* scores,
+                                                      float* out,
+                                                      int num_states,
+                                                      float fixed_stay_score) {
+    constexpr int kUnroll = 8;
+    const int pred_stride = num_states / NUM_BASES;
+    const __m256 stay = _mm256_set1_ps(fixed_stay_score);
+    // Offsets of scores[s * NUM_BASES] for the 8 states of a block.
+    const __m256i kTransOffsets = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+
+    for (int s = 0; s < num_states; s += kUnroll) {
+        const __m256 stay_scores = _mm256_add_ps(_mm256_loadu_ps(prev + s), stay);
+
+        // States s..s+3 share a predecessor, as do states s+4..s+7.
+        const float* pred = prev + s / NUM_BASES;
+        const float* trans = scores + s * NUM_BASES;
+        __m256 step_scores[NUM_BASES];
+        for (int k = 0; k < NUM_BASES; ++k) {
+            const __m256 pred_scores =
+                    _mm256_set_m128(_mm_set1_ps(pred[k * pred_stride + 1]),
+                                    _mm_set1_ps(pred[k * pred_stride]));
+            const __m256 trans_scores = _mm256_i32gather_ps(trans + k, kTransOffsets, 4);
+            step_scores[k] = _mm256_add_ps(pred_scores, trans_scores);
+        }
+
+        _mm256_storeu_ps(out + s, log_sum_exp5_avx2(stay_scores, step_scores[0], step_scores[1],
+                                                    step_scores[2], step_scores[3]));
+    }
+}
+
+__attribute__((target("avx2,fma"))) void backward_step(const float* next,
+                                                       const float* scores,
+                                                       float* out,
+                                                       int num_states,
+                                                       float fixed_stay_score) {
+    constexpr int kUnroll = 8;
+    const int pred_stride = num_states / NUM_BASES;
+    const __m256 stay = _mm256_set1_ps(fixed_stay_score);
+    // Offsets of next[succ] and scores[succ * NUM_BASES] for the 8 states of a block.
+    const __m256i kSuccOffsets = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    const __m256i kTransOffsets = _mm256_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112);
+
+    for (int s = 0; s < num_states; s += kUnroll) {
+        const __m256 stay_scores = _mm256_add_ps(_mm256_loadu_ps(next + s), stay);
+
+        const int k = s / pred_stride;
+        const int succ = (s % pred_stride) * NUM_BASES;
+        const float* trans = scores + succ * NUM_BASES + k;
+        __m256 step_scores[NUM_BASES];
+        for (int j = 0; j < NUM_BASES; ++j) {
+            const __m256 succ_scores = _mm256_i32gather_ps(next + succ + j, kSuccOffsets, 4);
+            const __m256 trans_scores =
+                    _mm256_i32gather_ps(trans + j * NUM_BASES, kTransOffsets, 4);
+            step_scores[j] = _mm256_add_ps(succ_scores, trans_scores);
+        }
+
+        _mm256_storeu_ps(out + s, log_sum_exp5_avx2(stay_scores, step_scores[0], step_scores[1],
+                                                    step_scores[2], step_scores[3]));
+    }
+}
+#endif
+
+using StepFn = void (*)(const float*, const float*, float*, int, float);
+
+// Runs `step` over every timestep and chunk of `scores_TNC`, in the direction given by `reverse`.
+// Returns guide values in (T + 1)NS, with the initial guides of 0 at t = 0 for the forward scan or
+// t = T for the backward scan.
+at::Tensor scan_raw(const at::Tensor& scores_TNC,
+                    const float fixed_stay_score,
+                    const StepFn step,
+                    const bool reverse) {
+    const auto scores = scores_TNC.stride(2) == 1 ? scores_TNC : scores_TNC.contiguous();
+    const int T = int(scores.size(0));
+    const int N = int(scores.size(1));
+    const int num_states = get_num_states(int(scores.size(2)));
+
+    at::Tensor guides = at::empty({T + 1, N, num_states}, scores.options());
+    guides[reverse ? T : 0].zero_();
+
+    const float* const scores_ptr = scores.data_ptr<float>();
+    float* const guides_ptr = guides.data_ptr<float>();
+    const auto stride_T = scores.stride(0);
+    const auto stride_N = scores.stride(1);
+    const int64_t guide_stride_T = int64_t(N) * num_states;
+
+    for (int n = 0; n < N; ++n) {
+        for (int i = 0; i < T; ++i) {
+            const int t = reverse ? T - 1 - i : i;
+            const int t_in = reverse ? t + 1 : t;
+            const int t_out = reverse ? t : t + 1;
+            step(guides_ptr + t_in * guide_stride_T + int64_t(n) * num_states,
+                 scores_ptr + t * stride_T + n * stride_N,
+                 guides_ptr + t_out * guide_stride_T + int64_t(n) * num_states, num_states,
+                 fixed_stay_score);
+        }
+    }
+
+    return guides;
+}
+
+bool can_use_raw_scan(const at::Tensor& scores_TNC) {
+    // The vectorised kernels need blocks of 8 states not to straddle a multiple of num_states / 4.
+    return scores_TNC.device().is_cpu() && scores_TNC.scalar_type() == at::ScalarType::Float &&
+           scores_TNC.size(2) % (NUM_BASES * NUM_BASES * 8) == 0;
+}
+
 }  // namespace
 
 namespace dorado::basecall::decode::inner {
 
 at::Tensor forward_scores(const at::Tensor& scores_TNC, const float fixed_stay_score) {
+    if (!can_use_raw_scan(scores_TNC)) {
+        return forward_scores_aten(scores_TNC, fixed_stay_score);
+    }
+    return scan_raw(scores_TNC, fixed_stay_score, forward_step, false);
+}
+
+at::Tensor backward_scores(const at::Tensor& scores_TNC, const float fixed_stay_score) {
+    if (!can_use_raw_scan(scores_TNC)) {
+        return backward_scores_aten(scores_TNC, fixed_stay_score);
+    }
+    return scan_raw(scores_TNC, fixed_stay_score, backward_step, true);
+}
+
+at::Tensor forward_scores_aten(const at::Tensor& scores_TNC, const float fixed_stay_score) {
     const int T = int(scores_TNC.size(0));  // Signal len
     const int N = int(scores_TNC.size(1));  // Num batches
     const int C = int(scores_TNC.size(2));  // 4^state_len * 4 = 4^(state_len + 1)
@@ -64,7 +339,7 @@ at::Tensor forward_scores(const at::Tensor& scores_TNC, const float fixed_stay_s
     return scan(Ms, fixed_stay_score, idx, v0);
 }
 
-at::Tensor backward_scores(const at::Tensor& scores_TNC, const float fixed_stay_score) {
+at::Tensor backward_scores_aten(const at::Tensor& scores_TNC, const float fixed_stay_score) {
     const int N = int(scores_TNC.size(1));  // Num batches
     const int C = int(scores_TNC.size(2));  // 4^state_len * 4 = 4^(state_len + 1)
 
@@ -101,44 +376,38 @@ std::vector<DecodedChunk> CPUDecoder::beam_search_part_2(DecodeData data) const
     const auto scores_cpu = data.data.to(at::kCPU);
     const auto num_chunks = data.num_chunks;
     const auto& options = data.options;
-    int num_threads = std::min(num_chunks, 4);
-    int chunks_per_thread = num_chunks / num_threads;
-    int num_threads_with_one_more_chunk = num_chunks % num_threads;
+    const int num_threads = std::min(num_chunks, 4);
 
     std::vector<DecodedChunk> chunk_results(num_chunks);
 
+    // Chunks take very different times to decode depending on how much the beam has to be cut,
+    // so rather than splitting them up front each thread takes the next chunk when it's done.
+    // Every chunk is scanned and decoded independently, so the results don't depend on which
+    // thread decodes it.
+    std::atomic<int> next_chunk_idx{0};
     std::vector<std::thread> threads;
     threads.reserve(num_threads);
     for (int i = 0; i < num_threads; ++i) {
-        threads.emplace_back([&, i]() {
+        threads.emplace_back([&]() {
             at::InferenceMode inference_mode_guard;
 
-            int t_first_chunk =
-                    i * chunks_per_thread + std::min(i, num_threads_with_one_more_chunk);
-            int t_num_chunks = chunks_per_thread + int(i < num_threads_with_one_more_chunk);
-
-            // Slice TNC -> TnC
-            using Slice = at::indexing::Slice;
-            auto t_scores =
-                    scores_cpu.index({Slice(), Slice(t_first_chunk, t_first_chunk + t_num_chunks)});
-
-            at::Tensor fwd = inner::forward_scores(t_scores, options.blank_score);
-            at::Tensor bwd = inner::backward_scores(t_scores, options.blank_score);
-
-            at::Tensor posts = at::softmax(fwd + bwd, -1);
-
-            // Transpose TnC to nTC
-            t_scores = t_scores.transpose(0, 1);
-            bwd = bwd.transpose(0, 1).contiguous();
-            posts = posts.transpose(0, 1).contiguous();
-
-            // Iter over n in nTC, passing TC tensors to beam_search_decode
-            for (int chunk_idx = 0; chunk_idx < t_num_chunks; chunk_idx++) {
-                auto decode_result = beam_search_decode(t_scores[chunk_idx], bwd[chunk_idx],
-                                                        posts[chunk_idx], options.beam_width,
-                                                        options.beam_cut, options.blank_score,
-                                                        options.q_shift, options.q_scale, 1.0f);
-                chunk_results[t_first_chunk + chunk_idx] = DecodedChunk{
+            for (int chunk_idx = next_chunk_idx++; chunk_idx < num_chunks;
+                 chunk_idx = next_chunk_idx++) {
+                // Slice TNC -> T1C
+                using Slice = at::indexing::Slice;
+                const auto chunk_scores =
+                        scores_cpu.index({Slice(), Slice(chunk_idx, chunk_idx + 1)});
+
+                const at::Tensor fwd = inner::forward_scores(chunk_scores, options.blank_score);
+                const at::Tensor bwd = inner::backward_scores(chunk_scores, options.blank_score);
+                const at::Tensor posts = at::softmax(fwd + bwd, -1);
+
+                // Drop the chunk dimension, passing TC tensors to beam_search_decode
+                auto decode_result = beam_search_decode(
+                        chunk_scores.select(1, 0), bwd.select(1, 0), posts.select(1, 0),
+                        options.beam_width, options.beam_cut, options.blank_score,
+                        options.q_shift, options.q_scale, 1.0f);
+                chunk_results[chunk_idx] = DecodedChunk{
                         std::get<0>(decode_result),
                         std::get<1>(decode_result),
                         std::get<2>(decode_result),
@@ -8,9 +8,15 @@ namespace dorado::basecall::decode {
 
 namespace inner {
 
+// Forward/backward guide scores in (T + 1)NS for transition scores in TNC.  Float CPU inputs are
+// scanned directly over the raw buffer, with AVX2 kernels where available.
 at::Tensor forward_scores(const at::Tensor& scores_TNC, float fixed_stay_score);
 at::Tensor backward_scores(const at::Tensor& scores_TNC, float fixed_stay_score);
 
+// Reference implementations built from per-timestep ATen ops, used for other dtypes/devices.
+at::Tensor forward_scores_aten(const at::Tensor& scores_TNC, float fixed_stay_score);
+at::Tensor backward_scores_aten(const at::Tensor& scores_TNC, float fixed_stay_score);
+
 }  // namespace inner
 
 class CPUDecoder final : public Decoder {
@@ -11,6 +11,7 @@
 #include <array>
 #include <bitset>
 #include <cstring>
+#include <iterator>
 #include <iostream>
 #include <limits>
 #include <numeric>
@@ -104,7 +105,7 @@ std::tuple<std::string, std::string> generate_sequence(const std::vector<uint8_t
 // Incorporates NUM_NEW_BITS into a Castagnoli CRC32, aka CRC32C
 // (not the same polynomial as CRC32 as used in zip/ethernet).
 template <int NUM_NEW_BITS>
-uint32_t crc32c(uint32_t crc, uint32_t new_bits) {
+constexpr uint32_t crc32c_bitwise(uint32_t crc, uint32_t new_bits) {
     // Note that this is the reversed polynomial.
     constexpr uint32_t POLYNOMIAL = 0x82f63b78u;
     for (int i = 0; i < NUM_NEW_BITS; ++i) {
@@ -118,6 +119,111 @@ uint32_t crc32c(uint32_t crc, uint32_t new_bits) {
     return crc;
 }
 
+// Lookup table for crc32c(): entry i is the CRC update for low bits i of (crc ^ new_bits).
+template <int NUM_NEW_BITS>
+struct Crc32cTable {
+    uint32_t entries[1 << NUM_NEW_BITS]{};
+    constexpr Crc32cTable() {
+        for (uint32_t i = 0; i < (1u << NUM_NEW_BITS); ++i) {
+            entries[i] = crc32c_bitwise<NUM_NEW_BITS>(i, 0);
+        }
+    }
+};
+
+// Same result as crc32c_bitwise(), but a single table lookup for the small numbers of bits
+// added per beam element.
+template <int NUM_NEW_BITS>
+uint32_t crc32c(uint32_t crc, uint32_t new_bits) {
+    if constexpr (NUM_NEW_BITS <= 8) {
+        static constexpr Crc32cTable<NUM_NEW_BITS> TABLE;
+        constexpr uint32_t MASK = (1u << NUM_NEW_BITS) - 1;
+        return (crc >> NUM_NEW_BITS) ^ TABLE.entries[(crc ^ new_bits) & MASK];
+    } else {
+        return crc32c_bitwise<NUM_NEW_BITS>(crc, new_bits);
+    }
+}
+
+// Returns the number of the first count scores which are >= cutoff.
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+size_t count_scores_at_least(const float* score_ptr, size_t count, float cutoff) {
+    size_t elem_count = 0;
+#if !ENABLE_NEON_IMPL
+    for (int i = int(count); i; --i) {
+        if (*score_ptr >= cutoff) {
+            ++elem_count;
+        }
+        ++score_ptr;
+    }
+#else
+    uint32x4_t counts_x4_a = vdupq_n_u32(0u);
+    uint32x4_t counts_x4_b = vdupq_n_u32(0u);
+    const float32x4_t cutoff_x4 = vdupq_n_f32(cutoff);
+
+    // 8 fold unrolled version has the small upside that both loads
+    // can be done with a single ldp instruction.
+    const int kUnroll = 8;
+    for (int i = int(count) / kUnroll; i; --i) {
+        // True comparison sets lane bits to 0xffffffff, or -1 in two's complement,
+        // which we subtract to increment our counts.
+        float32x4_t scores_x4_a = vld1q_f32(score_ptr);
+        uint32x4_t comparisons_x4_a = vcgeq_f32(scores_x4_a, cutoff_x4);
+        counts_x4_a = vsubq_u32(counts_x4_a, comparisons_x4_a);
+
+        float32x4_t scores_x4_b = vld1q_f32(score_ptr + 4);
+        uint32x4_t comparisons_x4_b = vcgeq_f32(scores_x4_b, cutoff_x4);
+        counts_x4_b = vsubq_u32(counts_x4_b, comparisons_x4_b);
+
+        score_ptr += 8;
+    }
+    // Add together the result of 2 horizontal adds.
+    elem_count = vaddvq_u32(counts_x4_a) + vaddvq_u32(counts_x4_b);
+    for (int i = count % kUnroll; i; --i) {
+        if (*score_ptr >= cutoff) {
+            ++elem_count;
+        }
+        ++score_ptr;
+    }
+#endif
+    return elem_count;
+}
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("avx2"))) size_t count_scores_at_least(const float* score_ptr,
+                                                             size_t count,
+                                                             float cutoff) {
+    // As in the NEON version, true comparisons are -1 in each lane and are subtracted from the
+    // counts.  Two accumulators hide the latency of the compare.
+    __m256i counts_x8_a = _mm256_setzero_si256();
+    __m256i counts_x8_b = _mm256_setzero_si256();
+    const __m256 cutoff_x8 = _mm256_set1_ps(cutoff);
+
+    const int kUnroll = 16;
+    for (int i = int(count) / kUnroll; i; --i) {
+        const __m256 comparisons_x8_a =
+                _mm256_cmp_ps(_mm256_loadu_ps(score_ptr), cutoff_x8, _CMP_GE_OQ);
+        counts_x8_a = _mm256_sub_epi32(counts_x8_a, _mm256_castps_si256(comparisons_x8_a));
+        const __m256 comparisons_x8_b =
+                _mm256_cmp_ps(_mm256_loadu_ps(score_ptr + 8), cutoff_x8, _CMP_GE_OQ);
+        counts_x8_b = _mm256_sub_epi32(counts_x8_b, _mm256_castps_si256(comparisons_x8_b));
+        score_ptr += kUnroll;
+    }
+
+    alignas(32) uint32_t lane_counts[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lane_counts),
+                       _mm256_add_epi32(counts_x8_a, counts_x8_b));
+    size_t elem_count = std::accumulate(std::begin(lane_counts), std::end(lane_counts), size_t(0));
+    for (int i = count % kUnroll; i; --i) {
+        if (*score_ptr >= cutoff) {
+            ++elem_count;
+        }
+        ++score_ptr;
+    }
+    return elem_count;
+}
+#endif
+
 }  // anonymous namespace
 
 namespace dorado::basecall::decode {
@@ -312,46 +418,8 @@ float beam_search(const T* const scores,
 
         auto get_elem_count = [new_elem_count, &beam_cutoff_score, &current_scores]() {
             // Count the elements which meet the beam cutoff.
-            size_t elem_count = 0;
-            const float* score_ptr = current_scores.data();
-#if !ENABLE_NEON_IMPL
-            for (int i = int(new_elem_count); i; --i) {
-                if (*score_ptr >= beam_cutoff_score) {
-                    ++elem_count;
-                }
-                ++score_ptr;
-            }
-#else
-            uint32x4_t counts_x4_a = vdupq_n_u32(0u);
-            uint32x4_t counts_x4_b = vdupq_n_u32(0u);
-            const float32x4_t cutoff_x4 = vdupq_n_f32(beam_cutoff_score);
-
-            // 8 fold unrolled version has the small upside that both loads
-            // can be done with a single ldp instruction.
-            const int kUnroll = 8;
-            for (int i = int(new_elem_count) / kUnroll; i; --i) {
-                // True comparison sets lane bits to 0xffffffff, or -1 in two's complement,
-                // which we subtract to increment our counts.
-                float32x4_t scores_x4_a = vld1q_f32(score_ptr);
-                uint32x4_t comparisons_x4_a = vcgeq_f32(scores_x4_a, cutoff_x4);
-                counts_x4_a = vsubq_u32(counts_x4_a, comparisons_x4_a);
-
-                float32x4_t scores_x4_b = vld1q_f32(score_ptr + 4);
-                uint32x4_t comparisons_x4_b = vcgeq_f32(scores_x4_b, cutoff_x4);
-                counts_x4_b = vsubq_u32(counts_x4_b, comparisons_x4_b);
-
-                score_ptr += 8;
-            }
-            // Add together the result of 2 horizontal adds.
-            elem_count = vaddvq_u32(counts_x4_a) + vaddvq_u32(counts_x4_b);
-            for (int i = new_elem_count % kUnroll; i; --i) {
-                if (*score_ptr >= beam_cutoff_score) {
-                    ++elem_count;
-                }
-                ++score_ptr;
-            }
-#endif
-            return elem_count;
+            return count_scores_at_least(current_scores.data(), new_elem_count,
+                                         beam_cutoff_score);
         };
 
         // Count the elements which meet the min score
@@ -4,6 +4,7 @@
 #include "torch_utils/tensor_utils.h"
 #include "utils/math_utils.h"
 #include "utils/module_utils.h"
+#include "utils/string_utils.h"
 
 #if DORADO_CUDA_BUILD
 #include "torch_utils/cuda_utils.h"
@@ -16,8 +17,16 @@ extern "C" {
 }
 #endif
 
+#include <ATen/Parallel.h>
+#include <spdlog/spdlog.h>
 #include <torch/torch.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <optional>
+#include <string>
+
 using namespace torch::nn;
 namespace F = torch::nn::functional;
 using Slice = torch::indexing::Slice;
@@ -523,6 +532,10 @@ LSTMStackImpl::LSTMStackImpl(int num_layers, int size) : layer_size(size) {
 };
 
 at::Tensor LSTMStackImpl::forward(at::Tensor x) {
+    if (cpu_mode != CpuLstmMode::TORCH && x.device().is_cpu()) {
+        return forward_cpu(x);
+    }
+
     // Input is [N, T, C], contiguity optional
     for (auto &rnn : rnns) {
         x = std::get<0>(rnn(x.flip(1)));
@@ -532,6 +545,214 @@ at::Tensor LSTMStackImpl::forward(at::Tensor x) {
     return (rnns.size() & 1) ? x.flip(1) : x;
 }
 
+namespace {
+
+float sigmoid(float x) { return 1.f / (1.f + std::exp(-x)); }
+
+// Updates the cell and hidden states of batch rows [begin, end) for one time step, from the gate
+// pre-activations of the input (which include both biases) and of the hidden state, in torch's
+// i, f, g, o gate order.  The new hidden state is also written to out.
+template <typename HiddenGateT>
+void lstm_cell_update(const float *gates_x,
+                      int64_t gates_x_stride,
+                      const HiddenGateT *gates_h,
+                      float *cell,
+                      float *hidden,
+                      float *out,
+                      int64_t out_stride,
+                      int64_t C,
+                      int64_t begin,
+                      int64_t end) {
+    for (int64_t n = begin; n < end; ++n) {
+        const float *gx = gates_x + n * gates_x_stride;
+        const HiddenGateT *gh = gates_h + n * 4 * C;
+        float *c = cell + n * C;
+        float *h = hidden + n * C;
+        float *o = out + n * out_stride;
+        for (int64_t i = 0; i < C; ++i) {
+            const float input_gate = sigmoid(gx[i] + float(gh[i]));
+            const float forget_gate = sigmoid(gx[C + i] + float(gh[C + i]));
+            const float cell_gate = std::tanh(gx[2 * C + i] + float(gh[2 * C + i]));
+            const float output_gate = sigmoid(gx[3 * C + i] + float(gh[3 * C + i]));
+            c[i] = forget_gate * c[i] + input_gate * cell_gate;
+            h[i] = output_gate * std::tanh(c[i]);
+            o[i] = h[i];
+        }
+    }
+}
+
+LSTMStackImpl::CpuInt8Weight quantize_int8_weight(const at::Tensor &weight) {
+    LSTMStackImpl::CpuInt8Weight quantized;
+    std::tie(quantized.weight, quantized.col_offsets, quantized.scale, quantized.zero_point) =
+            at::fbgemm_linear_quantize_weight(weight.contiguous());
+    quantized.packed = at::fbgemm_pack_quantized_matrix(quantized.weight);
+    return quantized;
+}
+
+at::Tensor int8_linear(const at::Tensor &x,
+                       const LSTMStackImpl::CpuInt8Weight &w,
+                       const at::Tensor &bias) {
+    return at::fbgemm_linear_int8_weight_fp32_activation(x, w.weight, w.packed, w.col_offsets,
+                                                         w.scale, w.zero_point, bias);
+}
+
+}  // namespace
+
+CpuLstmMode parse_cpu_lstm_mode(const std::string &setting, const std::string &model_name) {
+    std::optional<CpuLstmMode> default_mode;
+    std::optional<CpuLstmMode> model_mode;
+    for (const auto &entry : utils::split(setting, ',')) {
+        if (entry.empty()) {
+            continue;
+        }
+        const auto separator = entry.rfind('=');
+        const bool keyed = separator != std::string::npos;
+        const auto name = keyed ? entry.substr(0, separator) : std::string();
+        const auto mode_str = keyed ? entry.substr(separator + 1) : entry;
+
+        CpuLstmMode mode;
+        if (mode_str == "torch") {
+            mode = CpuLstmMode::TORCH;
+        } else if (mode_str == "fp32") {
+            mode = CpuLstmMode::FP32;
+        } else if (mode_str == "bf16") {
+            mode = CpuLstmMode::BF16;
+        } else if (mode_str == "int8") {
+            mode = CpuLstmMode::INT8;
+        } else {
+            spdlog::warn("Ignoring unrecognised CPU LSTM mode \"{}\"", entry);
+            continue;
+        }
+
+        if (name.empty()) {
+            default_mode = mode;
+        } else if (name == model_name) {
+            model_mode = mode;
+        }
+    }
+    return model_mode.value_or(default_mode.value_or(CpuLstmMode::TORCH));
+}
+
+CpuLstmMode get_cpu_lstm_mode_from_env(const std::string &model_name) {
+    const char *env_cpu_lstm_mode = std::getenv("DORADO_CPU_LSTM_MODE");
+    if (env_cpu_lstm_mode == nullptr) {
+        return CpuLstmMode::TORCH;
+    }
+    return parse_cpu_lstm_mode(env_cpu_lstm_mode, model_name);
+}
+
+void LSTMStackImpl::set_cpu_mode(CpuLstmMode mode) {
+    if (mode == CpuLstmMode::INT8 && !at::fbgemm_is_cpu_supported()) {
+        spdlog::warn("INT8 LSTM isn't supported on this CPU, using FP32");
+        mode = CpuLstmMode::FP32;
+    }
+
+    at::NoGradGuard no_grad;
+    cpu_weights.clear();
+    if (mode != CpuLstmMode::TORCH) {
+        for (auto &rnn : rnns) {
+            const auto &params = rnn->named_parameters();
+            const auto w_ih = params["weight_ih_l0"].to(torch::kFloat32);
+            const auto w_hh = params["weight_hh_l0"].to(torch::kFloat32);
+
+            CpuLayerWeights weights;
+            weights.bias = (params["bias_ih_l0"] + params["bias_hh_l0"]).to(torch::kFloat32);
+            if (mode == CpuLstmMode::INT8) {
+                weights.w_ih_int8 = quantize_int8_weight(w_ih);
+                weights.w_hh_int8 = quantize_int8_weight(w_hh);
+                weights.zero_bias = torch::zeros_like(weights.bias);
+            } else if (mode == CpuLstmMode::BF16) {
+                weights.w_ih = w_ih.to(torch::kBFloat16).t().contiguous();
+                weights.w_hh = w_hh.to(torch::kBFloat16).t().contiguous();
+            } else {
+                // Views of the LSTM parameters, so FP32 mode doesn't hold a second copy.  GEMM
+                // handles the transposed layout without copying.
+                weights.w_ih = w_ih.t();
+                weights.w_hh = w_hh.t();
+            }
+            cpu_weights.push_back(std::move(weights));
+        }
+    }
+    cpu_mode = mode;
+}
+
+at::Tensor LSTMStackImpl::forward_cpu(at::Tensor x) {
+    utils::ScopedProfileRange spr("lstm_cpu", 2);
+    // Input is [N, T, C], contiguity optional
+    const int64_t N = x.size(0);
+    const int64_t T = x.size(1);
+    const int64_t C = layer_size;
+    const auto dtype = x.scalar_type();
+    x = x.to(torch::kFloat32).contiguous();
+
+    const bool bf16 = cpu_mode == CpuLstmMode::BF16;
+    const bool int8 = cpu_mode == CpuLstmMode::INT8;
+    const auto options = x.options();
+    const int64_t grain_size = std::max<int64_t>(1, at::internal::GRAIN_SIZE / (4 * C));
+
+    // The first layer runs backwards in time and the direction alternates from there, which is
+    // what forward() does by flipping the input to each layer.  Here the outputs are written in
+    // time order instead, so there's nothing to flip back.
+    bool reverse = true;
+    for (const auto &weights : cpu_weights) {
+        const auto x_2D = x.view({N * T, C});
+        at::Tensor gates_x;
+        if (int8) {
+            gates_x = int8_linear(x_2D, weights.w_ih_int8, weights.bias);
+        } else if (bf16) {
+            gates_x = torch::matmul(x_2D.to(torch::kBFloat16), weights.w_ih)
+                              .to(torch::kFloat32)
+                              .add_(weights.bias);
+        } else {
+            gates_x = torch::addmm(weights.bias, x_2D, weights.w_ih);
+        }
+        gates_x = gates_x.view({N, T, 4 * C}).contiguous();
+
+        auto out = torch::empty({N, T, C}, options);
+        auto hidden = torch::zeros({N, C}, options);
+        auto cell = torch::zeros({N, C}, options);
+        auto gates_h = torch::zeros({N, 4 * C}, bf16 ? options.dtype(torch::kBFloat16) : options);
+        at::Tensor hidden_bf16;
+        if (bf16) {
+            hidden_bf16 = torch::empty({N, C}, options.dtype(torch::kBFloat16));
+        }
+
+        for (int64_t step = 0; step < T; ++step) {
+            const int64_t t = reverse ? T - 1 - step : step;
+            // The initial hidden state is zero, so there's nothing to add on the first step.
+            if (step > 0) {
+                if (int8) {
+                    gates_h = int8_linear(hidden, weights.w_hh_int8, weights.zero_bias);
+                } else if (bf16) {
+                    hidden_bf16.copy_(hidden);
+                    torch::matmul_out(gates_h, hidden_bf16, weights.w_hh);
+                } else {
+                    torch::matmul_out(gates_h, hidden, weights.w_hh);
+                }
+            }
+
+            const float *gates_x_t = gates_x.data_ptr<float>() + t * 4 * C;
+            float *out_t = out.data_ptr<float>() + t * C;
+            float *cell_ptr = cell.data_ptr<float>();
+            float *hidden_ptr = hidden.data_ptr<float>();
+            at::parallel_for(0, N, grain_size, [&](int64_t begin, int64_t end) {
+                if (bf16) {
+                    lstm_cell_update(gates_x_t, T * 4 * C, gates_h.data_ptr<at::BFloat16>(),
+                                     cell_ptr, hidden_ptr, out_t, T * C, C, begin, end);
+                } else {
+                    lstm_cell_update(gates_x_t, T * 4 * C, gates_h.data_ptr<float>(), cell_ptr,
+                                     hidden_ptr, out_t, T * C, C, begin, end);
+                }
+            });
+        }
+        x = out;
+        reverse = !reverse;
+    }
+
+    // Output is [N, T, C], contiguous
+    return x.to(dtype);
+}
+
 #if DORADO_CUDA_BUILD
 void LSTMStackImpl::reserve_working_memory(WorkingMemory &wm) {
     if (wm.layout == TensorLayout::NTC) {
@@ -753,6 +974,8 @@ void CRFModelImpl::load_state_dict(const std::vector<at::Tensor> &weights) {
     utils::load_state_dict(*this, weights);
 }
 
+void CRFModelImpl::set_cpu_lstm_mode(CpuLstmMode mode) { rnns->set_cpu_mode(mode); }
+
 #if DORADO_CUDA_BUILD
 at::Tensor CRFModelImpl::run_koi(const at::Tensor &in) {
     // Input is [N, C, T] -- TODO: change to [N, T, C] on the input buffer side?
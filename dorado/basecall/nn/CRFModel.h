@@ -4,6 +4,8 @@
 
 #include <torch/nn.h>
 
+#include <cstdint>
+#include <string>
 #include <vector>
 
 namespace dorado::basecall::nn {
@@ -56,9 +58,57 @@ struct LinearCRFImpl : torch::nn::Module {
     torch::nn::Tanh activation{nullptr};
 };
 
+// How the LSTM layers run on CPU.  TORCH uses torch::nn::LSTM.  The others project the inputs for
+// the whole chunk with one matmul per layer, then step through time with one hidden state matmul
+// and a fused gate update per step, holding the weights in FP32, BF16 or dynamically quantised
+// INT8.  INT8 needs FBGEMM, so is x86 only.
+enum class CpuLstmMode { TORCH, FP32, BF16, INT8 };
+
+// Parses the mode for model_name from setting, a comma separated list of modes ("torch", "fp32",
+// "bf16" or "int8") that are either for every model or for one model, given as model_name=mode,
+// e.g. "bf16,dna_r10.4.1_e8.2_5khz_stereo@v1.1=fp32".  A model's own entry takes precedence, and
+// the default is TORCH.
+CpuLstmMode parse_cpu_lstm_mode(const std::string &setting, const std::string &model_name);
+
+// The mode for model_name from DORADO_CPU_LSTM_MODE, as parsed by parse_cpu_lstm_mode().
+CpuLstmMode get_cpu_lstm_mode_from_env(const std::string &model_name);
+
 struct LSTMStackImpl : torch::nn::Module {
     LSTMStackImpl(int num_layers, int size);
     at::Tensor forward(at::Tensor x);
+
+    // Prepares the CPU weights for mode from the current FP32 weights, so must be called after
+    // they are loaded.  The prepared weights are read only, so the stack can still be shared
+    // between threads.  Falls back to FP32 if INT8 isn't supported.
+    // FP32 mode uses the LSTM parameters directly.  BF16 and INT8 keep the FP32 parameters
+    // alongside their own copies (an extra half or quarter of the LSTM weight memory) because
+    // they are what the modes are prepared from, so the mode can be changed again, and they
+    // remain the module's parameters for sharing and for moving to another device.
+    void set_cpu_mode(CpuLstmMode mode);
+    CpuLstmMode get_cpu_mode() const { return cpu_mode; }
+
+    struct CpuInt8Weight {
+        at::Tensor weight;
+        at::Tensor packed;
+        at::Tensor col_offsets;
+        double scale{1};
+        int64_t zero_point{0};
+    };
+
+    // Weights for x @ w, so transposed from torch's layout.  Only those for cpu_mode are set.
+    struct CpuLayerWeights {
+        at::Tensor w_ih;  // FP32 (a view of weight_ih_l0) or BF16, [C, 4C]
+        at::Tensor w_hh;  // FP32 (a view of weight_hh_l0) or BF16, [C, 4C]
+        CpuInt8Weight w_ih_int8;
+        CpuInt8Weight w_hh_int8;
+        at::Tensor bias;       // b_ih + b_hh, FP32
+        at::Tensor zero_bias;  // INT8 only, as FBGEMM needs a bias for the hidden state matmul
+    };
+
+    at::Tensor forward_cpu(at::Tensor x);
+
+    CpuLstmMode cpu_mode{CpuLstmMode::TORCH};
+    std::vector<CpuLayerWeights> cpu_weights;
 #if DORADO_CUDA_BUILD
     void reserve_working_memory(WorkingMemory &wm);
     void run_koi(WorkingMemory &wm);
@@ -97,6 +147,9 @@ struct CRFModelImpl : torch::nn::Module {
     at::Tensor run_koi(const at::Tensor &in);
 #endif
 
+    // See LSTMStackImpl::set_cpu_mode.
+    void set_cpu_lstm_mode(CpuLstmMode mode);
+
     at::Tensor forward(const at::Tensor &x);
     ConvStack convs{nullptr};
     LSTMStack rnns{nullptr};
@@ -7,6 +7,7 @@
 #include "utils/math_utils.h"
 
 #include <ATen/Functions.h>
+#include <ATen/Parallel.h>
 #include <ATen/TensorIndexing.h>
 #include <c10/core/ScalarType.h>
 #include <c10/core/TensorOptions.h>
@@ -87,7 +88,9 @@ struct KoiTensorExt : public KoiTensor {
 
 #endif
 
+#include <algorithm>
 #include <filesystem>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -124,6 +127,130 @@ torch::Tensor scaled_dot_product_attention_naive(const torch::Tensor &q,
     return torch::matmul(weights, v);
 }
 
+namespace {
+
+// windowed_attention_rotary_cpu works through queries in blocks of this many, so that each task
+// multiplies a block of queries by the band of keys they need.
+constexpr int64_t WINDOWED_ATTENTION_BLOCK_SIZE = 64;
+
+// Writes one [D] row of Q or K with the rotary embedding for its time step applied.  As in
+// RotaryEmbeddingImpl::forward, the first and second halves of the row are the "even" and "odd"
+// elements.
+void apply_rotary_embedding(const float *x,
+                            const float *cos_t,
+                            const float *sin_t,
+                            int64_t D,
+                            float *out) {
+    const int64_t half = D / 2;
+    for (int64_t d = 0; d < half; ++d) {
+        out[d] = cos_t[d] * x[d] - sin_t[d] * x[half + d];
+        out[half + d] = sin_t[d] * x[d] + cos_t[d] * x[half + d];
+    }
+}
+
+}  // namespace
+
+at::Tensor windowed_attention_rotary_cpu(const at::Tensor &qkv_,
+                                         const at::Tensor &cos_freqs,
+                                         const at::Tensor &sin_freqs,
+                                         int win_upper,
+                                         int win_lower) {
+    // Input is [N, T, 3, H, D]
+    const auto qkv = qkv_.to(torch::kFloat32).contiguous();
+    const int64_t N = qkv.size(0);
+    const int64_t T = qkv.size(1);
+    const int64_t H = qkv.size(3);
+    const int64_t D = qkv.size(4);
+    const auto cos_buf = cos_freqs.narrow(0, 0, T).to(torch::kFloat32).contiguous();
+    const auto sin_buf = sin_freqs.narrow(0, 0, T).to(torch::kFloat32).contiguous();
+    auto output = at::empty({N, T, H, D}, qkv.options());
+    if (T == 0) {
+        return output;
+    }
+
+    const int64_t upper = std::max(win_upper, 0);
+    const int64_t lower = std::max(win_lower, 0);
+    const int64_t block_size = std::min(T, WINDOWED_ATTENTION_BLOCK_SIZE);
+    const int64_t max_keys = std::min(T, block_size + upper + lower);
+    const int64_t num_blocks = utils::div_round_up(T, block_size);
+    const int64_t t_stride = 3 * H * D;
+    const float scale = 1.f / std::sqrt(static_cast<float>(D));
+
+    const float *qkv_ptr = qkv.data_ptr<float>();
+    const float *cos_ptr = cos_buf.data_ptr<float>();
+    const float *sin_ptr = sin_buf.data_ptr<float>();
+    float *output_ptr = output.data_ptr<float>();
+    const auto options = qkv.options();
+
+    // Each task is one block of queries for one head of one chunk.
+    at::parallel_for(0, N * H * num_blocks, 1, [&](int64_t begin, int64_t end) {
+        auto q_rot = at::empty({block_size, D}, options);
+        auto k_rot = at::empty({max_keys, D}, options);
+        auto scores = at::empty({block_size, max_keys}, options);
+        for (int64_t task = begin; task < end; ++task) {
+            const int64_t block = task % num_blocks;
+            const int64_t h = (task / num_blocks) % H;
+            const int64_t n = task / (num_blocks * H);
+            const int64_t qb = block * block_size;
+            const int64_t qe = std::min(T, qb + block_size);
+            const int64_t kb = std::max<int64_t>(0, qb - upper);
+            const int64_t ke = std::min(T, qe + lower);
+            const int64_t num_q = qe - qb;
+            const int64_t num_k = ke - kb;
+
+            // Q, K and V for time t are at head + t * t_stride, plus H * D for K and 2 * H * D
+            // for V.
+            const float *head = qkv_ptr + n * T * t_stride + h * D;
+            float *q_rot_ptr = q_rot.data_ptr<float>();
+            for (int64_t t = qb; t < qe; ++t) {
+                apply_rotary_embedding(head + t * t_stride, cos_ptr + t * (D / 2),
+                                       sin_ptr + t * (D / 2), D, q_rot_ptr + (t - qb) * D);
+            }
+            float *k_rot_ptr = k_rot.data_ptr<float>();
+            for (int64_t t = kb; t < ke; ++t) {
+                apply_rotary_embedding(head + t * t_stride + H * D, cos_ptr + t * (D / 2),
+                                       sin_ptr + t * (D / 2), D, k_rot_ptr + (t - kb) * D);
+            }
+
+            auto block_scores = scores.narrow(0, 0, num_q).narrow(1, 0, num_k);
+            at::mm_out(block_scores, q_rot.narrow(0, 0, num_q), k_rot.narrow(0, 0, num_k).t());
+
+            // Softmax over the keys in each query's window, with everything else zeroed.
+            float *scores_ptr = scores.data_ptr<float>();
+            for (int64_t i = 0; i < num_q; ++i) {
+                const int64_t t = qb + i;
+                const int64_t jb = std::max<int64_t>(0, t - upper) - kb;
+                const int64_t je = std::min(T, t + lower + 1) - kb;
+                float *row = scores_ptr + i * max_keys;
+                float max_score = -std::numeric_limits<float>::infinity();
+                for (int64_t j = jb; j < je; ++j) {
+                    row[j] *= scale;
+                    max_score = std::max(max_score, row[j]);
+                }
+                float sum = 0.f;
+                for (int64_t j = jb; j < je; ++j) {
+                    row[j] = std::exp(row[j] - max_score);
+                    sum += row[j];
+                }
+                std::fill(row, row + jb, 0.f);
+                for (int64_t j = jb; j < je; ++j) {
+                    row[j] /= sum;
+                }
+                std::fill(row + je, row + num_k, 0.f);
+            }
+
+            const auto v = torch::from_blob(const_cast<float *>(head + kb * t_stride + 2 * H * D),
+                                            {num_k, D}, {t_stride, 1}, options);
+            auto block_output = torch::from_blob(output_ptr + ((n * T + qb) * H + h) * D,
+                                                 {num_q, D}, {H * D, 1}, options);
+            at::mm_out(block_output, block_scores, v);
+        }
+    });
+
+    // Output is [N, T, H, D]
+    return output;
+}
+
 RMSNormImpl::RMSNormImpl(int hidden_size_) : hidden_size(hidden_size_) {
     weight = at::ones({hidden_size});
     register_parameter("weight", weight, false);
@@ -304,6 +431,7 @@ MultiHeadAttentionImpl::MultiHeadAttentionImpl(int d_model_,
 
 at::Tensor MultiHeadAttentionImpl::get_attn_window_mask(const int64_t size) {
     const auto key = MaskKey{size, options.device()};
+    std::lock_guard lock(mask_cache_mutex);
     if (mask_cache.find(key) == mask_cache.end()) {
         mask_cache[key] = build_attn_window_mask(size);
     }
@@ -353,6 +481,21 @@ at::Tensor MultiHeadAttentionImpl::forward(at::Tensor x) {
         // in_feat=512, out_feat=1536 (3*in), nhead=8, head_dim=64=(512/8), dim_ff=2048
         qkv = wqkv(x).view({N, T, 3, nhead, head_dim});
     }
+    if (x.device().is_cpu() && x.scalar_type() == torch::kFloat32 &&
+        utils::get_dev_opt<bool>("use_cpu_windowed_attention", true)) {
+        {
+            utils::ScopedProfileRange spr("ROTE+WA", 3);
+            rotary_emb->assert_forward_dims(qkv);
+            auto buffers = rotary_emb->named_buffers();
+            const auto [win_upper, win_lower] = attn_window;
+            attn_output_ntc =
+                    windowed_attention_rotary_cpu(qkv, buffers["cos_freqs"], buffers["sin_freqs"],
+                                                  win_upper, win_lower)
+                            .view({N, T, C});
+        }
+        utils::ScopedProfileRange spr("OUTP", 3);
+        return out_proj(attn_output_ntc);
+    }
     {
         utils::ScopedProfileRange spr("ROTE", 3);
 #if DORADO_CUDA_BUILD
@@ -745,12 +888,11 @@ LinearScaledCRFImpl::LinearScaledCRFImpl(const tx::CRFEncoderParams &params) {
             "linear", Linear(LinearOptions(m_params.insize, m_params.outsize()).bias(false)));
 };
 
-at::Tensor LinearScaledCRFImpl::forward(const at::Tensor &x) {
-    if (!scale_applied) {
-        linear->weight *= m_params.scale;
-        scale_applied = true;
-    }
-    return linear(x);
+at::Tensor LinearScaledCRFImpl::forward(const at::Tensor &x) { return linear(x); }
+
+void LinearScaledCRFImpl::scale_weights() {
+    torch::NoGradGuard no_grad;
+    linear->weight *= m_params.scale;
 }
 
 TxModelImpl::TxModelImpl(const basecall::CRFModelConfig &config, const at::TensorOptions &options)
@@ -12,6 +12,7 @@
 #include <torch/nn.h>
 
 #include <cstdint>
+#include <mutex>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -25,6 +26,17 @@ torch::Tensor scaled_dot_product_attention_naive(const torch::Tensor &q,
                                                  const torch::Tensor &v,
                                                  const torch::Tensor &mask);
 
+// Attention over the band of keys [t - win_upper, t + win_lower] for each query t, i.e.
+// scaled_dot_product_attention_naive with the mask from build_attn_window_mask, but computing only
+// the band.  qkv is the [N, T, 3, H, D] FP32 output of the QKV projection, and the rotary embedding
+// from cos_freqs and sin_freqs ([>= T, 1, 1, D / 2]) is applied to Q and K on the fly.
+// Output is [N, T, H, D], contiguous.  CPU only.
+at::Tensor windowed_attention_rotary_cpu(const at::Tensor &qkv,
+                                         const at::Tensor &cos_freqs,
+                                         const at::Tensor &sin_freqs,
+                                         int win_upper,
+                                         int win_lower);
+
 struct RMSNormImpl : torch::nn::Module {
     RMSNormImpl(int hidden_size_);
     at::Tensor forward(at::Tensor x);
@@ -96,6 +108,8 @@ struct MultiHeadAttentionImpl : torch::nn::Module {
     const at::TensorOptions options;
     bool wqkv_transposed = false;
 
+    // Guards mask_cache, since CPU runners share the model between threads.
+    std::mutex mask_cache_mutex;
     std::unordered_map<MaskKey, at::Tensor, MaskKeyHash> mask_cache{};
 
     torch::nn::Linear wqkv{nullptr}, out_proj{nullptr};
@@ -153,7 +167,11 @@ struct LinearScaledCRFImpl : torch::nn::Module {
 
     at::Tensor forward(const at::Tensor &x);
 
-    bool scale_applied = false;
+    // Folds the CRF scale into the linear weights.  Called once after the weights are loaded and
+    // converted to their final dtype and device, so that forward() does not modify the module,
+    // which may be shared between runner threads.
+    void scale_weights();
+
     torch::nn::Linear linear{nullptr};
     tx::CRFEncoderParams m_params;
 };
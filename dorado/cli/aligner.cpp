@@ -28,6 +28,7 @@
 #include <memory>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <unordered_set>
 #include <vector>
 
@@ -257,7 +258,8 @@ int aligner(int argc, char* argv[]) {
 
     for (const auto& file_info : all_files) {
         spdlog::info("processing {} -> {}", file_info.input, file_info.output);
-        auto reader = std::make_unique<HtsReader>(file_info.input, std::nullopt);
+        // Decompressing the input costs about as much as compressing the output.
+        auto reader = std::make_unique<HtsReader>(file_info.input, std::nullopt, writer_threads);
         reader->set_client_info(client_info);
         if (file_info.output != "-" &&
             !create_output_folder(std::filesystem::path(file_info.output).parent_path())) {
@@ -283,7 +285,9 @@ int aligner(int argc, char* argv[]) {
                 align_info->bed_file, align_info->minimap_options, aligner_threads);
 
         // Create the Pipeline from our description.
-        std::vector<dorado::stats::StatsReporter> stats_reporters;
+        std::vector<dorado::stats::StatsReporter> stats_reporters{[&reader] {
+            return std::make_tuple(std::string("HtsReader"), reader->sample_stats());
+        }};
         auto pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
         if (pipeline == nullptr) {
             spdlog::error("Failed to create pipeline");
@@ -105,16 +105,15 @@ void set_basecaller_params(const argparse::ArgumentParser& arg,
                                    cli::get_optional_argument<int>("--overlap", arg),
                                    cli::get_optional_argument<int>("--batchsize", arg));
 
-    if (device == "cpu" && model_config.basecaller.batch_size() == 0) {
-        // Force the batch size to 128
-        // TODO: This is tuned for LSTM models - investigate Tx
-        model_config.basecaller.set_batch_size(128);
-    }
+    // Otherwise a batch size of 0 is resolved when the runners are created, which on CPU
+    // benchmarks a few batch sizes.
 #if DORADO_METAL_BUILD
-    else if (device == "metal" && model_config.is_tx_model() &&
-             model_config.basecaller.batch_size() == 0) {
+    if (device == "metal" && model_config.is_tx_model() &&
+        model_config.basecaller.batch_size() == 0) {
         model_config.basecaller.set_batch_size(32);
     }
+#else
+    (void)device;  // unused in other build types
 #endif
 
     model_config.normalise_basecaller_params();
@@ -301,6 +300,7 @@ void setup(const std::vector<std::string>& args,
            bool skip_model_compatibility_check,
            const std::string& dump_stats_file,
            const std::string& dump_stats_filter,
+           const std::string& dump_stats_trace,
            bool run_batchsize_benchmarks,
            bool emit_batchsize_benchmarks,
            const std::string& resume_from_file,
@@ -595,7 +595,8 @@ void setup(const std::vector<std::string>& args,
     stats_callables.push_back(
             [&tracker](const stats::NamedStats& stats) { tracker.update_progress_bar(stats); });
     constexpr auto kStatsPeriod = 100ms;
-    const size_t max_stats_records = static_cast<size_t>(dump_stats_file.empty() ? 0 : 100000);
+    const bool keep_stats_records = !dump_stats_file.empty() || !dump_stats_trace.empty();
+    const size_t max_stats_records = static_cast<size_t>(keep_stats_records ? 100000 : 0);
     auto stats_sampler = std::make_unique<dorado::stats::StatsSampler>(
             kStatsPeriod, stats_reporters, stats_callables, max_stats_records);
 
@@ -633,6 +634,13 @@ void setup(const std::vector<std::string>& args,
                                           ? std::nullopt
                                           : std::optional<std::regex>(dump_stats_filter));
     }
+    if (!dump_stats_trace.empty()) {
+        std::ofstream trace_file(dump_stats_trace);
+        stats_sampler->dump_chrome_trace(trace_file,
+                                         dump_stats_filter.empty()
+                                                 ? std::nullopt
+                                                 : std::optional<std::regex>(dump_stats_filter));
+    }
 }
 
 int basecaller(int argc, char* argv[]) {
@@ -833,7 +841,8 @@ int basecaller(int argc, char* argv[]) {
               parser.visible.get<std::string>("--read-ids"), recursive, *minimap_options,
               parser.hidden.get<bool>("--skip-model-compatibility-check"),
               parser.hidden.get<std::string>("--dump_stats_file"),
-              parser.hidden.get<std::string>("--dump_stats_filter"), run_batchsize_benchmarks,
+              parser.hidden.get<std::string>("--dump_stats_filter"),
+              parser.hidden.get<std::string>("--dump_stats_trace"), run_batchsize_benchmarks,
               parser.hidden.get<bool>("--emit-batchsize-benchmarks"),
               parser.visible.get<std::string>("--resume-from"),
               parser.visible.get<bool>("--estimate-poly-a"), polya_config, model_complex,
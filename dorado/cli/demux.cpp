@@ -22,12 +22,15 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <vector>
 using namespace std::chrono_literals;
 
@@ -228,7 +231,7 @@ int demuxer(int argc, char* argv[]) {
 
     auto read_list = utils::load_read_list(parser.visible.get<std::string>("--read-ids"));
 
-    HtsReader reader(all_files[0].input, read_list);
+    HtsReader reader(all_files[0].input, read_list, demux_writer_threads);
     utils::MergeHeaders hdr_merger(strip_alignment);
     hdr_merger.add_header(reader.header(), all_files[0].input);
 
@@ -256,10 +259,18 @@ int demuxer(int argc, char* argv[]) {
     auto client_info = std::make_shared<DefaultClientInfo>();
     reader.set_client_info(client_info);
 
+    // Split the writer threads between the demuxer's writer threads and the htslib threads that
+    // each output file compresses with.  Every open file gets its own htslib threads, and the
+    // writers finalise files concurrently, so it is the product that needs to fit the budget.
+    const int num_demux_writers = std::max(demux_writer_threads / 2, 1);
+    const int htslib_threads_per_file = std::max(demux_writer_threads / num_demux_writers, 1);
+    spdlog::debug("> demux writers {}, htslib threads per file {}", num_demux_writers,
+                  htslib_threads_per_file);
+
     PipelineDescriptor pipeline_desc;
     auto demux_writer = pipeline_desc.add_node<BarcodeDemuxerNode>(
-            {}, output_dir, demux_writer_threads, parser.visible.get<bool>("--emit-fastq"),
-            std::move(sample_sheet), sort_bam);
+            {}, output_dir, htslib_threads_per_file, parser.visible.get<bool>("--emit-fastq"),
+            std::move(sample_sheet), sort_bam, num_demux_writers);
 
     auto barcoding_info = get_barcoding_info(parser, sample_sheet.get());
     if (barcoding_info) {
@@ -268,8 +279,18 @@ int demuxer(int argc, char* argv[]) {
         pipeline_desc.add_node<BarcodeClassifierNode>({trimmer}, demux_threads);
     }
 
+    // The reader for each file after the first replaces the previous one, under reader_mutex as
+    // the stats sampler reports on whichever reader is current.
+    std::mutex reader_mutex;
+    std::unique_ptr<HtsReader> input_reader;
+
     // Create the Pipeline from our description.
-    std::vector<dorado::stats::StatsReporter> stats_reporters;
+    std::vector<dorado::stats::StatsReporter> stats_reporters{[&reader_mutex, &input_reader,
+                                                               &reader] {
+        std::lock_guard lock(reader_mutex);
+        const auto& current_reader = input_reader ? *input_reader : reader;
+        return std::make_tuple(std::string("HtsReader"), current_reader.sample_stats());
+    }};
     auto pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
     if (pipeline == nullptr) {
         spdlog::error("Failed to create pipeline");
@@ -322,14 +343,19 @@ int demuxer(int argc, char* argv[]) {
 
     // Barcode all the other files passed in
     for (size_t input_idx = 1; input_idx < all_files.size(); input_idx++) {
-        HtsReader input_reader(all_files[input_idx].input, read_list);
-        input_reader.set_client_info(client_info);
+        auto next_reader = std::make_unique<HtsReader>(all_files[input_idx].input, read_list,
+                                                       demux_writer_threads);
+        next_reader->set_client_info(client_info);
         if (!strip_alignment) {
-            input_reader.set_record_mutator([&sq_mapping, input_idx](BamPtr& record) {
+            next_reader->set_record_mutator([&sq_mapping, input_idx](BamPtr& record) {
                 adjust_tid(sq_mapping[input_idx], record);
             });
         }
-        num_reads_in_file = input_reader.read(*pipeline, max_reads);
+        {
+            std::lock_guard lock(reader_mutex);
+            input_reader = std::move(next_reader);
+        }
+        num_reads_in_file = input_reader->read(*pipeline, max_reads);
         spdlog::trace("pushed to pipeline: {}", num_reads_in_file);
         progress_stats.update_reads_per_file_estimate(num_reads_in_file);
     }
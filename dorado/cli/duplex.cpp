@@ -43,6 +43,7 @@
 #include <spdlog/spdlog.h>
 #include <torch/utils.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <exception>
 #include <filesystem>
@@ -452,7 +453,9 @@ int duplex(int argc, char* argv[]) {
 
         const std::string dump_stats_file = parser.hidden.get<std::string>("--dump_stats_file");
         const std::string dump_stats_filter = parser.hidden.get<std::string>("--dump_stats_filter");
-        const size_t max_stats_records = static_cast<size_t>(dump_stats_file.empty() ? 0 : 100000);
+        const std::string dump_stats_trace = parser.hidden.get<std::string>("--dump_stats_trace");
+        const bool keep_stats_records = !dump_stats_file.empty() || !dump_stats_trace.empty();
+        const size_t max_stats_records = static_cast<size_t>(keep_stats_records ? 100000 : 0);
 
         bool recursive_file_loading = parser.visible.get<bool>("--recursive");
 
@@ -691,14 +694,18 @@ int duplex(int argc, char* argv[]) {
             } else
 #endif
             {
-                std::tie(runners, num_devices) =
-                        api::create_basecall_runners({models.model_config, device, 0.9f,
-                                                      api::PipelineType::duplex, 0.f, false, false},
-                                                     num_runners, 0);
-                std::tie(stereo_runners, std::ignore) =
-                        api::create_basecall_runners({models.stereo_model_config, device, 0.5f,
-                                                      api::PipelineType::duplex, 0.f, false, false},
-                                                     num_runners, 0);
+                // The simplex and stereo runners run at the same time, so split the cores
+                // between them rather than tuning each for the whole CPU.
+                const size_t num_threads = std::max(std::thread::hardware_concurrency(), 2u);
+                const size_t num_stereo_threads = num_threads / 2;
+                std::tie(runners, num_devices) = api::create_basecall_runners(
+                        {models.model_config, device, 0.9f, api::PipelineType::duplex, 0.f, false,
+                         false},
+                        num_runners, 0, num_threads - num_stereo_threads);
+                std::tie(stereo_runners, std::ignore) = api::create_basecall_runners(
+                        {models.stereo_model_config, device, 0.5f, api::PipelineType::duplex, 0.f,
+                         false, false},
+                        num_runners, 0, num_stereo_threads);
             }
 
             spdlog::info("> Starting Stereo Duplex pipeline");
@@ -770,6 +777,13 @@ int duplex(int argc, char* argv[]) {
                                               ? std::nullopt
                                               : std::optional<std::regex>(dump_stats_filter));
         }
+        if (!dump_stats_trace.empty()) {
+            std::ofstream trace_file(dump_stats_trace);
+            stats_sampler->dump_chrome_trace(
+                    trace_file, dump_stats_filter.empty()
+                                        ? std::nullopt
+                                        : std::optional<std::regex>(dump_stats_filter));
+        }
     } catch (const std::exception& e) {
         utils::clean_temporary_models(temp_model_paths);
         spdlog::error(e.what());
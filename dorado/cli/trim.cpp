@@ -20,6 +20,7 @@
 #include <optional>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <vector>
 using namespace std::chrono_literals;
 
@@ -108,7 +109,7 @@ int trim(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
-    HtsReader reader(reads[0], read_list);
+    HtsReader reader(reads[0], read_list, trim_writer_threads);
     auto header = SamHdrPtr(sam_hdr_dup(reader.header()));
     cli::add_pg_hdr(header.get(), "trim", args, "cpu");
     // Always remove alignment information from input header
@@ -154,7 +155,9 @@ int trim(int argc, char* argv[]) {
     pipeline_desc.add_node<AdapterDetectorNode>({trimmer}, trim_threads);
 
     // Create the Pipeline from our description.
-    std::vector<dorado::stats::StatsReporter> stats_reporters;
+    std::vector<dorado::stats::StatsReporter> stats_reporters{[&reader] {
+        return std::make_tuple(std::string("HtsReader"), reader.sample_stats());
+    }};
     auto pipeline = Pipeline::create(std::move(pipeline_desc), &stats_reporters);
     if (pipeline == nullptr) {
         spdlog::error("Failed to create pipeline");
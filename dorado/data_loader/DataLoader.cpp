@@ -4,6 +4,7 @@
 #include "read_pipeline/ReadPipeline.h"
 #include "read_pipeline/messages.h"
 #include "utils/PostCondition.h"
+#include "utils/dev_utils.h"
 #include "utils/thread_naming.h"
 #include "utils/time_utils.h"
 #include "utils/types.h"
@@ -18,11 +19,17 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <condition_variable>
 #include <ctime>
+#include <deque>
 #include <filesystem>
+#include <future>
 #include <mutex>
 #include <optional>
 #include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace dorado {
@@ -299,6 +306,204 @@ bool can_process_pod5_row(Pod5ReadRecordBatch_t* batch,
 
 }  // namespace
 
+// Loads the read batches of a pod5 file ahead of the caller on a background thread, submitting
+// the conversion of each batch's rows into SimplexReads to the worker pool as soon as the batch
+// has been loaded.  This keeps the pool busy while the caller waits on, and pushes the reads
+// of, earlier batches.
+// At most max_batches batches, holding at most max_signal_bytes of signal between them, are in
+// flight at once, although there is always room for one batch however large it is.
+class Pod5BatchPrefetcher {
+public:
+    struct Batch {
+        Pod5ReadRecordBatch_t* batch{nullptr};
+        std::vector<std::future<SimplexReadPtr>> reads;
+        size_t signal_bytes{0};
+    };
+
+    // Returns the rows of the batch with the given index to convert, or std::nullopt if no
+    // more batches should be loaded.  Only called from the prefetch thread.
+    using RowSelector = std::function<std::optional<std::vector<uint32_t>>(
+            size_t batch_index,
+            Pod5ReadRecordBatch_t* batch)>;
+    using RowConverter = std::function<SimplexReadPtr(uint32_t row, Pod5ReadRecordBatch_t* batch)>;
+
+    Pod5BatchPrefetcher(Pod5FileReader_t* file,
+                        size_t batch_count,
+                        cxxpool::thread_pool& pool,
+                        RowSelector select_rows,
+                        RowConverter convert_row,
+                        size_t max_batches,
+                        size_t max_signal_bytes)
+            : m_file(file),
+              m_batch_count(batch_count),
+              m_pool(pool),
+              m_select_rows(std::move(select_rows)),
+              m_convert_row(std::move(convert_row)),
+              m_max_batches(std::max(max_batches, size_t{1})),
+              m_max_signal_bytes(max_signal_bytes) {
+        m_prefetch_thread = std::thread([this] { prefetch_thread_fn(); });
+    }
+
+    ~Pod5BatchPrefetcher() {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_space_cv.notify_all();
+        m_prefetch_thread.join();
+        // Batches can't be freed until the pool has finished with them.  Batches handed out by
+        // next() have already waited for their reads, as the handles can't outlive us.
+        for (auto& batch : m_ready_batches) {
+            wait_and_free_batch(batch);
+        }
+    }
+
+    Pod5BatchPrefetcher(const Pod5BatchPrefetcher&) = delete;
+    Pod5BatchPrefetcher& operator=(const Pod5BatchPrefetcher&) = delete;
+
+    // A batch handed out by next().  When it goes out of scope, it waits for any of its reads
+    // still being converted and then gives the batch back, so the batch isn't leaked and no
+    // conversion is left using it if the caller stops early, e.g. because a conversion threw.
+    class BatchHandle {
+    public:
+        BatchHandle(Pod5BatchPrefetcher& prefetcher, Batch batch)
+                : m_prefetcher(&prefetcher), m_batch(std::move(batch)) {}
+        BatchHandle(BatchHandle&& other) noexcept
+                : m_prefetcher(std::exchange(other.m_prefetcher, nullptr)),
+                  m_batch(std::move(other.m_batch)) {}
+        BatchHandle(const BatchHandle&) = delete;
+        BatchHandle& operator=(const BatchHandle&) = delete;
+        BatchHandle& operator=(BatchHandle&&) = delete;
+        ~BatchHandle() {
+            if (m_prefetcher) {
+                m_prefetcher->release(m_batch);
+            }
+        }
+
+        std::vector<std::future<SimplexReadPtr>>& reads() { return m_batch.reads; }
+
+    private:
+        Pod5BatchPrefetcher* m_prefetcher;
+        Batch m_batch;
+    };
+
+    // Blocks until the next batch has been loaded, returning std::nullopt once there are no
+    // more batches.
+    std::optional<BatchHandle> next() {
+        std::unique_lock lock(m_mutex);
+        m_ready_cv.wait(lock, [this] { return !m_ready_batches.empty() || m_done; });
+        if (m_ready_batches.empty()) {
+            return std::nullopt;
+        }
+        auto batch = std::move(m_ready_batches.front());
+        m_ready_batches.pop_front();
+        return BatchHandle(*this, std::move(batch));
+    }
+
+private:
+    void release(Batch& batch) {
+        wait_and_free_batch(batch);
+        {
+            std::lock_guard lock(m_mutex);
+            --m_num_batches_in_flight;
+            m_signal_bytes_in_flight -= batch.signal_bytes;
+        }
+        m_space_cv.notify_one();
+    }
+
+    void prefetch_thread_fn() {
+        utils::set_thread_name("pod5_prefetch");
+        for (size_t batch_index = 0; batch_index < m_batch_count; ++batch_index) {
+            {
+                std::unique_lock lock(m_mutex);
+                m_space_cv.wait(lock, [this] {
+                    return m_stop || m_num_batches_in_flight == 0 ||
+                           (m_num_batches_in_flight < m_max_batches &&
+                            m_signal_bytes_in_flight < m_max_signal_bytes);
+                });
+                if (m_stop) {
+                    break;
+                }
+            }
+
+            Batch batch;
+            if (pod5_get_read_batch(&batch.batch, m_file, batch_index) != POD5_OK) {
+                spdlog::error("Failed to get batch: {}", pod5_get_error_string());
+                continue;
+            }
+
+            auto rows = m_select_rows(batch_index, batch.batch);
+            if (!rows) {
+                free_batch(batch);
+                break;
+            }
+
+            for (auto row : *rows) {
+                uint16_t read_table_version = 0;
+                ReadBatchRowInfo_t read_data;
+                if (pod5_get_read_batch_row_info_data(batch.batch, row, READ_BATCH_ROW_INFO_VERSION,
+                                                      &read_data,
+                                                      &read_table_version) == POD5_OK) {
+                    batch.signal_bytes += read_data.num_samples * sizeof(int16_t);
+                }
+                batch.reads.push_back(m_pool.push(m_convert_row, row, batch.batch));
+            }
+
+            {
+                std::lock_guard lock(m_mutex);
+                ++m_num_batches_in_flight;
+                m_signal_bytes_in_flight += batch.signal_bytes;
+                m_ready_batches.push_back(std::move(batch));
+            }
+            m_ready_cv.notify_one();
+        }
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_done = true;
+        }
+        m_ready_cv.notify_one();
+    }
+
+    static void wait_and_free_batch(Batch& batch) {
+        // Reads that have been taken with get() are no longer valid, and are already done.
+        for (auto& read : batch.reads) {
+            if (read.valid()) {
+                read.wait();
+            }
+        }
+        free_batch(batch);
+    }
+
+    static void free_batch(Batch& batch) {
+        if (batch.batch && pod5_free_read_batch(batch.batch) != POD5_OK) {
+            spdlog::error("Failed to release batch");
+        }
+        batch.batch = nullptr;
+    }
+
+    Pod5FileReader_t* const m_file;
+    const size_t m_batch_count;
+    cxxpool::thread_pool& m_pool;
+    const RowSelector m_select_rows;
+    const RowConverter m_convert_row;
+    const size_t m_max_batches;
+    const size_t m_max_signal_bytes;
+
+    std::mutex m_mutex;
+    // Signalled when a batch has been loaded, or there are no more batches to load.
+    std::condition_variable m_ready_cv;
+    // Signalled when a batch has been released, or we are asked to stop.
+    std::condition_variable m_space_cv;
+    std::deque<Batch> m_ready_batches;
+    size_t m_num_batches_in_flight{0};
+    size_t m_signal_bytes_in_flight{0};
+    bool m_done{false};
+    bool m_stop{false};
+
+    std::thread m_prefetch_thread;
+};
+
 void Pod5Destructor::operator()(Pod5FileReader_t* pod5) { pod5_close_and_free_reader(pod5); }
 
 void DataLoader::load_reads(const std::filesystem::path& path,
@@ -875,42 +1080,39 @@ void DataLoader::load_pod5_reads_from_file_by_read_ids(const std::string& path,
     // Create static threadpool so it is reused across calls to this function.
     static cxxpool::thread_pool pool{m_num_worker_threads};
 
-    uint32_t row_offset = 0;
+    // The rows to load for each batch are laid out batch by batch in traversal_batch_rows.
+    std::vector<std::uint32_t> batch_row_offsets(batch_count + 1, 0);
     for (std::size_t batch_index = 0; batch_index < batch_count; ++batch_index) {
-        if (m_loaded_read_count == m_max_reads) {
-            break;
-        }
-        Pod5ReadRecordBatch_t* batch = nullptr;
-        if (pod5_get_read_batch(&batch, file, batch_index) != POD5_OK) {
-            spdlog::error("Failed to get batch: {}", pod5_get_error_string());
-            continue;
-        }
-
-        std::vector<std::future<SimplexReadPtr>> futures;
-        for (std::size_t row_idx = 0; row_idx < traversal_batch_counts[batch_index]; row_idx++) {
-            uint32_t row = traversal_batch_rows[row_idx + row_offset];
+        batch_row_offsets[batch_index + 1] =
+                batch_row_offsets[batch_index] + traversal_batch_counts[batch_index];
+    }
 
+    size_t num_scheduled_reads = m_loaded_read_count;
+    auto select_rows = [&](size_t batch_index, Pod5ReadRecordBatch_t* batch)
+            -> std::optional<std::vector<uint32_t>> {
+        if (num_scheduled_reads >= m_max_reads) {
+            return std::nullopt;
+        }
+        std::vector<uint32_t> rows;
+        for (auto row_idx = batch_row_offsets[batch_index];
+             row_idx < batch_row_offsets[batch_index + 1] && num_scheduled_reads < m_max_reads;
+             ++row_idx) {
+            uint32_t row = traversal_batch_rows[row_idx];
             if (can_process_pod5_row(batch, row, m_allowed_read_ids, m_ignored_read_ids)) {
-                futures.push_back(pool.push(process_pod5_thread_fn, row, batch, file,
-                                            std::cref(path), std::cref(m_reads_by_channel),
-                                            std::cref(m_read_id_to_index)));
+                rows.push_back(row);
+                ++num_scheduled_reads;
             }
         }
+        return rows;
+    };
+    auto convert_row = [&](uint32_t row, Pod5ReadRecordBatch_t* batch) {
+        return process_pod5_thread_fn(row, batch, file, path, m_reads_by_channel,
+                                      m_read_id_to_index);
+    };
 
-        for (auto& v : futures) {
-            auto read = v.get();
-            initialise_read(read->read_common);
-            check_read(read);
-            m_pipeline.push_message(std::move(read));
-            m_loaded_read_count++;
-        }
-
-        if (pod5_free_read_batch(batch) != POD5_OK) {
-            spdlog::error("Failed to release batch");
-        }
-
-        row_offset += traversal_batch_counts[batch_index];
-    }
+    Pod5BatchPrefetcher prefetcher(file, batch_count, pool, select_rows, convert_row,
+                                   m_pod5_prefetch_batches, m_pod5_prefetch_signal_bytes);
+    push_prefetched_pod5_reads(prefetcher);
 }
 
 void DataLoader::load_pod5_reads_from_file(const std::string& path) {
@@ -921,8 +1123,17 @@ void DataLoader::load_pod5_reads_from_file(const std::string& path) {
 
     if (!file) {
         spdlog::error("Failed to open file {}: {}", path, pod5_get_error_string());
+        return;
     }
 
+    auto free_pod5 = [&]() {
+        if (pod5_close_and_free_reader(file) != POD5_OK) {
+            spdlog::error("Failed to close and free POD5 reader");
+        }
+    };
+
+    auto post = utils::PostCondition(free_pod5);
+
     std::size_t batch_count = 0;
     if (pod5_get_read_batch_count(&batch_count, file) != POD5_OK) {
         spdlog::error("Failed to query batch count: {}", pod5_get_error_string());
@@ -930,47 +1141,57 @@ void DataLoader::load_pod5_reads_from_file(const std::string& path) {
 
     cxxpool::thread_pool pool{m_num_worker_threads};
 
-    for (std::size_t batch_index = 0; batch_index < batch_count; ++batch_index) {
-        if (m_loaded_read_count == m_max_reads) {
-            break;
-        }
-        Pod5ReadRecordBatch_t* batch = nullptr;
-        if (pod5_get_read_batch(&batch, file, batch_index) != POD5_OK) {
-            spdlog::error("Failed to get batch: {}", pod5_get_error_string());
+    size_t num_scheduled_reads = m_loaded_read_count;
+    auto select_rows = [&](size_t, Pod5ReadRecordBatch_t* batch)
+            -> std::optional<std::vector<uint32_t>> {
+        if (num_scheduled_reads >= m_max_reads) {
+            return std::nullopt;
         }
 
         std::size_t batch_row_count = 0;
         if (pod5_get_read_batch_row_count(&batch_row_count, batch) != POD5_OK) {
             spdlog::error("Failed to get batch row count");
         }
-        batch_row_count = std::min(batch_row_count, m_max_reads - m_loaded_read_count);
-
-        std::vector<std::future<SimplexReadPtr>> futures;
-
-        for (std::size_t row = 0; row < batch_row_count; ++row) {
-            // TODO - check the read ID here, for each one, only send the row if it is in the list of ones we care about
 
+        std::vector<uint32_t> rows;
+        for (std::size_t row = 0; row < batch_row_count && num_scheduled_reads < m_max_reads;
+             ++row) {
             if (can_process_pod5_row(batch, int(row), m_allowed_read_ids, m_ignored_read_ids)) {
-                futures.push_back(pool.push(process_pod5_thread_fn, row, batch, file,
-                                            std::cref(path), std::cref(m_reads_by_channel),
-                                            std::cref(m_read_id_to_index)));
+                rows.push_back(uint32_t(row));
+                ++num_scheduled_reads;
             }
         }
+        return rows;
+    };
+    auto convert_row = [&](uint32_t row, Pod5ReadRecordBatch_t* batch) {
+        return process_pod5_thread_fn(row, batch, file, path, m_reads_by_channel,
+                                      m_read_id_to_index);
+    };
 
-        for (auto& v : futures) {
+    Pod5BatchPrefetcher prefetcher(file, batch_count, pool, select_rows, convert_row,
+                                   m_pod5_prefetch_batches, m_pod5_prefetch_signal_bytes);
+    push_prefetched_pod5_reads(prefetcher);
+}
+
+void DataLoader::push_prefetched_pod5_reads(Pod5BatchPrefetcher& prefetcher) {
+    for (;;) {
+        const auto wait_start = std::chrono::steady_clock::now();
+        auto batch = prefetcher.next();
+        m_pod5_batch_wait_us += std::chrono::duration_cast<std::chrono::microseconds>(
+                                        std::chrono::steady_clock::now() - wait_start)
+                                        .count();
+        if (!batch) {
+            break;
+        }
+        ++m_pod5_batches_loaded;
+
+        for (auto& v : batch->reads()) {
             auto read = v.get();
             initialise_read(read->read_common);
             check_read(read);
             m_pipeline.push_message(std::move(read));
             m_loaded_read_count++;
         }
-
-        if (pod5_free_read_batch(batch) != POD5_OK) {
-            spdlog::error("Failed to release batch");
-        }
-    }
-    if (pod5_close_and_free_reader(file) != POD5_OK) {
-        spdlog::error("Failed to close and free POD5 reader");
     }
 }
 
@@ -1105,11 +1326,23 @@ DataLoader::DataLoader(Pipeline& pipeline,
           m_ignored_read_ids(std::move(read_ignore_list)) {
     m_max_reads = max_reads == 0 ? std::numeric_limits<decltype(m_max_reads)>::max() : max_reads;
     assert(m_num_worker_threads > 0);
+    set_pod5_prefetch_limits(
+            utils::get_dev_opt<size_t>("pod5_prefetch_batches", DEFAULT_POD5_PREFETCH_BATCHES),
+            utils::get_dev_opt<size_t>("pod5_prefetch_mb", DEFAULT_POD5_PREFETCH_MB) << 20);
     static std::once_flag vbz_init_flag;
     std::call_once(vbz_init_flag, vbz_register);
 }
 
+void DataLoader::set_pod5_prefetch_limits(size_t max_batches, size_t max_signal_bytes) {
+    m_pod5_prefetch_batches = std::max(max_batches, size_t{1});
+    m_pod5_prefetch_signal_bytes = max_signal_bytes;
+}
+
 stats::NamedStats DataLoader::sample_stats() const {
-    return stats::NamedStats{{"loaded_read_count", static_cast<double>(m_loaded_read_count)}};
+    return stats::NamedStats{
+            {"loaded_read_count", static_cast<double>(m_loaded_read_count)},
+            {"pod5_batches_loaded", static_cast<double>(m_pod5_batches_loaded)},
+            {"pod5_batch_wait_ms", static_cast<double>(m_pod5_batch_wait_us) / 1000.0},
+    };
 }
 }  // namespace dorado
@@ -5,6 +5,7 @@
 #include "utils/types.h"
 
 #include <array>
+#include <atomic>
 #include <filesystem>
 #include <functional>
 #include <map>
@@ -21,6 +22,7 @@ struct Pod5FileReader;
 namespace dorado {
 
 class Pipeline;
+class Pod5BatchPrefetcher;
 class ReadCommon;
 class SimplexRead;
 using SimplexReadPtr = std::unique_ptr<SimplexRead>;
@@ -36,6 +38,9 @@ using Pod5Ptr = std::unique_ptr<Pod5FileReader, Pod5Destructor>;
 
 class DataLoader {
 public:
+    static constexpr size_t DEFAULT_POD5_PREFETCH_BATCHES = 4;
+    static constexpr size_t DEFAULT_POD5_PREFETCH_MB = 1024;
+
     DataLoader(Pipeline& pipeline,
                const std::string& device,
                size_t num_worker_threads,
@@ -87,17 +92,29 @@ public:
         m_read_initialisers.push_back(std::move(func));
     }
 
+    // Limits how far ahead of the pipeline pod5 read batches are loaded: at most max_batches
+    // batches, holding at most max_signal_bytes of signal between them, are loaded and
+    // being converted into reads at once.  A single batch is always allowed, however large.
+    void set_pod5_prefetch_limits(size_t max_batches, size_t max_signal_bytes);
+
 private:
     void load_fast5_reads_from_file(const std::string& path);
     void load_pod5_reads_from_file(const std::string& path);
     void load_pod5_reads_from_file_by_read_ids(const std::string& path,
                                                const std::vector<ReadID>& read_ids);
     void load_read_channels(const std::filesystem::path& data_path, bool recursive_file_loading);
+    // Pushes the reads from each prefetched batch in turn to the pipeline, in row order.
+    void push_prefetched_pod5_reads(Pod5BatchPrefetcher& prefetcher);
 
     void initialise_read(ReadCommon& read) const;
 
     Pipeline& m_pipeline;  // Where should the loaded reads go?
     std::atomic<size_t> m_loaded_read_count{0};
+    // Time spent waiting for the next pod5 batch to be loaded.
+    std::atomic<int64_t> m_pod5_batch_wait_us{0};
+    std::atomic<size_t> m_pod5_batches_loaded{0};
+    size_t m_pod5_prefetch_batches{DEFAULT_POD5_PREFETCH_BATCHES};
+    size_t m_pod5_prefetch_signal_bytes{DEFAULT_POD5_PREFETCH_MB << 20};
     std::string m_device;
     size_t m_num_worker_threads{1};
     size_t m_max_reads{0};
@@ -3,6 +3,7 @@
 #include "barcoding_info.h"
 #include "utils/alignment_utils.h"
 #include "utils/barcode_kits.h"
+#include "utils/dev_utils.h"
 #include "utils/sequence_utils.h"
 #include "utils/types.h"
 
@@ -11,6 +12,11 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -146,6 +152,179 @@ std::tuple<bool, int, float> pick_top_or_bottom(int top_penalty,
     }
 }
 
+// Length of the q-grams used by the barcode prefilter.
+constexpr int QGRAM_LEN = 4;
+constexpr size_t NUM_QGRAMS = size_t{1} << (2 * QGRAM_LEN);
+using QGramCounts = std::array<uint16_t, NUM_QGRAMS>;
+
+// Calls fn(code) for every q-gram in seq that is made up of only ACGT.
+template <typename Fn>
+void for_each_qgram(std::string_view seq, Fn&& fn) {
+    uint32_t code = 0;
+    int num_valid = 0;
+    for (char c : seq) {
+        switch (c) {
+        case 'A':
+        case 'C':
+        case 'G':
+        case 'T':
+            code = ((code << 2) | utils::base_to_int(c)) & (NUM_QGRAMS - 1);
+            num_valid++;
+            break;
+        default:
+            num_valid = 0;
+        }
+        if (num_valid >= QGRAM_LEN) {
+            fn(code);
+        }
+    }
+}
+
+QGramCounts count_qgrams(std::string_view seq) {
+    QGramCounts counts{};
+    for_each_qgram(seq, [&counts](uint32_t code) { counts[code]++; });
+    return counts;
+}
+
+// A barcode along with the q-grams it contains.
+// A single edit destroys at most QGRAM_LEN of the q-grams that a barcode shares with a mask
+// region, so counting the q-grams that aren't shared gives a lower bound on the edit distance
+// between the two, which is much cheaper to compute than the distance itself.
+struct PaddedBarcode {
+    PaddedBarcode(std::string seq) : sequence(std::move(seq)) {
+        const auto counts = count_qgrams(sequence);
+        for (size_t code = 0; code < NUM_QGRAMS; ++code) {
+            if (counts[code] > 0) {
+                qgram_counts.emplace_back(static_cast<uint16_t>(code), counts[code]);
+                num_qgrams += counts[code];
+            }
+        }
+    }
+
+    // Lower bound on the global edit distance between this barcode and a mask region.
+    int penalty_lower_bound(std::string_view mask, const QGramCounts& mask_counts) const {
+        int num_shared = 0;
+        for (const auto& [code, count] : qgram_counts) {
+            num_shared += std::min(count, mask_counts[code]);
+        }
+        const int qgram_bound = (num_qgrams - num_shared + QGRAM_LEN - 1) / QGRAM_LEN;
+        const int length_bound = std::abs(int(sequence.length()) - int(mask.length()));
+        return std::max(qgram_bound, length_bound);
+    }
+
+    std::string sequence;
+    std::vector<std::pair<uint16_t, uint16_t>> qgram_counts;
+    int num_qgrams = 0;
+};
+
+// Decides the order in which barcodes are scored, and skips the ones whose lower bounds show
+// that they can't change the outcome of BarcodeClassifier::find_best_barcode().
+// Once two barcodes have been scored, a barcode is skipped if its penalty can't come within the
+// separation distance of the best penalty so far, so neither the best barcode nor the outcome of
+// the separation checks against the second best can change. The distance that matters depends on
+// whether the best barcode is bound to pass the penalty and flank score checks. For double ended
+// kits neither end may be able to beat the best penalty for that end, since those are checked too.
+class BarcodeScoringQueue {
+public:
+    // |min_flank_score| is the lowest flank score that any of the results can have.
+    BarcodeScoringQueue(bool use_prefilter,
+                        bool double_ends,
+                        float min_flank_score,
+                        const barcode_kits::BarcodeKitScoringParams& params)
+            : m_use_prefilter(use_prefilter),
+              m_double_ends(double_ends),
+              m_flank_scores_acceptable(min_flank_score >= params.min_flank_score),
+              m_max_barcode_penalty(params.max_barcode_penalty),
+              m_min_separation(std::max(
+                      {params.min_barcode_penalty_dist, params.min_separation_only_dist, 1})),
+              m_min_separation_if_acceptable(std::max(
+                      std::min(params.min_barcode_penalty_dist, params.min_separation_only_dist),
+                      1)) {}
+
+    // Adds a barcode with lower bounds on its top and bottom penalties.
+    void add(size_t index, int top_bound, int bottom_bound) {
+        const int penalty_bound = m_double_ends ? std::min(top_bound, bottom_bound) : top_bound;
+        m_entries.push_back({index, top_bound, bottom_bound, penalty_bound});
+    }
+
+    // Returns the next barcode that needs to be scored, or std::nullopt if there are none left.
+    std::optional<size_t> next() {
+        if (m_next_entry == 0 && m_use_prefilter) {
+            std::stable_sort(m_entries.begin(), m_entries.end(), [](const auto& l, const auto& r) {
+                return l.penalty_bound < r.penalty_bound;
+            });
+        }
+        while (m_next_entry < m_entries.size()) {
+            const auto& entry = m_entries[m_next_entry++];
+            if (!m_use_prefilter || !can_skip(entry)) {
+                return entry.index;
+            }
+            m_num_skipped++;
+        }
+        return std::nullopt;
+    }
+
+    // Records the score of the barcode last returned by next().
+    void add_result(BarcodeScoreResult res) {
+        m_best_penalty = std::min(m_best_penalty, res.penalty);
+        m_best_top_penalty = std::min(m_best_top_penalty, res.top_penalty);
+        m_best_bottom_penalty = std::min(m_best_bottom_penalty, res.bottom_penalty);
+        m_results.emplace_back(m_entries[m_next_entry - 1].index, std::move(res));
+    }
+
+    // Returns the scores in the order the barcodes were added.
+    std::vector<BarcodeScoreResult> take_results() {
+        spdlog::trace("Prefilter skipped {} of {} barcodes", m_num_skipped, m_entries.size());
+        std::sort(m_results.begin(), m_results.end(),
+                  [](const auto& l, const auto& r) { return l.first < r.first; });
+        std::vector<BarcodeScoreResult> results;
+        results.reserve(m_results.size());
+        for (auto& [index, res] : m_results) {
+            results.push_back(std::move(res));
+        }
+        return results;
+    }
+
+private:
+    struct Entry {
+        size_t index;
+        int top_bound;
+        int bottom_bound;
+        int penalty_bound;
+    };
+
+    bool can_skip(const Entry& entry) const {
+        if (m_results.size() < 2) {
+            return false;
+        }
+        // The final best penalty can only be lower than the current one.
+        const bool best_is_acceptable =
+                m_best_penalty == 0 ||
+                (m_best_penalty <= m_max_barcode_penalty && m_flank_scores_acceptable);
+        const int min_separation =
+                best_is_acceptable ? m_min_separation_if_acceptable : m_min_separation;
+        if (entry.penalty_bound < m_best_penalty + min_separation) {
+            return false;
+        }
+        return !m_double_ends || (entry.top_bound > m_best_top_penalty &&
+                                  entry.bottom_bound > m_best_bottom_penalty);
+    }
+
+    const bool m_use_prefilter;
+    const bool m_double_ends;
+    const bool m_flank_scores_acceptable;
+    const int m_max_barcode_penalty;
+    const int m_min_separation;
+    const int m_min_separation_if_acceptable;
+    std::vector<Entry> m_entries;
+    size_t m_next_entry = 0;
+    size_t m_num_skipped = 0;
+    std::vector<std::pair<size_t, BarcodeScoreResult>> m_results;
+    int m_best_penalty = INT_MAX;
+    int m_best_top_penalty = INT_MAX;
+    int m_best_bottom_penalty = INT_MAX;
+};
+
 }  // namespace
 
 namespace demux {
@@ -169,6 +348,12 @@ struct BarcodeClassifier::BarcodeCandidateKit {
     std::string bottom_context_rev;
     std::string bottom_context_rev_left_buffer;
     std::string bottom_context_rev_right_buffer;
+    // The barcodes with the flank buffers they are aligned with attached, matching the order
+    // of the barcodes above.
+    std::vector<PaddedBarcode> padded_barcodes1;
+    std::vector<PaddedBarcode> padded_barcodes1_rev;
+    std::vector<PaddedBarcode> padded_barcodes2;
+    std::vector<PaddedBarcode> padded_barcodes2_rev;
     std::vector<std::string> barcode_names;
     // This is the specific barcode kit product name
     // that is selected by the user, such as SQK-RBK114-96
@@ -182,7 +367,8 @@ struct BarcodeClassifier::BarcodeCandidateKit {
 BarcodeClassifier::BarcodeClassifier(KitInfoProvider kit_info_provider)
         : m_kit_info_provider(std::move(kit_info_provider)),
           m_scoring_params(m_kit_info_provider.scoring_params()),
-          m_barcode_candidates(generate_candidates()) {}
+          m_barcode_candidates(generate_candidates()),
+          m_use_prefilter(utils::get_dev_opt<bool>("barcode_prefilter", true)) {}
 
 BarcodeClassifier::~BarcodeClassifier() = default;
 
@@ -289,6 +475,11 @@ std::vector<BarcodeClassifier::BarcodeCandidateKit> BarcodeClassifier::generate_
                         " is different.");
             }
 
+            candidate.padded_barcodes1.emplace_back(candidate.top_context_left_buffer + barcode1 +
+                                                    candidate.top_context_right_buffer);
+            candidate.padded_barcodes1_rev.emplace_back(candidate.top_context_rev_left_buffer +
+                                                        barcode1_rev +
+                                                        candidate.top_context_rev_right_buffer);
             candidate.barcodes1.push_back(barcode1);
             candidate.barcodes1_rev.push_back(std::move(barcode1_rev));
 
@@ -304,6 +495,12 @@ std::vector<BarcodeClassifier::BarcodeCandidateKit> BarcodeClassifier::generate_
                             bc2_name + " is different.");
                 }
 
+                candidate.padded_barcodes2.emplace_back(candidate.bottom_context_left_buffer +
+                                                        barcode2 +
+                                                        candidate.bottom_context_right_buffer);
+                candidate.padded_barcodes2_rev.emplace_back(
+                        candidate.bottom_context_rev_left_buffer + barcode2_rev +
+                        candidate.bottom_context_rev_right_buffer);
                 candidate.barcodes2.push_back(barcode2);
                 candidate.barcodes2_rev.push_back(std::move(barcode2_rev));
             }
@@ -408,25 +605,36 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score_diffe
     spdlog::trace("total v1 edit dist {}, total v2 edit dis {}", total_v1_penalty,
                   total_v2_penalty);
 
-    std::vector<BarcodeScoreResult> results;
+    // Bound the penalties of each permitted barcode using the q-grams of the masks.
+    const auto top_mask_v1_qgrams = count_qgrams(top_mask_v1);
+    const auto bottom_mask_v1_qgrams = count_qgrams(bottom_mask_v1);
+    const auto top_mask_v2_qgrams = count_qgrams(top_mask_v2);
+    const auto bottom_mask_v2_qgrams = count_qgrams(bottom_mask_v2);
+    const float min_flank_score = std::min({top_flank_score_v1, bottom_flank_score_v1,
+                                            top_flank_score_v2, bottom_flank_score_v2});
+    BarcodeScoringQueue queue(m_use_prefilter, true, min_flank_score, m_scoring_params);
     for (size_t i = 0; i < candidate.barcodes1.size(); i++) {
-        const auto barcode1 = std::string(top_context_v1_left_buffer)
-                                      .append(candidate.barcodes1[i])
-                                      .append(top_context_v1_right_buffer);
-        const auto barcode1_rev = std::string(bottom_context_v2_left_buffer)
-                                          .append(candidate.barcodes1_rev[i])
-                                          .append(bottom_context_v2_right_buffer);
-        const auto barcode2 = std::string(top_context_v2_left_buffer)
-                                      .append(candidate.barcodes2[i])
-                                      .append(top_context_v2_right_buffer);
-        const auto barcode2_rev = std::string(bottom_context_v1_left_buffer)
-                                          .append(candidate.barcodes2_rev[i])
-                                          .append(bottom_context_v1_right_buffer);
-        auto& barcode_name = candidate.barcode_names[i];
-
-        if (!barcode_is_permitted(allowed_barcodes, barcode_name)) {
+        if (!barcode_is_permitted(allowed_barcodes, candidate.barcode_names[i])) {
             continue;
         }
+        const int top_bound = std::min(candidate.padded_barcodes1[i].penalty_lower_bound(
+                                               top_mask_v1, top_mask_v1_qgrams),
+                                       candidate.padded_barcodes2[i].penalty_lower_bound(
+                                               top_mask_v2, top_mask_v2_qgrams));
+        const int bottom_bound = std::min(candidate.padded_barcodes2_rev[i].penalty_lower_bound(
+                                                  bottom_mask_v1, bottom_mask_v1_qgrams),
+                                          candidate.padded_barcodes1_rev[i].penalty_lower_bound(
+                                                  bottom_mask_v2, bottom_mask_v2_qgrams));
+        queue.add(i, top_bound, bottom_bound);
+    }
+
+    while (const auto next = queue.next()) {
+        const size_t i = *next;
+        const auto& barcode1 = candidate.padded_barcodes1[i].sequence;
+        const auto& barcode1_rev = candidate.padded_barcodes1_rev[i].sequence;
+        const auto& barcode2 = candidate.padded_barcodes2[i].sequence;
+        const auto& barcode2_rev = candidate.padded_barcodes2_rev[i].sequence;
+        auto& barcode_name = candidate.barcode_names[i];
 
         spdlog::trace("Checking barcode {}", barcode_name);
 
@@ -493,13 +701,13 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score_diffe
         res.kit = candidate.kit;
         res.barcode_kit = candidate.barcode_kit;
 
-        results.push_back(res);
+        queue.add_result(std::move(res));
     }
     edlibFreeAlignResult(top_result_v1);
     edlibFreeAlignResult(bottom_result_v1);
     edlibFreeAlignResult(top_result_v2);
     edlibFreeAlignResult(bottom_result_v2);
-    return results;
+    return queue.take_results();
 }
 
 float BarcodeClassifier::find_midstrand_barcode_different_double_ends(
@@ -610,19 +818,26 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score_doubl
     std::string_view bottom_mask =
             read_bottom.substr(bottom_start_idx, bottom_end_idx - bottom_start_idx);
 
-    std::vector<BarcodeScoreResult> results;
+    // Bound the penalties of each permitted barcode using the q-grams of the masks.
+    const auto top_mask_qgrams = count_qgrams(top_mask);
+    const auto bottom_mask_qgrams = count_qgrams(bottom_mask);
+    BarcodeScoringQueue queue(m_use_prefilter, true,
+                              std::min(top_flank_score, bottom_flank_score), m_scoring_params);
     for (size_t i = 0; i < candidate.barcodes1.size(); i++) {
-        auto barcode = std::string(top_left_buffer)
-                               .append(candidate.barcodes1[i])
-                               .append(top_right_buffer);
-        auto barcode_rev = std::string(bottom_left_buffer)
-                                   .append(candidate.barcodes1_rev[i])
-                                   .append(bottom_right_buffer);
-        auto& barcode_name = candidate.barcode_names[i];
-
-        if (!barcode_is_permitted(allowed_barcodes, barcode_name)) {
+        if (!barcode_is_permitted(allowed_barcodes, candidate.barcode_names[i])) {
             continue;
         }
+        queue.add(i,
+                  candidate.padded_barcodes1[i].penalty_lower_bound(top_mask, top_mask_qgrams),
+                  candidate.padded_barcodes1_rev[i].penalty_lower_bound(bottom_mask,
+                                                                        bottom_mask_qgrams));
+    }
+
+    while (const auto next = queue.next()) {
+        const size_t i = *next;
+        const auto& barcode = candidate.padded_barcodes1[i].sequence;
+        const auto& barcode_rev = candidate.padded_barcodes1_rev[i].sequence;
+        auto& barcode_name = candidate.barcode_names[i];
         spdlog::trace("Checking barcode {}", barcode_name);
 
         auto top_mask_penalty =
@@ -649,11 +864,11 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score_doubl
         res.bottom_barcode_pos = {bottom_start + bottom_result.startLocations[0],
                                   bottom_start + bottom_result.endLocations[0]};
 
-        results.push_back(res);
+        queue.add_result(std::move(res));
     }
     edlibFreeAlignResult(top_result);
     edlibFreeAlignResult(bottom_result);
-    return results;
+    return queue.take_results();
 }
 
 float BarcodeClassifier::find_midstrand_barcode_double_ends(
@@ -735,15 +950,22 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score(
 
     spdlog::trace("BC location {}", top_bc_loc);
 
-    std::vector<BarcodeScoreResult> results;
+    // Bound the penalty of each permitted barcode using the q-grams of the mask.
+    const auto top_mask_qgrams = count_qgrams(top_mask);
+    BarcodeScoringQueue queue(m_use_prefilter, false, top_flank_score, m_scoring_params);
     for (size_t i = 0; i < candidate.barcodes1.size(); i++) {
-        const auto barcode = candidate.top_context_left_buffer + candidate.barcodes1[i] +
-                             candidate.top_context_right_buffer;
-        auto& barcode_name = candidate.barcode_names[i];
-
-        if (!barcode_is_permitted(allowed_barcodes, barcode_name)) {
+        if (!barcode_is_permitted(allowed_barcodes, candidate.barcode_names[i])) {
             continue;
         }
+        const int bound =
+                candidate.padded_barcodes1[i].penalty_lower_bound(top_mask, top_mask_qgrams);
+        queue.add(i, bound, bound);
+    }
+
+    while (const auto next = queue.next()) {
+        const size_t i = *next;
+        const auto& barcode = candidate.padded_barcodes1[i].sequence;
+        auto& barcode_name = candidate.barcode_names[i];
         spdlog::trace("Checking barcode {}", barcode_name);
 
         auto top_mask_penalty =
@@ -776,10 +998,10 @@ std::vector<BarcodeScoreResult> BarcodeClassifier::calculate_barcode_score(
             res.barcode_score = res.top_barcode_score;
             res.top_barcode_pos = {top_result.startLocations[0], top_result.endLocations[0]};
         }
-        results.push_back(res);
+        queue.add_result(std::move(res));
     }
     edlibFreeAlignResult(top_result);
-    return results;
+    return queue.take_results();
 }
 
 float BarcodeClassifier::find_midstrand_barcode_single_end(std::string_view read_seq,
@@ -906,9 +1128,10 @@ BarcodeScoreResult BarcodeClassifier::find_best_barcode(
         }
     }
 
-    // Sort the scores windows by their barcode score.
-    std::sort(results.begin(), results.end(),
-              [](const auto& l, const auto& r) { return l.penalty < r.penalty; });
+    // Sort the scores windows by their barcode score. Ties keep barcode order so that the best
+    // result doesn't depend on which barcodes the prefilter skipped.
+    std::stable_sort(results.begin(), results.end(),
+                     [](const auto& l, const auto& r) { return l.penalty < r.penalty; });
 
     std::stringstream d;
     for (auto& s : results) {
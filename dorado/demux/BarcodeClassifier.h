@@ -37,6 +37,8 @@ private:
     const KitInfoProvider m_kit_info_provider;
     const barcode_kits::BarcodeKitScoringParams m_scoring_params;
     const std::vector<BarcodeCandidateKit> m_barcode_candidates;
+    // Whether to skip scoring barcodes that q-gram bounds show can't be the best match.
+    const bool m_use_prefilter;
 
     std::vector<BarcodeCandidateKit> generate_candidates();
     float find_midstrand_barcode_different_double_ends(std::string_view read_seq,
@@ -4,40 +4,67 @@
 
 #include <nvtx3/nvtx3.hpp>
 
-#include <iterator>
-#include <regex>
+#include <stdexcept>
 #include <unordered_map>
 
 namespace {
-const std::unordered_map<char, std::string> IUPAC_CODES =
-        {
-                // clang-format off
-        {'A', "A"},
-        {'C', "C"},
-        {'G', "G"},
-        {'T', "T"},
-        {'U', "T"},  // basecalls will have "T"s instead of "U"s
-        {'R', "[AG]"},
-        {'Y', "[CT]"}, 
-        {'S', "[GC]"}, 
-        {'W', "[AT]"},
-        {'K', "[GT]"}, 
-        {'M', "[AC]"}, 
-        {'B', "[CGT]"},
-        {'D', "[AGT]"},
-        {'H', "[ACT]"},
-        {'V', "[ACG]"},
-        {'N', "[ACGT]"},
-                // clang-format on
+
+constexpr uint8_t A = 1 << 0;
+constexpr uint8_t C = 1 << 1;
+constexpr uint8_t G = 1 << 2;
+constexpr uint8_t T = 1 << 3;
+constexpr size_t NUM_BASES = 4;
+
+const std::unordered_map<char, uint8_t> IUPAC_CODES = {
+        // clang-format off
+        {'A', A},
+        {'C', C},
+        {'G', G},
+        {'T', T},
+        {'U', T},  // basecalls will have "T"s instead of "U"s
+        {'R', A | G},
+        {'Y', C | T},
+        {'S', G | C},
+        {'W', A | T},
+        {'K', G | T},
+        {'M', A | C},
+        {'B', C | G | T},
+        {'D', A | G | T},
+        {'H', A | C | T},
+        {'V', A | C | G},
+        {'N', A | C | G | T},
+        // clang-format on
 };
 
-std::string expand_motif_regex(const std::string& motif) {
-    std::string motif_regex = "(";
-    for (auto base : motif) {
-        motif_regex += IUPAC_CODES.at(base);
+// Maps sequence characters to their index in ACGT, or NUM_BASES for anything else.
+// Only uppercase bases match, and an 'N' in the sequence doesn't match any motif.
+constexpr std::array<uint8_t, 256> make_base_index() {
+    std::array<uint8_t, 256> base_index{};
+    for (auto& index : base_index) {
+        index = NUM_BASES;
+    }
+    base_index['A'] = 0;
+    base_index['C'] = 1;
+    base_index['G'] = 2;
+    base_index['T'] = 3;
+    return base_index;
+}
+constexpr auto BASE_INDEX = make_base_index();
+
+size_t base_index(char base) { return BASE_INDEX[static_cast<unsigned char>(base)]; }
+
+std::vector<uint8_t> expand_motif(const std::string& motif) {
+    std::vector<uint8_t> allowed_bases;
+    allowed_bases.reserve(motif.size());
+    for (auto code : motif) {
+        auto it = IUPAC_CODES.find(code);
+        if (it == IUPAC_CODES.end()) {
+            throw std::runtime_error("Invalid IUPAC code '" + std::string(1, code) +
+                                     "' in motif " + motif);
+        }
+        allowed_bases.push_back(it->second);
     }
-    motif_regex += ")";
-    return motif_regex;
+    return allowed_bases;
 }
 
 }  // namespace
@@ -48,23 +75,51 @@ MotifMatcher::MotifMatcher(const ModBaseModelConfig& model_config)
         : MotifMatcher(model_config.mods.motif, model_config.mods.motif_offset) {}
 
 MotifMatcher::MotifMatcher(const std::string& motif, size_t offset)
-        : m_motif(expand_motif_regex(motif)), m_motif_offset(offset) {}
+        : m_motif(expand_motif(motif)), m_motif_offset(offset) {
+    if (m_motif.size() <= 64) {
+        for (size_t pos = 0; pos < m_motif.size(); ++pos) {
+            for (size_t base = 0; base < NUM_BASES; ++base) {
+                if (m_motif[pos] & (1 << base)) {
+                    m_base_masks[base] |= uint64_t{1} << pos;
+                }
+            }
+        }
+    }
+}
 
 std::vector<size_t> MotifMatcher::get_motif_hits(std::string_view seq) const {
     NVTX3_FUNC_RANGE();
     std::vector<size_t> context_hits;
 
-    std::regex regex(m_motif);
-    auto start = std::cbegin(seq);
-    auto end = std::cend(seq);
-    auto pos = start;
-    // string_view on linux uses `const_iterator=const char*`,
-    // but on Windows it's a `std::_String_view_iterator<_Traits>`
-    std::match_results<decltype(pos)> motif_match;
-    while (std::regex_search(pos, end, motif_match, regex)) {
-        auto hit = std::distance(start, pos) + motif_match.position(0) + m_motif_offset;
-        context_hits.push_back(hit);
-        pos += motif_match.position(0) + 1;
+    const size_t motif_len = m_motif.size();
+    if (motif_len == 0 || seq.size() < motif_len) {
+        return context_hits;
+    }
+
+    if (motif_len <= 64) {
+        // Bit i of state is set if the motif's first i + 1 bases match the sequence ending
+        // at the current position.
+        const uint64_t match_bit = uint64_t{1} << (motif_len - 1);
+        uint64_t state = 0;
+        for (size_t i = 0; i < seq.size(); ++i) {
+            state = ((state << 1) | 1) & m_base_masks[base_index(seq[i])];
+            if (state & match_bit) {
+                context_hits.push_back(i + 1 - motif_len + m_motif_offset);
+            }
+        }
+        return context_hits;
+    }
+
+    // Too long for a single word of state, so check each position directly.
+    for (size_t start = 0; start + motif_len <= seq.size(); ++start) {
+        bool match = true;
+        for (size_t pos = 0; pos < motif_len && match; ++pos) {
+            const auto base = base_index(seq[start + pos]);
+            match = base < NUM_BASES && (m_motif[pos] & (1 << base));
+        }
+        if (match) {
+            context_hits.push_back(start + m_motif_offset);
+        }
     }
     return context_hits;
 }
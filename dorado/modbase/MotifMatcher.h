@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -15,8 +17,13 @@ public:
     std::vector<size_t> get_motif_hits(std::string_view seq) const;
 
 private:
-    const std::string m_motif;
+    // The bases allowed at each position of the motif, as a bitmask over ACGT.
+    const std::vector<uint8_t> m_motif;
     const size_t m_motif_offset;
+    // Shift-and tables, for motifs of up to 64 bases: bit i of m_base_masks[b] is set if
+    // base b (in ACGT order) is allowed at position i of the motif.  The last entry is for
+    // any other character, which never matches.
+    std::array<uint64_t, 5> m_base_masks{};
 };
 
 }  // namespace dorado::modbase
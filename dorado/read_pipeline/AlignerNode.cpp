@@ -22,6 +22,23 @@ namespace {
 
 constexpr std::size_t MAX_INPUT_QUEUE_SIZE{10000};
 constexpr std::size_t MAX_PROCESSING_QUEUE_SIZE{MAX_INPUT_QUEUE_SIZE / 2};
+// Messages are aligned in tasks of roughly this many bases, so that short reads are batched
+// together and the per-task overhead doesn't rival the cost of mapping them.  Long reads
+// still get a task each.
+constexpr std::size_t TARGET_BASES_PER_TASK{20000};
+
+std::size_t get_num_bases(const dorado::Message& message) {
+    if (std::holds_alternative<dorado::BamMessage>(message)) {
+        return std::get<dorado::BamMessage>(message).bam_ptr->core.l_qseq;
+    }
+    if (std::holds_alternative<dorado::SimplexReadPtr>(message)) {
+        return std::get<dorado::SimplexReadPtr>(message)->read_common.seq.size();
+    }
+    if (std::holds_alternative<dorado::DuplexReadPtr>(message)) {
+        return std::get<dorado::DuplexReadPtr>(message)->read_common.seq.size();
+    }
+    return 0;
+}
 
 std::shared_ptr<const dorado::alignment::Minimap2Index> load_and_get_index(
         dorado::alignment::IndexFileAccess& index_file_access,
@@ -176,46 +193,83 @@ void AlignerNode::align_read_common(ReadCommon& read_common, mm_tbuf_t* tbuf) {
 }
 
 template <typename READ>
-void AlignerNode::align_read(utils::concurrency::AsyncTaskExecutor& executor, READ&& read) {
-    executor.send([this, read_ = std::move(read)]() mutable {
-        thread_local MmTbufPtr tbuf{mm_tbuf_init()};
-        align_read_common(read_->read_common, tbuf.get());
-        send_message_to_sink(std::move(read_));
-    });
+void AlignerNode::align_read(READ&& read, mm_tbuf_t* tbuf, std::vector<Message>& results) {
+    align_read_common(read->read_common, tbuf);
+    results.push_back(std::move(read));
 }
 
-void AlignerNode::align_bam_message(utils::concurrency::AsyncTaskExecutor& executor,
-                                    BamMessage&& bam_message) {
-    executor.send([this, bam_message_ = std::move(bam_message)] {
+void AlignerNode::align_bam_message(BamMessage&& bam_message,
+                                    mm_tbuf_t* tbuf,
+                                    std::vector<Message>& results) {
+    auto records = alignment::Minimap2Aligner(m_index_for_bam_messages)
+                           .align(bam_message.bam_ptr.get(), tbuf);
+    for (auto& record : records) {
+        if (m_bedfile_for_bam_messages && !(record->core.flag & BAM_FUNMAP)) {
+            auto ref_id = record->core.tid;
+            add_bed_hits_to_record(m_header_sequence_names.at(ref_id), record.get());
+        }
+        results.push_back(BamMessage{std::move(record), bam_message.client_info});
+    }
+}
+
+void AlignerNode::align_message(Message&& message,
+                                mm_tbuf_t* tbuf,
+                                std::vector<Message>& results) {
+    if (std::holds_alternative<BamMessage>(message)) {
+        align_bam_message(std::get<BamMessage>(std::move(message)), tbuf, results);
+    } else if (std::holds_alternative<SimplexReadPtr>(message)) {
+        align_read(std::get<SimplexReadPtr>(std::move(message)), tbuf, results);
+    } else if (std::holds_alternative<DuplexReadPtr>(message)) {
+        align_read(std::get<DuplexReadPtr>(std::move(message)), tbuf, results);
+    }
+}
+
+void AlignerNode::align_messages(utils::concurrency::AsyncTaskExecutor& executor,
+                                 std::vector<Message>&& messages) {
+    executor.send([this, messages_ = std::move(messages)]() mutable {
         thread_local MmTbufPtr tbuf{mm_tbuf_init()};
-        auto records = alignment::Minimap2Aligner(m_index_for_bam_messages)
-                               .align(bam_message_.bam_ptr.get(), tbuf.get());
-        for (auto& record : records) {
-            if (m_bedfile_for_bam_messages && !(record->core.flag & BAM_FUNMAP)) {
-                auto ref_id = record->core.tid;
-                add_bed_hits_to_record(m_header_sequence_names.at(ref_id), record.get());
-            }
-            send_message_to_sink(BamMessage{std::move(record), bam_message_.client_info});
+        std::vector<Message> results;
+        results.reserve(messages_.size());
+        for (auto& message : messages_) {
+            align_message(std::move(message), tbuf.get(), results);
         }
+        send_messages_to_sink(std::move(results));
     });
 }
 
 void AlignerNode::input_thread_fn() {
-    Message message;
+    std::vector<Message> messages;
+    std::vector<Message> batch;
+    std::size_t batch_bases = 0;
     // create an executor for the pool whose destructor will block till all tasks completed.
     utils::concurrency::AsyncTaskExecutor task_executor{*m_thread_pool, m_pipeline_priority,
                                                         MAX_PROCESSING_QUEUE_SIZE};
-    while (get_input_message(message)) {
-        if (std::holds_alternative<BamMessage>(message)) {
-            align_bam_message(task_executor, std::get<BamMessage>(std::move(message)));
-        } else if (std::holds_alternative<SimplexReadPtr>(message)) {
-            align_read(task_executor, std::get<SimplexReadPtr>(std::move(message)));
-        } else if (std::holds_alternative<DuplexReadPtr>(message)) {
-            align_read(task_executor, std::get<DuplexReadPtr>(std::move(message)));
-        } else {
-            send_message_to_sink(std::move(message));
-            continue;
+    while (get_input_messages(messages, MAX_INPUT_BATCH_SIZE)) {
+        for (auto& message : messages) {
+            if (!std::holds_alternative<BamMessage>(message) &&
+                !std::holds_alternative<SimplexReadPtr>(message) &&
+                !std::holds_alternative<DuplexReadPtr>(message)) {
+                send_message_to_sink(std::move(message));
+                continue;
+            }
+            batch_bases += get_num_bases(message);
+            batch.push_back(std::move(message));
+            if (batch_bases >= TARGET_BASES_PER_TASK) {
+                align_messages(task_executor, std::move(batch));
+                batch = {};
+                batch_bases = 0;
+            }
         }
+        // Only hold back a partial batch while there's more input waiting, so that a trickle
+        // of reads isn't delayed.
+        if (!batch.empty() && m_work_queue.size() == 0) {
+            align_messages(task_executor, std::move(batch));
+            batch = {};
+            batch_bases = 0;
+        }
+    }
+    if (!batch.empty()) {
+        align_messages(task_executor, std::move(batch));
     }
 }
 
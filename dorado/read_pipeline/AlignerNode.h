@@ -54,11 +54,17 @@ private:
     std::shared_ptr<const alignment::Minimap2Index> get_index(const ClientInfo& client_info);
     std::shared_ptr<dorado::alignment::BedFile> get_bedfile(const ClientInfo& client_info,
                                                             const std::string& bedfile);
+    // Aligns a batch of messages in a single task, sending the results on together.
+    void align_messages(utils::concurrency::AsyncTaskExecutor& executor,
+                        std::vector<Message>&& messages);
+    void align_message(Message&& message, mm_tbuf_t* tbuf, std::vector<Message>& results);
+
     template <typename READ>
-    void align_read(utils::concurrency::AsyncTaskExecutor& executor, READ&& read);
+    void align_read(READ&& read, mm_tbuf_t* tbuf, std::vector<Message>& results);
 
-    void align_bam_message(utils::concurrency::AsyncTaskExecutor& executor,
-                           BamMessage&& bam_message);
+    void align_bam_message(BamMessage&& bam_message,
+                           mm_tbuf_t* tbuf,
+                           std::vector<Message>& results);
 
     void align_read_common(ReadCommon& read_common, mm_tbuf_t* tbuf);
     void add_bed_hits_to_record(const std::string& genome, bam1_t* record);
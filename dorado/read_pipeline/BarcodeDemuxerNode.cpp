@@ -4,11 +4,16 @@
 #include "utils/SampleSheet.h"
 #include "utils/fastq_reader.h"
 #include "utils/hts_file.h"
+#include "utils/thread_naming.h"
 
 #include <htslib/bgzf.h>
 #include <htslib/sam.h>
+#include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <cassert>
+#include <functional>
+#include <numeric>
 #include <stdexcept>
 #include <string>
 
@@ -17,6 +22,7 @@ namespace dorado {
 namespace {
 constexpr size_t BAM_BUFFER_SIZE =
         20000000;  // 20 MB per barcode classification. So roughly 2 GB for 96 barcodes.
+constexpr size_t WRITER_QUEUE_SIZE = 1000;
 
 std::string get_run_id_from_fq_tag(const bam1_t& record) {
     auto fastq_id_tag = bam_aux_get(&record, "fq");
@@ -69,7 +75,8 @@ BarcodeDemuxerNode::BarcodeDemuxerNode(const std::string& output_dir,
                                        size_t htslib_threads,
                                        bool write_fastq,
                                        std::unique_ptr<const utils::SampleSheet> sample_sheet,
-                                       bool sort_bam)
+                                       bool sort_bam,
+                                       size_t num_writers)
         : MessageSink(10000, 1),
           m_output_dir(output_dir),
           m_htslib_threads(int(htslib_threads)),
@@ -77,44 +84,93 @@ BarcodeDemuxerNode::BarcodeDemuxerNode(const std::string& output_dir,
           m_sort_bam(sort_bam && !write_fastq),
           m_sample_sheet(std::move(sample_sheet)) {
     std::filesystem::create_directories(m_output_dir);
+    for (size_t i = 0; i < std::max(num_writers, size_t{1}); ++i) {
+        m_writers.push_back(std::make_unique<Writer>(WRITER_QUEUE_SIZE));
+    }
+}
+
+BarcodeDemuxerNode::~BarcodeDemuxerNode() { terminate_impl(); }
+
+void BarcodeDemuxerNode::start_threads() {
+    for (auto& writer : m_writers) {
+        writer->queue.restart();
+        writer->thread = std::thread([this, target = writer.get()] { writer_thread_fn(*target); });
+    }
+    start_input_processing([this] { input_thread_fn(); }, "brcd_demux");
+}
+
+void BarcodeDemuxerNode::terminate_impl() {
+    stop_input_processing();
+    // The writers finish off whatever is left in their queues.
+    for (auto& writer : m_writers) {
+        writer->queue.terminate();
+        if (writer->thread.joinable()) {
+            writer->thread.join();
+        }
+    }
 }
 
-BarcodeDemuxerNode::~BarcodeDemuxerNode() { stop_input_processing(); }
+void BarcodeDemuxerNode::restart() { start_threads(); }
 
+// Each barcode is mapped to its own file. Depending
+// on the barcode assigned to each read, the read is
+// sent to the writer for the corresponding barcode file.
 void BarcodeDemuxerNode::input_thread_fn() {
     Message message;
     while (get_input_message(message)) {
         auto bam_message = std::move(std::get<BamMessage>(message));
-        write(*bam_message.bam_ptr);
+        bam1_t& record = *bam_message.bam_ptr;
+
+        // Fetch the barcode name.
+        std::string barcode = "unclassified";
+        auto bam_tag = bam_aux_get(&record, "BC");
+        if (bam_tag) {
+            barcode = std::string(bam_aux2Z(bam_tag));
+        }
+        if (m_sample_sheet) {
+            apply_sample_sheet_alias(*m_sample_sheet, barcode, record);
+        }
+
+        auto file_stem = get_run_id(record) + "_" + barcode;
+        auto& writer = *m_writers[std::hash<std::string>{}(file_stem) % m_writers.size()];
+        writer.queue.try_push({std::move(file_stem), std::move(bam_message.bam_ptr)});
     }
 }
 
-// Each barcode is mapped to its own file. Depending
-// on the barcode assigned to each read, the read is
-// written to the corresponding barcode file.
-int BarcodeDemuxerNode::write(bam1_t& record) {
-    assert(m_header);
-    // Fetch the barcode name.
-    std::string barcode = "unclassified";
-    auto bam_tag = bam_aux_get(&record, "BC");
-    if (bam_tag) {
-        barcode = std::string(bam_aux2Z(bam_tag));
-    }
-    if (m_sample_sheet) {
-        apply_sample_sheet_alias(*m_sample_sheet, barcode, record);
+void BarcodeDemuxerNode::writer_thread_fn(Writer& writer) {
+    utils::set_thread_name("brcd_demux_wr");
+    PendingRecord pending;
+    while (writer.queue.try_pop(pending) == utils::AsyncQueueStatus::Success) {
+        // Keep popping after a failure, so that the input thread isn't left blocked.
+        if (m_writer_failed.load()) {
+            continue;
+        }
+        try {
+            write(writer.files, pending.file_stem, *pending.record);
+        } catch (const std::exception& e) {
+            spdlog::error("BarcodeDemuxerNode failed to write {}: {}", pending.file_stem,
+                          e.what());
+            std::lock_guard lock(m_writer_error_mutex);
+            if (!m_writer_error) {
+                m_writer_error = std::current_exception();
+            }
+            m_writer_failed = true;
+        }
     }
+}
 
-    const auto run_id = get_run_id(record);
-
+int BarcodeDemuxerNode::write(HtsFiles& files, const std::string& file_stem, bam1_t& record) {
+    assert(m_header);
     // Check for existence of file for that barcode and run id.
-    auto& file = m_files[run_id + barcode];
-    if (!file) {
+    auto file_it = files.find(file_stem);
+    if (file_it == files.end()) {
         // For new barcodes, create a new HTS file (either fastq or BAM).
-        const std::string filename = run_id + "_" + barcode + (m_write_fastq ? ".fastq" : ".bam");
+        const std::string filename = file_stem + (m_write_fastq ? ".fastq" : ".bam");
         const auto filepath = m_output_dir / filename;
         const auto filepath_str = filepath.string();
 
-        file = std::make_unique<utils::HtsFile>(
+        // Only add the file once it's fully set up, so a failure here can't leave a null entry.
+        auto file = std::make_unique<utils::HtsFile>(
                 filepath_str,
                 m_write_fastq ? utils::HtsFile::OutputMode::FASTQ : utils::HtsFile::OutputMode::BAM,
                 m_htslib_threads, m_sort_bam);
@@ -122,9 +178,10 @@ int BarcodeDemuxerNode::write(bam1_t& record) {
             file->set_buffer_size(BAM_BUFFER_SIZE);
         }
         file->set_header(m_header.get());
+        file_it = files.emplace(file_stem, std::move(file)).first;
     }
 
-    auto hts_res = file->write(&record);
+    auto hts_res = file_it->second->write(&record);
     if (hts_res < 0) {
         throw std::runtime_error("Failed to write SAM record, error code " +
                                  std::to_string(hts_res));
@@ -142,19 +199,66 @@ void BarcodeDemuxerNode::set_header(const sam_hdr_t* const header) {
 
 void BarcodeDemuxerNode::finalise_hts_files(
         const utils::HtsFile::ProgressCallback& progress_callback) {
-    const size_t num_files = m_files.size();
-    size_t current_file_idx = 0;
-    for (auto& [bc, hts_file] : m_files) {
-        hts_file->finalise([&](size_t progress) {
-            // Give each file/barcode the same contribution to the total progress.
-            const size_t total_progress = (current_file_idx * 100 + progress) / num_files;
-            progress_callback(total_progress);
-        });
-        ++current_file_idx;
-    }
-
-    m_files.clear();
+    std::vector<std::unique_ptr<utils::HtsFile>> files;
+    for (auto& writer : m_writers) {
+        for (auto& entry : writer->files) {
+            files.push_back(std::move(entry.second));
+        }
+        writer->files.clear();
+    }
+    const size_t num_files = files.size();
+
+    // Each thread takes the next file that hasn't been started until there are none left.
+    std::atomic<size_t> next_file{0};
+    std::mutex mutex;
+    std::vector<size_t> file_progress(num_files, 0);
+    size_t reported_progress = 0;
+    std::exception_ptr finalise_error;
+    auto finalise_files = [&] {
+        for (size_t i = next_file++; i < num_files; i = next_file++) {
+            try {
+                files[i]->finalise([&, i](size_t progress) {
+                    // Give each file/barcode the same contribution to the total progress.
+                    std::lock_guard lock(mutex);
+                    file_progress[i] = progress;
+                    const size_t total_progress =
+                            std::accumulate(file_progress.begin(), file_progress.end(),
+                                            size_t{0}) /
+                            num_files;
+                    // Progress only moves forward, whichever file reports it.
+                    if (total_progress > reported_progress) {
+                        reported_progress = total_progress;
+                        progress_callback(total_progress);
+                    }
+                });
+            } catch (...) {
+                std::lock_guard lock(mutex);
+                if (!finalise_error) {
+                    finalise_error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    const size_t num_threads = std::min(num_files, m_writers.size());
+    for (size_t i = 1; i < num_threads; ++i) {
+        threads.emplace_back(finalise_files);
+    }
+    finalise_files();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    files.clear();
     progress_callback(100);
+
+    if (m_writer_error) {
+        std::rethrow_exception(m_writer_error);
+    }
+    if (finalise_error) {
+        std::rethrow_exception(finalise_error);
+    }
 }
 
 stats::NamedStats BarcodeDemuxerNode::sample_stats() const {
@@ -163,6 +267,6 @@ stats::NamedStats BarcodeDemuxerNode::sample_stats() const {
     return stats;
 }
 
-void BarcodeDemuxerNode::terminate(const FlushOptions&) { stop_input_processing(); }
+void BarcodeDemuxerNode::terminate(const FlushOptions&) { terminate_impl(); }
 
 }  // namespace dorado
@@ -1,15 +1,20 @@
 #pragma once
 
 #include "read_pipeline/MessageSink.h"
+#include "utils/AsyncQueue.h"
 #include "utils/hts_file.h"
 #include "utils/stats.h"
 #include "utils/types.h"
 
 #include <atomic>
+#include <exception>
 #include <filesystem>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 struct bam1_t;
 
@@ -23,34 +28,58 @@ class BarcodeDemuxerNode : public MessageSink {
 public:
     using HtsFiles = std::unordered_map<std::string, std::unique_ptr<utils::HtsFile>>;
 
+    // Records are written by num_writers worker threads, each owning the output files whose
+    // names hash to it, so records for one file are always written in order by one thread.
     BarcodeDemuxerNode(const std::string& output_dir,
                        size_t htslib_threads,
                        bool write_fastq,
                        std::unique_ptr<const utils::SampleSheet> sample_sheet,
-                       bool sort_bam);
+                       bool sort_bam,
+                       size_t num_writers = 1);
     ~BarcodeDemuxerNode();
     std::string get_name() const override { return "BarcodeDemuxerNode"; }
     stats::NamedStats sample_stats() const override;
     void terminate(const FlushOptions&) override;
-    void restart() override {
-        start_input_processing([this] { input_thread_fn(); }, "brcd_demux");
-    }
+    void restart() override;
 
     void set_header(const sam_hdr_t* header);
 
     // Finalisation must occur before destruction of this node.
     // Note that this isn't safe to call until after this node has been terminated.
+    // Files are finalised concurrently, on up to num_writers threads.  Rethrows the first error
+    // from writing or finalising.
     void finalise_hts_files(const utils::HtsFile::ProgressCallback& progress_callback);
 
 private:
+    // A record waiting to be written to the file named file_stem.
+    struct PendingRecord {
+        std::string file_stem;
+        BamPtr record;
+    };
+
+    struct Writer {
+        explicit Writer(size_t queue_size) : queue(queue_size) {}
+        utils::AsyncQueue<PendingRecord> queue;
+        HtsFiles files;
+        std::thread thread;
+    };
+
     const std::filesystem::path m_output_dir;
     const int m_htslib_threads;
     SamHdrPtr m_header;
     std::atomic<int> m_processed_reads{0};
 
-    HtsFiles m_files;
+    std::vector<std::unique_ptr<Writer>> m_writers;
+    // The first error from a writer, after which records are dropped.
+    std::atomic<bool> m_writer_failed{false};
+    std::mutex m_writer_error_mutex;
+    std::exception_ptr m_writer_error;
+
+    void start_threads();
+    void terminate_impl();
     void input_thread_fn();
-    int write(bam1_t& record);
+    void writer_thread_fn(Writer& writer);
+    int write(HtsFiles& files, const std::string& file_stem, bam1_t& record);
     const bool m_write_fastq;
     const bool m_sort_bam;
     const std::unique_ptr<const utils::SampleSheet> m_sample_sheet;
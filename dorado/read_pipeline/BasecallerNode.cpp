@@ -15,6 +15,8 @@
 
 #include <algorithm>
 #include <cstdlib>
+#include <mutex>
+#include <optional>
 
 #if DORADO_METAL_BUILD
 #include "torch_utils/metal_utils.h"
@@ -39,9 +41,11 @@ struct BasecallerNode::BasecallingChunk : utils::Chunk {
 };
 
 struct BasecallerNode::BasecallingRead {
-    Message read;                                              // The read itself.
-    std::vector<std::unique_ptr<utils::Chunk>> called_chunks;  // Vector of basecalled chunks.
-    std::atomic_size_t num_chunks_called;  // Number of chunks which have been basecalled.
+    Message read;  // The read itself.
+    // Stitches the called chunks as they arrive.  Guarded by stitcher_mutex, since chunks
+    // from the same read can be handled by different working reads manager threads.
+    std::optional<utils::ChunkStitcher> stitcher;
+    std::mutex stitcher_mutex;
 };
 
 size_t BasecallerNode::get_chunk_queue_idx(size_t read_raw_size) {
@@ -100,7 +104,6 @@ void BasecallerNode::input_thread_fn() {
         std::vector<std::unique_ptr<BasecallingChunk>> read_chunks;
         read_chunks.emplace_back(std::make_unique<BasecallingChunk>(
                 working_read, offset, chunk_in_read_idx++, chunk_size));
-        size_t num_chunks = 1;
         auto last_chunk_offset = raw_size - chunk_size;
         auto misalignment = last_chunk_offset % m_model_stride;
         if (misalignment != 0) {
@@ -111,10 +114,13 @@ void BasecallerNode::input_thread_fn() {
             offset = std::min(offset + signal_chunk_step, last_chunk_offset);
             read_chunks.push_back(std::make_unique<BasecallingChunk>(
                     working_read, offset, chunk_in_read_idx++, chunk_size));
-            ++num_chunks;
         }
-        working_read->called_chunks.resize(num_chunks);
-        working_read->num_chunks_called.store(0);
+        std::vector<size_t> chunk_offsets;
+        chunk_offsets.reserve(read_chunks.size());
+        for (const auto &chunk : read_chunks) {
+            chunk_offsets.push_back(chunk->input_offset);
+        }
+        working_read->stitcher.emplace(std::move(chunk_offsets), int(m_model_stride), raw_size);
         working_read->read = std::move(message);
 
         // Put the read in the working list
@@ -179,24 +185,28 @@ void BasecallerNode::working_reads_manager() {
     while (m_processed_chunks.try_pop(chunk) == utils::AsyncQueueStatus::Success) {
         nvtx3::scoped_range loop{"working_reads_manager"};
 
+        // Keep the read alive, since the chunk will be released once it's stitched.
         auto working_read = chunk->owning_read;
         auto idx_in_read = chunk->idx_in_read;
-        working_read->called_chunks[idx_in_read] = std::move(chunk);
-        auto num_chunks_called = ++working_read->num_chunks_called;
-        if (num_chunks_called == working_read->called_chunks.size()) {
+        bool read_complete = false;
+        {
+            std::lock_guard stitcher_lock(working_read->stitcher_mutex);
+            read_complete = working_read->stitcher->add_chunk(idx_in_read, std::move(chunk));
+        }
+        if (read_complete) {
             // Finalise the read.
             auto source_read = std::move(working_read->read);
 
             ReadCommon &read_common_data = get_read_common_data(source_read);
 
-            // model_stride is needed by the basecall server and stitch_chunks.
+            // model_stride is needed by the basecall server.
             read_common_data.model_stride = m_model_runners[0]->config().stride;
 
             // qbias/qscale are expected by the basecall server.
             read_common_data.model_q_bias = m_model_runners[0]->config().qbias;
             read_common_data.model_q_scale = m_model_runners[0]->config().qscale;
 
-            utils::stitch_chunks(read_common_data, working_read->called_chunks);
+            working_read->stitcher->finish(read_common_data);
             read_common_data.model_name = m_model_name;
             read_common_data.mean_qscore_start_pos = m_mean_qscore_start_pos;
             read_common_data.pre_trim_seq_length = read_common_data.seq.length();
@@ -212,9 +222,6 @@ void BasecallerNode::working_reads_manager() {
             m_num_bases_processed += read_common_data.seq.length();
             m_num_samples_processed += read_common_data.get_raw_data_samples();
 
-            // Chunks have ownership of the working read, so destroy them to avoid a leak.
-            working_read->called_chunks.clear();
-
             // Do not trim R9.4.1 data to avoid changes to legacy products
             // Check here to avoid adding models lib as a dependency of utils
             if (read_common_data.chemistry != models::Chemistry::DNA_R9_4_1_E8) {
@@ -2,6 +2,7 @@
 
 #include "read_pipeline/MessageSink.h"
 #include "utils/AsyncQueue.h"
+#include "utils/interned_string.h"
 #include "utils/stats.h"
 
 #include <atomic>
@@ -62,7 +63,7 @@ private:
     // Whether the model is for rna
     bool m_is_rna_model;
     // model_name
-    std::string m_model_name;
+    utils::InternedString m_model_name;
     // Mean Q-score start position from model properties.
     uint32_t m_mean_qscore_start_pos;
 
@@ -3,6 +3,7 @@
 #include "read_pipeline/DefaultClientInfo.h"
 #include "read_pipeline/ReadPipeline.h"
 #include "read_pipeline/messages.h"
+#include "utils/AsyncQueue.h"
 #include "utils/bam_utils.h"
 #include "utils/fastq_reader.h"
 #include "utils/types.h"
@@ -10,6 +11,10 @@
 #include <htslib/sam.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
 #include <functional>
 #include <memory>
@@ -17,6 +22,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -26,6 +32,16 @@ namespace {
 
 const std::string HTS_FORMAT_TEXT_FASTQ{"FASTQ sequence text"};
 
+// Records are handed from the decoding thread to the pushing thread in batches, to keep queue
+// overhead per record negligible.  A few batches in flight is enough to absorb the jitter of
+// both sides without holding much of the file in memory.
+constexpr std::size_t PREFETCH_BATCH_SIZE = 1000;
+constexpr std::size_t PREFETCH_QUEUE_SIZE = 4;
+
+int64_t to_ns(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
 void write_bam_aux_tag_from_string(bam1_t& record, const std::string& bam_tag_string) {
     // Format TAG:TYPE:VALUE where TAG is a 2 char string, TYPE is a single char, and value
     std::istringstream tag_stream{bam_tag_string};
@@ -55,16 +71,17 @@ void write_bam_aux_tag_from_string(bam1_t& record, const std::string& bam_tag_st
                    reinterpret_cast<const uint8_t*>(tag_data.c_str()));
 }
 
-void write_bam_aux_tags_from_fastq(bam1_t& record, const utils::FastqRecord& fastq_record) {
+void write_bam_aux_tags_from_fastq(bam1_t& record,
+                                   const utils::FastqRecordView& fastq_record) {
     for (const auto& bam_tag_string : fastq_record.get_bam_tags()) {
         write_bam_aux_tag_from_string(record, bam_tag_string);
     }
 }
 
-bool try_assign_bam_from_fastq(bam1_t& record, const utils::FastqRecord& fastq_record) {
+bool try_assign_bam_from_fastq(bam1_t& record, const utils::FastqRecordView& fastq_record) {
     std::vector<uint8_t> qscore{};
-    qscore.reserve(fastq_record.qstring().size());
-    std::transform(fastq_record.qstring().begin(), fastq_record.qstring().end(),
+    qscore.reserve(fastq_record.qstring.size());
+    std::transform(fastq_record.qstring.begin(), fastq_record.qstring.end(),
                    std::back_inserter(qscore), [](char c) { return static_cast<uint8_t>(c - 33); });
     constexpr uint16_t flags = 4;     // 4 = UNMAPPED
     constexpr int leftmost_pos = -1;  // UNMAPPED - will be written as 0
@@ -72,22 +89,23 @@ bool try_assign_bam_from_fastq(bam1_t& record, const utils::FastqRecord& fastq_r
     constexpr int next_pos = -1;      // UNMAPPED - will be written as 0
     const auto read_id = fastq_record.read_id_view();
     if (bam_set1(&record, read_id.size(), read_id.data(), flags, -1, leftmost_pos, map_q, 0,
-                 nullptr, -1, next_pos, 0, fastq_record.sequence().size(),
-                 fastq_record.sequence().c_str(), (char*)qscore.data(), 0) < 0) {
+                 nullptr, -1, next_pos, 0, fastq_record.sequence.size(),
+                 fastq_record.sequence.data(), (char*)qscore.data(), 0) < 0) {
         return false;
     }
 
     write_bam_aux_tags_from_fastq(record, fastq_record);
-    utils::try_add_fastq_header_tag(&record, fastq_record.header());
+    utils::try_add_fastq_header_tag(&record, std::string(fastq_record.header));
     return true;
 }
 
 class FastqBamRecordGenerator {
-    utils::FastqReader m_fastq_reader;
+    utils::FastqBlockReader m_fastq_reader;
     SamHdrPtr m_header;
 
 public:
-    FastqBamRecordGenerator(const std::string& filename) : m_fastq_reader(filename) {
+    FastqBamRecordGenerator(const std::string& filename, int threads)
+            : m_fastq_reader(filename, std::max(threads, 1)) {
         if (!is_valid()) {
             return;
         }
@@ -118,11 +136,18 @@ class HtsLibBamRecordGenerator {
     std::string m_format{};
 
 public:
-    HtsLibBamRecordGenerator(const std::string& filename) {
+    HtsLibBamRecordGenerator(const std::string& filename, int threads) {
         m_file.reset(hts_open(filename.c_str(), "r"));
         if (!m_file) {
             return;
         }
+        // Only BGZF compressed SAM/BAM benefit from the pool; FASTX parsing is single threaded.
+        const auto* hts_format = hts_get_format(m_file.get());
+        if (threads > 0 && hts_format->compression == bgzf &&
+            (hts_format->format == bam || hts_format->format == sam) &&
+            hts_set_threads(m_file.get(), threads) < 0) {
+            spdlog::warn("Could not use {} threads to decompress {}", threads, filename);
+        }
         // If input format is FASTX, read tags from the query name line.
         hts_set_opt(m_file.get(), FASTQ_OPT_AUX, "1");
         auto format = hts_format_description(hts_get_format(m_file.get()));
@@ -149,8 +174,11 @@ public:
 }  // namespace
 
 HtsReader::HtsReader(const std::string& filename,
-                     std::optional<std::unordered_set<std::string>> read_list)
-        : m_client_info(std::make_shared<DefaultClientInfo>()), m_read_list(std::move(read_list)) {
+                     std::optional<std::unordered_set<std::string>> read_list,
+                     int threads)
+        : m_client_info(std::make_shared<DefaultClientInfo>()),
+          m_read_list(std::move(read_list)),
+          m_threads(threads) {
     if (!try_initialise_generator<FastqBamRecordGenerator>(filename) &&
         !try_initialise_generator<HtsLibBamRecordGenerator>(filename)) {
         throw std::runtime_error("Could not open file: " + filename);
@@ -162,7 +190,7 @@ HtsReader::HtsReader(const std::string& filename,
 
 template <typename T>
 bool HtsReader::try_initialise_generator(const std::string& filename) {
-    auto generator = std::make_shared<T>(filename);  // shared to allow copy assignment
+    auto generator = std::make_shared<T>(filename, m_threads);  // shared to allow copy assignment
     if (!generator->is_valid()) {
         return false;
     }
@@ -189,14 +217,26 @@ bool HtsReader::has_tag(const char* tagname) {
     return static_cast<bool>(tag);
 }
 
+stats::NamedStats HtsReader::sample_stats() const {
+    stats::NamedStats stats;
+    stats["decode_wait_s"] = double(m_decode_wait_ns.load()) / 1e9;
+    stats["push_wait_s"] = double(m_push_wait_ns.load()) / 1e9;
+    return stats;
+}
+
+bool HtsReader::is_in_read_list(const bam1_t& bam_record) const {
+    return !m_read_list || m_read_list->count(bam_get_qname(&bam_record)) > 0;
+}
+
 std::size_t HtsReader::read(Pipeline& pipeline, std::size_t max_reads) {
+    if (m_threads > 0) {
+        return read_with_prefetch(pipeline, max_reads);
+    }
+
     std::size_t num_reads = 0;
     while (this->read()) {
-        if (m_read_list) {
-            std::string read_id = bam_get_qname(record.get());
-            if (m_read_list->find(read_id) == m_read_list->end()) {
-                continue;
-            }
+        if (!is_in_read_list(*record)) {
+            continue;
         }
         if (m_record_mutator) {
             m_record_mutator(record);
@@ -216,6 +256,86 @@ std::size_t HtsReader::read(Pipeline& pipeline, std::size_t max_reads) {
     return num_reads;
 }
 
+std::size_t HtsReader::read_with_prefetch(Pipeline& pipeline, std::size_t max_reads) {
+    using Clock = std::chrono::steady_clock;
+    utils::AsyncQueue<std::vector<BamPtr>> batches(PREFETCH_QUEUE_SIZE);
+
+    // Records are decoded straight into the BamPtrs that get pushed, so there's no copy.
+    // Filtering happens here too, so that exactly max_reads records are consumed from the file.
+    std::exception_ptr decode_error;
+    std::thread decode_thread([&] {
+        try {
+            std::size_t num_decoded = 0;
+            std::vector<BamPtr> batch;
+            BamPtr decoded(bam_init1());
+            while ((max_reads == 0 || num_decoded < max_reads) &&
+                   m_bam_record_generator(*decoded)) {
+                if (!is_in_read_list(*decoded)) {
+                    continue;
+                }
+                batch.push_back(std::move(decoded));
+                decoded.reset(bam_init1());
+                ++num_decoded;
+                if (batch.size() == PREFETCH_BATCH_SIZE) {
+                    if (batches.try_push(std::move(batch)) != utils::AsyncQueueStatus::Success) {
+                        break;
+                    }
+                    batch = {};
+                }
+            }
+            if (!batch.empty()) {
+                batches.try_push(std::move(batch));
+            }
+        } catch (...) {
+            decode_error = std::current_exception();
+        }
+        batches.terminate();
+    });
+
+    std::size_t num_reads = 0;
+    std::exception_ptr push_error;
+    try {
+        std::vector<BamPtr> batch;
+        while (true) {
+            const auto wait_start = Clock::now();
+            if (batches.try_pop(batch) != utils::AsyncQueueStatus::Success) {
+                break;
+            }
+            const auto push_start = Clock::now();
+            m_decode_wait_ns += to_ns(push_start - wait_start);
+
+            for (auto& bam_record : batch) {
+                if (m_record_mutator) {
+                    m_record_mutator(bam_record);
+                }
+                pipeline.push_message(BamMessage{std::move(bam_record), m_client_info});
+                ++num_reads;
+                if (num_reads % 50000 == 0) {
+                    spdlog::debug("Processed {} reads", num_reads);
+                }
+            }
+            m_push_wait_ns += to_ns(Clock::now() - push_start);
+        }
+    } catch (...) {
+        push_error = std::current_exception();
+    }
+
+    // Unblocks the decoding thread if we stopped early.
+    batches.terminate();
+    decode_thread.join();
+    if (push_error) {
+        std::rethrow_exception(push_error);
+    }
+    if (decode_error) {
+        std::rethrow_exception(decode_error);
+    }
+
+    const auto stats = sample_stats();
+    spdlog::debug("Total reads processed: {}, waited {:.3f}s for decoding, {:.3f}s for pipeline",
+                  num_reads, stats.at("decode_wait_s"), stats.at("push_wait_s"));
+    return num_reads;
+}
+
 sam_hdr_t* HtsReader::header() { return m_header; }
 
 const std::string& HtsReader::format() const { return m_format; }
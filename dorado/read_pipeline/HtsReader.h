@@ -7,6 +7,8 @@
 
 #include <htslib/sam.h>
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -23,8 +25,11 @@ class Pipeline;
 
 class HtsReader {
 public:
+    // If threads > 0, BGZF compressed input is decompressed on a pool of that many threads, and
+    // read(Pipeline&, ...) decodes records on a background thread ahead of pushing them.
     HtsReader(const std::string& filename,
-              std::optional<std::unordered_set<std::string>> read_list);
+              std::optional<std::unordered_set<std::string>> read_list,
+              int threads = 0);
     bool read();
 
     // If reading directly into a pipeline need to set the client info on the messages
@@ -35,6 +40,10 @@ public:
     bool has_tag(const char* tagname);
     void set_record_mutator(std::function<void(BamPtr&)> mutator);
 
+    // How long read(Pipeline&, ...) has spent blocked waiting for records to be decoded
+    // ("decode_wait_s"), and pushing them into the pipeline ("push_wait_s").
+    stats::NamedStats sample_stats() const;
+
     bool is_aligned{false};
     BamPtr record{nullptr};
 
@@ -51,9 +60,19 @@ private:
     std::optional<std::unordered_set<std::string>> m_read_list;
 
     std::function<bool(bam1_t&)> m_bam_record_generator{};
+    int m_threads{0};
+
+    // In nanoseconds.  Atomic as they are sampled from the stats thread while reading.
+    std::atomic<int64_t> m_decode_wait_ns{0};
+    std::atomic<int64_t> m_push_wait_ns{0};
 
     template <typename T>
     bool try_initialise_generator(const std::string& filename);
+
+    bool is_in_read_list(const bam1_t& bam_record) const;
+    // Decodes up to max_reads records (0 for all) in batches on a background thread, while the
+    // calling thread pushes them into the pipeline.
+    std::size_t read_with_prefetch(Pipeline& pipeline, std::size_t max_reads);
 };
 
 template <typename T>
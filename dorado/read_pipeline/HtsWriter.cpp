@@ -18,7 +18,9 @@ namespace dorado {
 using OutputMode = dorado::utils::HtsFile::OutputMode;
 
 HtsWriter::HtsWriter(utils::HtsFile& file, std::string gpu_names)
-        : MessageSink(10000, 1), m_file(file), m_gpu_names(std::move(gpu_names)) {
+        : MessageSink(10000, 1, utils::AsyncQueueBackend::LockFree),
+          m_file(file),
+          m_gpu_names(std::move(gpu_names)) {
     if (!m_gpu_names.empty()) {
         m_gpu_names = "gpu:" + m_gpu_names;
     }
@@ -38,55 +40,57 @@ OutputMode HtsWriter::get_output_mode(const std::string& mode) {
 }
 
 void HtsWriter::input_thread_fn() {
-    Message message;
-    while (get_input_message(message)) {
-        if (!std::holds_alternative<BamMessage>(message)) {
-            continue;
-        }
+    std::vector<Message> messages;
+    while (get_input_messages(messages, MAX_INPUT_BATCH_SIZE)) {
+        for (auto& message : messages) {
+            if (!std::holds_alternative<BamMessage>(message)) {
+                continue;
+            }
 
-        auto bam_message = std::move(std::get<BamMessage>(message));
-        BamPtr aln = std::move(bam_message.bam_ptr);
+            auto bam_message = std::move(std::get<BamMessage>(message));
+            BamPtr aln = std::move(bam_message.bam_ptr);
 
-        if (m_file.get_output_mode() == utils::HtsFile::OutputMode::FASTQ) {
-            if (!m_gpu_names.empty()) {
-                bam_aux_append(aln.get(), "DS", 'Z', int(m_gpu_names.length() + 1),
-                               (uint8_t*)m_gpu_names.c_str());
+            if (m_file.get_output_mode() == utils::HtsFile::OutputMode::FASTQ) {
+                if (!m_gpu_names.empty()) {
+                    bam_aux_append(aln.get(), "DS", 'Z', int(m_gpu_names.length() + 1),
+                                   (uint8_t*)m_gpu_names.c_str());
+                }
             }
-        }
 
-        auto res = write(aln.get());
-        if (res < 0) {
-            throw std::runtime_error("Failed to write SAM record, error code " +
-                                     std::to_string(res));
-        }
+            auto res = write(aln.get());
+            if (res < 0) {
+                throw std::runtime_error("Failed to write SAM record, error code " +
+                                         std::to_string(res));
+            }
 
-        // For the purpose of estimating write count, we ignore duplex reads
-        int64_t dx_tag = 0;
-        auto tag_str = bam_aux_get(aln.get(), "dx");
-        if (tag_str) {
-            dx_tag = bam_aux2i(tag_str);
-        }
+            // For the purpose of estimating write count, we ignore duplex reads
+            int64_t dx_tag = 0;
+            auto tag_str = bam_aux_get(aln.get(), "dx");
+            if (tag_str) {
+                dx_tag = bam_aux2i(tag_str);
+            }
 
-        bool ignore_read_id = dx_tag == 1;
-
-        if (ignore_read_id) {
-            // Read is a duplex read.
-            m_duplex_reads_written++;
-        } else {
-            std::string read_id;
-
-            // If read is a split read, use the parent read id
-            // to track write count since we don't know a priori
-            // how many split reads will be generated.
-            auto pid_tag = bam_aux_get(aln.get(), "pi");
-            if (pid_tag) {
-                read_id = std::string(bam_aux2Z(pid_tag));
-                m_split_reads_written++;
+            bool ignore_read_id = dx_tag == 1;
+
+            if (ignore_read_id) {
+                // Read is a duplex read.
+                m_duplex_reads_written++;
             } else {
-                read_id = bam_get_qname(aln.get());
+                std::string read_id;
+
+                // If read is a split read, use the parent read id
+                // to track write count since we don't know a priori
+                // how many split reads will be generated.
+                auto pid_tag = bam_aux_get(aln.get(), "pi");
+                if (pid_tag) {
+                    read_id = std::string(bam_aux2Z(pid_tag));
+                    m_split_reads_written++;
+                } else {
+                    read_id = bam_get_qname(aln.get());
+                }
+
+                m_processed_read_ids.add(std::move(read_id));
             }
-
-            m_processed_read_ids.add(std::move(read_id));
         }
     }
 }
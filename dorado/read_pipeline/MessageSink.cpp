@@ -2,23 +2,145 @@
 
 #include "utils/thread_naming.h"
 
+#include <algorithm>
 #include <cassert>
+#include <optional>
 
 namespace dorado {
 
-MessageSink::MessageSink(size_t max_messages, int num_input_threads)
-        : m_work_queue(max_messages), m_num_input_threads(num_input_threads) {}
+namespace {
+
+bool is_disconnected(const Message &message) {
+    return is_read_message(message) && get_read_common_data(message).client_info &&
+           get_read_common_data(message).client_info->is_disconnected();
+}
+
+// The messages an input thread is currently working on, for timing how long they take.
+// Input threads only ever pop from a single node.
+struct InputThreadState {
+    const MessageSink *sink = nullptr;
+    std::chrono::steady_clock::time_point start_time;
+    size_t num_messages = 0;
+};
+thread_local InputThreadState t_input_thread_state;
+
+}  // namespace
+
+MessageSink::MessageSink(size_t max_messages,
+                         int num_input_threads,
+                         utils::AsyncQueueBackend queue_backend)
+        : m_work_queue(max_messages, queue_backend), m_num_input_threads(num_input_threads) {}
 
 void MessageSink::push_message_internal(Message &&message) {
 #ifndef NDEBUG
     const auto status =
 #endif
-            m_work_queue.try_push(std::move(message));
+            m_work_queue.try_push(QueuedMessage{std::move(message), Clock::now()});
     // try_push will fail if the sink has been told to terminate.
     // We do not expect to be pushing reads from this source if that is the case.
     assert(status == utils::AsyncQueueStatus::Success);
 }
 
+void MessageSink::push_messages(std::vector<Message> &&messages) {
+    const auto now = Clock::now();
+    std::vector<QueuedMessage> queued_messages;
+    queued_messages.reserve(messages.size());
+    for (auto &message : messages) {
+        queued_messages.push_back(QueuedMessage{std::move(message), now});
+    }
+    messages.clear();
+#ifndef NDEBUG
+    const auto status =
+#endif
+            m_work_queue.try_push_n(std::move(queued_messages));
+    // As with push_message_internal, we do not expect to be pushing reads once the sink
+    // has been told to terminate.
+    assert(status == utils::AsyncQueueStatus::Success);
+}
+
+bool MessageSink::get_input_message(Message &message) {
+    finish_processing();
+    const bool forward_disconnected = !m_sinks.empty() && forward_on_disconnected();
+    QueuedMessage queued_message;
+    while (m_work_queue.try_pop(queued_message) == utils::AsyncQueueStatus::Success) {
+        const auto now = Clock::now();
+        record_wait_time(queued_message, now);
+        if (forward_disconnected && is_disconnected(queued_message.message)) {
+            send_message_to_sink(0, std::move(queued_message.message));
+            continue;
+        }
+        message = std::move(queued_message.message);
+        start_processing(now, 1);
+        return true;
+    }
+    return false;
+}
+
+bool MessageSink::get_input_messages(std::vector<Message> &messages, size_t max_messages) {
+    finish_processing();
+    const bool forward_disconnected = !m_sinks.empty() && forward_on_disconnected();
+    messages.clear();
+    while (messages.empty()) {
+        // Only read the clock once we have something, rather than before blocking.
+        std::optional<Clock::time_point> now;
+        const auto status = m_work_queue.process_and_pop_n(
+                [this, &messages, &now](QueuedMessage &&queued_message) {
+                    if (!now) {
+                        now = Clock::now();
+                    }
+                    record_wait_time(queued_message, *now);
+                    messages.push_back(std::move(queued_message.message));
+                },
+                max_messages);
+        if (status != utils::AsyncQueueStatus::Success) {
+            return false;
+        }
+
+        if (forward_disconnected) {
+            // Pass on messages from disconnected clients untouched, preserving the order of
+            // the rest.  This is done outside of process_and_pop_n so that we don't block
+            // on the downstream queue while the locked backend holds our queue's mutex.
+            auto disconnected_begin =
+                    std::stable_partition(messages.begin(), messages.end(),
+                                          [](const Message &m) { return !is_disconnected(m); });
+            for (auto it = disconnected_begin; it != messages.end(); ++it) {
+                send_message_to_sink(0, std::move(*it));
+            }
+            messages.erase(disconnected_begin, messages.end());
+        }
+        if (!messages.empty()) {
+            start_processing(*now, messages.size());
+        }
+    }
+    return true;
+}
+
+void MessageSink::record_wait_time(const QueuedMessage &message, Clock::time_point dequeue_time) {
+    m_wait_time.record(dequeue_time - message.enqueue_time);
+}
+
+void MessageSink::start_processing(Clock::time_point start_time, size_t num_messages) {
+    t_input_thread_state = {this, start_time, num_messages};
+}
+
+void MessageSink::finish_processing() {
+    auto &state = t_input_thread_state;
+    if (state.sink == this && state.num_messages > 0) {
+        // Batches are timed as a whole, so share the time out evenly between their messages.
+        const auto elapsed = Clock::now() - state.start_time;
+        m_processing_time.record(elapsed / static_cast<int64_t>(state.num_messages),
+                                 state.num_messages);
+    }
+    state = {};
+}
+
+stats::NamedStats MessageSink::sample_latency_stats() const {
+    stats::NamedStats stats;
+    m_wait_time.add_to_stats(stats, "wait_time");
+    m_processing_time.add_to_stats(stats, "processing_time");
+    return stats;
+}
+
 void MessageSink::add_sink(MessageSink &sink) { m_sinks.push_back(std::ref(sink)); }
 
 void MessageSink::start_input_processing(const std::function<void()> &input_thread_fn,
@@ -36,9 +158,12 @@ void MessageSink::start_input_processing(const std::function<void()> &input_thre
     // otherwise the pop will fail and the thread will terminate.
     start_input_queue();
     for (int i = 0; i < m_num_input_threads; ++i) {
-        m_input_threads.emplace_back([func = input_thread_fn, name = worker_name] {
+        m_input_threads.emplace_back([this, func = input_thread_fn, name = worker_name] {
             dorado::utils::set_thread_name(name);
             func();
+            // A thread that stops without asking for another message has still finished
+            // processing its last one.
+            finish_processing();
         });
     }
 }
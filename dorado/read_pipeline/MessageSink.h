@@ -4,9 +4,11 @@
 #include "flush_options.h"
 #include "messages.h"
 #include "utils/AsyncQueue.h"
+#include "utils/latency_histogram.h"
 #include "utils/stats.h"
 
 #include <atomic>
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -25,7 +27,11 @@ namespace dorado {
 // waits on the input queue before attempting to join input worker threads.
 class MessageSink {
 public:
-    MessageSink(size_t max_messages, int num_input_threads);
+    // queue_backend selects how the input queue is implemented.  The lock-free backend avoids
+    // mutex traffic on every hop for nodes that see a high message rate.
+    MessageSink(size_t max_messages,
+                int num_input_threads,
+                utils::AsyncQueueBackend queue_backend = utils::AsyncQueueBackend::Locked);
 
     virtual ~MessageSink() = default;
 
@@ -35,6 +41,11 @@ public:
         return std::unordered_map<std::string, double>();
     }
 
+    // Latency stats that are collected for every node: how long messages waited in the input
+    // queue, and how long the input threads spent on each message (from popping it to asking for
+    // the next one, so including any time spent blocked on downstream nodes).
+    stats::NamedStats sample_latency_stats() const;
+
     // Adds a message to the input queue.  This can block if the sink's queue is full.
     template <typename Msg>
     void push_message(Msg&& msg) {
@@ -43,6 +54,10 @@ public:
         push_message_internal(Message(std::move(msg)));
     }
 
+    // Adds a batch of messages to the input queue, in order.  This can block if the sink's
+    // queue is full.  Cheaper than pushing the messages one at a time.
+    void push_messages(std::vector<Message>&& messages);
+
     // Waits until work is finished and shuts down worker threads.
     // No work can be done by the node after this returns until
     // restart is subsequently called.
@@ -75,23 +90,42 @@ protected:
         send_message_to_sink(0, std::forward<Msg>(message));
     }
 
-    // Pops the next input message, returning true on success.
-    // If terminating, returns false.
-    bool get_input_message(Message& message) {
-        auto status = m_work_queue.try_pop(message);
-        if (!m_sinks.empty() && forward_on_disconnected()) {
-            while (status == utils::AsyncQueueStatus::Success && is_read_message(message) &&
-                   get_read_common_data(message).client_info &&
-                   get_read_common_data(message).client_info->is_disconnected()) {
-                send_message_to_sink(0, std::move(message));
-                status = m_work_queue.try_pop(message);
-            }
+    // Sends a batch of messages to the designated sink, in order.
+    void send_messages_to_sink(int sink_index, std::vector<Message>&& messages) {
+        m_sinks.at(sink_index).get().push_messages(std::move(messages));
+    }
+
+    // Version for nodes with a single sink that is implicit.
+    void send_messages_to_sink(std::vector<Message>&& messages) {
+        if (m_sinks.size() != 1) {
+            throw std::runtime_error("Invalid m_sinks size");
         }
-        return status == utils::AsyncQueueStatus::Success;
+        send_messages_to_sink(0, std::move(messages));
     }
 
+    // Pops the next input message, returning true on success.
+    // If terminating, returns false.
+    bool get_input_message(Message& message);
+
+    // Maximum number of messages that nodes processing their input in batches should pop
+    // at once.
+    static constexpr size_t MAX_INPUT_BATCH_SIZE = 32;
+
+    // Replaces the contents of messages with up to max_messages input messages, returning
+    // true on success.  Blocks until at least one message is available.
+    // If terminating, returns false.
+    bool get_input_messages(std::vector<Message>& messages, size_t max_messages);
+
+    using Clock = std::chrono::steady_clock;
+
+    // Input messages are stamped on entry to the queue, so we know how long they waited.
+    struct QueuedMessage {
+        Message message;
+        Clock::time_point enqueue_time;
+    };
+
     // Queue of work items for this node.
-    utils::AsyncQueue<Message> m_work_queue;
+    utils::AsyncQueue<QueuedMessage> m_work_queue;
 
     // Mark the input queue as active, and start input processing threads executing the
     // supplied functor.
@@ -110,6 +144,16 @@ private:
 
     void push_message_internal(Message&& message);
 
+    // Records the wait time of a message popped from the input queue at |dequeue_time|.
+    void record_wait_time(const QueuedMessage& message, Clock::time_point dequeue_time);
+    // Notes that the calling thread started processing |num_messages| messages at |start_time|.
+    void start_processing(Clock::time_point start_time, size_t num_messages);
+    // Records the processing time of the calling thread's previous messages, if it has any.
+    void finish_processing();
+
+    stats::LatencyHistogram m_wait_time;
+    stats::LatencyHistogram m_processing_time;
+
     // Input processing threads.
     const int m_num_input_threads;
     std::vector<std::thread> m_input_threads;
@@ -3,9 +3,9 @@
 namespace dorado {
 
 void NullNode::input_thread_fn() {
-    Message message;
-    while (get_input_message(message)) {
-        // Do nothing with the popped message.
+    std::vector<Message> messages;
+    while (get_input_messages(messages, MAX_INPUT_BATCH_SIZE)) {
+        // Do nothing with the popped messages.
     }
 }
 
@@ -17,6 +17,10 @@ const int kMaxTimeDeltaMs = 10000;
 const int kMinOverlapLength = 50;
 const int kMinSeqLength = 500;
 const float kMinSimplexQScore = 8.f;
+// Genuine pairs share hundreds of minimizers even at the lowest accepted qscore, while
+// unrelated reads of typical length share none, so this only screens out pairs that can't
+// possibly pass the alignment criteria.
+const size_t kMinSharedMinimizers = 3;
 
 size_t read_signal_bytes(const dorado::SimplexRead& read) {
     return read.read_common.raw_data.nbytes();
@@ -101,6 +105,17 @@ PairingNode::PairingResult PairingNode::is_within_time_and_length_criteria(
                 int(comp.read_common.seq.length() - 1)};
     }
 
+    // Most candidates don't overlap at all, so check for shared minimizers before paying for a
+    // minimap2 index of the template.
+    const auto num_shared_minimizers = temp.pairing_sketch.count_shared(comp.pairing_sketch);
+    if (num_shared_minimizers < kMinSharedMinimizers) {
+        spdlog::trace("Sketch rejection: {} shared minimizers, {} and {}", num_shared_minimizers,
+                      temp.read_common.read_id, comp.read_common.read_id);
+        m_sketch_rejected_pairs++;
+        return {false, 0, 0, 0, 0};
+    }
+    m_sketch_passed_pairs++;
+
     return is_within_alignment_criteria(temp, comp, delta, true, tid);
 }
 
@@ -248,6 +263,12 @@ void PairingNode::pair_list_worker_thread(int tid) {
     --m_num_active_worker_threads;
 }
 
+void PairingNode::send_cached_read(SimplexReadPtr read) {
+    // The sketch is only needed for pairing.
+    read->pairing_sketch = {};
+    send_message_to_sink(std::move(read));
+}
+
 void PairingNode::pair_generating_worker_thread(int tid) {
     utils::set_thread_name("pair_gen_thrd");
     at::InferenceMode inference_mode_guard;
@@ -267,7 +288,7 @@ void PairingNode::pair_generating_worker_thread(int tid) {
                 for (auto& read_ptr : reads_list) {
                     // Push each read message
                     m_cache_signal_bytes -= read_signal_bytes(*read_ptr);
-                    send_message_to_sink(std::move(read_ptr));
+                    send_cached_read(std::move(read_ptr));
                 }
             }
             m_read_caches.erase(flush_message.client_id);
@@ -285,6 +306,12 @@ void PairingNode::pair_generating_worker_thread(int tid) {
         // If this message isn't a read, we'll get a bad_variant_access exception.
         auto read = std::get<SimplexReadPtr>(std::move(message));
 
+        // Sketch the read before it's visible to other threads, so the sketches of cached reads
+        // can be compared without holding the lock.
+        if (read->read_common.seq.length() >= size_t(kMinSeqLength)) {
+            read->pairing_sketch = utils::MinimizerSketch(read->read_common.seq);
+        }
+
         int channel = read->read_common.attributes.channel_number;
         std::string run_id = read->read_common.run_id;
         std::string flowcell_id = read->read_common.flowcell_id;
@@ -417,7 +444,7 @@ void PairingNode::pair_generating_worker_thread(int tid) {
             }
             if (ok_to_clear) {
                 auto read_handle = m_reads_to_clear.extract(*to_clear_itr++);
-                send_message_to_sink(std::move(read_handle.value()));
+                send_cached_read(std::move(read_handle.value()));
             } else {
                 ++to_clear_itr;
             }
@@ -437,7 +464,7 @@ void PairingNode::pair_generating_worker_thread(int tid) {
                     for (auto& read_ptr : reads_list) {
                         m_cache_signal_bytes -= read_signal_bytes(*read_ptr);
                         // Push each read message
-                        send_message_to_sink(std::move(read_ptr));
+                        send_cached_read(std::move(read_ptr));
                     }
                 }
             }
@@ -524,6 +551,8 @@ stats::NamedStats PairingNode::sample_stats() const {
     stats::NamedStats stats = m_work_queue.sample_stats();
     stats["early_accepted_pairs"] = m_early_accepted_pairs.load();
     stats["overlap_accepted_pairs"] = m_overlap_accepted_pairs.load();
+    stats["sketch_rejected_pairs"] = m_sketch_rejected_pairs.load();
+    stats["sketch_passed_pairs"] = m_sketch_passed_pairs.load();
     stats["cached_signal_mb"] =
             static_cast<double>(m_cache_signal_bytes) / static_cast<double>(1024 * 1024);
     return stats;
@@ -64,6 +64,9 @@ private:
      */
     void pair_generating_worker_thread(int tid);
 
+    // Sends a read which is leaving the read cache on to the sink.
+    void send_cached_read(SimplexReadPtr read);
+
     std::vector<std::thread> m_workers;
     const int m_num_worker_threads;
     std::atomic<int> m_num_active_worker_threads = 0;
@@ -127,6 +130,8 @@ private:
     // Stats tracking for pairing node.
     std::atomic<int> m_early_accepted_pairs{0};
     std::atomic<int> m_overlap_accepted_pairs{0};
+    std::atomic<int> m_sketch_rejected_pairs{0};
+    std::atomic<int> m_sketch_passed_pairs{0};
     std::atomic<size_t> m_cache_signal_bytes{0};
 };
 
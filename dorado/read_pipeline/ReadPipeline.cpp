@@ -11,12 +11,25 @@
 #include <stack>
 #include <stdexcept>
 #include <string_view>
+#include <tuple>
 #include <unordered_map>
 
 using namespace std::chrono_literals;
 
 namespace dorado {
 
+namespace {
+
+// A node's own stats, plus the latency stats that every node collects.
+stats::NamedStats sample_node_stats(const MessageSink &node) {
+    auto node_stats = node.sample_stats();
+    const auto latency_stats = node.sample_latency_stats();
+    node_stats.insert(latency_stats.begin(), latency_stats.end());
+    return node_stats;
+}
+
+}  // namespace
+
 // Depth first search that establishes a topological ordering for node destruction.
 // Returns true if a cycle is found.
 bool Pipeline::DFS(const std::vector<PipelineDescriptor::NodeDescriptor> &node_descriptors,
@@ -94,7 +107,9 @@ Pipeline::Pipeline(PipelineDescriptor &&descriptor,
 
     if (stats_reporters) {
         for (auto node_index : m_source_to_sink_order) {
-            stats_reporters->push_back(stats::make_stats_reporter(*m_nodes.at(node_index)));
+            const auto &node = *m_nodes.at(node_index);
+            stats_reporters->push_back(
+                    [&node] { return std::make_tuple(node.get_name(), sample_node_stats(node)); });
         }
     }
 
@@ -123,7 +138,7 @@ stats::NamedStats Pipeline::terminate(const FlushOptions &flush_options) {
     for (auto handle : m_source_to_sink_order) {
         auto &node = m_nodes.at(handle);
         node->terminate(flush_options);
-        auto node_stats = node->sample_stats();
+        auto node_stats = sample_node_stats(*node);
         const auto node_name = node->get_name();
         for (const auto &[name, value] : node_stats) {
             final_stats[std::string(node_name).append(".").append(name)] = value;
@@ -31,6 +31,8 @@ public:
 
 private:
     void input_thread_fn();
+    // Appends the BAM records for the read held by message to outputs.
+    void convert_read(Message& message, std::vector<Message>& outputs);
 
     bool m_emit_moves;
     uint8_t m_modbase_threshold;
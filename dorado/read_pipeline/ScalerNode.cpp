@@ -6,6 +6,8 @@
 #include "torch_utils/tensor_utils.h"
 #include "torch_utils/trim.h"
 #include "torch_utils/trim_rapid_adapter.h"
+#include "utils/signal_histogram.h"
+#include "utils/sliding_median.h"
 
 #include <ATen/Functions.h>
 #include <ATen/TensorIndexing.h>
@@ -33,6 +35,13 @@ std::pair<float, float> med_mad(const at::Tensor& x) {
     //  (specifically the "Relation to standard deviation" section)
     constexpr float factor = 1.4826f;
     //Calculate signal median and median absolute deviation
+    if (x.dtype() == at::kShort) {
+        // Raw signal is int16, so both medians can come from a single histogram pass.
+        const auto x_contig = x.contiguous();
+        const dorado::utils::SignalHistogram histogram(x_contig.data_ptr<int16_t>(),
+                                                       x_contig.numel());
+        return {float(histogram.median()), float(histogram.mad()) * factor + EPS};
+    }
     auto med = x.median();
     auto mad = at::median(at::abs(x - med)) * factor + EPS;
     return {med.item<float>(), mad.item<float>()};
@@ -41,10 +50,11 @@ std::pair<float, float> med_mad(const at::Tensor& x) {
 std::pair<float, float> normalisation(const dorado::basecall::QuantileScalingParams& params,
                                       const at::Tensor& x) {
     // Calculate shift and scale factors for normalisation.
-    auto quantiles =
-            dorado::utils::quantile_counting(x, at::tensor({params.quantile_a, params.quantile_b}));
-    float q_a = quantiles[0].item<float>();
-    float q_b = quantiles[1].item<float>();
+    // This gives the same result as quantile_counting() without going through tensors.
+    const auto x_contig = x.contiguous();
+    const dorado::utils::SignalHistogram histogram(x_contig.data_ptr<int16_t>(), x_contig.numel());
+    float q_a = histogram.quantile(params.quantile_a);
+    float q_b = histogram.quantile(params.quantile_b);
     float shift = std::max(10.0f, params.shift_multiplier * (q_a + q_b));
     float scale = std::max(1.0f, params.scale_multiplier * (q_b - q_a));
     return {shift, scale};
@@ -83,11 +93,11 @@ int determine_rna_adapter_pos(const dorado::SimplexRead& read, SampleType model_
     int break_point = 0;
     const int signal_start = kOffsetMap.at(model_type);
     const int signal_end = 3 * signal_len / 4;
+    // Consecutive windows overlap by all but kStride samples, so update the median incrementally.
+    dorado::utils::SlidingMedian window(kWindowSize);
     for (int i = signal_start; i < signal_end; i += kStride) {
-        auto slice = at::from_blob(const_cast<int16_t*>(&signal[i]),
-                                   {static_cast<int>(std::min(kWindowSize, signal_len - i))},
-                                   at::TensorOptions().dtype(at::kShort));
-        int16_t median = slice.median().item<int16_t>();
+        window.move_to(signal, i, i + std::min(kWindowSize, signal_len - i));
+        int16_t median = window.median();
         medians[median_pos % medians.size()] = median;
         // Since the medians are stored in a circular buffer, we need
         // to store the actual window positions for the median values
@@ -122,151 +132,159 @@ int determine_rna_adapter_pos(const dorado::SimplexRead& read, SampleType model_
 
 namespace dorado {
 
-void ScalerNode::input_thread_fn() {
-    at::InferenceMode inference_mode_guard;
-
-    Message message;
-    while (get_input_message(message)) {
-        // If this message isn't a Simplex read, just forward it to the sink.
-        if (!std::holds_alternative<SimplexReadPtr>(message)) {
-            send_message_to_sink(std::move(message));
-            continue;
-        }
-
-        auto read = std::get<SimplexReadPtr>(std::move(message));
-
-        bool is_rna_model =
-                (m_model_type == SampleType::RNA002 || m_model_type == SampleType::RNA004);
-
-        // Trim adapter for RNA first before scaling.
-        int trim_start = 0;
-        if (is_rna_model) {
-            std::shared_ptr<const demux::AdapterInfo> adapter_info =
-                    read->read_common.client_info ? read->read_common.client_info->contexts()
-                                                            .get_ptr<const demux::AdapterInfo>()
-                                                  : nullptr;
-
-            const bool has_rna_based_adapters = adapter_info && adapter_info->rna_adapters;
-            if (!has_rna_based_adapters) {
-                trim_start = determine_rna_adapter_pos(*read, m_model_type);
-                if (size_t(trim_start) < read->read_common.get_raw_data_samples()) {
-                    read->read_common.raw_data = read->read_common.raw_data.index(
-                            {Slice(trim_start, at::indexing::None)});
-                    read->read_common.rna_adapter_end_signal_pos = 0;
-                } else {
-                    // If RNA adapter isn't trimmed, track where the adapter signal is ending
-                    // so it can be used during polyA estimation.
-                    read->read_common.rna_adapter_end_signal_pos = trim_start;
-                    // Since we're not actualy trimming the signal, reset the trim value to 0.
-                    trim_start = 0;
-                }
+void ScalerNode::scale_read(SimplexRead& read) {
+    bool is_rna_model =
+            (m_model_type == SampleType::RNA002 || m_model_type == SampleType::RNA004);
+
+    // Trim adapter for RNA first before scaling.
+    int trim_start = 0;
+    if (is_rna_model) {
+        std::shared_ptr<const demux::AdapterInfo> adapter_info =
+                read.read_common.client_info ? read.read_common.client_info->contexts()
+                                                       .get_ptr<const demux::AdapterInfo>()
+                                             : nullptr;
+
+        const bool has_rna_based_adapters = adapter_info && adapter_info->rna_adapters;
+        if (!has_rna_based_adapters) {
+            trim_start = determine_rna_adapter_pos(read, m_model_type);
+            if (size_t(trim_start) < read.read_common.get_raw_data_samples()) {
+                read.read_common.raw_data = read.read_common.raw_data.index(
+                        {Slice(trim_start, at::indexing::None)});
+                read.read_common.rna_adapter_end_signal_pos = 0;
+            } else {
+                // If RNA adapter isn't trimmed, track where the adapter signal is ending
+                // so it can be used during polyA estimation.
+                read.read_common.rna_adapter_end_signal_pos = trim_start;
+                // Since we're not actualy trimming the signal, reset the trim value to 0.
+                trim_start = 0;
             }
         }
+    }
 
-        // Note: Temporarily disabling the rapid adapter trimming since in some datasets it overtrims
-        // the signal leading to barcode information being lost.
-        // Further details in ticket DOR-695
+    // Note: Temporarily disabling the rapid adapter trimming since in some datasets it overtrims
+    // the signal leading to barcode information being lost.
+    // Further details in ticket DOR-695
 #if 0
-        // Activate rapid adapter trimming when while basecalling DNA where the sequencing kit
-        // has a rapid adapter
-        bool trim_rapid_adapter = !is_rna_model && m_rapid_settings.active &&
-            read->read_common.rapid_chemistry == models::RapidChemistry::V1;
-
-        if (trim_rapid_adapter) {
-            const auto trim_rapid_adapter_idx = utils::rapid::find_rapid_adapter_trim_pos(
-                    read->read_common.raw_data, m_rapid_settings);
-            if (trim_rapid_adapter_idx < 0) {
-                spdlog::trace("ScalerNode: {} rapid_adapter_trim - failed",
-                        read->read_common.read_id);
-            } else {
-                spdlog::trace("ScalerNode: {} rapid_adapter_trim - trim_index: {}",
-                        read->read_common.read_id, trim_rapid_adapter_idx);
-                trim_start = static_cast<int>(trim_rapid_adapter_idx);
-            }
+    // Activate rapid adapter trimming when while basecalling DNA where the sequencing kit
+    // has a rapid adapter
+    bool trim_rapid_adapter = !is_rna_model && m_rapid_settings.active &&
+        read.read_common.rapid_chemistry == models::RapidChemistry::V1;
+
+    if (trim_rapid_adapter) {
+        const auto trim_rapid_adapter_idx = utils::rapid::find_rapid_adapter_trim_pos(
+                read.read_common.raw_data, m_rapid_settings);
+        if (trim_rapid_adapter_idx < 0) {
+            spdlog::trace("ScalerNode: {} rapid_adapter_trim - failed",
+                    read.read_common.read_id);
+        } else {
+            spdlog::trace("ScalerNode: {} rapid_adapter_trim - trim_index: {}",
+                    read.read_common.read_id, trim_rapid_adapter_idx);
+            trim_start = static_cast<int>(trim_rapid_adapter_idx);
         }
+    }
 #endif
 
-        assert(read->read_common.raw_data.dtype() == at::kShort);
-
-        float scale = 1.0f;
-        float shift = 0.0f;
-
-        read->read_common.scaling_method = to_string(m_scaling_params.strategy);
-        if (m_scaling_params.strategy == ScalingStrategy::PA) {
-            // We want to keep the scaling formula `(x - shift) / scale` consistent between
-            // quantile and pA methods as this affects downstream tools.
-            const auto& stdn = m_scaling_params.standarisation;
-            if (stdn.standardise) {
-                // Standardise from scaled pa
-                // 1. x_pa  = (Scale)*(x + Offset)
-                // 2. x_std = (1 / Stdev)*(x_pa - Mean)
-                // => x_std = (Scale / Stdev)*(x + (Offset - (Mean / Scale)))
-                // => x_std = (x - ((Mean / Scale) - Offset)) / (Stdev / Scale)
-                scale = stdn.stdev / read->scaling;
-                shift = (stdn.mean / read->scaling) - read->offset;
-            } else {
-                scale = 1.f / read->scaling;
-                shift = -1.f * read->offset;
-            }
-
-            read->read_common.raw_data =
-                    ((read->read_common.raw_data.to(at::kFloat) - shift) / scale)
-                            .to(at::ScalarType::Half);
+    assert(read.read_common.raw_data.dtype() == at::kShort);
 
-            read->read_common.scale = scale;
-            read->read_common.shift = shift;
+    float scale = 1.0f;
+    float shift = 0.0f;
+
+    read.read_common.scaling_method = to_string(m_scaling_params.strategy);
+    if (m_scaling_params.strategy == ScalingStrategy::PA) {
+        // We want to keep the scaling formula `(x - shift) / scale` consistent between
+        // quantile and pA methods as this affects downstream tools.
+        const auto& stdn = m_scaling_params.standarisation;
+        if (stdn.standardise) {
+            // Standardise from scaled pa
+            // 1. x_pa  = (Scale)*(x + Offset)
+            // 2. x_std = (1 / Stdev)*(x_pa - Mean)
+            // => x_std = (Scale / Stdev)*(x + (Offset - (Mean / Scale)))
+            // => x_std = (x - ((Mean / Scale) - Offset)) / (Stdev / Scale)
+            scale = stdn.stdev / read.scaling;
+            shift = (stdn.mean / read.scaling) - read.offset;
         } else {
-            // Ignore the RNA adapter. If this is DNA or we've already trimmed the adapter, this will be zero
-            auto scaling_data = read->read_common.raw_data.index(
-                    {Slice(read->read_common.rna_adapter_end_signal_pos, at::indexing::None)});
-            std::tie(shift, scale) =
-                    m_scaling_params.strategy == ScalingStrategy::QUANTILE
-                            ? normalisation(m_scaling_params.quantile, scaling_data)
-                            : med_mad(scaling_data);
-
-            // raw_data comes from DataLoader with dtype int16.  We send it on as float16 after
-            // shifting/scaling in float32 form.
-            read->read_common.raw_data =
-                    ((read->read_common.raw_data.to(at::kFloat) - shift) / scale)
-                            .to(at::ScalarType::Half);
-            // move the shift and scale into pA.
-            read->read_common.scale = read->scaling * scale;
-            read->read_common.shift = read->scaling * (shift + read->offset);
+            scale = 1.f / read.scaling;
+            shift = -1.f * read.offset;
         }
 
-        // Don't perform DNA trimming on RNA since it looks too different and we lose useful signal.
-        if (!is_rna_model) {
-            if (trim_start == 0 && m_scaling_params.standarisation.standardise) {
-                // Constant trimming level for standardised scaling
-                // In most cases kit14 trim algorithm returns 10, so bypassing the heuristic
-                // and applying 10 for pA scaled data.
-                // TODO: may need refinement in the future
-                trim_start = 10;
-            } else if (trim_start == 0) {
-                // 8000 value may be changed in future. Currently this is found to work well.
-                int max_samples = std::min(
-                        8000, static_cast<int>(read->read_common.get_raw_data_samples() / 2));
-                trim_start = utils::trim(
-                        read->read_common.raw_data.index({Slice(at::indexing::None, max_samples)}),
-                        utils::DEFAULT_TRIM_THRESHOLD, utils::DEFAULT_TRIM_WINDOW_SIZE,
-                        utils::DEFAULT_TRIM_MIN_ELEMENTS);
-            }
+        read.read_common.raw_data =
+                ((read.read_common.raw_data.to(at::kFloat) - shift) / scale)
+                        .to(at::ScalarType::Half);
+
+        read.read_common.scale = scale;
+        read.read_common.shift = shift;
+    } else {
+        // Ignore the RNA adapter. If this is DNA or we've already trimmed the adapter, this will be zero
+        auto scaling_data = read.read_common.raw_data.index(
+                {Slice(read.read_common.rna_adapter_end_signal_pos, at::indexing::None)});
+        std::tie(shift, scale) =
+                m_scaling_params.strategy == ScalingStrategy::QUANTILE
+                        ? normalisation(m_scaling_params.quantile, scaling_data)
+                        : med_mad(scaling_data);
+
+        // raw_data comes from DataLoader with dtype int16.  We send it on as float16 after
+        // shifting/scaling in float32 form.
+        read.read_common.raw_data =
+                ((read.read_common.raw_data.to(at::kFloat) - shift) / scale)
+                        .to(at::ScalarType::Half);
+        // move the shift and scale into pA.
+        read.read_common.scale = read.scaling * scale;
+        read.read_common.shift = read.scaling * (shift + read.offset);
+    }
 
-            if (size_t(trim_start) < read->read_common.get_raw_data_samples()) {
-                read->read_common.raw_data =
-                        read->read_common.raw_data.index({Slice(trim_start, at::indexing::None)});
-            } else {
-                trim_start = 0;
-            }
+    // Don't perform DNA trimming on RNA since it looks too different and we lose useful signal.
+    if (!is_rna_model) {
+        if (trim_start == 0 && m_scaling_params.standarisation.standardise) {
+            // Constant trimming level for standardised scaling
+            // In most cases kit14 trim algorithm returns 10, so bypassing the heuristic
+            // and applying 10 for pA scaled data.
+            // TODO: may need refinement in the future
+            trim_start = 10;
+        } else if (trim_start == 0) {
+            // 8000 value may be changed in future. Currently this is found to work well.
+            int max_samples = std::min(
+                    8000, static_cast<int>(read.read_common.get_raw_data_samples() / 2));
+            trim_start = utils::trim(
+                    read.read_common.raw_data.index({Slice(at::indexing::None, max_samples)}),
+                    utils::DEFAULT_TRIM_THRESHOLD, utils::DEFAULT_TRIM_WINDOW_SIZE,
+                    utils::DEFAULT_TRIM_MIN_ELEMENTS);
         }
 
-        read->read_common.num_trimmed_samples = trim_start;
+        if (size_t(trim_start) < read.read_common.get_raw_data_samples()) {
+            read.read_common.raw_data =
+                    read.read_common.raw_data.index({Slice(trim_start, at::indexing::None)});
+        } else {
+            trim_start = 0;
+        }
+    }
+
+    read.read_common.num_trimmed_samples = trim_start;
 
-        spdlog::trace("ScalerNode: {} shift: {} scale: {} trim: {}", read->read_common.read_id,
-                      shift, scale, trim_start);
+    spdlog::trace("ScalerNode: {} shift: {} scale: {} trim: {}", read.read_common.read_id,
+                  shift, scale, trim_start);
+}
+
+void ScalerNode::input_thread_fn() {
+    at::InferenceMode inference_mode_guard;
+
+    std::vector<Message> messages;
+    std::vector<Message> outputs;
+    while (get_input_messages(messages, MAX_INPUT_BATCH_SIZE)) {
+        for (auto& message : messages) {
+            // If this message isn't a Simplex read, just forward it to the sink.
+            if (!std::holds_alternative<SimplexReadPtr>(message)) {
+                outputs.push_back(std::move(message));
+                continue;
+            }
+
+            auto read = std::get<SimplexReadPtr>(std::move(message));
+            scale_read(*read);
+            outputs.push_back(std::move(read));
+        }
 
-        // Pass the read to the next node
-        send_message_to_sink(std::move(read));
+        // Pass the batch on to the next node
+        send_messages_to_sink(std::move(outputs));
+        outputs.clear();
     }
 }
 
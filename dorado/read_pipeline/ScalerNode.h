@@ -27,6 +27,8 @@ public:
 
 private:
     void input_thread_fn();
+    // Trims and normalises the read's signal in place.
+    void scale_read(SimplexRead& read);
 
     const basecall::SignalNormalisationParams m_scaling_params;
     const models::SampleType m_model_type;
@@ -2,11 +2,26 @@
 
 #include "modbase/ModBaseContext.h"
 #include "stereo_features.h"
+#include "utils/bam_record_builder.h"
 #include "utils/bam_utils.h"
 #include "utils/sequence_utils.h"
 
 #include <htslib/sam.h>
 
+#include <charconv>
+
+namespace {
+
+// Appends ",<skipped_bases>" to an MM tag string.
+void append_skip_count(std::string &modbase_string, int skipped_bases) {
+    char buffer[16];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), skipped_bases);
+    modbase_string += ',';
+    modbase_string.append(buffer, result.ptr);
+}
+
+}  // namespace
+
 namespace dorado {
 
 bool is_read_message(const Message &message) {
@@ -23,7 +38,7 @@ uint64_t SimplexRead::get_end_time_ms() const {
 std::string ReadCommon::generate_read_group() const {
     std::string read_group;
     if (!run_id.empty()) {
-        read_group = run_id + '_';
+        read_group = run_id.str() + '_';
         if (model_name.empty()) {
             read_group += "unknown";
         } else {
@@ -36,104 +51,68 @@ std::string ReadCommon::generate_read_group() const {
     return read_group;
 }
 
-void ReadCommon::generate_read_tags(bam1_t *aln, bool emit_moves, bool is_duplex_parent) const {
-    float qs = calculate_mean_qscore();
-    bam_aux_append(aln, "qs", 'f', sizeof(qs), (uint8_t *)&qs);
-
-    float du = (float)(get_raw_data_samples() + num_trimmed_samples) / (float)sample_rate;
-    bam_aux_append(aln, "du", 'f', sizeof(du), (uint8_t *)&du);
-
-    int ns = int(get_raw_data_samples() + num_trimmed_samples);
-    bam_aux_append(aln, "ns", 'i', sizeof(ns), (uint8_t *)&ns);
-
-    int ts = int(num_trimmed_samples);
-    bam_aux_append(aln, "ts", 'i', sizeof(ts), (uint8_t *)&ts);
-
-    int mx = attributes.mux;
-    bam_aux_append(aln, "mx", 'i', sizeof(mx), (uint8_t *)&mx);
-
-    int ch = attributes.channel_number;
-    bam_aux_append(aln, "ch", 'i', sizeof(ch), (uint8_t *)&ch);
-
-    bam_aux_append(aln, "st", 'Z', int(attributes.start_time.length() + 1),
-                   (uint8_t *)attributes.start_time.c_str());
+void ReadCommon::generate_read_tags(utils::BamRecordBuilder &builder,
+                                    bool emit_moves,
+                                    bool is_duplex_parent) const {
+    const auto num_samples = get_raw_data_samples() + num_trimmed_samples;
+    builder.append_float("qs", calculate_mean_qscore());
+    builder.append_float("du", (float)num_samples / (float)sample_rate);
+    builder.append_int("ns", int(num_samples));
+    builder.append_int("ts", int(num_trimmed_samples));
+    builder.append_int("mx", int(attributes.mux));
+    builder.append_int("ch", attributes.channel_number);
+    builder.append_string("st", attributes.start_time);
 
     // For reads which are the result of read splitting, the read number will be set to -1
-    int rn = attributes.read_number;
-    bam_aux_append(aln, "rn", 'i', sizeof(rn), (uint8_t *)&rn);
-
-    bam_aux_append(aln, "fn", 'Z', int(attributes.fast5_filename.length() + 1),
-                   (uint8_t *)attributes.fast5_filename.c_str());
-
-    float sm = shift;
-    bam_aux_append(aln, "sm", 'f', sizeof(sm), (uint8_t *)&sm);
-
-    float sd = scale;
-    bam_aux_append(aln, "sd", 'f', sizeof(sd), (uint8_t *)&sd);
-
-    bam_aux_append(aln, "sv", 'Z', int(scaling_method.size() + 1),
-                   (uint8_t *)scaling_method.c_str());
-
-    int32_t dx = (is_duplex_parent ? -1 : 0);
-    bam_aux_append(aln, "dx", 'i', sizeof(dx), (uint8_t *)&dx);
+    builder.append_int("rn", attributes.read_number);
+    builder.append_string("fn", attributes.fast5_filename);
+    builder.append_float("sm", shift);
+    builder.append_float("sd", scale);
+    builder.append_string("sv", scaling_method);
+    builder.append_int("dx", is_duplex_parent ? -1 : 0);
 
     auto rg = generate_read_group();
     if (!rg.empty()) {
-        bam_aux_append(aln, "RG", 'Z', int(rg.length() + 1), (uint8_t *)rg.c_str());
+        builder.append_string("RG", rg);
     }
 
     if (!parent_read_id.empty()) {
-        bam_aux_append(aln, "pi", 'Z', int(parent_read_id.size() + 1),
-                       (uint8_t *)parent_read_id.c_str());
+        builder.append_string("pi", parent_read_id);
         // For split reads, also store the start coordinate of the new read
         // in the original signal.
-        bam_aux_append(aln, "sp", 'i', sizeof(split_point), (uint8_t *)&split_point);
+        builder.append_int("sp", int32_t(split_point));
     }
 
     if (emit_moves) {
-        std::vector<uint8_t> m(moves.size() + 1, 0);
+        uint8_t *m = builder.append_byte_array("mv", 'c', moves.size() + 1);
         m[0] = uint8_t(model_stride);
-
-        for (size_t idx = 0; idx < moves.size(); idx++) {
-            m[idx + 1] = static_cast<uint8_t>(moves[idx]);
-        }
-
-        bam_aux_update_array(aln, "mv", 'c', int(m.size()), (uint8_t *)m.data());
+        std::copy(moves.begin(), moves.end(), m + 1);
     }
 
     if (rna_poly_tail_length >= 0) {
-        bam_aux_append(aln, "pt", 'i', sizeof(rna_poly_tail_length),
-                       (uint8_t *)&rna_poly_tail_length);
+        builder.append_int("pt", rna_poly_tail_length);
     }
 }
 
-void ReadCommon::generate_duplex_read_tags(bam1_t *aln) const {
-    float qs = calculate_mean_qscore();
-    bam_aux_append(aln, "qs", 'f', sizeof(qs), (uint8_t *)&qs);
-    uint32_t duplex = 1;
-    bam_aux_append(aln, "dx", 'i', sizeof(duplex), (uint8_t *)&duplex);
-
-    int mx = attributes.mux;
-    bam_aux_append(aln, "mx", 'i', sizeof(mx), (uint8_t *)&mx);
-
-    int ch = attributes.channel_number;
-    bam_aux_append(aln, "ch", 'i', sizeof(ch), (uint8_t *)&ch);
-
-    bam_aux_append(aln, "st", 'Z', int(attributes.start_time.length() + 1),
-                   (uint8_t *)attributes.start_time.c_str());
+void ReadCommon::generate_duplex_read_tags(utils::BamRecordBuilder &builder) const {
+    builder.append_float("qs", calculate_mean_qscore());
+    builder.append_int("dx", 1);
+    builder.append_int("mx", int(attributes.mux));
+    builder.append_int("ch", attributes.channel_number);
+    builder.append_string("st", attributes.start_time);
 
     auto rg = generate_read_group();
     if (!rg.empty()) {
-        bam_aux_append(aln, "RG", 'Z', int(rg.length() + 1), (uint8_t *)rg.c_str());
+        builder.append_string("RG", rg);
     }
 
     if (!parent_read_id.empty()) {
-        bam_aux_append(aln, "pi", 'Z', int(parent_read_id.size() + 1),
-                       (uint8_t *)parent_read_id.c_str());
+        builder.append_string("pi", parent_read_id);
     }
 }
 
-void ReadCommon::generate_modbase_tags(bam1_t *aln, uint8_t threshold) const {
+void ReadCommon::generate_modbase_tags(utils::BamRecordBuilder &builder,
+                                       uint8_t threshold) const {
     if (!mod_base_info) {
         return;
     }
@@ -147,8 +126,12 @@ void ReadCommon::generate_modbase_tags(bam1_t *aln, uint8_t threshold) const {
                 "modbase_alphabet!");
     }
 
-    std::string modbase_string = "";
+    // Each modified base adds a skip count to MM and a probability to ML, so reserve enough
+    // for a typical read up front rather than regrowing them.
+    std::string modbase_string;
+    modbase_string.reserve(64 + 2 * seq.size());
     std::vector<uint8_t> modbase_prob;
+    modbase_prob.reserve(seq.size());
 
     // Create a mask indicating which bases are modified.
     std::unordered_map<char, bool> base_has_context = {
@@ -218,13 +201,15 @@ void ReadCommon::generate_modbase_tags(bam1_t *aln, uint8_t threshold) const {
             }
 
             // Write out the results we found
-            modbase_string += std::string(1, current_cardinal) + "+" + bam_name;
-            modbase_string += base_has_context[current_cardinal] ? "?" : ".";
+            modbase_string += current_cardinal;
+            modbase_string += '+';
+            modbase_string += bam_name;
+            modbase_string += base_has_context[current_cardinal] ? '?' : '.';
             int skipped_bases = 0;
             for (size_t base_idx = 0; base_idx < seq.size(); base_idx++) {
                 if (seq[base_idx] == current_cardinal) {
                     if (modbase_mask[base_idx]) {
-                        modbase_string += "," + std::to_string(skipped_bases);
+                        append_skip_count(modbase_string, skipped_bases);
                         skipped_bases = 0;
                         modbase_prob.push_back(
                                 base_mod_probs[base_idx * num_channels + channel_idx]);
@@ -253,13 +238,15 @@ void ReadCommon::generate_modbase_tags(bam1_t *aln, uint8_t threshold) const {
                     return;
                 }
 
-                modbase_string += std::string(1, cardinal_complement) + "-" + bam_name;
-                modbase_string += base_has_context[current_cardinal] ? "?" : ".";
+                modbase_string += cardinal_complement;
+                modbase_string += '-';
+                modbase_string += bam_name;
+                modbase_string += base_has_context[current_cardinal] ? '?' : '.';
                 int skipped_bases = 0;
                 for (size_t base_idx = 0; base_idx < seq.size(); base_idx++) {
                     if (seq[base_idx] == cardinal_complement) {  // complement
                         if (modbase_mask[base_idx]) {            // Not sure this one is right
-                            modbase_string += "," + std::to_string(skipped_bases);
+                            append_skip_count(modbase_string, skipped_bases);
                             skipped_bases = 0;
                             modbase_prob.push_back(
                                     base_mod_probs[base_idx * num_channels + channel_idx]);
@@ -274,11 +261,10 @@ void ReadCommon::generate_modbase_tags(bam1_t *aln, uint8_t threshold) const {
         }
     }
 
-    int seq_len = int(seq.length());
-    bam_aux_append(aln, "MN", 'i', sizeof(seq_len), (uint8_t *)&seq_len);
-    bam_aux_append(aln, "MM", 'Z', int(modbase_string.length() + 1),
-                   (uint8_t *)modbase_string.c_str());
-    bam_aux_update_array(aln, "ML", 'C', int(modbase_prob.size()), (uint8_t *)modbase_prob.data());
+    builder.append_int("MN", int(seq.length()));
+    builder.append_string("MM", modbase_string);
+    uint8_t *ml = builder.append_byte_array("ML", 'C', modbase_prob.size());
+    std::copy(modbase_prob.begin(), modbase_prob.end(), ml);
 }
 
 float ReadCommon::calculate_mean_qscore() const {
@@ -314,35 +300,29 @@ std::vector<BamPtr> ReadCommon::extract_sam_lines(bool emit_moves,
         throw std::runtime_error("Empty sequence and qstring provided for read id " + read_id);
     }
 
-    std::vector<BamPtr> alns;
-
-    bam1_t *aln = bam_init1();
-    uint32_t flags = 4;     // 4 = UNMAPPED
-    int leftmost_pos = -1;  // UNMAPPED - will be written as 0
-    int map_q = 0;          // UNMAPPED
-    int next_pos = -1;      // UNMAPPED - will be written as 0
-
-    // Convert string qscore to phred vector.
-    std::vector<uint8_t> qscore;
-    std::transform(qstring.begin(), qstring.end(), std::back_inserter(qscore),
-                   [](char c) { return (uint8_t)(c)-33; });
-
-    bam_set1(aln, read_id.length(), read_id.c_str(), uint16_t(flags), -1, leftmost_pos,
-             uint8_t(map_q), 0, nullptr, -1, next_pos, 0, seq.length(), seq.c_str(),
-             (char *)qscore.data(), 0);
+    // Reserve for the fixed size tags plus the variable length ones, so that usually only the
+    // modbase tags (if any) need the tag buffer to grow.
+    size_t reserve_aux_bytes = 256 + barcode.size() + attributes.start_time.size() +
+                               attributes.fast5_filename.size() + scaling_method.size() +
+                               parent_read_id.size() + run_id.size() + model_name.size();
+    if (emit_moves) {
+        reserve_aux_bytes += moves.size() + 1;
+    }
+    utils::BamRecordBuilder builder(reserve_aux_bytes);
 
     if (!barcode.empty() && barcode != "unclassified") {
-        bam_aux_append(aln, "BC", 'Z', int(barcode.length() + 1), (uint8_t *)barcode.c_str());
+        builder.append_string("BC", barcode);
     }
 
     if (is_duplex) {
-        generate_duplex_read_tags(aln);
+        generate_duplex_read_tags(builder);
     } else {
-        generate_read_tags(aln, emit_moves, is_duplex_parent);
+        generate_read_tags(builder, emit_moves, is_duplex_parent);
     }
-    generate_modbase_tags(aln, modbase_threshold);
-    alns.push_back(BamPtr(aln));
+    generate_modbase_tags(builder, modbase_threshold);
 
+    std::vector<BamPtr> alns;
+    alns.push_back(builder.build(read_id, 4 /* UNMAPPED */, seq, qstring));
     return alns;
 }
 
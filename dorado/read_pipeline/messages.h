@@ -2,6 +2,8 @@
 
 #include "models/kits.h"
 #include "utils/cigar.h"
+#include "utils/interned_string.h"
+#include "utils/minimizer_sketch.h"
 #include "utils/overlap.h"
 #include "utils/types.h"
 
@@ -18,6 +20,10 @@
 
 namespace dorado {
 
+namespace utils {
+class BamRecordBuilder;
+}
+
 namespace details {
 
 struct Attributes {
@@ -46,12 +52,14 @@ public:
     std::string qstring;                  // Read Qstring (Phred)
     std::vector<uint8_t> moves;           // Move table
     std::vector<uint8_t> base_mod_probs;  // Modified base probabilities
-    std::string run_id;                   // Run ID - used in read group
-    std::string flow_cell_product_code;   // Flowcell product code
-    std::string flowcell_id;    // Flowcell ID - used in read group and for sample sheet aliasing
-    std::string position_id;    // Position ID - used for sample sheet aliasing
-    std::string experiment_id;  // Experiment ID - used for sample sheet aliasing
-    std::string model_name;     // Read group
+
+    // Run-level values are interned, since every read from the same run shares them.
+    utils::InternedString run_id;                  // Run ID - used in read group
+    utils::InternedString flow_cell_product_code;  // Flowcell product code
+    utils::InternedString flowcell_id;  // Flowcell ID - used in read group and for aliasing
+    utils::InternedString position_id;  // Position ID - used for sample sheet aliasing
+    utils::InternedString experiment_id;  // Experiment ID - used for sample sheet aliasing
+    utils::InternedString model_name;     // Read group
 
     dorado::details::Attributes attributes;
 
@@ -127,9 +135,11 @@ public:
     float model_q_scale{0.0f};
 
 private:
-    void generate_duplex_read_tags(bam1_t*) const;
-    void generate_read_tags(bam1_t* aln, bool emit_moves, bool is_duplex_parent) const;
-    void generate_modbase_tags(bam1_t* aln, uint8_t threshold) const;
+    void generate_duplex_read_tags(utils::BamRecordBuilder& builder) const;
+    void generate_read_tags(utils::BamRecordBuilder& builder,
+                            bool emit_moves,
+                            bool is_duplex_parent) const;
+    void generate_modbase_tags(utils::BamRecordBuilder& builder, uint8_t threshold) const;
     std::string generate_read_group() const;
 };
 
@@ -185,6 +195,10 @@ public:
     // Track the previous/next read fom the same channel/mux.
     std::string prev_read;
     std::string next_read;
+
+    // Sketch of the sequence, used to screen duplex pair candidates.  Only populated while the
+    // read is held in PairingNode's read cache.
+    utils::MinimizerSketch pairing_sketch;
 };
 
 using SimplexReadPtr = std::unique_ptr<SimplexRead>;
@@ -5,77 +5,132 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
 
 namespace dorado::utils {
 
-void stitch_chunks(ReadCommon& read_common,
-                   const std::vector<std::unique_ptr<Chunk>>& called_chunks) {
-    assert(static_cast<int>(div_round_closest(called_chunks[0]->raw_chunk_size,
-                                              called_chunks[0]->moves.size())) ==
-           read_common.model_stride);
-
-    int start_pos = 0;
-    int mid_point_front = 0;
-    std::vector<uint8_t> moves;
-    std::vector<std::string> sequences;
-    std::vector<std::string> qstrings;
-
-    for (int i = 0; i < int(called_chunks.size() - 1); i++) {
-        auto& current_chunk = called_chunks[i];
-        auto& next_chunk = called_chunks[i + 1];
-        int overlap_size = int((current_chunk->raw_chunk_size + current_chunk->input_offset) -
-                               (next_chunk->input_offset));
-        assert(overlap_size % read_common.model_stride == 0);
-        int overlap_down_sampled = overlap_size / read_common.model_stride;
-        int mid_point_rear = overlap_down_sampled / 2;
+ChunkStitcher::ChunkStitcher(std::vector<size_t> chunk_offsets,
+                             int model_stride,
+                             size_t num_samples)
+        : m_chunk_offsets(std::move(chunk_offsets)),
+          m_model_stride(model_stride),
+          m_num_samples(num_samples) {
+    if (m_chunk_offsets.empty()) {
+        throw std::runtime_error("ChunkStitcher requires at least one chunk");
+    }
+    // The stitched moves cover the signal, plus up to one partial stride that's removed at the
+    // end.  Reserving that up front means the moves never need to be reallocated.  The bases are
+    // reserved once the first chunk arrives, see reserve_bases().
+    m_moves.reserve(max_moves());
+}
 
-        int current_chunk_bases_to_trim =
-                std::accumulate(std::prev(current_chunk->moves.end(), mid_point_rear),
-                                current_chunk->moves.end(), 0);
+size_t ChunkStitcher::max_moves() const { return m_num_samples / m_model_stride + 1; }
+
+void ChunkStitcher::reserve_bases(const Chunk& first_chunk) {
+    // There's at most one base per move, but typically about half that, and whatever is reserved
+    // stays with the read for the rest of the pipeline.  So estimate the number of bases from the
+    // first chunk's bases per move, with some headroom so that the estimate is rarely exceeded.
+    size_t num_bases = max_moves();
+    if (!first_chunk.moves.empty()) {
+        const double bases_per_move =
+                double(first_chunk.seq.size()) / double(first_chunk.moves.size());
+        num_bases = std::min(num_bases, size_t(std::ceil(num_bases * bases_per_move * 1.25)));
+    }
+    m_seq.reserve(num_bases);
+    m_qstring.reserve(num_bases);
+}
 
-        int current_chunk_seq_len = int(current_chunk->seq.size());
-        int end_pos = current_chunk_seq_len - current_chunk_bases_to_trim;
-        int trimmed_len = end_pos - start_pos;
-        sequences.push_back(current_chunk->seq.substr(start_pos, trimmed_len));
-        qstrings.push_back(current_chunk->qstring.substr(start_pos, trimmed_len));
-        moves.insert(moves.end(), std::next(current_chunk->moves.begin(), mid_point_front),
-                     std::prev(current_chunk->moves.end(), mid_point_rear));
+bool ChunkStitcher::add_chunk(size_t idx, std::unique_ptr<Chunk> chunk) {
+    if (idx < m_num_stitched || idx >= m_chunk_offsets.size()) {
+        throw std::runtime_error("Invalid chunk index " + std::to_string(idx));
+    }
+    if (idx != m_num_stitched) {
+        if (m_pending_chunks.empty()) {
+            m_pending_chunks.resize(m_chunk_offsets.size());
+        }
+        m_pending_chunks[idx] = std::move(chunk);
+        return false;
+    }
 
-        mid_point_front = overlap_down_sampled - mid_point_rear;
+    stitch_chunk(*chunk);
+    chunk.reset();
+    // Stitch any chunks that were waiting on this one.
+    while (!complete() && !m_pending_chunks.empty() && m_pending_chunks[m_num_stitched]) {
+        auto next_chunk = std::move(m_pending_chunks[m_num_stitched]);
+        stitch_chunk(*next_chunk);
+    }
+    return complete();
+}
 
-        start_pos = 0;
-        for (int j = 0; j < mid_point_front; j++) {
-            start_pos += (int)next_chunk->moves[j];
-        }
+void ChunkStitcher::stitch_chunk(const Chunk& chunk) {
+    assert(!complete());
+    assert(chunk.input_offset == m_chunk_offsets[m_num_stitched]);
+    assert(static_cast<int>(div_round_closest(chunk.raw_chunk_size, chunk.moves.size())) ==
+           m_model_stride);
+    if (m_num_stitched == 0) {
+        reserve_bases(chunk);
     }
 
-    // Append the final chunk
-    auto& last_chunk = called_chunks.back();
-    moves.insert(moves.end(), std::next(last_chunk->moves.begin(), mid_point_front),
-                 last_chunk->moves.end());
+    // Skip the bases in the part of the chunk that the previous chunk covered.
+    const int start_pos = std::accumulate(
+            chunk.moves.begin(), std::next(chunk.moves.begin(), m_mid_point_front), 0);
+    const bool is_last_chunk = m_num_stitched + 1 == m_chunk_offsets.size();
+
+    if (!is_last_chunk) {
+        // Trim the part of the chunk that the next chunk covers.
+        const size_t next_offset = m_chunk_offsets[m_num_stitched + 1];
+        int overlap_size = int((chunk.raw_chunk_size + chunk.input_offset) - next_offset);
+        assert(overlap_size % m_model_stride == 0);
+        int overlap_down_sampled = overlap_size / m_model_stride;
+        int mid_point_rear = overlap_down_sampled / 2;
+
+        int current_chunk_bases_to_trim = std::accumulate(
+                std::prev(chunk.moves.end(), mid_point_rear), chunk.moves.end(), 0);
+
+        int current_chunk_seq_len = int(chunk.seq.size());
+        int end_pos = current_chunk_seq_len - current_chunk_bases_to_trim;
+        int trimmed_len = end_pos - start_pos;
+        m_seq.append(chunk.seq, start_pos, trimmed_len);
+        m_qstring.append(chunk.qstring, start_pos, trimmed_len);
+        m_moves.insert(m_moves.end(), std::next(chunk.moves.begin(), m_mid_point_front),
+                       std::prev(chunk.moves.end(), mid_point_rear));
+
+        m_mid_point_front = overlap_down_sampled - mid_point_rear;
 
-    if (called_chunks.size() == 1) {
+    } else if (m_chunk_offsets.size() == 1) {
         // shorten the sequence, qstring & moves where the read is shorter than chunksize
-        int last_index_in_moves_to_keep =
-                int(read_common.get_raw_data_samples() / read_common.model_stride);
-        moves = std::vector<uint8_t>(moves.begin(), moves.begin() + last_index_in_moves_to_keep);
-        int end = std::accumulate(moves.begin(), moves.end(), 0);
-        sequences.push_back(last_chunk->seq.substr(start_pos, end));
-        qstrings.push_back(last_chunk->qstring.substr(start_pos, end));
+        int last_index_in_moves_to_keep = int(m_num_samples / m_model_stride);
+        auto moves_end = std::next(chunk.moves.begin(), last_index_in_moves_to_keep);
+        int end = std::accumulate(chunk.moves.begin(), moves_end, 0);
+        m_seq.append(chunk.seq, start_pos, end);
+        m_qstring.append(chunk.qstring, start_pos, end);
+        m_moves.insert(m_moves.end(), chunk.moves.begin(), moves_end);
 
     } else {
-        sequences.push_back(last_chunk->seq.substr(start_pos));
-        qstrings.push_back(last_chunk->qstring.substr(start_pos));
+        m_seq.append(chunk.seq, start_pos);
+        m_qstring.append(chunk.qstring, start_pos);
+        m_moves.insert(m_moves.end(), std::next(chunk.moves.begin(), m_mid_point_front),
+                       chunk.moves.end());
+    }
+
+    ++m_num_stitched;
+}
+
+void ChunkStitcher::finish(ReadCommon& read_common) {
+    if (!complete()) {
+        throw std::runtime_error("Attempting to finish stitching an incomplete read");
     }
 
     // Set the read seq and qstring
-    read_common.seq = std::accumulate(sequences.begin(), sequences.end(), std::string(""));
-    read_common.qstring = std::accumulate(qstrings.begin(), qstrings.end(), std::string(""));
-    read_common.moves = std::move(moves);
+    read_common.seq = std::move(m_seq);
+    read_common.qstring = std::move(m_qstring);
+    read_common.moves = std::move(m_moves);
 
     // remove partial stride overhang
     if (static_cast<int>(read_common.moves.size()) >
-        static_cast<int>(read_common.get_raw_data_samples() / read_common.model_stride)) {
+        static_cast<int>(m_num_samples / m_model_stride)) {
         if (read_common.moves.back() == 1) {
             read_common.seq.pop_back();
             read_common.qstring.pop_back();
@@ -86,4 +141,20 @@ void stitch_chunks(ReadCommon& read_common,
     }
 }
 
+void stitch_chunks(ReadCommon& read_common,
+                   const std::vector<std::unique_ptr<Chunk>>& called_chunks) {
+    std::vector<size_t> chunk_offsets;
+    chunk_offsets.reserve(called_chunks.size());
+    for (const auto& chunk : called_chunks) {
+        chunk_offsets.push_back(chunk->input_offset);
+    }
+
+    ChunkStitcher stitcher(std::move(chunk_offsets), read_common.model_stride,
+                           read_common.get_raw_data_samples());
+    for (const auto& chunk : called_chunks) {
+        stitcher.stitch_chunk(*chunk);
+    }
+    stitcher.finish(read_common);
+}
+
 }  // namespace dorado::utils
@@ -23,6 +23,47 @@ struct Chunk {
     std::vector<uint8_t> moves;  // For stitching.
 };
 
+// Stitches a read's chunks together (accounting for overlap) as they are called, so that each
+// chunk can be released once it and the chunks before it are done, rather than holding on to
+// every chunk of the read until the last one has been called.
+class ChunkStitcher {
+public:
+    // |chunk_offsets| are the input offsets of each of the read's chunks, in order.
+    // |num_samples| is the length of the read's signal.
+    ChunkStitcher(std::vector<size_t> chunk_offsets, int model_stride, size_t num_samples);
+
+    // Adds the chunk at index |idx| in the read.  Chunks may arrive in any order: the chunk is
+    // stitched (and released) straight away if all of the chunks before it have been, otherwise
+    // it's held on to until they have.  Returns true once every chunk has been stitched.
+    bool add_chunk(size_t idx, std::unique_ptr<Chunk> chunk);
+
+    // Stitches the next chunk in order.  The caller keeps ownership of |chunk|.
+    void stitch_chunk(const Chunk& chunk);
+
+    bool complete() const { return m_num_stitched == m_chunk_offsets.size(); }
+
+    // Assigns the stitched seq, qstring and moves to |read_common|.  Must be complete.
+    void finish(ReadCommon& read_common);
+
+private:
+    size_t max_moves() const;
+    void reserve_bases(const Chunk& first_chunk);
+
+    const std::vector<size_t> m_chunk_offsets;
+    const int m_model_stride;
+    const size_t m_num_samples;
+
+    // Chunks that are waiting on an earlier chunk.  Only allocated once a chunk arrives early.
+    std::vector<std::unique_ptr<Chunk>> m_pending_chunks;
+    size_t m_num_stitched = 0;
+    // Number of moves at the start of the next chunk that overlap the previous one.
+    size_t m_mid_point_front = 0;
+
+    std::string m_seq;
+    std::string m_qstring;
+    std::vector<uint8_t> m_moves;
+};
+
 // Given a read and its unstitched chunks, stitch the chunks (accounting for overlap) and assign basecalled read and
 // qstring to Read
 void stitch_chunks(ReadCommon& read, const std::vector<std::unique_ptr<Chunk>>& called_chunks);
@@ -219,82 +219,88 @@ PosRanges DuplexReadSplitter::find_muA_adapter_spikes(const ExtRead& read) const
         return {};
     }
 
-    auto match_start_range = [&](std::string_view query, std::int64_t min_start,
-                                 std::int64_t max_start, std::int64_t max_edist,
-                                 bool best_only) -> PosRanges {
+    auto match_best_start = [&](std::string_view query, std::int64_t min_start,
+                                std::int64_t max_start,
+                                std::int64_t max_edist) -> std::optional<PosRange> {
         const auto max_end_pos =
                 std::min<std::int64_t>(read_seq.size(), max_start + query.size() + max_edist);
         if (min_start + static_cast<std::int64_t>(query.size()) > max_end_pos) {
             // Too close to the end.
-            return {};
+            return std::nullopt;
         }
 
         // Trim the sequence.
         const std::string_view seq(read_seq.data() + min_start, max_end_pos - min_start);
 
         // Search the sequence.
-        if (best_only) {
-            auto edlib_cfg = edlibNewAlignConfig(static_cast<int>(max_edist), EDLIB_MODE_HW,
-                                                 EDLIB_TASK_LOC, nullptr, 0);
-            auto edlib_result = edlibAlign(query.data(), static_cast<int>(query.size()), seq.data(),
-                                           static_cast<int>(seq.size()), edlib_cfg);
-            assert(edlib_result.status == EDLIB_STATUS_OK);
-            auto edlib_cleanup = utils::PostCondition([&] { edlibFreeAlignResult(edlib_result); });
-
-            // Add the match if it looks good.
-            PosRanges ranges;
-            if (edlib_result.status == EDLIB_STATUS_OK && edlib_result.editDistance != -1) {
-                PosRange range;
-                range.first = min_start + edlib_result.startLocations[0];
-                range.second = min_start + edlib_result.endLocations[0] + 1;
-                if (static_cast<std::int64_t>(range.first) <= max_start) {
-                    ranges.push_back(range);
-                }
-            }
-            return ranges;
-
-        } else {
-            const auto alignments = myers_align(query, seq, max_edist);
-
-            // Build the results.
-            PosRanges ranges;
-            for (auto alignment : alignments) {
-                if (min_start + static_cast<std::int64_t>(alignment.begin) <= max_start) {
-                    PosRange range;
-                    range.first = min_start + alignment.begin;
-                    range.second = min_start + alignment.end;
-                    ranges.push_back(range);
-                }
+        auto edlib_cfg = edlibNewAlignConfig(static_cast<int>(max_edist), EDLIB_MODE_HW,
+                                             EDLIB_TASK_LOC, nullptr, 0);
+        auto edlib_result = edlibAlign(query.data(), static_cast<int>(query.size()), seq.data(),
+                                       static_cast<int>(seq.size()), edlib_cfg);
+        assert(edlib_result.status == EDLIB_STATUS_OK);
+        auto edlib_cleanup = utils::PostCondition([&] { edlibFreeAlignResult(edlib_result); });
+
+        // Add the match if it looks good.
+        if (edlib_result.status == EDLIB_STATUS_OK && edlib_result.editDistance != -1) {
+            PosRange range;
+            range.first = min_start + edlib_result.startLocations[0];
+            range.second = min_start + edlib_result.endLocations[0] + 1;
+            if (static_cast<std::int64_t>(range.first) <= max_start) {
+                return range;
             }
-
-            // Merge the ranges.
-            std::sort(ranges.begin(), ranges.end());
-            return merge_ranges(ranges, 0);
         }
+        return std::nullopt;
     };
 
-    // Search for muAs.
-    const auto muA_ranges =
-            match_start_range(muA_seq, ignore_start, read_seq.size(), max_muA_edist, false);
+    // Search for muAs and the adapter in a single pass over the read.
+    const std::string_view search_seq(read_seq.data() + ignore_start,
+                                      read_seq.size() - ignore_start);
+    const auto edists = myers_edists({muA_seq, adapter_seq}, search_seq);
+
+    PosRanges muA_ranges;
+    for (auto alignment : myers_find_hits(muA_seq, search_seq, edists[0], max_muA_edist)) {
+        muA_ranges.emplace_back(ignore_start + alignment.begin, ignore_start + alignment.end);
+    }
+    std::sort(muA_ranges.begin(), muA_ranges.end());
+    muA_ranges = merge_ranges(muA_ranges, 0);
     if (muA_ranges.empty()) {
         spdlog::trace("No muA found in read: id={}", read.read->read_common.read_id);
         return {};
     }
 
+    // adapter_hits[i] is the number of positions before i (in search_seq) where an adapter match
+    // within |max_adapter_edist| ends. An edlib match inside a window of the read is at least as
+    // good a match over the whole of search_seq, so windows without any hits can be skipped.
+    std::vector<std::size_t> adapter_hits(edists[1].size() + 1, 0);
+    for (std::size_t i = 0; i < edists[1].size(); ++i) {
+        adapter_hits[i + 1] =
+                adapter_hits[i] + (edists[1][i] <= static_cast<std::size_t>(max_adapter_edist));
+    }
+    // Check for any match ending in (begin, end] in read coordinates.
+    auto has_adapter_hit = [&](std::int64_t begin, std::int64_t end) {
+        const auto first = static_cast<std::size_t>(begin + 1 - ignore_start);
+        const auto last = std::min(static_cast<std::size_t>(end - ignore_start) + 1,
+                                   adapter_hits.size() - 1);
+        return first < last && adapter_hits[last] > adapter_hits[first];
+    };
+
     // Search for any adapters that are close to the muAs.
     PosRanges spike_ranges;
     for (auto muA_range : muA_ranges) {
         const auto adapter_start = std::max(
                 ignore_start, static_cast<std::int64_t>(muA_range.first) - max_muA_adapter_dist);
-        const auto adapter_ranges = match_start_range(adapter_seq, adapter_start, muA_range.first,
-                                                      max_adapter_edist, true);
-        if (adapter_ranges.empty()) {
+        const auto adapter_end = std::min<std::int64_t>(
+                read_seq.size(), muA_range.first + adapter_seq.size() + max_adapter_edist);
+        if (!has_adapter_hit(adapter_start, adapter_end)) {
+            continue;
+        }
+        const auto adapter_range =
+                match_best_start(adapter_seq, adapter_start, muA_range.first, max_adapter_edist);
+        if (!adapter_range) {
             continue;
         }
 
-        // We only wanted the best match.
-        assert(adapter_ranges.size() == 1);
-        const auto adapter_match = adapter_ranges.front();
+        const auto adapter_match = *adapter_range;
         if (adapter_match.first < max_spike_adapter_dist) {
             continue;
         }
@@ -2,6 +2,7 @@
 
 #include "utils/PostCondition.h"
 #include "utils/alignment_utils.h"
+#include "utils/simd.h"
 
 #include <algorithm>
 #include <cassert>
@@ -50,11 +51,123 @@ std::vector<size_t> d_myers(const char* pattern, size_t m, const char* text, siz
     return D;
 }
 
+// Number of queries that are searched for at once.
+constexpr size_t NUM_LANES = 4;
+
+// Fills |edists|[i] with the result of d_myers() for each of the (at most NUM_LANES) |queries|.
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+void d_myers_lanes(const std::string_view* queries,
+                   size_t num_queries,
+                   std::string_view text,
+                   std::vector<size_t>* edists) {
+    assert(num_queries <= NUM_LANES);
+    for (size_t i = 0; i < num_queries; i++) {
+        edists[i] = d_myers(queries[i].data(), queries[i].size(), text.data(), text.size());
+    }
+}
+
+#if ENABLE_AVX2_IMPL
+// Runs the same bit-vector recurrence as d_myers() with one query per 64-bit AVX2 lane, so a
+// single pass over the text serves up to 4 queries. Lanes don't need the same query length since
+// each lane tracks its own score bit.
+__attribute__((target("avx2"))) void d_myers_lanes(const std::string_view* queries,
+                                                   size_t num_queries,
+                                                   std::string_view text,
+                                                   std::vector<size_t>* edists) {
+    assert(num_queries <= NUM_LANES);
+    constexpr size_t MAX_ALPHABET = 256;
+
+    // PM[c] holds the match masks of character c for every lane. Unused lanes never match and
+    // their output is discarded.
+    alignas(32) uint64_t PM[MAX_ALPHABET][NUM_LANES]{};
+    alignas(32) uint64_t last_bit[NUM_LANES]{1, 1, 1, 1};
+    alignas(32) int64_t score[NUM_LANES]{};
+    const size_t n = text.size();
+    for (size_t lane = 0; lane < num_queries; lane++) {
+        const auto& query = queries[lane];
+        const size_t m = query.size();
+        assert(m > 0 && m < 64);
+        for (size_t i = 0; i < m; i++) {
+            PM[static_cast<uint8_t>(query[i])][lane] |= uint64_t{1} << i;
+        }
+        last_bit[lane] = uint64_t{1} << (m - 1);
+        score[lane] = static_cast<int64_t>(m);
+        edists[lane].resize(n + 1);
+        edists[lane][0] = m;
+    }
+
+    const __m256i all_ones = _mm256_set1_epi64x(-1);
+    const __m256i last = _mm256_load_si256(reinterpret_cast<const __m256i*>(last_bit));
+    __m256i VP = all_ones;
+    __m256i VN = _mm256_setzero_si256();
+    __m256i scores = _mm256_load_si256(reinterpret_cast<const __m256i*>(score));
+    for (size_t j = 0; j < n; j++) {
+        const __m256i EQ = _mm256_load_si256(
+                reinterpret_cast<const __m256i*>(PM[static_cast<uint8_t>(text[j])]));
+        const __m256i X = _mm256_and_si256(EQ, VP);
+        const __m256i D0 = _mm256_or_si256(
+                _mm256_or_si256(_mm256_xor_si256(_mm256_add_epi64(X, VP), VP), EQ), VN);
+        __m256i HP = _mm256_or_si256(VN, _mm256_andnot_si256(_mm256_or_si256(D0, VP), all_ones));
+        __m256i HN = _mm256_and_si256(D0, VP);
+
+        // The comparisons are all ones (i.e. -1) in lanes where the score bit is set.
+        scores = _mm256_sub_epi64(scores, _mm256_cmpeq_epi64(_mm256_and_si256(HP, last), last));
+        scores = _mm256_add_epi64(scores, _mm256_cmpeq_epi64(_mm256_and_si256(HN, last), last));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(score), scores);
+        for (size_t lane = 0; lane < num_queries; lane++) {
+            edists[lane][j + 1] = static_cast<size_t>(score[lane]);
+        }
+
+        HP = _mm256_slli_epi64(HP, 1);
+        HN = _mm256_slli_epi64(HN, 1);
+        VP = _mm256_or_si256(HN, _mm256_andnot_si256(_mm256_or_si256(D0, HP), all_ones));
+        VN = _mm256_and_si256(D0, HP);
+    }
+}
+#endif
+
 }  // namespace
 
 std::vector<EdistResult> myers_align(std::string_view query,
                                      std::string_view seq,
                                      std::size_t max_edist) {
+    if (seq.size() < query.size()) {
+        // Too small, don't bother.
+        return {};
+    }
+    const auto local_edists = d_myers(query.data(), query.size(), seq.data(), seq.size());
+    return myers_find_hits(query, seq, local_edists, max_edist);
+}
+
+std::vector<std::vector<std::size_t>> myers_edists(const std::vector<std::string_view>& queries,
+                                                   std::string_view seq) {
+    std::vector<std::vector<std::size_t>> edists(queries.size());
+    for (size_t first = 0; first < queries.size(); first += NUM_LANES) {
+        const auto num_queries = std::min(NUM_LANES, queries.size() - first);
+        d_myers_lanes(queries.data() + first, num_queries, seq, edists.data() + first);
+    }
+    return edists;
+}
+
+std::vector<std::vector<EdistResult>> myers_align_multi(
+        const std::vector<std::string_view>& queries,
+        std::string_view seq,
+        std::size_t max_edist) {
+    const auto edists = myers_edists(queries, seq);
+    std::vector<std::vector<EdistResult>> results(queries.size());
+    for (size_t i = 0; i < queries.size(); i++) {
+        results[i] = myers_find_hits(queries[i], seq, edists[i], max_edist);
+    }
+    return results;
+}
+
+std::vector<EdistResult> myers_find_hits(std::string_view query,
+                                         std::string_view seq,
+                                         const std::vector<std::size_t>& local_edists,
+                                         std::size_t max_edist) {
+    assert(local_edists.size() == seq.size() + 1);
     std::vector<EdistResult> ranges;
     const auto query_len = query.size();
     if (seq.size() < query_len) {
@@ -104,9 +217,6 @@ std::vector<EdistResult> myers_align(std::string_view query,
         }
     };
 
-    // Calculate edit distances for each index.
-    const auto local_edists = d_myers(query.data(), query.size(), seq.data(), seq.size());
-
     // Look for drops below the threshold and join neighbouring ranges together.
     //
     // TODO: can we improve on this, since we have cases such as:
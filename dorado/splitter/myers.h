@@ -15,6 +15,24 @@ std::vector<EdistResult> myers_align(std::string_view query,
                                      std::string_view seq,
                                      std::size_t max_edist);
 
+// Computes the local edit distances of each query (all shorter than 64 bases) against every
+// prefix of |seq| in a single pass, packing several queries into SIMD lanes where available.
+// Entry i of each returned vector is the edist of the query against a suffix of seq[0, i).
+std::vector<std::vector<std::size_t>> myers_edists(const std::vector<std::string_view>& queries,
+                                                   std::string_view seq);
+
+// Finds the hits of |query| in |seq| given its |edists| as returned by myers_edists().
+std::vector<EdistResult> myers_find_hits(std::string_view query,
+                                         std::string_view seq,
+                                         const std::vector<std::size_t>& edists,
+                                         std::size_t max_edist);
+
+// Equivalent to calling myers_align() for each query, but scans |seq| only once.
+std::vector<std::vector<EdistResult>> myers_align_multi(
+        const std::vector<std::string_view>& queries,
+        std::string_view seq,
+        std::size_t max_edist);
+
 void print_edists(std::ostream& os, std::string_view seq, const std::vector<size_t>& edists);
 
 }  // namespace dorado::splitter
@@ -1,5 +1,6 @@
 #include "tensor_utils.h"
 
+#include "utils/signal_histogram.h"
 #include "utils/simd.h"
 
 #include <torch/csrc/jit/serialization/pickle.h>
@@ -111,28 +112,15 @@ at::Tensor quantile(const at::Tensor& t, const at::Tensor& q) {
 at::Tensor quantile_counting(const at::Tensor& t, const at::Tensor& q) {
     assert(q.dtype() == at::ScalarType::Float);
 
-    auto p = t.data_ptr<int16_t>();
-    auto range_min = t.min().item<int16_t>();
-    auto range_max = t.max().item<int16_t>();
+    const auto t_contig = t.contiguous();
+    const SignalHistogram histogram(t_contig.data_ptr<int16_t>(), t_contig.size(0));
 
-    size_t size = t.size(0);
-
-    std::vector<int> counts(range_max - range_min + 1, 0);
-    for (size_t i = 0; i < size; ++i) {
-        counts[p[i] - range_min]++;
-    }
-    std::partial_sum(counts.begin(), counts.end(), counts.begin());
-
-    auto res = at::empty_like(q);
-
-    for (size_t idx = 0; idx < size_t(q.numel()); idx++) {
-        int threshold = int(q[idx].item<float>() * (size - 1));
-        for (int i = 0; i < int(counts.size()); ++i) {
-            if (counts[i] > threshold) {
-                res[idx] = i + range_min;
-                break;
-            }
-        }
+    const auto q_contig = q.contiguous();
+    const float* const q_ptr = q_contig.data_ptr<float>();
+    auto res = at::empty_like(q_contig);
+    float* const res_ptr = res.data_ptr<float>();
+    for (size_t idx = 0; idx < size_t(q_contig.numel()); idx++) {
+        res_ptr[idx] = histogram.quantile(q_ptr[idx]);
     }
 
     return res;
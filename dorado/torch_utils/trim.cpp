@@ -4,34 +4,38 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <cassert>
 #include <sstream>
 
 namespace dorado::utils {
 
-int trim(const at::Tensor& signal, float threshold, int window_size, int min_elements) {
+namespace {
+
+template <typename T>
+int trim_impl(const T* signal,
+              int signal_len,
+              float threshold,
+              int window_size,
+              int min_elements) {
     const int min_trim = 10;
-    const int num_samples = static_cast<int>(signal.size(0)) - min_trim;
+    const int num_samples = signal_len - min_trim;
     const int num_windows = num_samples / window_size;
 
-    // Access via raw pointers because of torch indexing overhead.
-    const auto signal_f32 = signal.to(at::ScalarType::Float);
-    assert(signal_f32.is_contiguous());
-    const float* const signal_f32_ptr = signal_f32.data_ptr<float>();
+    auto is_large_enough = [threshold](T elem) { return static_cast<float>(elem) > threshold; };
 
     bool seen_peak = false;
     for (int pos = 0; pos < num_windows; ++pos) {
         const int start = pos * window_size + min_trim;
         const int end = start + window_size;
-        assert(start < signal.size(0));
-        assert(end <= signal.size(0));  // end is exclusive
+        assert(start < signal_len);
+        assert(end <= signal_len);  // end is exclusive
 
         const auto num_large_enough =
-                std::count_if(&signal_f32_ptr[start], &signal_f32_ptr[end],
-                              [threshold](float elem) { return elem > threshold; });
+                std::count_if(&signal[start], &signal[end], is_large_enough);
 
         if (num_large_enough > min_elements || seen_peak) {
             seen_peak = true;
-            if (signal_f32_ptr[end - 1] > threshold) {
+            if (is_large_enough(signal[end - 1])) {
                 continue;
             }
             if (end >= num_samples) {
@@ -45,6 +49,31 @@ int trim(const at::Tensor& signal, float threshold, int window_size, int min_ele
     return min_trim;
 }
 
+}  // namespace
+
+int trim(const at::Tensor& signal, float threshold, int window_size, int min_elements) {
+    // Access via raw pointers because of torch indexing overhead. The search usually stops
+    // after a few windows, so read the signal in place rather than converting all of it.
+    const auto signal_contig = signal.contiguous();
+    const int signal_len = static_cast<int>(signal_contig.size(0));
+    switch (signal_contig.scalar_type()) {
+    case at::ScalarType::Half:
+        return trim_impl(signal_contig.data_ptr<at::Half>(), signal_len, threshold, window_size,
+                         min_elements);
+    case at::ScalarType::Float:
+        return trim_impl(signal_contig.data_ptr<float>(), signal_len, threshold, window_size,
+                         min_elements);
+    case at::ScalarType::Short:
+        return trim_impl(signal_contig.data_ptr<int16_t>(), signal_len, threshold, window_size,
+                         min_elements);
+    default: {
+        const auto signal_f32 = signal_contig.to(at::ScalarType::Float);
+        return trim_impl(signal_f32.data_ptr<float>(), signal_len, threshold, window_size,
+                         min_elements);
+    }
+    }
+}
+
 std::string trim_sequence(const std::string& seq, const std::pair<int, int>& trim_interval) {
     if (trim_interval.first >= int(seq.length()) || trim_interval.second > int(seq.length()) ||
         trim_interval.second < trim_interval.first) {
@@ -1,19 +1,32 @@
 #pragma once
 
+#include "concurrency/detail/mpmc_ring_buffer.h"
+
 #include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace dorado::utils {
 
 // Status return by push/pop methods.
 enum class AsyncQueueStatus { Success, Timeout, Terminate };
 
+// How an AsyncQueue stores its items.
+enum class AsyncQueueBackend {
+    // A std::queue guarded by m_mutex.
+    Locked,
+    // A lock-free bounded ring buffer.  m_mutex and the CVs are only used by threads that
+    // have to block because the queue is full/empty, and by threads that wake them.
+    LockFree,
+};
+
 // Asynchronous queue for producer/consumer use.
 // Items must be movable.
 template <class Item>
@@ -21,20 +34,28 @@ class AsyncQueue {
     // Guards the entire structure.  Should be held while adding/removing items,
     // or interacting with m_terminate.
     // Used for not-empty and not-full CV waits.
+    // For the lock-free backend this only guards the CV waits.
     mutable std::mutex m_mutex;
     // Signalled when an item has been consumed, and the queue therefore has space
     // for new items.
     mutable std::condition_variable m_not_full_cv;
     // Signalled when an item has been added, and the queue therefore is not empty.
     std::condition_variable m_not_empty_cv;
-    // Holds the items.
+    // Holds the items for the locked backend.
     std::queue<Item> m_items;
+    // Holds the items for the lock-free backend, or null for the locked backend.
+    std::unique_ptr<concurrency::detail::MPMCRingBuffer<Item>> m_ring_buffer;
+    // Number of threads blocked on m_not_empty_cv/m_not_full_cv with the lock-free backend.
+    // Threads that pop/push only take m_mutex to notify if these are non-zero.
+    std::atomic<int> m_num_waiting_pops{0};
+    std::atomic<int> m_num_waiting_pushes{0};
     // Number of items that can be added before further additions block, pending
     // consumption of items.
     size_t m_capacity = 0;
     // If true, CV waits should terminate regardless of other state.
     // Pending attempts to push or pop items will fail.
-    bool m_terminate = false;
+    // Atomic since the lock-free backend reads it without holding m_mutex.
+    std::atomic<bool> m_terminate{false};
     // Stats for monitoring queue usage.
     int64_t m_num_pushes = 0;
     int64_t m_num_pops = 0;
@@ -94,9 +115,108 @@ class AsyncQueue {
         return {std::move(lock), wait_status};
     }
 
+    // Lock-free backend: calls attempt_fn, which should try to push or pop without blocking,
+    // until it succeeds or we are asked to terminate.  Blocks on cv between attempts.
+    // Returns true if attempt_fn succeeded.
+    template <class AttemptFn>
+    bool lock_free_wait(std::condition_variable& cv,
+                        std::atomic<int>& num_waiting,
+                        AttemptFn attempt_fn) {
+        if (attempt_fn()) {
+            return true;
+        }
+
+        bool success = false;
+        std::unique_lock lock(m_mutex);
+        // Registering as a waiter before retrying under the lock means that any thread that
+        // completes a push/pop after our retry fails will see us and notify.
+        num_waiting.fetch_add(1);
+        cv.wait(lock, [&] {
+            success = attempt_fn();
+            return success || m_terminate.load();
+        });
+        num_waiting.fetch_sub(1);
+        return success;
+    }
+
+    // Same as lock_free_wait, but will also time out, returning AsyncQueueStatus::Timeout.
+    // Returns AsyncQueueStatus::Terminate if we were asked to terminate without attempt_fn
+    // succeeding.
+    template <class AttemptFn, class Clock, class Duration>
+    AsyncQueueStatus lock_free_wait_until(
+            std::condition_variable& cv,
+            std::atomic<int>& num_waiting,
+            AttemptFn attempt_fn,
+            const std::chrono::time_point<Clock, Duration>& timeout_time) {
+        if (attempt_fn()) {
+            return AsyncQueueStatus::Success;
+        }
+
+        bool success = false;
+        std::unique_lock lock(m_mutex);
+        num_waiting.fetch_add(1);
+        const bool wait_status = cv.wait_until(lock, timeout_time, [&] {
+            success = attempt_fn();
+            return success || m_terminate.load();
+        });
+        num_waiting.fetch_sub(1);
+
+        if (!wait_status) {
+            return AsyncQueueStatus::Timeout;
+        }
+        return success ? AsyncQueueStatus::Success : AsyncQueueStatus::Terminate;
+    }
+
+    // Lock-free backend: wakes threads blocked in lock_free_wait on cv, if there are any.
+    // Must be called after the push/pop they may be waiting for has completed.
+    void lock_free_notify(std::condition_variable& cv,
+                          std::atomic<int>& num_waiting,
+                          bool notify_all) {
+        // This is a read-modify-write rather than a load so that it is ordered with the
+        // increment in lock_free_wait: either we see the waiter, or the waiter's retry sees
+        // our push/pop.  (A fence would also work, but TSan doesn't support them.)
+        if (num_waiting.fetch_add(0) == 0) {
+            return;
+        }
+        // Taking the lock ensures the waiter is either inside cv.wait or has yet to retry.
+        { std::lock_guard lock(m_mutex); }
+        if (notify_all) {
+            cv.notify_all();
+        } else {
+            cv.notify_one();
+        }
+    }
+
+    // Lock-free backend: pops up to max_count items, blocking until at least one is available.
+    template <class ProcessFn, class WaitFn>
+    AsyncQueueStatus lock_free_process_and_pop_n(ProcessFn& process_fn,
+                                                 size_t max_count,
+                                                 WaitFn wait_fn) {
+        if (max_count == 0) {
+            return AsyncQueueStatus::Success;
+        }
+        const auto status = wait_fn([this, &process_fn] {
+            return m_ring_buffer->try_pop(process_fn);
+        });
+        if (status != AsyncQueueStatus::Success) {
+            return status;
+        }
+        for (size_t count = 1; count < max_count && m_ring_buffer->try_pop(process_fn); ++count) {
+        }
+
+        // As with the locked backend, we have in general removed > 1 item.
+        lock_free_notify(m_not_full_cv, m_num_waiting_pushes, true);
+        return AsyncQueueStatus::Success;
+    }
+
 public:
     // Attempts to push items beyond capacity will block.
-    explicit AsyncQueue(size_t capacity) : m_capacity(capacity) {}
+    explicit AsyncQueue(size_t capacity, AsyncQueueBackend backend = AsyncQueueBackend::Locked)
+            : m_capacity(capacity) {
+        if (backend == AsyncQueueBackend::LockFree) {
+            m_ring_buffer = std::make_unique<concurrency::detail::MPMCRingBuffer<Item>>(capacity);
+        }
+    }
 
     ~AsyncQueue() {
         // Ensure CV waits terminate before destruction.
@@ -117,6 +237,17 @@ public:
     // is returned.
     // Items pushed must be rvalues, since we assume sole ownership.
     AsyncQueueStatus try_push(Item&& item) {
+        if (m_ring_buffer) {
+            const bool pushed = lock_free_wait(m_not_full_cv, m_num_waiting_pushes, [&] {
+                return !m_terminate.load() && m_ring_buffer->try_push(item);
+            });
+            if (!pushed) {
+                return AsyncQueueStatus::Terminate;
+            }
+            lock_free_notify(m_not_empty_cv, m_num_waiting_pops, false);
+            return AsyncQueueStatus::Success;
+        }
+
         std::unique_lock lock(m_mutex);
 
         // Ensure there is space for the new item, given our limit on capacity.
@@ -138,6 +269,53 @@ public:
         return AsyncQueueStatus::Success;
     }
 
+    // Adds all of items to the queue, in order.
+    // As many items as fit are added each time the lock is taken, so if the queue is
+    // contended this is more efficient than repeated calls to try_push.
+    // If the queue is full, blocks until there is space or terminate() is called.
+    // If terminate() was called, any remaining items are not added and
+    // AsyncQueueStatus::Terminate is returned.
+    AsyncQueueStatus try_push_n(std::vector<Item>&& items) {
+        if (m_ring_buffer) {
+            for (auto& item : items) {
+                const auto attempt_fn = [&] {
+                    return !m_terminate.load() && m_ring_buffer->try_push(item);
+                };
+                if (attempt_fn()) {
+                    continue;
+                }
+                // Wake consumers of what we have pushed so far before blocking on them.
+                lock_free_notify(m_not_empty_cv, m_num_waiting_pops, true);
+                if (!lock_free_wait(m_not_full_cv, m_num_waiting_pushes, attempt_fn)) {
+                    return AsyncQueueStatus::Terminate;
+                }
+            }
+            lock_free_notify(m_not_empty_cv, m_num_waiting_pops, true);
+            return AsyncQueueStatus::Success;
+        }
+
+        auto it = items.begin();
+        while (it != items.end()) {
+            std::unique_lock lock(m_mutex);
+            m_not_full_cv.wait(lock,
+                               [this] { return m_items.size() < m_capacity || m_terminate; });
+            if (m_terminate) {
+                return AsyncQueueStatus::Terminate;
+            }
+
+            for (; it != items.end() && m_items.size() < m_capacity; ++it) {
+                m_items.push(std::move(*it));
+                ++m_num_pushes;
+            }
+
+            // In general we have added > 1 item, so inform all waiting threads.
+            lock.unlock();
+            m_not_empty_cv.notify_all();
+        }
+
+        return AsyncQueueStatus::Success;
+    }
+
     // Obtains the next item in the queue, potentially timing out.
     // If queue is empty:
     // If timeout is reached, but we are not terminating, returns AsyncQueueStatus::Timeout.
@@ -146,6 +324,20 @@ public:
     template <class Clock, class Duration>
     AsyncQueueStatus try_pop_until(Item& item,
                                    const std::chrono::time_point<Clock, Duration>& timeout_time) {
+        if (m_ring_buffer) {
+            const auto status = lock_free_wait_until(
+                    m_not_empty_cv, m_num_waiting_pops,
+                    [&] {
+                        return m_ring_buffer->try_pop(
+                                [&item](Item&& popped) { item = std::move(popped); });
+                    },
+                    timeout_time);
+            if (status == AsyncQueueStatus::Success) {
+                lock_free_notify(m_not_full_cv, m_num_waiting_pushes, false);
+            }
+            return status;
+        }
+
         auto [lock, wait_status] = wait_for_item_or_timeout(timeout_time);
 
         if (wait_status == false) {
@@ -169,6 +361,17 @@ public:
     // Otherwise block until an item is added, upon which AsyncQueueStatus::Success
     // is returned.
     AsyncQueueStatus try_pop(Item& item) {
+        if (m_ring_buffer) {
+            const bool popped = lock_free_wait(m_not_empty_cv, m_num_waiting_pops, [&] {
+                return m_ring_buffer->try_pop([&item](Item&& popped) { item = std::move(popped); });
+            });
+            if (!popped) {
+                return AsyncQueueStatus::Terminate;
+            }
+            lock_free_notify(m_not_full_cv, m_num_waiting_pushes, false);
+            return AsyncQueueStatus::Success;
+        }
+
         auto lock = wait_for_item();
 
         // Termination takes effect once all items have been popped from the queue.
@@ -190,6 +393,14 @@ public:
     // is returned.
     template <class ProcessFn>
     AsyncQueueStatus process_and_pop_n(ProcessFn process_fn, size_t max_count) {
+        if (m_ring_buffer) {
+            return lock_free_process_and_pop_n(process_fn, max_count, [this](auto attempt_fn) {
+                return lock_free_wait(m_not_empty_cv, m_num_waiting_pops, attempt_fn)
+                               ? AsyncQueueStatus::Success
+                               : AsyncQueueStatus::Terminate;
+            });
+        }
+
         auto lock = wait_for_item();
 
         // Termination takes effect once all items have been popped from the queue.
@@ -208,6 +419,14 @@ public:
             ProcessFn process_fn,
             size_t max_count,
             const std::chrono::time_point<Clock, Duration>& timeout_time) {
+        if (m_ring_buffer) {
+            return lock_free_process_and_pop_n(
+                    process_fn, max_count, [this, &timeout_time](auto attempt_fn) {
+                        return lock_free_wait_until(m_not_empty_cv, m_num_waiting_pops,
+                                                    attempt_fn, timeout_time);
+                    });
+        }
+
         auto [lock, wait_status] = wait_for_item_or_timeout(timeout_time);
 
         if (wait_status == false) {
@@ -254,14 +473,27 @@ public:
     // Current number of items in the queue.  Only useful for stats sampling and
     // testing.
     size_t size() const {
+        if (m_ring_buffer) {
+            return m_ring_buffer->size();
+        }
         std::lock_guard lock(m_mutex);
         return m_items.size();
     }
 
+    AsyncQueueBackend backend() const {
+        return m_ring_buffer ? AsyncQueueBackend::LockFree : AsyncQueueBackend::Locked;
+    }
+
     std::string get_name() const { return "queue"; }
 
     std::unordered_map<std::string, double> sample_stats() const {
         std::unordered_map<std::string, double> stats;
+        if (m_ring_buffer) {
+            stats["items"] = double(m_ring_buffer->size());
+            stats["pushes"] = double(m_ring_buffer->num_pushes());
+            stats["pops"] = double(m_ring_buffer->num_pops());
+            return stats;
+        }
         std::lock_guard<std::mutex> lock(m_mutex);
         stats["items"] = double(m_items.size());
         stats["pushes"] = double(m_num_pushes);
@@ -0,0 +1,78 @@
+#include "bam_record_builder.h"
+
+#include <htslib/sam.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace dorado::utils {
+
+uint8_t* BamRecordBuilder::append_tag(const char* tag, char type, std::size_t size) {
+    const auto offset = m_aux.size();
+    m_aux.resize(offset + 3 + size);
+    uint8_t* dest = m_aux.data() + offset;
+    dest[0] = static_cast<uint8_t>(tag[0]);
+    dest[1] = static_cast<uint8_t>(tag[1]);
+    dest[2] = static_cast<uint8_t>(type);
+    return dest + 3;
+}
+
+void BamRecordBuilder::append_float(const char* tag, float value) {
+    std::memcpy(append_tag(tag, 'f', sizeof(value)), &value, sizeof(value));
+}
+
+void BamRecordBuilder::append_int(const char* tag, int32_t value) {
+    std::memcpy(append_tag(tag, 'i', sizeof(value)), &value, sizeof(value));
+}
+
+void BamRecordBuilder::append_string(const char* tag, std::string_view value) {
+    uint8_t* dest = append_tag(tag, 'Z', value.size() + 1);
+    std::memcpy(dest, value.data(), value.size());
+    dest[value.size()] = '\0';
+}
+
+uint8_t* BamRecordBuilder::append_byte_array(const char* tag, char subtype, std::size_t count) {
+    uint8_t* dest = append_tag(tag, 'B', 1 + 4 + count);
+    dest[0] = static_cast<uint8_t>(subtype);
+    // The element count is always little endian.
+    const auto count32 = static_cast<uint32_t>(count);
+    for (int i = 0; i < 4; ++i) {
+        dest[1 + i] = static_cast<uint8_t>(count32 >> (8 * i));
+    }
+    return dest + 5;
+}
+
+BamPtr BamRecordBuilder::build(std::string_view read_id,
+                               uint16_t flags,
+                               std::string_view seq,
+                               std::string_view qstring) const {
+    if (seq.size() != qstring.size()) {
+        throw std::runtime_error("Sequence and qscore do not match size for read id " +
+                                 std::string(read_id));
+    }
+
+    BamPtr record(bam_init1());
+    bam1_t* aln = record.get();
+    // Unmapped, so no position, mapq, cigar or mate.  Qualities are filled in below, straight
+    // from the qstring.
+    if (bam_set1(aln, read_id.size(), read_id.data(), flags, -1, -1, 0, 0, nullptr, -1, -1, 0,
+                 seq.size(), seq.data(), nullptr, m_aux.size()) < 0) {
+        throw std::runtime_error("Failed to create BAM record for read id " +
+                                 std::string(read_id));
+    }
+
+    uint8_t* qual = bam_get_qual(aln);
+    for (std::size_t i = 0; i < qstring.size(); ++i) {
+        qual[i] = static_cast<uint8_t>(static_cast<uint8_t>(qstring[i]) - 33);
+    }
+
+    // bam_set1() has already made room for the tags.
+    if (!m_aux.empty()) {
+        std::memcpy(aln->data + aln->l_data, m_aux.data(), m_aux.size());
+        aln->l_data += static_cast<int>(m_aux.size());
+    }
+    return record;
+}
+
+}  // namespace dorado::utils
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace dorado::utils {
+
+// Builds an unmapped BAM record with a single allocation.  Aux tags are encoded up front into
+// one buffer, then the record is sized for the name, sequence, qualities and tags together and
+// everything is written into it, rather than growing the record with bam_aux_append() for each
+// tag.  Tags are encoded exactly as bam_aux_append()/bam_aux_update_array() encode them.
+class BamRecordBuilder {
+public:
+    // Reserves space for reserve_aux_bytes of tags.
+    explicit BamRecordBuilder(std::size_t reserve_aux_bytes = 0) {
+        m_aux.reserve(reserve_aux_bytes);
+    }
+
+    void append_float(const char* tag, float value);  // 'f'
+    void append_int(const char* tag, int32_t value);  // 'i'
+    void append_string(const char* tag, std::string_view value);  // 'Z'
+
+    // Appends a 'B' array tag of count 1-byte elements of the given subtype ('c' or 'C'), and
+    // returns where the caller should write them.  The pointer is invalidated by the next append.
+    uint8_t* append_byte_array(const char* tag, char subtype, std::size_t count);
+
+    std::size_t aux_size() const { return m_aux.size(); }
+
+    // Creates the record, with qualities converted from the phred+33 qstring.  qstring must be
+    // the same length as seq.
+    BamPtr build(std::string_view read_id,
+                 uint16_t flags,
+                 std::string_view seq,
+                 std::string_view qstring) const;
+
+private:
+    // Appends the tag and type, and returns where the value's size bytes should be written.
+    uint8_t* append_tag(const char* tag, char type, std::size_t size);
+
+    std::vector<uint8_t> m_aux;
+};
+
+}  // namespace dorado::utils
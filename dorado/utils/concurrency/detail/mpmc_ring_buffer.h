@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace dorado::utils::concurrency::detail {
+
+// Bounded multi-producer/multi-consumer ring buffer.
+// try_push/try_pop never block: they fail if the buffer is full/empty.
+//
+// Each slot carries a turn counter.  Position p maps to slot p % capacity on lap
+// p / capacity: the slot is free for the push at p when its turn is 2 * lap, and holds
+// the item for the pop at p when its turn is 2 * lap + 1.  Producers and consumers
+// claim positions by CAS on m_head/m_tail, so each slot only ever has one writer.
+template <class Item>
+class MPMCRingBuffer {
+    // Avoid false sharing between adjacent slots and between the head/tail counters.
+    static constexpr std::size_t kCacheLineSize = 64;
+
+    struct alignas(kCacheLineSize) Slot {
+        std::atomic<std::size_t> turn{0};
+        std::optional<Item> item;
+    };
+
+    const std::size_t m_capacity;
+    std::unique_ptr<Slot[]> m_slots;
+    // Position of the next push.  Also the number of pushes so far.
+    alignas(kCacheLineSize) std::atomic<std::size_t> m_head{0};
+    // Position of the next pop.  Also the number of pops so far.
+    alignas(kCacheLineSize) std::atomic<std::size_t> m_tail{0};
+
+    std::size_t lap(std::size_t pos) const { return pos / m_capacity; }
+    Slot& slot(std::size_t pos) { return m_slots[pos % m_capacity]; }
+
+public:
+    explicit MPMCRingBuffer(std::size_t capacity)
+            : m_capacity(std::max(capacity, std::size_t{1})),
+              m_slots(std::make_unique<Slot[]>(m_capacity)) {}
+
+    MPMCRingBuffer(const MPMCRingBuffer&) = delete;
+    MPMCRingBuffer& operator=(const MPMCRingBuffer&) = delete;
+
+    // Moves from item and returns true if there was space, otherwise leaves item untouched.
+    bool try_push(Item& item) {
+        auto head = m_head.load(std::memory_order_acquire);
+        for (;;) {
+            auto& head_slot = slot(head);
+            if (head_slot.turn.load(std::memory_order_acquire) == 2 * lap(head)) {
+                // On failure head is updated to the current value and we retry.
+                if (m_head.compare_exchange_strong(head, head + 1)) {
+                    head_slot.item.emplace(std::move(item));
+                    head_slot.turn.store(2 * lap(head) + 1, std::memory_order_release);
+                    return true;
+                }
+            } else {
+                // The slot is still occupied from the previous lap.  If nobody else has
+                // pushed in the meantime the buffer is full.
+                const auto prev_head = head;
+                head = m_head.load(std::memory_order_acquire);
+                if (head == prev_head) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Pops the next item, passing it to process_fn, and returns true if the buffer was not empty.
+    // The slot is released before process_fn is called.
+    template <class ProcessFn>
+    bool try_pop(ProcessFn&& process_fn) {
+        auto tail = m_tail.load(std::memory_order_acquire);
+        for (;;) {
+            auto& tail_slot = slot(tail);
+            if (tail_slot.turn.load(std::memory_order_acquire) == 2 * lap(tail) + 1) {
+                if (m_tail.compare_exchange_strong(tail, tail + 1)) {
+                    Item item = std::move(*tail_slot.item);
+                    tail_slot.item.reset();
+                    tail_slot.turn.store(2 * lap(tail) + 2, std::memory_order_release);
+                    process_fn(std::move(item));
+                    return true;
+                }
+            } else {
+                const auto prev_tail = tail;
+                tail = m_tail.load(std::memory_order_acquire);
+                if (tail == prev_tail) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    std::size_t capacity() const { return m_capacity; }
+
+    // These are only approximate while pushes/pops are in flight.
+    std::size_t num_pushes() const { return m_head.load(std::memory_order_relaxed); }
+    std::size_t num_pops() const { return m_tail.load(std::memory_order_relaxed); }
+    std::size_t size() const {
+        const auto pops = num_pops();
+        const auto pushes = num_pushes();
+        return pushes > pops ? pushes - pops : 0;
+    }
+};
+
+}  // namespace dorado::utils::concurrency::detail
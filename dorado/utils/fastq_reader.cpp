@@ -1,11 +1,15 @@
 #include "fastq_reader.h"
 
+#include <htslib/bgzf.h>
+#include <htslib/hts.h>
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
-#include <limits>
 #include <sstream>
 
 namespace dorado::utils {
@@ -107,8 +111,130 @@ bool get_wrapped_sequence_line(std::istream& input_stream, std::string& wrapped_
 
 char header_separator(bool has_bam_tags) { return has_bam_tags ? '\t' : ' '; }
 
-void ignore_next_tab_separated_field(std::istringstream& header_stream) {
-    header_stream.ignore(std::numeric_limits<std::streamsize>::max(), '\t');
+bool header_has_bam_tags(std::string_view header) {
+    return header.find('\t') != std::string_view::npos;
+}
+
+std::size_t header_token_len(std::string_view header,
+                             bool has_bam_tags,
+                             std::size_t token_start_pos) {
+    auto token_end_pos = header.find(header_separator(has_bam_tags), token_start_pos);
+    if (token_end_pos == std::string_view::npos) {
+        token_end_pos = header.size();
+    }
+    return token_end_pos - token_start_pos;
+}
+
+std::vector<std::string> get_bam_tags_from_header(std::string_view header) {
+    // First tab separated field is the read ID not a bam tag
+    std::vector<std::string> result{};
+    auto separator_pos = header.find('\t');
+    while (separator_pos != std::string_view::npos && separator_pos + 1 < header.size()) {
+        const auto tag_start_pos = separator_pos + 1;
+        separator_pos = header.find('\t', tag_start_pos);
+        result.emplace_back(header.substr(tag_start_pos, separator_pos == std::string_view::npos
+                                                                 ? std::string_view::npos
+                                                                 : separator_pos - tag_start_pos));
+    }
+    return result;
+}
+
+// Character classes of sequence characters, so that a line can be validated with a single
+// table lookup per base and no branches.
+constexpr uint8_t BASE_ACG = 1;
+constexpr uint8_t BASE_T = 2;
+constexpr uint8_t BASE_U = 4;
+constexpr uint8_t BASE_INVALID = 8;
+
+constexpr std::array<uint8_t, 256> make_base_classes() {
+    std::array<uint8_t, 256> classes{};
+    for (auto& base_class : classes) {
+        base_class = BASE_INVALID;
+    }
+    classes['A'] = classes['C'] = classes['G'] = BASE_ACG;
+    classes['T'] = BASE_T;
+    classes['U'] = BASE_U;
+    return classes;
+}
+constexpr auto BASE_CLASSES = make_base_classes();
+
+// Returns the union of the classes of the characters in the line.
+uint8_t get_sequence_line_classes(std::string_view line) {
+    uint8_t classes = 0;
+    for (const char c : line) {
+        classes |= BASE_CLASSES[static_cast<uint8_t>(c)];
+    }
+    return classes;
+}
+
+// Same rules as validate_sequence_and_replace_us(): only ACGT or ACGU.
+bool is_valid_sequence_line(uint8_t classes) {
+    return (classes & BASE_INVALID) == 0 && (classes & (BASE_T | BASE_U)) != (BASE_T | BASE_U);
+}
+
+// Same rules as is_valid_quality_field(), written so that the compiler can vectorise it.
+bool is_valid_quality_line(std::string_view line) {
+    uint8_t invalid = 0;
+    for (const char c : line) {
+        invalid |= static_cast<uint8_t>(static_cast<uint8_t>(c) - 0x21) > 0x7e - 0x21;
+    }
+    return invalid == 0;
+}
+
+// Splits a buffer into lines the same way std::getline() does.
+class LineScanner {
+public:
+    enum class Result { line, end_of_input, need_more_data };
+
+    LineScanner(const char* begin, const char* end, bool at_eof)
+            : m_pos(begin), m_end(end), m_at_eof(at_eof) {}
+
+    Result next(std::string_view& line) {
+        if (m_pos == m_end) {
+            return m_at_eof ? Result::end_of_input : Result::need_more_data;
+        }
+        const auto remaining = static_cast<std::size_t>(m_end - m_pos);
+        const auto* newline = static_cast<const char*>(std::memchr(m_pos, '\n', remaining));
+        if (!newline) {
+            if (!m_at_eof) {
+                return Result::need_more_data;
+            }
+            newline = m_end;
+        }
+        line = {m_pos, static_cast<std::size_t>(newline - m_pos)};
+        m_pos = newline == m_end ? m_end : newline + 1;
+        return Result::line;
+    }
+
+    // Same as std::istream::peek() == c, except that it reports when more data is needed.
+    Result next_starts_with(char c, bool& starts_with) const {
+        if (m_pos == m_end) {
+            starts_with = false;
+            return m_at_eof ? Result::end_of_input : Result::need_more_data;
+        }
+        starts_with = *m_pos == c;
+        return Result::line;
+    }
+
+    const char* pos() const { return m_pos; }
+
+private:
+    const char* m_pos;
+    const char* m_end;
+    bool m_at_eof;
+};
+
+// Joins the lines of a wrapped field up in place, returning a view of the result.
+std::string_view join_lines(const std::vector<std::string_view>& lines) {
+    auto* dest = const_cast<char*>(lines.front().data());
+    std::size_t size = 0;
+    for (const auto& line : lines) {
+        if (line.data() != dest + size) {
+            std::memmove(dest + size, line.data(), line.size());
+        }
+        size += line.size();
+    }
+    return {dest, size};
 }
 
 }  // namespace
@@ -118,12 +244,7 @@ const std::string& FastqRecord::sequence() const { return m_sequence; }
 const std::string& FastqRecord::qstring() const { return m_qstring; }
 
 std::size_t FastqRecord::token_len(std::size_t token_start_pos) const {
-    const auto separator = header_separator(m_header_has_bam_tags);
-    auto token_end_pos = m_header.find(separator, token_start_pos);
-    if (token_end_pos == std::string::npos) {
-        token_end_pos = m_header.size();
-    }
-    return token_end_pos - token_start_pos;
+    return header_token_len(m_header, m_header_has_bam_tags, token_start_pos);
 }
 
 std::string_view FastqRecord::read_id_view() const {
@@ -150,17 +271,7 @@ std::vector<std::string> FastqRecord::get_bam_tags() const {
     if (!m_header_has_bam_tags) {
         return {};
     }
-    std::vector<std::string> result{};
-    std::istringstream header_stream{m_header};
-
-    // First field is the read ID not a bam tag
-    ignore_next_tab_separated_field(header_stream);
-
-    std::string tag;
-    while (std::getline(header_stream, tag, '\t')) {
-        result.push_back(std::move(tag));
-    }
-    return result;
+    return get_bam_tags_from_header(m_header);
 }
 
 bool FastqRecord::set_header(std::string line) {
@@ -176,7 +287,7 @@ bool FastqRecord::set_header(std::string line) {
         return false;
     }
     m_header = std::move(line);
-    if (m_header.find('\t') != std::string::npos) {
+    if (header_has_bam_tags(m_header)) {
         m_header_has_bam_tags = true;
     }
     return true;
@@ -249,6 +360,204 @@ std::optional<FastqRecord> FastqReader::try_get_next_record() {
     return next_fastq_record;
 }
 
+std::string_view FastqRecordView::read_id_view() const {
+    assert(header.size() > 1);
+    return header.substr(1, header_token_len(header, header_has_bam_tags(header), 1));
+}
+
+std::vector<std::string> FastqRecordView::get_bam_tags() const {
+    return get_bam_tags_from_header(header);
+}
+
+void FastqBlockReader::BgzfDeleter::operator()(BGZF* file) { bgzf_close(file); }
+
+FastqBlockReader::FastqBlockReader(const std::string& input_file,
+                                   int threads,
+                                   std::size_t block_size)
+        : m_input_file(input_file), m_buffer(std::max<std::size_t>(block_size, 1)) {
+    // Uncompressed and gzip files are read through the BGZF API too, just without threads.
+    m_file.reset(bgzf_open(input_file.c_str(), "r"));
+    if (!m_file) {
+        m_finished = true;
+        return;
+    }
+    if (threads > 1 && bgzf_compression(m_file.get()) == bgzf) {
+        if (bgzf_mt(m_file.get(), threads, 256) < 0) {
+            spdlog::warn("Failed to decompress {} with {} threads", input_file, threads);
+        }
+    }
+
+    // Same check as is_fastq(), without consuming the record.
+    std::string ignore_error_when_checking;
+    fill_buffer();
+    ScanResult result;
+    while ((result = scan_record(ignore_error_when_checking)) == ScanResult::need_more_data) {
+        fill_buffer();
+    }
+    m_is_valid = result == ScanResult::record;
+    m_finished = !m_is_valid;
+}
+
+FastqBlockReader::~FastqBlockReader() = default;
+
+bool FastqBlockReader::is_valid() const { return m_is_valid; }
+
+void FastqBlockReader::fill_buffer() {
+    if (m_parse_pos > 0) {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_parse_pos, m_data_size - m_parse_pos);
+        m_data_size -= m_parse_pos;
+        m_parse_pos = 0;
+    }
+    if (m_data_size == m_buffer.size()) {
+        m_buffer.resize(2 * m_buffer.size());
+    }
+    while (!m_at_eof && m_data_size < m_buffer.size()) {
+        const auto bytes_read = bgzf_read(m_file.get(), m_buffer.data() + m_data_size,
+                                          m_buffer.size() - m_data_size);
+        if (bytes_read < 0) {
+            spdlog::warn("Failed to read from {}", m_input_file);
+        }
+        if (bytes_read <= 0) {
+            m_at_eof = true;
+            break;
+        }
+        m_data_size += static_cast<std::size_t>(bytes_read);
+    }
+}
+
+FastqBlockReader::ScanResult FastqBlockReader::scan_record(std::string& error_message) {
+    using Line = LineScanner::Result;
+    const char* begin = m_buffer.data() + m_parse_pos;
+    LineScanner scanner(begin, m_buffer.data() + m_data_size, m_at_eof);
+    auto& lines = m_lines;
+    lines.sequence.clear();
+    lines.qstring.clear();
+    lines.sequence_has_u = false;
+
+    std::string_view line;
+    auto result = scanner.next(line);
+    if (result == Line::need_more_data) {
+        return ScanResult::need_more_data;
+    }
+    if (result == Line::end_of_input || line.empty()) {
+        return ScanResult::end_of_input;
+    }
+    if (line.size() < 2 || line[0] != '@' || line[1] == ' ' || line[1] == '\t') {
+        error_message = "Invalid header line.";
+        return ScanResult::invalid;
+    }
+    lines.header = line;
+
+    std::size_t sequence_size = 0;
+    while (true) {
+        bool is_separator = false;
+        result = scanner.next_starts_with('+', is_separator);
+        if (result == Line::need_more_data) {
+            return ScanResult::need_more_data;
+        }
+        if (is_separator) {
+            break;
+        }
+        result = scanner.next(line);
+        if (result == Line::need_more_data) {
+            return ScanResult::need_more_data;
+        }
+        const auto classes = get_sequence_line_classes(line);
+        if (result == Line::end_of_input || line.empty() || !is_valid_sequence_line(classes)) {
+            error_message = "Invalid sequence.";
+            return ScanResult::invalid;
+        }
+        lines.sequence_has_u |= (classes & BASE_U) != 0;
+        lines.sequence.push_back(line);
+        sequence_size += line.size();
+    }
+    if (lines.sequence.empty()) {
+        error_message = "Invalid sequence.";
+        return ScanResult::invalid;
+    }
+
+    result = scanner.next(line);
+    if (result == Line::need_more_data) {
+        return ScanResult::need_more_data;
+    }
+    if (result == Line::end_of_input || line.empty()) {
+        error_message = "Invalid separator.";
+        return ScanResult::invalid;
+    }
+
+    std::size_t qstring_size = 0;
+    while (qstring_size < sequence_size) {
+        result = scanner.next(line);
+        if (result == Line::need_more_data) {
+            return ScanResult::need_more_data;
+        }
+        if (result == Line::end_of_input || line.empty()) {
+            break;
+        }
+        qstring_size += line.size();
+        if (!is_valid_quality_line(line) || qstring_size > sequence_size) {
+            error_message = "Invalid qstring.";
+            return ScanResult::invalid;
+        }
+        lines.qstring.push_back(line);
+    }
+    if (qstring_size != sequence_size) {
+        error_message = "Invalid qstring.";
+        return ScanResult::invalid;
+    }
+
+    lines.size = scanner.pos() - begin;
+    return ScanResult::record;
+}
+
+bool FastqBlockReader::read_block(std::vector<FastqRecordView>& records) {
+    records.clear();
+    if (m_finished) {
+        return false;
+    }
+    fill_buffer();
+    while (true) {
+        std::string error_message;
+        const auto result = scan_record(error_message);
+        if (result == ScanResult::need_more_data) {
+            if (!records.empty()) {
+                // Finish the record in the next block, as reading more would move this one.
+                break;
+            }
+            fill_buffer();
+            continue;
+        }
+        if (result != ScanResult::record) {
+            if (result == ScanResult::invalid) {
+                spdlog::warn("Failed to read record #{} from {}. {}", m_record_count + 1,
+                             m_input_file, error_message);
+            }
+            m_finished = true;
+            break;
+        }
+
+        auto sequence = join_lines(m_lines.sequence);
+        if (m_lines.sequence_has_u) {
+            auto* bases = const_cast<char*>(sequence.data());
+            std::replace(bases, bases + sequence.size(), 'U', 'T');
+        }
+        records.push_back({m_lines.header, sequence, join_lines(m_lines.qstring)});
+        m_parse_pos += m_lines.size;
+        ++m_record_count;
+    }
+    return !records.empty();
+}
+
+std::optional<FastqRecordView> FastqBlockReader::try_get_next_record() {
+    if (m_block_index == m_block.size()) {
+        m_block_index = 0;
+        if (!read_block(m_block)) {
+            return std::nullopt;
+        }
+    }
+    return m_block[m_block_index++];
+}
+
 bool is_fastq(const std::string& input_file) {
     std::ifstream input_stream{input_file};
     return is_fastq(input_stream);
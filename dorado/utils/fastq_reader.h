@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <istream>
 #include <memory>
 #include <optional>
@@ -7,6 +8,8 @@
 #include <string_view>
 #include <vector>
 
+struct BGZF;
+
 namespace dorado::utils {
 
 class FastqRecord {
@@ -65,6 +68,78 @@ private:
     std::size_t m_record_count{};
 };
 
+// A FASTQ record whose fields are views into the current block of a FastqBlockReader.
+// The fields follow the same rules as those of a FastqRecord.
+struct FastqRecordView {
+    std::string_view header;
+    std::string_view sequence;
+    std::string_view qstring;
+
+    std::string_view read_id_view() const;
+    std::vector<std::string> get_bam_tags() const;
+};
+
+// Reads FASTQ records from plain, gzip or BGZF compressed files a large block at a time,
+// applying the same validation as FastqRecord::try_create().  Rather than copying each field
+// into its own string, records are returned as views into the block, with line wrapped fields
+// joined up and Us replaced in place.  BGZF compressed input is decompressed on a pool of
+// threads.
+class FastqBlockReader {
+public:
+    static constexpr std::size_t DEFAULT_BLOCK_SIZE = 4 * 1024 * 1024;
+
+    FastqBlockReader(const std::string& input_file,
+                     int threads = 1,
+                     std::size_t block_size = DEFAULT_BLOCK_SIZE);
+    ~FastqBlockReader();
+
+    // True if the file could be opened and begins with a valid record.
+    bool is_valid() const;
+
+    // Replaces the contents of records with the records in the next block, returning false
+    // once there are no more.  Reading stops at the first invalid record.
+    // The views are only valid until the next call to read_block() or try_get_next_record().
+    bool read_block(std::vector<FastqRecordView>& records);
+
+    // Returns the next record, which is only valid until the next call to read_block() or
+    // try_get_next_record().
+    std::optional<FastqRecordView> try_get_next_record();
+
+private:
+    struct BgzfDeleter {
+        void operator()(BGZF* file);
+    };
+
+    // Lines making up the record at the start of the unparsed data.
+    struct RecordLines {
+        std::string_view header;
+        std::vector<std::string_view> sequence;
+        std::vector<std::string_view> qstring;
+        bool sequence_has_u{};
+        std::size_t size{};
+    };
+
+    enum class ScanResult { record, end_of_input, need_more_data, invalid };
+
+    // Moves any unparsed data to the front of the buffer and reads more after it, growing the
+    // buffer if a single record doesn't fit.
+    void fill_buffer();
+    ScanResult scan_record(std::string& error_message);
+
+    std::string m_input_file;
+    std::unique_ptr<BGZF, BgzfDeleter> m_file;
+    std::vector<char> m_buffer;
+    std::size_t m_data_size{};
+    std::size_t m_parse_pos{};
+    bool m_at_eof{};
+    bool m_finished{};
+    bool m_is_valid{};
+    std::size_t m_record_count{};
+    RecordLines m_lines;
+    std::vector<FastqRecordView> m_block;
+    std::size_t m_block_index{};
+};
+
 // Check for a fastq file. Does basic checks on the four fields of the first record
 // will return true for a sequence containing Us instead of Ts, so if the check
 // succeeds it is still possible the file cannot be opened by HtsLib
@@ -6,12 +6,18 @@
 #include <htslib/bgzf.h>
 #include <htslib/hts.h>
 #include <htslib/sam.h>
+#include <htslib/thread_pool.h>
 #include <spdlog/spdlog.h>
 
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <filesystem>
-#include <map>
+#include <mutex>
+#include <queue>
 #include <stdexcept>
+#include <unordered_set>
 
 namespace {
 
@@ -24,31 +30,109 @@ bool compare_headers(const dorado::SamHdrPtr& header1, const dorado::SamHdrPtr&
     return (strcmp(sam_hdr_str(header1.get()), sam_hdr_str(header2.get())) == 0);
 }
 
+// Stable LSD radix sort on the 64 bit key field of entries, a byte at a time.
+// Passes over bytes that are the same for every key (e.g. the high bytes of the contig
+// index) are skipped.
+template <typename Entry>
+void radix_sort(std::vector<Entry>& entries) {
+    constexpr size_t NUM_BUCKETS = 256;
+    constexpr size_t NUM_PASSES = sizeof(uint64_t);
+
+    // Count the occurrences of each byte value for every pass up front.
+    std::vector<std::array<size_t, NUM_BUCKETS>> counts(NUM_PASSES);
+    for (auto& pass_counts : counts) {
+        pass_counts.fill(0);
+    }
+    for (const auto& entry : entries) {
+        for (size_t pass = 0; pass < NUM_PASSES; ++pass) {
+            ++counts[pass][(entry.key >> (8 * pass)) & 0xff];
+        }
+    }
+
+    std::vector<Entry> scratch(entries.size());
+    for (size_t pass = 0; pass < NUM_PASSES; ++pass) {
+        auto& pass_counts = counts[pass];
+        const auto first_key_byte = entries.empty() ? 0 : (entries[0].key >> (8 * pass)) & 0xff;
+        if (pass_counts[first_key_byte] == entries.size()) {
+            continue;
+        }
+
+        std::array<size_t, NUM_BUCKETS> bucket_starts;
+        size_t start = 0;
+        for (size_t bucket = 0; bucket < NUM_BUCKETS; ++bucket) {
+            bucket_starts[bucket] = start;
+            start += pass_counts[bucket];
+        }
+        for (const auto& entry : entries) {
+            scratch[bucket_starts[(entry.key >> (8 * pass)) & 0xff]++] = entry;
+        }
+        entries.swap(scratch);
+    }
+}
+
 }  // namespace
 
 namespace dorado::utils {
 
+// Can be shared by concurrent merges, which each report the records they have written.
 struct HtsFile::ProgressUpdater {
     const ProgressCallback* m_progress_callback{nullptr};
-    size_t m_from{0}, m_to{0}, m_max{0}, m_last_progress{0};
+    size_t m_from{0}, m_to{0}, m_max{0};
+    std::atomic<size_t> m_count{0};
+    std::atomic<size_t> m_last_progress{0};
+    std::mutex m_callback_mutex;
     ProgressUpdater() = default;
     ProgressUpdater(const ProgressCallback& progress_callback, size_t from, size_t to, size_t max)
             : m_progress_callback(&progress_callback),
               m_from(from),
               m_to(to),
-              m_max(max),
-              m_last_progress(0) {}
+              m_max(std::max(max, size_t{1})),
+              m_last_progress(from) {}
 
-    void operator()(size_t count) {
+    void operator()(size_t num_new_records) {
+        const size_t count = m_count.fetch_add(num_new_records) + num_new_records;
         if (!m_progress_callback) {
             return;
         }
         const size_t new_progress = m_from + (m_to - m_from) * std::min(count, m_max) / m_max;
-        if (new_progress != m_last_progress) {
-            m_last_progress = new_progress;
-            m_progress_callback->operator()(new_progress);
+        if (new_progress != m_last_progress.load()) {
+            std::lock_guard lock(m_callback_mutex);
+            // Progress only moves forward, even if reports from other threads overtake us.
+            if (new_progress > m_last_progress.load()) {
+                m_last_progress.store(new_progress);
+                m_progress_callback->operator()(new_progress);
+            }
+        }
+    }
+
+    size_t count() const { return m_count.load(); }
+};
+
+// An htslib thread pool shared by all the files involved in merging, so that we don't start
+// m_threads threads for each of the (up to MAX_FILES_FOR_MERGE) files open at once.
+struct HtsFile::MergeThreadPool {
+    htsThreadPool m_pool{nullptr, 0};
+
+    explicit MergeThreadPool(int threads) {
+        if (threads > 0) {
+            m_pool.pool = hts_tpool_init(threads);
+            if (!m_pool.pool) {
+                throw std::runtime_error("Could not create thread pool for merging BAM files.");
+            }
+        }
+    }
+    ~MergeThreadPool() {
+        if (m_pool.pool) {
+            hts_tpool_destroy(m_pool.pool);
         }
     }
+    MergeThreadPool(const MergeThreadPool&) = delete;
+    MergeThreadPool& operator=(const MergeThreadPool&) = delete;
+
+    // Returns false on failure.
+    bool attach(htsFile* file) {
+        return !m_pool.pool || hts_set_thread_pool(file, &m_pool) == 0;
+    }
 };
 
 HtsFile::HtsFile(const std::string& filename, OutputMode mode, int threads, bool sort_bam)
@@ -130,6 +214,9 @@ HtsFile::~HtsFile() {
     if (!m_finalised) {
         spdlog::error("finalise() not called on a HtsFile.");
     }
+    if (m_spill_thread.joinable()) {
+        m_spill_thread.join();
+    }
 }
 
 uint64_t HtsFile::calculate_sorting_key(const bam1_t* record) {
@@ -145,60 +232,113 @@ void HtsFile::set_buffer_size(size_t buff_size) {
     m_bam_buffer.resize(buff_size);
 }
 
+size_t HtsFile::buffer_half_size() const {
+    // Keep the second half aligned for the bam1_t structs at the start of each record.
+    constexpr auto alignment = alignof(bam1_t);
+    return (m_bam_buffer.size() / 2 / alignment) * alignment;
+}
+
+std::byte* HtsFile::active_buffer() {
+    return m_bam_buffer.data() + m_active_half * buffer_half_size();
+}
+
+// Hands the records cached in the active half of the buffer (and last_record, if
+// non-null) over to m_spill_thread to be sorted and written out, then switches to caching
+// in the other half.
 void HtsFile::flush_temp_file(const bam1_t* last_record) {
     if (m_current_buffer_offset == 0 && !last_record) {
         // This handles the case that the last read passed in before calling finalise() has already triggered
         // a flush, or that finalise() was called without ever passing any reads.
         return;
     }
+
+    // The other half of the buffer must be written out before we can reuse it.
+    wait_for_spill();
+
+    // last_record isn't ours, so the spill thread needs its own copy.
+    BamPtr last_record_copy(last_record ? bam_dup1(last_record) : nullptr);
     if (last_record) {
-        // We add last_record to our buffer map with offset -1, so that we know where it should be sorted into
+        // We add last_record with offset -1, so that we know where it should be sorted into
         // the output.
-        auto sorting_key = calculate_sorting_key(last_record);
-        m_buffer_map.insert({sorting_key, -1});
+        m_sort_entries.push_back({calculate_sorting_key(last_record), -1});
     }
 
-    // Open the file for writing, and write the header. Note that all temp files will have the same header.
     auto file_index = m_temp_files.size();
     auto tempfilename = m_filename + "." + std::to_string(file_index) + ".tmp";
     m_temp_files.push_back(tempfilename);
-    m_file.reset(hts_open(tempfilename.c_str(), "wb"));
-    if (m_file->format.compression == bgzf) {
-        auto res = bgzf_mt(m_file->fp.bgzf, m_threads, 128);
+
+    m_spill_thread = std::thread([this, tempfilename, buffer = active_buffer(),
+                                  sort_entries = std::move(m_sort_entries),
+                                  record = std::move(last_record_copy)]() mutable {
+        try {
+            write_temp_file(tempfilename, buffer, sort_entries, record.get());
+        } catch (...) {
+            m_spill_error = std::current_exception();
+        }
+    });
+
+    m_active_half = 1 - m_active_half;
+    m_current_buffer_offset = 0;
+    m_sort_entries = {};
+}
+
+// Waits for any in-flight spill to finish, rethrowing any error it hit.
+void HtsFile::wait_for_spill() {
+    if (m_spill_thread.joinable()) {
+        m_spill_thread.join();
+    }
+    if (m_spill_error) {
+        std::rethrow_exception(std::exchange(m_spill_error, nullptr));
+    }
+}
+
+void HtsFile::write_temp_file(const std::string& tempfilename,
+                              std::byte* buffer,
+                              std::vector<SortEntry>& sort_entries,
+                              const bam1_t* last_record) const {
+    // This gives us the offsets into the buffer in sorted order.  The sort is stable, so
+    // records with the same key keep the order in which they were written.
+    radix_sort(sort_entries);
+
+    // Open the file for writing, and write the header. Note that all temp files will have the same header.
+    HtsFilePtr file(hts_open(tempfilename.c_str(), "wb"));
+    if (!file) {
+        throw std::runtime_error("Could not open temp file " + tempfilename);
+    }
+    if (file->format.compression == bgzf && m_threads > 0) {
+        auto res = bgzf_mt(file->fp.bgzf, m_threads, 128);
         if (res < 0) {
             throw std::runtime_error("Could not enable multi threading for BAM generation.");
         }
     }
-    if (m_mode != OutputMode::FASTQ && m_mode != OutputMode::FASTA) {
-        if (sam_hdr_write(m_file.get(), m_header.get()) != 0) {
-            throw std::runtime_error("Could not write header to temp file.");
-        }
+    if (sam_hdr_write(file.get(), m_header.get()) != 0) {
+        throw std::runtime_error("Could not write header to temp file.");
     }
 
-    for (const auto& item : m_buffer_map) {
-        // This will give us the offsets into the buffer in sorted order.
-        int64_t offset = item.second;
+    const size_t buffer_size = buffer_half_size();
+    for (const auto& entry : sort_entries) {
+        int64_t offset = entry.offset;
         const bam1_t* record{nullptr};
         if (offset == -1) {
             record = last_record;
         } else {
-            if (size_t(offset) + sizeof(bam1_t) > m_bam_buffer.size()) {
+            if (size_t(offset) + sizeof(bam1_t) > buffer_size) {
                 throw std::out_of_range("Index out of bounds in BAM record buffer.");
             }
-            record = std::launder(reinterpret_cast<bam1_t*>(m_bam_buffer.data() + offset));
-            if (size_t(offset) + sizeof(bam1_t) + size_t(record->l_data) > m_bam_buffer.size()) {
+            record = std::launder(reinterpret_cast<const bam1_t*>(buffer + offset));
+            if (size_t(offset) + sizeof(bam1_t) + size_t(record->l_data) > buffer_size) {
                 throw std::out_of_range("Index out of bounds in BAM record buffer.");
             }
         }
-        auto res = write_to_file(record);
+        auto res = sam_write1(file.get(), m_header.get(), record);
         if (res < 0) {
             throw std::runtime_error("Error writing to BAM temporary file, error code " +
                                      std::to_string(res));
         }
     }
-    m_file.reset();
-    m_current_buffer_offset = 0;
-    m_buffer_map.clear();
+    if (hts_close(file.release()) < 0) {
+        throw std::runtime_error("Error closing BAM temporary file " + tempfilename);
+    }
 }
 
 // If we are doing sorted BAM output, then when we are done we will have sorted temporary files
@@ -225,6 +365,7 @@ void HtsFile::finalise(const ProgressCallback& progress_callback) {
 
     // If any reads are cached for writing, write out the final temporary file.
     flush_temp_file(nullptr);
+    wait_for_spill();
 
     bool file_is_mapped = (sam_hdr_nref(m_header.get()) > 0);
     m_header.reset();
@@ -294,26 +435,27 @@ int HtsFile::write_to_file(const bam1_t* record) {
 
 void HtsFile::cache_record(const bam1_t* record) {
     size_t bytes_required = sizeof(bam1_t) + size_t(record->l_data);
-    if (m_current_buffer_offset + bytes_required > m_bam_buffer.size()) {
+    if (m_current_buffer_offset + bytes_required > buffer_half_size()) {
         // This record won't fit in the buffer, so flush the current buffer, plus this record, to the file.
         flush_temp_file(record);
         return;
     }
     auto sorting_key = calculate_sorting_key(record);
-    m_buffer_map.insert({sorting_key, m_current_buffer_offset});
+    m_sort_entries.push_back({sorting_key, m_current_buffer_offset});
 
     // Copy the contents of the bam1_t struct into the memory buffer.
-    auto record_buff = m_bam_buffer.data() + m_current_buffer_offset;
+    auto buffer = active_buffer();
+    auto record_buff = buffer + m_current_buffer_offset;
     memcpy(record_buff, record, sizeof(bam1_t));
     m_current_buffer_offset += sizeof(bam1_t);
 
     // The data pointed to by the bam1_t::data field is then copied immediately after the struct contents.
-    memcpy(m_bam_buffer.data() + m_current_buffer_offset, record->data, record->l_data);
+    memcpy(buffer + m_current_buffer_offset, record->data, record->l_data);
 
     // We have to tell our buffered object where its copy of the data is.
     bam1_t* buffer_entry = std::launder(reinterpret_cast<bam1_t*>(record_buff));
     buffer_entry->data =
-            std::launder(reinterpret_cast<uint8_t*>(m_bam_buffer.data() + m_current_buffer_offset));
+            std::launder(reinterpret_cast<uint8_t*>(buffer + m_current_buffer_offset));
 
     // When we write the cached records, we will use a pointer cast to treat the cached record as a bam1_t
     // object, so we need to round up our buffer offset so that the next entry will be properly aligned.
@@ -331,16 +473,67 @@ bool HtsFile::merge_temp_files_iteratively(const ProgressCallback& progress_call
     progress_callback(percent_start_merging);
     ProgressUpdater update_progress(progress_callback, percent_start_merging, 100,
                                     m_num_records * progress_multiplier);
-    for (size_t iter = 0; iter < num_batches; ++iter) {
-        if (!merge_temp_files(update_progress, batcher.get_batch(iter),
-                              batcher.get_merge_filename(iter))) {
+    MergeThreadPool thread_pool(m_threads);
+    const auto start_time = std::chrono::steady_clock::now();
+
+    // Batches only depend on the outputs of earlier batches, so we can merge a run of
+    // consecutive batches which don't depend on each other (i.e. those at the same level of
+    // the recursion) concurrently.
+    const size_t max_concurrent_merges = size_t(std::max(m_threads, 1));
+    size_t first_batch = 0;
+    while (first_batch < num_batches) {
+        std::unordered_set<std::string> outputs_in_wave;
+        size_t end_batch = first_batch;
+        for (; end_batch < num_batches; ++end_batch) {
+            const auto& batch = batcher.get_batch(end_batch);
+            if (std::any_of(batch.begin(), batch.end(), [&](const std::string& file) {
+                    return outputs_in_wave.count(file) > 0;
+                })) {
+                break;
+            }
+            outputs_in_wave.insert(batcher.get_merge_filename(end_batch));
+        }
+
+        std::atomic<size_t> next_batch{first_batch};
+        std::atomic<bool> success{true};
+        auto merge_batches = [&] {
+            for (size_t batch = next_batch++; batch < end_batch && success; batch = next_batch++) {
+                try {
+                    if (!merge_temp_files(update_progress, thread_pool, batcher.get_batch(batch),
+                                          batcher.get_merge_filename(batch))) {
+                        success = false;
+                    }
+                } catch (const std::exception& e) {
+                    spdlog::error("Error merging temporary files: {}", e.what());
+                    success = false;
+                }
+            }
+        };
+        std::vector<std::thread> merge_threads;
+        const size_t num_merge_threads = std::min(max_concurrent_merges, end_batch - first_batch);
+        for (size_t i = 1; i < num_merge_threads; ++i) {
+            merge_threads.emplace_back(merge_batches);
+        }
+        merge_batches();
+        for (auto& merge_thread : merge_threads) {
+            merge_thread.join();
+        }
+        if (!success) {
             return false;
         }
+
+        first_batch = end_batch;
     }
+
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start_time;
+    spdlog::debug("Merged {} temporary files in {} batches: {} records in {:.1f}s ({:.0f}/s)",
+                  m_temp_files.size(), num_batches, update_progress.count(), duration.count(),
+                  update_progress.count() / std::max(duration.count(), 1e-6));
     return true;
 }
 
 bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
+                               MergeThreadPool& thread_pool,
                                const std::vector<std::string>& temp_files,
                                const std::string& merged_filename) const {
     // This code assumes the headers for the files are all the same. This will be
@@ -349,11 +542,18 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
     const size_t num_temp_files = temp_files.size();
     std::vector<HtsFilePtr> in_files(num_temp_files);
     std::vector<BamPtr> top_records(num_temp_files);
-    std::vector<uint64_t> top_record_scores(num_temp_files);
+    // Min-heap of (sorting key, file index) for the next record of each file.  Ties go to the
+    // lowest file index, so records with equal keys keep the order in which they were written.
+    using HeapEntry = std::pair<uint64_t, size_t>;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> next_records;
     SamHdrPtr header{};
     for (size_t i = 0; i < num_temp_files; ++i) {
         in_files[i].reset(hts_open(temp_files[i].c_str(), "rb"));
-        if (bgzf_mt(in_files[i]->fp.bgzf, m_threads, 128) < 0) {
+        if (!in_files[i]) {
+            spdlog::error("Could not open temporary file {}", temp_files[i]);
+            return false;
+        }
+        if (!thread_pool.attach(in_files[i].get())) {
             spdlog::error("Could not enable multi threading for BAM reading.");
             return false;
         }
@@ -376,12 +576,16 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
                           res);
             return false;
         }
-        top_record_scores[i] = calculate_sorting_key(top_records[i].get());
+        next_records.emplace(calculate_sorting_key(top_records[i].get()), i);
     }
 
     // Open the output file, and write the header.
     HtsFilePtr out_file(hts_open(merged_filename.c_str(), "wb"));
-    if (bgzf_mt(out_file->fp.bgzf, m_threads, 128) < 0) {
+    if (!out_file) {
+        spdlog::error("Could not open sorted file {}", merged_filename);
+        return false;
+    }
+    if (!thread_pool.attach(out_file.get())) {
         spdlog::error("Could not enable multi threading for BAM generation.");
         return false;
     }
@@ -404,25 +608,10 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
         }
     }
 
-    size_t processed_records = 0;
-    size_t files_done = 0;
-    while (files_done < num_temp_files) {
+    while (!next_records.empty()) {
         // Find the next file to write a record from.
-        uint64_t best_score = std::numeric_limits<uint64_t>::max();
-        int best_index = -1;
-        for (size_t i = 0; i < num_temp_files; ++i) {
-            if (top_records[i]) {
-                auto score = top_record_scores[i];
-                if (best_index == -1 || score < best_score) {
-                    best_score = score;
-                    best_index = int(i);
-                }
-            }
-        }
-        if (best_index == -1) {
-            spdlog::error("Logic error in merging algorithm.");
-            return false;
-        }
+        const size_t best_index = next_records.top().second;
+        next_records.pop();
 
         // Write the record.
         auto res = sam_write1(out_file.get(), out_header.get(), top_records[best_index].get());
@@ -430,26 +619,23 @@ bool HtsFile::merge_temp_files(ProgressUpdater& update_progress,
             spdlog::error("Failed to write to sorted file {}, error code {}", out_file->fn, res);
             return false;
         }
-        ++processed_records;
-        update_progress(processed_records);
+        update_progress(1);
 
-        // Load the next record for the file.
-        top_records[best_index].reset(bam_init1());
+        // Load the next record for the file, reusing the record we've just written.
         res = sam_read1(in_files[best_index].get(), header.get(), top_records[best_index].get());
         if (res >= 0) {
-            top_record_scores[best_index] = calculate_sorting_key(top_records[best_index].get());
+            next_records.emplace(calculate_sorting_key(top_records[best_index].get()),
+                                 best_index);
         } else if (res == -1) {
             // EOF reached. Close the file and mark that this file is done.
             top_records[best_index].reset();
             in_files[best_index].reset();
-            ++files_done;
         } else if (res < -1) {
             spdlog::error("Error reading record from file {}, error code {}",
                           in_files[best_index]->fn, res);
             return false;
         }
     }
-
     if (final_iteration) {
         // Write the index file.
         auto res = sam_idx_save(out_file.get());
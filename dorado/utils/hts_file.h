@@ -3,10 +3,12 @@
 #include "types.h"
 
 #include <algorithm>
+#include <exception>
 #include <filesystem>
 #include <functional>
-#include <map>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace dorado::utils {
 
@@ -51,18 +53,39 @@ private:
     bool m_sort_bam;
     const OutputMode m_mode;
 
+    // Sort key for a cached record, and its offset in m_bam_buffer.
+    struct SortEntry {
+        uint64_t key;
+        int64_t offset;
+    };
+
+    // For sorted output, records are cached in one half of m_bam_buffer while the other half
+    // is sorted and written to a temporary file by m_spill_thread.
     std::vector<std::byte> m_bam_buffer;
-    std::multimap<uint64_t, int64_t> m_buffer_map;
+    size_t m_active_half{0};
+    std::vector<SortEntry> m_sort_entries;
     std::vector<std::string> m_temp_files;
     int64_t m_current_buffer_offset{0};
+    std::thread m_spill_thread;
+    // Set if m_spill_thread failed, to be rethrown on the caller's thread.
+    std::exception_ptr m_spill_error;
 
     struct ProgressUpdater;
+    struct MergeThreadPool;
 
+    size_t buffer_half_size() const;
+    std::byte* active_buffer();
     void flush_temp_file(const bam1_t* last_record);
+    void wait_for_spill();
+    void write_temp_file(const std::string& tempfilename,
+                         std::byte* buffer,
+                         std::vector<SortEntry>& sort_entries,
+                         const bam1_t* last_record) const;
     int write_to_file(const bam1_t* record);
     void cache_record(const bam1_t* record);
     bool merge_temp_files_iteratively(const ProgressCallback& progress_callback) const;
     bool merge_temp_files(ProgressUpdater& update_progress,
+                          MergeThreadPool& thread_pool,
                           const std::vector<std::string>& temp_files,
                           const std::string& merged_filename) const;
     void initialise_threads();
@@ -0,0 +1,52 @@
+#include "interned_string.h"
+
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+namespace dorado::utils {
+
+namespace {
+
+const std::string& empty_string() {
+    static const std::string empty;
+    return empty;
+}
+
+class StringPool {
+public:
+    const std::string* intern(std::string_view str) {
+        std::lock_guard lock(m_mutex);
+        auto it = m_index.find(str);
+        if (it != m_index.end()) {
+            return it->second;
+        }
+        // std::deque doesn't move its elements when growing, so the views in m_index stay valid.
+        const auto& stored = m_strings.emplace_back(str);
+        m_index.emplace(stored, &stored);
+        return &stored;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::deque<std::string> m_strings;
+    std::unordered_map<std::string_view, const std::string*> m_index;
+};
+
+StringPool& string_pool() {
+    // Leaked on purpose so that interned strings stay valid during static destruction.
+    static auto* pool = new StringPool;
+    return *pool;
+}
+
+}  // namespace
+
+InternedString::InternedString() : m_str(&empty_string()) {}
+
+InternedString::InternedString(std::string_view str)
+        : m_str(str.empty() ? &empty_string() : string_pool().intern(str)) {}
+
+std::ostream& operator<<(std::ostream& os, const InternedString& str) { return os << str.str(); }
+
+}  // namespace dorado::utils
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+namespace dorado::utils {
+
+// Immutable string whose storage is shared with every other InternedString of the same value.
+// Meant for values that are repeated across many reads (run ID, flowcell ID, model name...), so
+// that copying them onto each read is just a pointer copy rather than an allocation.
+// Interned values live for the lifetime of the process, so don't use this for per-read data.
+class InternedString {
+public:
+    InternedString();
+    InternedString(std::string_view str);
+    InternedString(const std::string& str) : InternedString(std::string_view(str)) {}
+    InternedString(const char* str) : InternedString(std::string_view(str)) {}
+
+    const std::string& str() const { return *m_str; }
+    operator const std::string&() const { return *m_str; }
+
+    bool empty() const { return m_str->empty(); }
+    std::size_t size() const { return m_str->size(); }
+    const char* c_str() const { return m_str->c_str(); }
+
+    // Equal values share the same storage, so this doesn't need to look at the characters.
+    friend bool operator==(const InternedString& lhs, const InternedString& rhs) {
+        return lhs.m_str == rhs.m_str;
+    }
+    friend bool operator!=(const InternedString& lhs, const InternedString& rhs) {
+        return !(lhs == rhs);
+    }
+
+    // Overloads for the other string types, to avoid ambiguous conversions.
+    friend bool operator==(const InternedString& lhs, const std::string& rhs) {
+        return lhs.str() == rhs;
+    }
+    friend bool operator==(const InternedString& lhs, const char* rhs) { return lhs.str() == rhs; }
+    friend bool operator==(const std::string& lhs, const InternedString& rhs) { return rhs == lhs; }
+    friend bool operator==(const char* lhs, const InternedString& rhs) { return rhs == lhs; }
+    friend bool operator!=(const InternedString& lhs, const std::string& rhs) {
+        return !(lhs == rhs);
+    }
+    friend bool operator!=(const InternedString& lhs, const char* rhs) { return !(lhs == rhs); }
+    friend bool operator!=(const std::string& lhs, const InternedString& rhs) {
+        return !(lhs == rhs);
+    }
+    friend bool operator!=(const char* lhs, const InternedString& rhs) { return !(lhs == rhs); }
+
+private:
+    const std::string* m_str;
+};
+
+std::ostream& operator<<(std::ostream& os, const InternedString& str);
+
+}  // namespace dorado::utils
@@ -0,0 +1,98 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dorado::stats {
+
+namespace {
+
+int highest_set_bit(uint64_t value) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+double to_us(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}  // namespace
+
+std::size_t LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<std::size_t>(value);
+    }
+    // The top SUB_BUCKET_BITS + 1 bits of the value pick the bucket.
+    const int shift = highest_set_bit(value) - SUB_BUCKET_BITS;
+    return static_cast<std::size_t>((shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS));
+}
+
+uint64_t LatencyHistogram::bucket_value(std::size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const auto shift = index / SUB_BUCKETS - 1;
+    const uint64_t lowest = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return lowest + ((uint64_t{1} << shift) - 1) / 2;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration, uint64_t count) {
+    const auto ns = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+    m_buckets[bucket_index(ns)].fetch_add(count, std::memory_order_relaxed);
+    m_total_ns.fetch_add(ns * count, std::memory_order_relaxed);
+    auto max_ns = m_max_ns.load(std::memory_order_relaxed);
+    while (ns > max_ns &&
+           !m_max_ns.compare_exchange_weak(max_ns, ns, std::memory_order_relaxed)) {
+    }
+    // Bump the count last, so that readers that see it will usually see the bucket too.
+    m_count.fetch_add(count, std::memory_order_release);
+}
+
+std::chrono::nanoseconds LatencyHistogram::mean() const {
+    const auto num = m_count.load(std::memory_order_acquire);
+    if (num == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::nanoseconds(m_total_ns.load(std::memory_order_relaxed) / num);
+}
+
+std::chrono::nanoseconds LatencyHistogram::max() const {
+    return std::chrono::nanoseconds(m_max_ns.load(std::memory_order_relaxed));
+}
+
+std::chrono::nanoseconds LatencyHistogram::quantile(double fraction) const {
+    const auto num = m_count.load(std::memory_order_acquire);
+    if (num == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    const auto rank = std::max<uint64_t>(
+            1, static_cast<uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * double(num))));
+    uint64_t seen = 0;
+    for (std::size_t index = 0; index < NUM_BUCKETS; ++index) {
+        seen += m_buckets[index].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // Don't report more than was actually recorded.
+            const auto value = std::min(bucket_value(index), m_max_ns.load());
+            return std::chrono::nanoseconds(value);
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::add_to_stats(NamedStats& stats, const std::string& prefix) const {
+    stats[prefix + ".count"] = double(count());
+    stats[prefix + ".mean_us"] = to_us(mean());
+    stats[prefix + ".p50_us"] = to_us(quantile(0.5));
+    stats[prefix + ".p90_us"] = to_us(quantile(0.9));
+    stats[prefix + ".p99_us"] = to_us(quantile(0.99));
+    stats[prefix + ".max_us"] = to_us(max());
+}
+
+}  // namespace dorado::stats
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "stats.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dorado::stats {
+
+// Lock-free histogram of durations, in the style of HdrHistogram.  Each power of two is split into
+// SUB_BUCKETS linear buckets, so durations are kept to within 1/SUB_BUCKETS of their true value
+// across the whole range.  Recording is a handful of relaxed atomic operations, which makes it
+// cheap enough to do for every message that passes through a node.
+class LatencyHistogram {
+public:
+    // Records |count| instances of |duration|.
+    void record(std::chrono::nanoseconds duration, uint64_t count = 1);
+
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    std::chrono::nanoseconds mean() const;
+    std::chrono::nanoseconds max() const;
+
+    // Returns the duration which |fraction| of the recorded durations are no larger than.
+    // Only approximate while durations are being recorded.
+    std::chrono::nanoseconds quantile(double fraction) const;
+
+    // Adds the count, along with the mean, p50, p90, p99 and max in microseconds, to |stats|
+    // with names prefixed by |prefix|.
+    void add_to_stats(NamedStats& stats, const std::string& prefix) const;
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr std::size_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static std::size_t bucket_index(uint64_t value);
+    // Returns the middle of the range of values held in bucket |index|.
+    static uint64_t bucket_value(std::size_t index);
+
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_total_ns{0};
+    std::atomic<uint64_t> m_max_ns{0};
+};
+
+}  // namespace dorado::stats
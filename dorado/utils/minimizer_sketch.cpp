@@ -0,0 +1,115 @@
+#include "minimizer_sketch.h"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+constexpr int kKmerBits = 2 * dorado::utils::MinimizerSketch::kKmerSize;
+constexpr uint32_t kKmerMask = (uint32_t{1} << kKmerBits) - 1;
+
+// 2-bit codes for ACGT, and -1 for anything else.
+constexpr std::array<int8_t, 256> make_base_codes() {
+    std::array<int8_t, 256> codes{};
+    for (auto& code : codes) {
+        code = -1;
+    }
+    codes['A'] = codes['a'] = 0;
+    codes['C'] = codes['c'] = 1;
+    codes['G'] = codes['g'] = 2;
+    codes['T'] = codes['t'] = 3;
+    return codes;
+}
+constexpr auto kBaseCodes = make_base_codes();
+
+// Thomas Wang's integer hash, as used by minimap2, restricted to kKmerBits.  Every step is
+// invertible, so distinct k-mers never have the same hash and the minimizer of a window
+// doesn't depend on the order the k-mers were seen in.
+uint32_t hash_kmer(uint32_t kmer) {
+    uint64_t key = kmer;
+    key = (~key + (key << 21)) & kKmerMask;
+    key = key ^ (key >> 24);
+    key = ((key + (key << 3)) + (key << 8)) & kKmerMask;
+    key = key ^ (key >> 14);
+    key = ((key + (key << 2)) + (key << 4)) & kKmerMask;
+    key = key ^ (key >> 28);
+    return static_cast<uint32_t>(key);
+}
+
+}  // namespace
+
+namespace dorado::utils {
+
+MinimizerSketch::MinimizerSketch(std::string_view seq) {
+    struct Kmer {
+        uint32_t hash;
+        uint32_t canonical;
+    };
+    std::array<Kmer, kWindowSize> window{};
+    m_minimizers.reserve(2 * seq.size() / (kWindowSize + 1) + 1);
+
+    auto add_minimizer = [&window, this](size_t num_kmers) {
+        const auto min_it = std::min_element(
+                window.begin(), window.begin() + num_kmers,
+                [](const Kmer& lhs, const Kmer& rhs) { return lhs.hash < rhs.hash; });
+        // Neighbouring windows usually share a minimizer, so skip the obvious duplicates now.
+        if (m_minimizers.empty() || m_minimizers.back() != min_it->canonical) {
+            m_minimizers.push_back(min_it->canonical);
+        }
+    };
+
+    uint32_t forward = 0;
+    uint32_t reverse = 0;
+    // Number of valid bases and k-mers since the last ambiguous base.
+    size_t num_bases = 0;
+    size_t num_kmers = 0;
+    const int reverse_shift = kKmerBits - 2;
+    for (size_t i = 0; i <= seq.size(); ++i) {
+        const int code = i < seq.size() ? kBaseCodes[static_cast<uint8_t>(seq[i])] : -1;
+        if (code < 0) {
+            // A short run of k-mers that never filled a window still gets its best one.
+            if (num_kmers > 0 && num_kmers < kWindowSize) {
+                add_minimizer(num_kmers);
+            }
+            num_bases = 0;
+            num_kmers = 0;
+            continue;
+        }
+
+        forward = ((forward << 2) | uint32_t(code)) & kKmerMask;
+        reverse = (reverse >> 2) | (uint32_t(3 - code) << reverse_shift);
+        if (++num_bases < kKmerSize) {
+            continue;
+        }
+
+        // k is odd, so a k-mer is never its own reverse complement.
+        const uint32_t canonical = std::min(forward, reverse);
+        window[num_kmers % kWindowSize] = {hash_kmer(canonical), canonical};
+        if (++num_kmers >= kWindowSize) {
+            add_minimizer(kWindowSize);
+        }
+    }
+
+    std::sort(m_minimizers.begin(), m_minimizers.end());
+    m_minimizers.erase(std::unique(m_minimizers.begin(), m_minimizers.end()), m_minimizers.end());
+}
+
+std::size_t MinimizerSketch::count_shared(const MinimizerSketch& other) const {
+    std::size_t num_shared = 0;
+    auto lhs = m_minimizers.begin();
+    auto rhs = other.m_minimizers.begin();
+    while (lhs != m_minimizers.end() && rhs != other.m_minimizers.end()) {
+        if (*lhs < *rhs) {
+            ++lhs;
+        } else if (*rhs < *lhs) {
+            ++rhs;
+        } else {
+            ++num_shared;
+            ++lhs;
+            ++rhs;
+        }
+    }
+    return num_shared;
+}
+
+}  // namespace dorado::utils
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace dorado::utils {
+
+// Canonical (k, w)-minimizers of a sequence, for cheaply checking whether two reads could
+// overlap before aligning them.  Minimizers are strand independent, so a read and the reverse
+// complement of an overlapping read share them too.  Any exact match of at least
+// kWindowSize + kKmerSize - 1 bases between two sequences, in either orientation, is
+// guaranteed to give a shared minimizer.
+class MinimizerSketch {
+public:
+    static constexpr int kKmerSize = 15;
+    static constexpr int kWindowSize = 5;
+
+    MinimizerSketch() = default;
+    explicit MinimizerSketch(std::string_view seq);
+
+    std::size_t size() const { return m_minimizers.size(); }
+    bool empty() const { return m_minimizers.empty(); }
+
+    // Number of distinct minimizers present in both sketches.
+    std::size_t count_shared(const MinimizerSketch& other) const;
+
+private:
+    // Sorted and deduplicated 2-bit encoded canonical k-mers.
+    std::vector<uint32_t> m_minimizers;
+};
+
+}  // namespace dorado::utils
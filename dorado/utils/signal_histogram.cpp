@@ -0,0 +1,151 @@
+#include "signal_histogram.h"
+
+#include "simd.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace {
+
+// Returns the min and max values of signal[0, size).
+#if ENABLE_AVX2_IMPL
+__attribute__((target("default")))
+#endif
+std::pair<int16_t, int16_t> signal_range(const int16_t* signal, std::size_t size) {
+    const auto [min_it, max_it] = std::minmax_element(signal, signal + size);
+    return {*min_it, *max_it};
+}
+
+#if ENABLE_AVX2_IMPL
+__attribute__((target("avx2"))) std::pair<int16_t, int16_t> signal_range(const int16_t* signal,
+                                                                        std::size_t size) {
+    // 16 int16 values per AVX2 register.
+    static constexpr std::size_t kUnroll = 16;
+
+    int16_t min_value = signal[0];
+    int16_t max_value = signal[0];
+    std::size_t i = 0;
+    if (size >= kUnroll) {
+        __m256i mins = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(signal));
+        __m256i maxs = mins;
+        for (i = kUnroll; i + kUnroll <= size; i += kUnroll) {
+            const __m256i values =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&signal[i]));
+            mins = _mm256_min_epi16(mins, values);
+            maxs = _mm256_max_epi16(maxs, values);
+        }
+
+        alignas(32) int16_t lane_mins[kUnroll];
+        alignas(32) int16_t lane_maxs[kUnroll];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lane_mins), mins);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lane_maxs), maxs);
+        min_value = *std::min_element(std::begin(lane_mins), std::end(lane_mins));
+        max_value = *std::max_element(std::begin(lane_maxs), std::end(lane_maxs));
+    }
+
+    // Final 0-15 values.
+    for (; i < size; ++i) {
+        min_value = std::min(min_value, signal[i]);
+        max_value = std::max(max_value, signal[i]);
+    }
+    return {min_value, max_value};
+}
+#endif
+
+}  // namespace
+
+namespace dorado::utils {
+
+SignalHistogram::SignalHistogram(const int16_t* signal, std::size_t size) : m_size(size) {
+    if (size == 0) {
+        throw std::runtime_error("Cannot build a histogram of an empty signal");
+    }
+    std::tie(m_min, m_max) = signal_range(signal, size);
+    const std::size_t range = std::size_t(m_max - m_min) + 1;
+
+    // Neighbouring samples usually have similar values, so counting into a single histogram
+    // stalls on the store->load dependency of repeated increments to the same bin.  Spread
+    // the counts over a few interleaved histograms and sum them afterwards.
+    static constexpr std::size_t kNumHistograms = 4;
+    std::vector<uint32_t> counts(kNumHistograms * range);
+    const int min_value = m_min;
+    std::size_t i = 0;
+    for (; i + kNumHistograms <= size; i += kNumHistograms) {
+        for (std::size_t h = 0; h < kNumHistograms; ++h) {
+            ++counts[(signal[i + h] - min_value) * kNumHistograms + h];
+        }
+    }
+    for (; i < size; ++i) {
+        ++counts[(signal[i] - min_value) * kNumHistograms];
+    }
+
+    m_cumulative_counts.resize(range);
+    std::size_t total = 0;
+    for (std::size_t bin = 0; bin < range; ++bin) {
+        for (std::size_t h = 0; h < kNumHistograms; ++h) {
+            total += counts[bin * kNumHistograms + h];
+        }
+        m_cumulative_counts[bin] = total;
+    }
+    assert(total == size);
+}
+
+std::size_t SignalHistogram::count_up_to(int value) const {
+    if (value < m_min) {
+        return 0;
+    }
+    if (value >= m_max) {
+        return m_size;
+    }
+    return m_cumulative_counts[value - m_min];
+}
+
+int16_t SignalHistogram::quantile(float q) const {
+    // Rounded the same way as quantile_counting().
+    const float position = q * (m_size - 1);
+    if (!(position >= 0)) {
+        return m_min;
+    }
+    const auto threshold = static_cast<std::size_t>(position);
+    const auto it =
+            std::upper_bound(m_cumulative_counts.begin(), m_cumulative_counts.end(), threshold);
+    if (it == m_cumulative_counts.end()) {
+        return m_max;
+    }
+    return static_cast<int16_t>(m_min + std::distance(m_cumulative_counts.begin(), it));
+}
+
+int16_t SignalHistogram::median() const {
+    // The lower median is the value with (size - 1) / 2 values before it.
+    const auto rank = (m_size - 1) / 2;
+    const auto it = std::upper_bound(m_cumulative_counts.begin(), m_cumulative_counts.end(), rank);
+    assert(it != m_cumulative_counts.end());
+    return static_cast<int16_t>(m_min + std::distance(m_cumulative_counts.begin(), it));
+}
+
+int SignalHistogram::mad() const {
+    // The number of values within deviation d of the median is the count of values in
+    // [median - d, median + d], which grows with d, so binary search for the smallest d
+    // covering more than (size - 1) / 2 values.
+    const int median_value = median();
+    const auto rank = (m_size - 1) / 2;
+    int lo = 0;
+    int hi = std::max(median_value - m_min, m_max - median_value);
+    while (lo < hi) {
+        const int deviation = lo + (hi - lo) / 2;
+        const auto within = count_up_to(median_value + deviation) -
+                            count_up_to(median_value - deviation - 1);
+        if (within > rank) {
+            hi = deviation;
+        } else {
+            lo = deviation + 1;
+        }
+    }
+    return lo;
+}
+
+}  // namespace dorado::utils
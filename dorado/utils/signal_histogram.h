@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dorado::utils {
+
+// Histogram of the values in an int16 signal, from which any number of quantiles and the
+// median/MAD can be read without sorting.  Raw signal only covers a few thousand distinct
+// values, so building it is a vectorised min/max scan followed by a single counting pass.
+class SignalHistogram {
+public:
+    // Throws if the signal is empty.
+    SignalHistogram(const int16_t* signal, std::size_t size);
+
+    std::size_t size() const { return m_size; }
+    int16_t min() const { return m_min; }
+    int16_t max() const { return m_max; }
+
+    // Same result as quantile_counting(): the smallest value with more than
+    // int(q * (size - 1)) values at or below it, i.e. `interpolation='lower'`.
+    int16_t quantile(float q) const;
+
+    // Lower median and median absolute deviation, the same as at::median().
+    int16_t median() const;
+    int mad() const;
+
+private:
+    // Number of values <= value.
+    std::size_t count_up_to(int value) const;
+
+    // m_cumulative_counts[i] is the number of values <= m_min + i.
+    std::vector<std::size_t> m_cumulative_counts;
+    std::size_t m_size;
+    int16_t m_min;
+    int16_t m_max;
+};
+
+}  // namespace dorado::utils
@@ -0,0 +1,62 @@
+#include "sliding_median.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+namespace dorado::utils {
+
+void SlidingMedian::move_to(const int16_t* signal, std::size_t begin, std::size_t end) {
+    assert(begin <= end);
+    assert(m_sorted.empty() || (begin >= m_begin && end >= m_end));
+
+    const auto num_changes = (begin - m_begin) + (end - m_end);
+    if (m_sorted.empty() || begin >= m_end || num_changes >= m_sorted.size()) {
+        // Little or nothing in common with the previous window, so start from scratch.
+        m_sorted.assign(signal + begin, signal + end);
+        std::sort(m_sorted.begin(), m_sorted.end());
+    } else {
+        for (auto i = m_begin; i < begin; ++i) {
+            const auto it = std::lower_bound(m_sorted.begin(), m_sorted.end(), signal[i]);
+            assert(it != m_sorted.end() && *it == signal[i]);
+            m_sorted.erase(it);
+        }
+        for (auto i = m_end; i < end; ++i) {
+            const auto it = std::upper_bound(m_sorted.begin(), m_sorted.end(), signal[i]);
+            m_sorted.insert(it, signal[i]);
+        }
+    }
+    m_begin = begin;
+    m_end = end;
+}
+
+void SlidingMedian::reset() {
+    m_sorted.clear();
+    m_begin = 0;
+    m_end = 0;
+}
+
+int SlidingMedian::mad() const {
+    assert(!m_sorted.empty());
+    // The absolute deviations increase moving out from the median in either direction, so
+    // merge the two sides until we reach the middle deviation.
+    const int median_value = median();
+    const auto median_idx = static_cast<std::ptrdiff_t>((m_sorted.size() - 1) / 2);
+    auto left = median_idx;
+    auto right = median_idx + 1;
+    const auto num_values = static_cast<std::ptrdiff_t>(m_sorted.size());
+    int deviation = 0;
+    for (std::ptrdiff_t i = 0; i <= median_idx; ++i) {
+        const bool take_left =
+                right >= num_values ||
+                (left >= 0 && median_value - m_sorted[left] <= m_sorted[right] - median_value);
+        if (take_left) {
+            deviation = median_value - m_sorted[left--];
+        } else {
+            deviation = m_sorted[right++] - median_value;
+        }
+    }
+    return deviation;
+}
+
+}  // namespace dorado::utils
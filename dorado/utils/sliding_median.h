@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dorado::utils {
+
+// Median (and median absolute deviation) of a window of int16 samples sliding along a signal.
+// The window's samples are kept sorted and updated incrementally as the window moves, so moving
+// it by k samples costs O(k * window size) rather than a fresh median over the whole window.
+// Medians follow the at::median() convention of taking the lower middle value.
+class SlidingMedian {
+public:
+    explicit SlidingMedian(std::size_t max_window_size = 0) { m_sorted.reserve(max_window_size); }
+
+    // Moves the window to cover signal[begin, end).  The window only moves forwards, so begin
+    // and end can't be less than in the previous call for the same signal.
+    void move_to(const int16_t* signal, std::size_t begin, std::size_t end);
+
+    // Starts again with a new signal.
+    void reset();
+
+    std::size_t size() const { return m_sorted.size(); }
+
+    // The window must not be empty.
+    int16_t median() const { return m_sorted[(m_sorted.size() - 1) / 2]; }
+    int mad() const;
+
+private:
+    std::vector<int16_t> m_sorted;
+    std::size_t m_begin = 0;
+    std::size_t m_end = 0;
+};
+
+}  // namespace dorado::utils
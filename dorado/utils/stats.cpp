@@ -2,11 +2,29 @@
 
 #include "thread_naming.h"
 
+#include <cmath>
+#include <map>
 #include <ostream>
 #include <set>
+#include <utility>
 
 namespace dorado::stats {
 
+namespace {
+
+void write_json_string(std::ostream& out_stream, const std::string& str) {
+    out_stream << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            out_stream << '\\';
+        }
+        out_stream << c;
+    }
+    out_stream << '"';
+}
+
+}  // namespace
+
 struct StatsSampler::StatsRecord {
     int64_t elapsed_ms;
     NamedStats stats;
@@ -73,6 +91,46 @@ void StatsSampler::dump_stats(std::ostream& out_stream,
     }
 }
 
+void StatsSampler::dump_chrome_trace(std::ostream& out_stream,
+                                     std::optional<std::regex> name_filter) const {
+    out_stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out_stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,"
+               << "\"args\":{\"name\":\"dorado\"}}";
+
+    for (const auto& [elapsed_ms, record] : m_records) {
+        // Group stats into tracks by everything before the last '.' in their name.
+        std::map<std::string, std::vector<std::pair<std::string, double>>> tracks;
+        for (const auto& [name, value] : record) {
+            if (!std::isfinite(value) ||
+                (name_filter.has_value() && !std::regex_match(name, name_filter.value()))) {
+                continue;
+            }
+            const auto split = name.rfind('.');
+            if (split == std::string::npos) {
+                tracks[name].emplace_back("value", value);
+            } else {
+                tracks[name.substr(0, split)].emplace_back(name.substr(split + 1), value);
+            }
+        }
+
+        // Emit a counter event per track.
+        for (const auto& [track_name, series] : tracks) {
+            out_stream << ",\n{\"name\":";
+            write_json_string(out_stream, track_name);
+            out_stream << ",\"ph\":\"C\",\"pid\":0,\"ts\":" << elapsed_ms * 1000 << ",\"args\":{";
+            for (size_t i = 0; i < series.size(); ++i) {
+                if (i > 0) {
+                    out_stream << ",";
+                }
+                write_json_string(out_stream, series[i].first);
+                out_stream << ":" << series[i].second;
+            }
+            out_stream << "}}";
+        }
+    }
+    out_stream << "\n]}\n";
+}
+
 void StatsSampler::sampling_thread_fn() {
     utils::set_thread_name("stats_sampling");
     m_start_time = std::chrono::system_clock::now();
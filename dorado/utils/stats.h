@@ -41,6 +41,11 @@ public:
     // Dumps stats in CSV form, with entries filtered optionally according to name_filter.
     void dump_stats(std::ostream& out_stream, std::optional<std::regex> name_filter) const;
 
+    // Dumps stats as a Chrome trace (viewable in chrome://tracing or Perfetto), with entries
+    // filtered optionally according to name_filter.  Stats are shown as counter tracks grouped
+    // by name, e.g. all basecaller.queue.* stats share a track.
+    void dump_chrome_trace(std::ostream& out_stream, std::optional<std::regex> name_filter) const;
+
 private:
     std::vector<StatsReporter> m_stats_reporters;  // Entities we monitor
     std::vector<StatsCallable> m_stats_callables;
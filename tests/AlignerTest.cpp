@@ -8,6 +8,7 @@
 #include "read_pipeline/DefaultClientInfo.h"
 #include "read_pipeline/HtsReader.h"
 #include "utils/PostCondition.h"
+#include "utils/bam_record_builder.h"
 #include "utils/bam_utils.h"
 #include "utils/concurrency/multi_queue_thread_pool.h"
 #include "utils/sequence_utils.h"
@@ -17,9 +18,12 @@
 #include <catch2/catch.hpp>
 #include <htslib/sam.h>
 
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <random>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -634,3 +638,86 @@ TEST_CASE_METHOD(AlignerNodeTestFixture,
     }
     CHECK_THAT(bam_aux2Z(bam_aux_get(supplementary_rec, "SA")), Equals("read3,1,+,999M899S,0,0;"));
 }
+
+namespace {
+
+// Aligns reads sampled from a random reference, named by the position they were sampled from,
+// and returns the primary alignments and how long aligning took.
+std::pair<std::vector<dorado::BamPtr>, double> align_sampled_reads(std::size_t reference_length,
+                                                                   std::size_t read_length,
+                                                                   std::size_t num_reads,
+                                                                   int threads) {
+    std::minstd_rand gen(42);
+    std::uniform_int_distribution<int> base_dist(0, 3);
+    std::string reference(reference_length, 'A');
+    for (auto& base : reference) {
+        base = "ACGT"[base_dist(gen)];
+    }
+    auto temp_dir = make_temp_dir("aligner_batching_test");
+    const auto reference_file = (temp_dir.m_path / "reference.fa").string();
+    std::ofstream(reference_file) << ">reference\n" << reference << '\n';
+
+    const auto options = dorado::alignment::create_dflt_options();
+    std::vector<dorado::Message> output_messages;
+    dorado::PipelineDescriptor pipeline_desc;
+    auto sink = pipeline_desc.add_node<MessageSinkToVector>({}, 100, output_messages);
+    pipeline_desc.add_node<dorado::AlignerNode>(
+            {sink}, std::make_shared<dorado::alignment::IndexFileAccess>(),
+            std::make_shared<dorado::alignment::BedFileAccess>(), reference_file, "", options,
+            threads);
+    auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+    std::vector<dorado::BamPtr> reads;
+    std::uniform_int_distribution<std::size_t> pos_dist(0, reference_length - read_length);
+    const std::string qstring(read_length, '5');
+    for (std::size_t i = 0; i < num_reads; ++i) {
+        const auto pos = pos_dist(gen);
+        auto seq = reference.substr(pos, read_length);
+        if (i % 2 == 1) {
+            seq = dorado::utils::reverse_complement(seq);
+        }
+        reads.push_back(dorado::utils::BamRecordBuilder().build(std::to_string(pos), 4, seq,
+                                                                qstring));
+    }
+
+    const auto client_info = std::make_shared<dorado::DefaultClientInfo>();
+    const auto start = std::chrono::steady_clock::now();
+    for (auto& read : reads) {
+        pipeline->push_message(dorado::BamMessage{std::move(read), client_info});
+    }
+    pipeline->terminate({});
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+    std::vector<dorado::BamPtr> primary_alignments;
+    for (auto& bam_message : ConvertMessages<dorado::BamMessage>(std::move(output_messages))) {
+        if (!(bam_message.bam_ptr->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY))) {
+            primary_alignments.push_back(std::move(bam_message.bam_ptr));
+        }
+    }
+    return {std::move(primary_alignments), duration.count()};
+}
+
+}  // namespace
+
+TEST_CASE("AlignerTest: Check batched alignment of short reads", TEST_GROUP) {
+    const std::size_t num_reads = 1000;
+    const auto alignments = align_sampled_reads(100000, 200, num_reads, 4).first;
+    REQUIRE(alignments.size() == num_reads);
+    for (const auto& alignment : alignments) {
+        CAPTURE(bam_get_qname(alignment.get()));
+        CHECK_FALSE(alignment->core.flag & BAM_FUNMAP);
+        CHECK(std::to_string(alignment->core.pos) == bam_get_qname(alignment.get()));
+    }
+}
+
+TEST_CASE("AlignerTest: batched alignment throughput", BENCHMARK_TAG) {
+    const std::size_t total_bases = 20'000'000;
+    for (const std::size_t read_length : {200, 20000}) {
+        const auto num_reads = total_bases / read_length;
+        const auto [alignments, seconds] =
+                align_sampled_reads(1'000'000, read_length, num_reads, 8);
+        CHECK(alignments.size() == num_reads);
+        std::cerr << read_length << " bp reads: " << num_reads / seconds << " reads/s, "
+                  << total_bases / seconds / 1e6 << " Mbases/s" << '\n';
+    }
+}
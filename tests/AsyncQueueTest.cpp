@@ -1,3 +1,4 @@
+#include "TestUtils.h"
 #include "utils/AsyncQueue.h"
 
 #include <catch2/catch.hpp>
@@ -6,16 +7,83 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <iostream>
 #include <numeric>
 #include <thread>
+#include <tuple>
+#include <vector>
 
 using dorado::utils::AsyncQueue;
+using dorado::utils::AsyncQueueBackend;
 using dorado::utils::AsyncQueueStatus;
 
+// Every test runs against both backends, since they must have the same behaviour.
+#define GENERATE_BACKEND() GENERATE(AsyncQueueBackend::Locked, AsyncQueueBackend::LockFree)
+
+namespace {
+
+// Pushes num_items_per_producer items from each of num_producers threads and pops them with
+// num_consumers threads, using batched pops if batch_size > 1.  Returns the number of times
+// each item was popped, and the time taken.
+std::tuple<std::vector<int>, std::chrono::duration<double>> run_producers_consumers(
+        AsyncQueueBackend backend,
+        int num_producers,
+        int num_consumers,
+        int num_items_per_producer,
+        size_t batch_size) {
+    AsyncQueue<int> queue(1000, backend);
+    const int num_items = num_producers * num_items_per_producer;
+    std::vector<std::atomic<int>> pop_counts(num_items);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < num_consumers; ++c) {
+        consumers.emplace_back([&] {
+            auto record_pop = [&pop_counts](int val) { pop_counts.at(val).fetch_add(1); };
+            if (batch_size > 1) {
+                while (queue.process_and_pop_n(record_pop, batch_size) ==
+                       AsyncQueueStatus::Success) {
+                }
+            } else {
+                int val = -1;
+                while (queue.try_pop(val) == AsyncQueueStatus::Success) {
+                    record_pop(val);
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < num_items_per_producer; ++i) {
+                int val = p * num_items_per_producer + i;
+                queue.try_push(std::move(val));
+            }
+        });
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    // Pops only fail once the queue has been drained.
+    queue.terminate();
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    return {std::vector<int>(pop_counts.begin(), pop_counts.end()), duration};
+}
+
+}  // namespace
+
 TEST_CASE(TEST_GROUP ": InputsMatchOutputs") {
     const int n = 10;
-    AsyncQueue<int> queue(n);
+    const auto backend = GENERATE_BACKEND();
+    AsyncQueue<int> queue(n, backend);
 
     for (int i = 0; i < n; ++i) {
         // clang-tidy don't like us reusing a moved-from variable even if it's trivial,
@@ -33,14 +101,16 @@ TEST_CASE(TEST_GROUP ": InputsMatchOutputs") {
 }
 
 TEST_CASE(TEST_GROUP ": PushFailsIfTerminating") {
-    AsyncQueue<int> queue(1);
+    const auto backend = GENERATE_BACKEND();
+    AsyncQueue<int> queue(1, backend);
     queue.terminate();
     const auto status = queue.try_push(42);
     CHECK(status == AsyncQueueStatus::Terminate);
 }
 
 TEST_CASE(TEST_GROUP ": PopFailsIfTerminating") {
-    AsyncQueue<int> queue(1);
+    const auto backend = GENERATE_BACKEND();
+    AsyncQueue<int> queue(1, backend);
     queue.terminate();
     int val;
     const auto status = queue.try_pop(val);
@@ -48,7 +118,8 @@ TEST_CASE(TEST_GROUP ": PopFailsIfTerminating") {
 }
 
 TEST_CASE(TEST_GROUP ": PushPopSucceedAfterRestarting") {
-    AsyncQueue<int> queue(1);
+    const auto backend = GENERATE_BACKEND();
+    AsyncQueue<int> queue(1, backend);
     queue.terminate();
     queue.restart();
     const auto push_status = queue.try_push(42);
@@ -61,7 +132,8 @@ TEST_CASE(TEST_GROUP ": PushPopSucceedAfterRestarting") {
 // Spawned thread sits waiting for an item.
 // Main thread supplies that item.
 TEST_CASE(TEST_GROUP ": PopFromOtherThread") {
-    AsyncQueue<int> queue(1);
+    const auto backend = GENERATE_BACKEND();
+    AsyncQueue<int> queue(1, backend);
     std::atomic_bool thread_started{false};
     AsyncQueueStatus pop_status;
 
@@ -88,7 +160,8 @@ TEST_CASE(TEST_GROUP ": PopFromOtherThread") {
 // Spawned thread sits waiting for an item.
 // Main thread terminates wait.
 TEST_CASE(TEST_GROUP ": TerminateFromOtherThread") {
-    AsyncQueue<int> queue(1);
+    const auto backend = GENERATE_BACKEND();
+    AsyncQueue<int> queue(1, backend);
     std::atomic_bool thread_started{false};
     AsyncQueueStatus pop_status;
 
@@ -114,7 +187,8 @@ TEST_CASE(TEST_GROUP ": TerminateFromOtherThread") {
 
 TEST_CASE(TEST_GROUP ": process_and_pop_n") {
     const int n = 10;
-    AsyncQueue<int> queue(n);
+    const auto backend = GENERATE_BACKEND();
+    AsyncQueue<int> queue(n, backend);
     for (int i = 0; i < n; ++i) {
         // clang-tidy don't like us reusing a moved-from variable even if it's trivial,
         // so store to a temporary that's not used again after it's moved.
@@ -140,4 +214,112 @@ TEST_CASE(TEST_GROUP ": process_and_pop_n") {
     std::iota(expected.begin(), expected.end(), 0);
     CHECK(popped_items == expected);
     CHECK(queue.size() == 0);
-}
\ No newline at end of file
+}
+
+TEST_CASE(TEST_GROUP ": try_pop_until times out") {
+    const auto backend = GENERATE_BACKEND();
+    AsyncQueue<int> queue(1, backend);
+    int val = -1;
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+    CHECK(queue.try_pop_until(val, timeout) == AsyncQueueStatus::Timeout);
+
+    CHECK(queue.try_push(42) == AsyncQueueStatus::Success);
+    CHECK(queue.try_pop_until(val, timeout) == AsyncQueueStatus::Success);
+    CHECK(val == 42);
+}
+
+TEST_CASE(TEST_GROUP ": items are popped after terminate") {
+    const auto backend = GENERATE_BACKEND();
+    AsyncQueue<int> queue(2, backend);
+    CHECK(queue.try_push(1) == AsyncQueueStatus::Success);
+    CHECK(queue.try_push(2) == AsyncQueueStatus::Success);
+    queue.terminate();
+
+    // Termination only takes effect for pops once the queue is empty.
+    int val = -1;
+    CHECK(queue.try_pop(val) == AsyncQueueStatus::Success);
+    CHECK(val == 1);
+    std::vector<int> popped_items;
+    auto pop_item = [&popped_items](int popped) { popped_items.push_back(popped); };
+    CHECK(queue.process_and_pop_n(pop_item, 5) == AsyncQueueStatus::Success);
+    CHECK(popped_items == std::vector<int>{2});
+    CHECK(queue.try_pop(val) == AsyncQueueStatus::Terminate);
+}
+
+TEST_CASE(TEST_GROUP ": full queue blocks push until popped") {
+    const auto backend = GENERATE_BACKEND();
+    AsyncQueue<int> queue(1, backend);
+    CHECK(queue.try_push(1) == AsyncQueueStatus::Success);
+
+    std::atomic_bool pushed{false};
+    AsyncQueueStatus push_status;
+    auto pushing_thread = std::thread([&]() {
+        // catch2 isn't thread safe so we have to check this on the main thread
+        push_status = queue.try_push(2);
+        pushed.store(true);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(!pushed.load());
+
+    int val = -1;
+    CHECK(queue.try_pop(val) == AsyncQueueStatus::Success);
+    CHECK(val == 1);
+    pushing_thread.join();
+    CHECK(push_status == AsyncQueueStatus::Success);
+    CHECK(queue.try_pop(val) == AsyncQueueStatus::Success);
+    CHECK(val == 2);
+}
+
+TEST_CASE(TEST_GROUP ": try_push_n pushes in order, blocking when full") {
+    const auto backend = GENERATE_BACKEND();
+    const int num_items = 100;
+    // Smaller than the batch, so the push has to wait for the consumer.
+    AsyncQueue<int> queue(7, backend);
+
+    std::vector<int> popped_items;
+    auto popping_thread = std::thread([&]() {
+        auto pop_item = [&popped_items](int popped) { popped_items.push_back(popped); };
+        while (queue.process_and_pop_n(pop_item, 3) == AsyncQueueStatus::Success) {
+        }
+    });
+
+    std::vector<int> items(num_items);
+    std::iota(items.begin(), items.end(), 0);
+    CHECK(queue.try_push_n(std::vector<int>(items)) == AsyncQueueStatus::Success);
+    queue.terminate();
+    popping_thread.join();
+    CHECK(popped_items == items);
+
+    // Once terminating, nothing more is added.
+    CHECK(queue.try_push_n({1, 2, 3}) == AsyncQueueStatus::Terminate);
+    CHECK(queue.size() == 0);
+}
+
+TEST_CASE(TEST_GROUP ": multiple producers and consumers") {
+    const auto backend = GENERATE_BACKEND();
+    const size_t batch_size = GENERATE(1, 16);
+    const auto [pop_counts, duration] = run_producers_consumers(backend, 4, 4, 10000, batch_size);
+    // Every item should be popped exactly once.
+    CHECK(std::all_of(pop_counts.begin(), pop_counts.end(), [](int count) { return count == 1; }));
+}
+
+// Compares throughput of the two backends under contention.
+TEST_CASE(TEST_GROUP ": contention benchmark", BENCHMARK_TAG) {
+    const int num_items_per_producer = 200000;
+    for (const auto& [num_producers, num_consumers] :
+         {std::pair{1, 1}, std::pair{4, 4}, std::pair{8, 2}, std::pair{2, 8}}) {
+        for (size_t batch_size : {1, 16}) {
+            for (auto backend : {AsyncQueueBackend::Locked, AsyncQueueBackend::LockFree}) {
+                const auto [pop_counts, duration] =
+                        run_producers_consumers(backend, num_producers, num_consumers,
+                                                num_items_per_producer, batch_size);
+                const double items_per_sec =
+                        num_producers * num_items_per_producer / duration.count();
+                std::cerr << (backend == AsyncQueueBackend::Locked ? "locked    " : "lock-free ")
+                          << num_producers << "P/" << num_consumers << "C batch=" << batch_size
+                          << ": " << items_per_sec / 1e6 << "M items/s" << '\n';
+            }
+        }
+    }
+}
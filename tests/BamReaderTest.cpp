@@ -1,13 +1,17 @@
 #include "MessageSinkUtils.h"
 #include "TestUtils.h"
 #include "read_pipeline/HtsReader.h"
+#include "utils/bam_record_builder.h"
 #include "utils/bam_utils.h"
 
 #include <catch2/catch.hpp>
 #include <htslib/sam.h>
 
+#include <algorithm>
 #include <filesystem>
+#include <string>
 #include <unordered_set>
+#include <vector>
 
 #define TEST_GROUP "[bam_utils][hts_reader]"
 
@@ -15,6 +19,42 @@ namespace fs = std::filesystem;
 
 namespace dorado::hts_reader::test {
 
+namespace {
+
+// Writes num_reads unmapped reads named read_0, read_1, ... to a BGZF compressed BAM file.
+void write_bam(const fs::path& path, int num_reads) {
+    HtsFilePtr file(hts_open(path.string().c_str(), "wb"));
+    REQUIRE(file);
+    SamHdrPtr header(sam_hdr_init());
+    REQUIRE(sam_hdr_write(file.get(), header.get()) == 0);
+    const std::string seq(200, 'A');
+    const std::string qstring(200, '5');
+    for (int i = 0; i < num_reads; ++i) {
+        utils::BamRecordBuilder builder;
+        builder.append_int("rl", i);
+        auto record = builder.build("read_" + std::to_string(i), 4, seq, qstring);
+        REQUIRE(sam_write1(file.get(), header.get(), record.get()) >= 0);
+    }
+}
+
+std::vector<std::string> read_names_via_pipeline(HtsReader& reader, std::size_t max_reads) {
+    dorado::PipelineDescriptor pipeline_desc;
+    std::vector<dorado::Message> bam_records;
+    pipeline_desc.add_node<MessageSinkToVector>({}, 100, bam_records);
+    auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+    reader.read(*pipeline, max_reads);
+    pipeline.reset();
+
+    std::vector<std::string> names;
+    for (auto& message : bam_records) {
+        const auto& bam_message = std::get<BamMessage>(message);
+        names.emplace_back(bam_get_qname(bam_message.bam_ptr.get()));
+    }
+    return names;
+}
+
+}  // namespace
+
 TEST_CASE("HtsReaderTest: Read fasta to sink", TEST_GROUP) {
     fs::path aligner_test_dir = fs::path(get_data_dir("bam_reader"));
     auto fasta = aligner_test_dir / "input.fa";
@@ -129,4 +169,42 @@ TEST_CASE(
             "read=1728 ch=332 start_time=2017-06-16T15:31:55Z");
 }
 
-}  // namespace dorado::hts_reader::test
\ No newline at end of file
+TEST_CASE("HtsReaderTest: Read with prefetch threads matches reading without", TEST_GROUP) {
+    auto temp_dir = make_temp_dir("hts_reader_prefetch");
+    const auto bam = temp_dir.m_path / "reads.bam";
+    constexpr int num_reads = 5432;  // Several prefetch batches, plus a partial one.
+    write_bam(bam, num_reads);
+
+    const auto threads = GENERATE(1, 4);
+    const auto max_reads = GENERATE(std::size_t{0}, std::size_t{1}, std::size_t{2345});
+    const auto filter = GENERATE(false, true);
+    CAPTURE(threads, max_reads, filter);
+
+    std::optional<std::unordered_set<std::string>> read_list;
+    if (filter) {
+        read_list.emplace();
+        for (int i = 0; i < num_reads; i += 3) {
+            read_list->insert("read_" + std::to_string(i));
+        }
+    }
+
+    HtsReader expected_reader(bam.string(), read_list);
+    const auto expected = read_names_via_pipeline(expected_reader, max_reads);
+    HtsReader prefetch_reader(bam.string(), read_list, threads);
+    const auto names = read_names_via_pipeline(prefetch_reader, max_reads);
+    CHECK(names == expected);
+    const std::size_t num_expected = filter ? (num_reads + 2) / 3 : num_reads;
+    CHECK(names.size() == (max_reads == 0 ? num_expected : std::min(max_reads, num_expected)));
+
+    // Reading can carry on from where the pipeline read stopped.
+    if (max_reads > 0) {
+        REQUIRE(prefetch_reader.read());
+        CHECK(prefetch_reader.get_tag<int>("rl") > 0);
+    }
+
+    const auto stats = prefetch_reader.sample_stats();
+    CHECK(stats.count("decode_wait_s") == 1);
+    CHECK(stats.count("push_wait_s") == 1);
+}
+
+}  // namespace dorado::hts_reader::test
@@ -0,0 +1,263 @@
+#include "TestUtils.h"
+#include "read_pipeline/ReadPipeline.h"
+#include "utils/bam_record_builder.h"
+#include "utils/types.h"
+
+#include <ATen/Functions.h>
+#include <catch2/catch.hpp>
+#include <htslib/sam.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[BamRecordBuilder]"
+
+namespace {
+
+// High enough that most modified base calls are skipped, so MM has multi-digit skip counts.
+constexpr uint8_t kModbaseThreshold = 240;
+
+dorado::ReadCommon make_read(size_t seq_len, bool with_modbases) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> base_dist(0, 3);
+    std::uniform_int_distribution<int> qscore_dist('!' + 5, '!' + 40);
+
+    dorado::ReadCommon read_common;
+    read_common.read_id = "00000000-0000-0000-0000-000000000001";
+    read_common.raw_data = at::empty(6 * seq_len);
+    read_common.seq.resize(seq_len);
+    read_common.qstring.resize(seq_len);
+    for (size_t i = 0; i < seq_len; ++i) {
+        read_common.seq[i] = "ACGT"[base_dist(gen)];
+        read_common.qstring[i] = char(qscore_dist(gen));
+    }
+    read_common.model_stride = 6;
+    read_common.moves.resize(6 * seq_len / read_common.model_stride);
+    for (size_t i = 0; i < read_common.moves.size(); ++i) {
+        read_common.moves[i] = uint8_t(i % 3 == 0);
+    }
+    read_common.sample_rate = 5000;
+    read_common.shift = 128.3842f;
+    read_common.scale = 8.258f;
+    read_common.scaling_method = "quantile";
+    read_common.num_trimmed_samples = 132;
+    read_common.attributes.mux = 2;
+    read_common.attributes.read_number = 18501;
+    read_common.attributes.channel_number = 5;
+    read_common.attributes.start_time = "2017-04-29T09:10:04Z";
+    read_common.attributes.fast5_filename = "batch_0.fast5";
+    read_common.run_id = "xyz";
+    read_common.model_name = "test_model";
+    read_common.barcode = "barcode01";
+    read_common.parent_read_id = "parent_read";
+    read_common.split_point = 1234;
+    read_common.rna_poly_tail_length = 56;
+
+    if (with_modbases) {
+        // 5mC and 5hmC calls on C, with no context, so every C can be called.
+        read_common.mod_base_info = std::make_shared<dorado::ModBaseInfo>(
+                std::vector<std::string>{"A", "C", "m", "h", "G", "T"}, "5mC 5hmC", "");
+        std::uniform_int_distribution<int> prob_dist(0, 255);
+        read_common.base_mod_probs.resize(seq_len * read_common.mod_base_info->alphabet.size());
+        for (auto& prob : read_common.base_mod_probs) {
+            prob = uint8_t(prob_dist(gen));
+        }
+    }
+    return read_common;
+}
+
+// The record as it used to be built: set the core fields, then grow the record with
+// bam_aux_append() one tag at a time.
+dorado::BamPtr build_with_aux_append(const dorado::ReadCommon& read_common) {
+    bam1_t* aln = bam_init1();
+    std::vector<uint8_t> qscore;
+    std::transform(read_common.qstring.begin(), read_common.qstring.end(),
+                   std::back_inserter(qscore), [](char c) { return (uint8_t)(c)-33; });
+    bam_set1(aln, read_common.read_id.length(), read_common.read_id.c_str(), 4, -1, -1, 0, 0,
+             nullptr, -1, -1, 0, read_common.seq.length(), read_common.seq.c_str(),
+             (char*)qscore.data(), 0);
+
+    const auto append_string = [aln](const char* tag, const std::string& value) {
+        bam_aux_append(aln, tag, 'Z', int(value.length() + 1), (uint8_t*)value.c_str());
+    };
+    const auto append_float = [aln](const char* tag, float value) {
+        bam_aux_append(aln, tag, 'f', sizeof(value), (uint8_t*)&value);
+    };
+    const auto append_int = [aln](const char* tag, int32_t value) {
+        bam_aux_append(aln, tag, 'i', sizeof(value), (uint8_t*)&value);
+    };
+
+    const int num_samples =
+            int(read_common.get_raw_data_samples() + read_common.num_trimmed_samples);
+    append_string("BC", read_common.barcode);
+    append_float("qs", read_common.calculate_mean_qscore());
+    append_float("du", float(num_samples) / float(read_common.sample_rate));
+    append_int("ns", num_samples);
+    append_int("ts", int(read_common.num_trimmed_samples));
+    append_int("mx", int(read_common.attributes.mux));
+    append_int("ch", read_common.attributes.channel_number);
+    append_string("st", read_common.attributes.start_time);
+    append_int("rn", read_common.attributes.read_number);
+    append_string("fn", read_common.attributes.fast5_filename);
+    append_float("sm", read_common.shift);
+    append_float("sd", read_common.scale);
+    append_string("sv", read_common.scaling_method);
+    append_int("dx", 0);
+    append_string("RG", read_common.run_id.str() + '_' + read_common.model_name.str() + '_' +
+                                read_common.barcode);
+    append_string("pi", read_common.parent_read_id);
+    append_int("sp", int32_t(read_common.split_point));
+
+    std::vector<uint8_t> moves(read_common.moves.size() + 1);
+    moves[0] = uint8_t(read_common.model_stride);
+    std::copy(read_common.moves.begin(), read_common.moves.end(), moves.begin() + 1);
+    bam_aux_update_array(aln, "mv", 'c', int(moves.size()), moves.data());
+
+    append_int("pt", read_common.rna_poly_tail_length);
+
+    if (read_common.mod_base_info) {
+        // As generate_modbase_tags() used to for a simplex read with no context: a base is
+        // called if any of its modifications reaches the threshold.
+        const auto& alphabet = read_common.mod_base_info->alphabet;
+        const auto& seq = read_common.seq;
+        const auto& probs = read_common.base_mod_probs;
+        const size_t num_channels = alphabet.size();
+        std::vector<bool> mask(seq.size(), false);
+        char cardinal = 0;
+        for (size_t channel = 0; channel < num_channels; ++channel) {
+            if (std::string("ACGT").find(alphabet[channel]) != std::string::npos) {
+                cardinal = alphabet[channel][0];
+                continue;
+            }
+            for (size_t i = 0; i < seq.size(); ++i) {
+                if (seq[i] == cardinal && probs[i * num_channels + channel] >= kModbaseThreshold) {
+                    mask[i] = true;
+                }
+            }
+        }
+
+        std::string mm;
+        std::vector<uint8_t> ml;
+        for (size_t channel = 0; channel < num_channels; ++channel) {
+            if (std::string("ACGT").find(alphabet[channel]) != std::string::npos) {
+                cardinal = alphabet[channel][0];
+                continue;
+            }
+            mm += std::string(1, cardinal) + "+" + alphabet[channel] + ".";
+            int skipped = 0;
+            for (size_t i = 0; i < seq.size(); ++i) {
+                if (seq[i] != cardinal) {
+                    continue;
+                }
+                if (mask[i]) {
+                    mm += "," + std::to_string(skipped);
+                    skipped = 0;
+                    ml.push_back(probs[i * num_channels + channel]);
+                } else {
+                    skipped++;
+                }
+            }
+            mm += ";";
+        }
+        append_int("MN", int32_t(seq.size()));
+        append_string("MM", mm);
+        bam_aux_update_array(aln, "ML", 'C', int(ml.size()), ml.data());
+    }
+    return dorado::BamPtr(aln);
+}
+
+void check_identical(const bam1_t* actual, const bam1_t* expected) {
+    CHECK(actual->core.tid == expected->core.tid);
+    CHECK(actual->core.pos == expected->core.pos);
+    CHECK(actual->core.bin == expected->core.bin);
+    CHECK(actual->core.qual == expected->core.qual);
+    CHECK(actual->core.l_extranul == expected->core.l_extranul);
+    CHECK(actual->core.flag == expected->core.flag);
+    CHECK(actual->core.l_qname == expected->core.l_qname);
+    CHECK(actual->core.n_cigar == expected->core.n_cigar);
+    CHECK(actual->core.l_qseq == expected->core.l_qseq);
+    CHECK(actual->core.mtid == expected->core.mtid);
+    CHECK(actual->core.mpos == expected->core.mpos);
+    CHECK(actual->core.isize == expected->core.isize);
+    REQUIRE(actual->l_data == expected->l_data);
+    CHECK(std::memcmp(actual->data, expected->data, actual->l_data) == 0);
+}
+
+}  // namespace
+
+TEST_CASE(TEST_GROUP ": Tags are encoded like bam_aux_append", TEST_GROUP) {
+    dorado::utils::BamRecordBuilder builder;
+    builder.append_float("qs", 12.5f);
+    builder.append_int("ns", -4132);
+    builder.append_string("st", "2017-04-29T09:10:04Z");
+    builder.append_string("pi", "");
+    uint8_t* ml = builder.append_byte_array("ML", 'C', 3);
+    ml[0] = 0;
+    ml[1] = 128;
+    ml[2] = 255;
+    builder.append_byte_array("mv", 'c', 0);
+    auto record = builder.build("read1", 4, "ACGTA", "!+5?I");
+
+    bam1_t* expected = bam_init1();
+    const uint8_t qual[] = {0, 10, 20, 30, 40};
+    bam_set1(expected, 5, "read1", 4, -1, -1, 0, 0, nullptr, -1, -1, 0, 5, "ACGTA",
+             (const char*)qual, 0);
+    float qs = 12.5f;
+    bam_aux_append(expected, "qs", 'f', sizeof(qs), (uint8_t*)&qs);
+    int32_t ns = -4132;
+    bam_aux_append(expected, "ns", 'i', sizeof(ns), (uint8_t*)&ns);
+    bam_aux_append(expected, "st", 'Z', 21, (const uint8_t*)"2017-04-29T09:10:04Z");
+    bam_aux_append(expected, "pi", 'Z', 1, (const uint8_t*)"");
+    const uint8_t ml_values[] = {0, 128, 255};
+    bam_aux_update_array(expected, "ML", 'C', 3, (void*)ml_values);
+    bam_aux_update_array(expected, "mv", 'c', 0, nullptr);
+
+    CHECK(builder.aux_size() == size_t(bam_get_l_aux(expected)));
+    check_identical(record.get(), expected);
+    bam_destroy1(expected);
+}
+
+TEST_CASE(TEST_GROUP ": Mismatched qstring throws", TEST_GROUP) {
+    dorado::utils::BamRecordBuilder builder;
+    CHECK_THROWS(builder.build("read1", 4, "ACGT", "!!!"));
+}
+
+TEST_CASE(TEST_GROUP ": extract_sam_lines output is unchanged", TEST_GROUP) {
+    const auto seq_len = GENERATE(1, 100, 10000);
+    const auto with_modbases = GENERATE(false, true);
+    CAPTURE(seq_len, with_modbases);
+    const auto read_common = make_read(seq_len, with_modbases);
+    const auto alignments = read_common.extract_sam_lines(true, kModbaseThreshold, false);
+    REQUIRE(alignments.size() == 1);
+    const auto expected = build_with_aux_append(read_common);
+    check_identical(alignments[0].get(), expected.get());
+}
+
+TEST_CASE(TEST_GROUP ": records/s benchmark", BENCHMARK_TAG) {
+    const auto read_common = make_read(5000, true);
+    constexpr int num_records = 20000;
+
+    const auto time_path = [&read_common](const char* name, auto&& build) {
+        const auto start = std::chrono::steady_clock::now();
+        size_t total_bytes = 0;
+        for (int i = 0; i < num_records; ++i) {
+            total_bytes += build(read_common)->l_data;
+        }
+        const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        std::cerr << name << ": " << num_records / duration.count() << " records/s ("
+                  << total_bytes / num_records << " bytes/record)" << '\n';
+    };
+
+    check_identical(read_common.extract_sam_lines(true, kModbaseThreshold, false)[0].get(),
+                    build_with_aux_append(read_common).get());
+    time_path("bam_aux_append", build_with_aux_append);
+    time_path("BamRecordBuilder", [](const dorado::ReadCommon& read) {
+        return std::move(read.extract_sam_lines(true, kModbaseThreshold, false)[0]);
+    });
+}
@@ -7,16 +7,20 @@
 #include "read_pipeline/DefaultClientInfo.h"
 #include "read_pipeline/HtsReader.h"
 #include "read_pipeline/TrimmerNode.h"
+#include "utils/PostCondition.h"
 #include "utils/bam_utils.h"
 #include "utils/barcode_kits.h"
+#include "utils/dev_utils.h"
 #include "utils/sequence_utils.h"
 
 #include <ATen/Functions.h>
 #include <catch2/catch.hpp>
 #include <htslib/sam.h>
 
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
+#include <iostream>
 #include <string>
 #include <vector>
 
@@ -49,6 +53,35 @@ std::shared_ptr<const demux::BarcodingInfo> create_barcoding_info(
     return std::make_shared<demux::BarcodingInfo>(std::move(result));
 }
 
+// Creates a classifier with the q-gram prefilter turned on or off.
+std::unique_ptr<demux::BarcodeClassifier> create_classifier(const std::string& kit_name,
+                                                            bool use_prefilter) {
+    utils::details::extract_dev_options(use_prefilter ? "barcode_prefilter=1"
+                                                      : "barcode_prefilter=0");
+    auto reset_option = utils::PostCondition(
+            [] { utils::details::g_dev_options.erase("barcode_prefilter"); });
+    return std::make_unique<demux::BarcodeClassifier>(std::vector<std::string>{kit_name},
+                                                      std::nullopt, std::nullopt);
+}
+
+// Reads the sequences from every file in the test data directory for a kit.
+std::vector<std::string> load_sequences(const std::string& data_dir_name) {
+    std::vector<std::string> seqs;
+    for (const auto& entry : fs::directory_iterator(get_data_dir(data_dir_name))) {
+        HtsReader reader(entry.path().string(), std::nullopt);
+        while (reader.read()) {
+            seqs.push_back(utils::extract_sequence(reader.record.get()));
+        }
+    }
+    return seqs;
+}
+
+const std::vector<std::pair<std::string, std::string>> kits_and_data_dirs{
+        {"SQK-RBK114-96", "barcode_demux/single_end"},
+        {"SQK-RPB004", "barcode_demux/double_end"},
+        {"EXP-PBC096", "barcode_demux/double_end_variant"},
+};
+
 }  // namespace
 
 TEST_CASE("BarcodeClassifier: check instantiation for all kits", TEST_GROUP) {
@@ -228,6 +261,51 @@ TEST_CASE("BarcodeClassifier: check presence of midstrand barcode single ended k
     }
 }
 
+TEST_CASE("BarcodeClassifier: prefilter gives the same results", TEST_GROUP) {
+    for (const auto& [kit_name, data_dir_name] : kits_and_data_dirs) {
+        CAPTURE(kit_name);
+        const auto seqs = load_sequences(data_dir_name);
+        const auto classifier = create_classifier(kit_name, false);
+        const auto prefiltered_classifier = create_classifier(kit_name, true);
+
+        for (bool barcode_both_ends : {false, true}) {
+            for (const auto& seq : seqs) {
+                const auto expected = classifier->barcode(seq, barcode_both_ends, std::nullopt);
+                const auto res =
+                        prefiltered_classifier->barcode(seq, barcode_both_ends, std::nullopt);
+                CHECK(res.barcode_name == expected.barcode_name);
+                CHECK(res.penalty == expected.penalty);
+                CHECK(res.top_penalty == expected.top_penalty);
+                CHECK(res.bottom_penalty == expected.bottom_penalty);
+                CHECK(res.flank_score == expected.flank_score);
+                CHECK(res.variant == expected.variant);
+                CHECK(res.top_barcode_pos == expected.top_barcode_pos);
+                CHECK(res.bottom_barcode_pos == expected.bottom_barcode_pos);
+                CHECK(res.found_midstrand == expected.found_midstrand);
+            }
+        }
+    }
+}
+
+TEST_CASE("BarcodeClassifier: prefilter benchmark", BENCHMARK_TAG) {
+    const int num_repeats = 20;
+    for (const auto& [kit_name, data_dir_name] : kits_and_data_dirs) {
+        const auto seqs = load_sequences(data_dir_name);
+        for (bool use_prefilter : {false, true}) {
+            const auto classifier = create_classifier(kit_name, use_prefilter);
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < num_repeats; ++i) {
+                for (const auto& seq : seqs) {
+                    classifier->barcode(seq, false, std::nullopt);
+                }
+            }
+            const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+            std::cerr << kit_name << (use_prefilter ? " with prefilter: " : " without prefilter: ")
+                      << num_repeats * seqs.size() / duration.count() << " reads/s" << '\n';
+        }
+    }
+}
+
 TEST_CASE(
         "BarcodeClassifierNode: check read messages are correctly updated after classification and "
         "trimming",
@@ -12,9 +12,13 @@
 #include <catch2/catch.hpp>
 #include <htslib/sam.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
+#include <iostream>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
@@ -25,17 +29,31 @@ namespace fs = std::filesystem;
 using namespace dorado;
 
 namespace {
-std::vector<BamPtr> create_bam_reader(const std::string& bc) {
+std::vector<BamPtr> create_bam_reader(const std::string& bc, const std::string& read_id) {
     ReadCommon read_common;
     read_common.seq = "AAAA";
     read_common.qstring = "!!!!";
-    read_common.read_id = bc;
+    read_common.read_id = read_id;
     auto records = read_common.extract_sam_lines(false, 0, false);
     for (auto& rec : records) {
         bam_aux_append(rec.get(), "BC", 'Z', int(bc.length() + 1), (uint8_t*)bc.c_str());
     }
     return records;
 }
+
+std::vector<BamPtr> create_bam_reader(const std::string& bc) { return create_bam_reader(bc, bc); }
+
+std::vector<std::string> read_ids_in_file(const fs::path& path) {
+    HtsFilePtr file(hts_open(path.string().c_str(), "r"));
+    REQUIRE(file);
+    SamHdrPtr header(sam_hdr_read(file.get()));
+    BamPtr record(bam_init1());
+    std::vector<std::string> read_ids;
+    while (sam_read1(file.get(), header.get(), record.get()) >= 0) {
+        read_ids.emplace_back(bam_get_qname(record.get()));
+    }
+    return read_ids;
+}
 }  // namespace
 
 TEST_CASE("BarcodeDemuxerNode: check correct output files are created", TEST_GROUP) {
@@ -89,3 +107,131 @@ TEST_CASE("BarcodeDemuxerNode: check correct output files are created", TEST_GRO
         }
     }
 }
+
+TEST_CASE("BarcodeDemuxerNode: records are written in order by parallel writers", TEST_GROUP) {
+    auto tmp_dir = make_temp_dir("dorado_demuxer_writers");
+    constexpr int num_barcodes = 24;
+    constexpr int reads_per_barcode = 50;
+    const size_t num_writers = GENERATE(1, 4);
+    CAPTURE(num_writers);
+
+    {
+        dorado::PipelineDescriptor pipeline_desc;
+        auto demuxer = pipeline_desc.add_node<BarcodeDemuxerNode>(
+                {}, tmp_dir.m_path.string(), 1, false, nullptr, false, num_writers);
+        auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+        SamHdrPtr hdr(sam_hdr_init());
+        sam_hdr_add_line(hdr.get(), "SQ", "ID", "foo", "LN", "100", "SN", "ref", NULL);
+        auto& demux_writer_ref = dynamic_cast<BarcodeDemuxerNode&>(pipeline->get_node_ref(demuxer));
+        demux_writer_ref.set_header(hdr.get());
+
+        // Interleave the barcodes, so that every writer has several files on the go.
+        auto client_info = std::make_shared<dorado::DefaultClientInfo>();
+        for (int read_idx = 0; read_idx < reads_per_barcode; ++read_idx) {
+            for (int bc = 0; bc < num_barcodes; ++bc) {
+                const auto barcode = "bc" + std::to_string(bc);
+                const auto read_id = barcode + "_" + std::to_string(read_idx);
+                for (auto& rec : create_bam_reader(barcode, read_id)) {
+                    pipeline->push_message(BamMessage{std::move(rec), client_info});
+                }
+            }
+        }
+
+        pipeline->terminate(DefaultFlushOptions());
+
+        // Files are finalised on several threads, so check the progress afterwards.
+        std::vector<size_t> progress_updates;
+        demux_writer_ref.finalise_hts_files(
+                [&progress_updates](size_t progress) { progress_updates.push_back(progress); });
+        REQUIRE_FALSE(progress_updates.empty());
+        CHECK(std::is_sorted(progress_updates.begin(), progress_updates.end()));
+        CHECK(progress_updates.back() == 100);
+    }
+
+    for (int bc = 0; bc < num_barcodes; ++bc) {
+        const auto barcode = "bc" + std::to_string(bc);
+        const auto read_ids =
+                read_ids_in_file(tmp_dir.m_path / ("unknown_run_id_" + barcode + ".bam"));
+        REQUIRE(read_ids.size() == size_t(reads_per_barcode));
+        for (int read_idx = 0; read_idx < reads_per_barcode; ++read_idx) {
+            CHECK(read_ids[read_idx] == barcode + "_" + std::to_string(read_idx));
+        }
+    }
+}
+
+TEST_CASE("BarcodeDemuxerNode: write failures are rethrown when finalising", TEST_GROUP) {
+    auto tmp_dir = make_temp_dir("dorado_demuxer_failure");
+    // A directory where one of the output files should go means that file can't be opened.
+    fs::create_directories(tmp_dir.m_path / "unknown_run_id_bc1.bam");
+
+    {
+        dorado::PipelineDescriptor pipeline_desc;
+        auto demuxer = pipeline_desc.add_node<BarcodeDemuxerNode>(
+                {}, tmp_dir.m_path.string(), 1, false, nullptr, false, 2);
+        auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+        SamHdrPtr hdr(sam_hdr_init());
+        sam_hdr_add_line(hdr.get(), "SQ", "ID", "foo", "LN", "100", "SN", "ref", NULL);
+        auto& demux_writer_ref = dynamic_cast<BarcodeDemuxerNode&>(pipeline->get_node_ref(demuxer));
+        demux_writer_ref.set_header(hdr.get());
+
+        auto client_info = std::make_shared<dorado::DefaultClientInfo>();
+        for (const std::string barcode : {"bc0", "bc1", "bc2"}) {
+            for (auto& rec : create_bam_reader(barcode)) {
+                pipeline->push_message(BamMessage{std::move(rec), client_info});
+            }
+        }
+
+        // The writer keeps going after the failure, so terminating doesn't hang.
+        pipeline->terminate(DefaultFlushOptions());
+        CHECK_THROWS_WITH(demux_writer_ref.finalise_hts_files([](size_t) {}),
+                          Catch::Matchers::Contains("unknown_run_id_bc1.bam"));
+    }
+}
+
+TEST_CASE("BarcodeDemuxerNode: 96 barcode throughput", BENCHMARK_TAG) {
+    constexpr int num_barcodes = 96;
+    constexpr int reads_per_barcode = 2000;
+    const std::string seq(2000, 'A');
+    const std::string qstring(seq.size(), '5');
+
+    const size_t max_writers = std::max(std::thread::hardware_concurrency(), 1u);
+    for (size_t num_writers = 1; num_writers <= max_writers; num_writers *= 2) {
+        auto tmp_dir = make_temp_dir("dorado_demuxer_benchmark");
+        const auto start = std::chrono::steady_clock::now();
+        {
+            dorado::PipelineDescriptor pipeline_desc;
+            auto demuxer = pipeline_desc.add_node<BarcodeDemuxerNode>(
+                    {}, tmp_dir.m_path.string(), 1, false, nullptr, false, num_writers);
+            auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+            SamHdrPtr hdr(sam_hdr_init());
+            auto& demux_writer_ref =
+                    dynamic_cast<BarcodeDemuxerNode&>(pipeline->get_node_ref(demuxer));
+            demux_writer_ref.set_header(hdr.get());
+
+            auto client_info = std::make_shared<dorado::DefaultClientInfo>();
+            for (int read_idx = 0; read_idx < reads_per_barcode; ++read_idx) {
+                for (int bc = 0; bc < num_barcodes; ++bc) {
+                    ReadCommon read_common;
+                    read_common.seq = seq;
+                    read_common.qstring = qstring;
+                    read_common.read_id = std::to_string(bc) + "_" + std::to_string(read_idx);
+                    for (auto& rec : read_common.extract_sam_lines(false, 0, false)) {
+                        const auto barcode = "bc" + std::to_string(bc);
+                        bam_aux_append(rec.get(), "BC", 'Z', int(barcode.length() + 1),
+                                       (uint8_t*)barcode.c_str());
+                        pipeline->push_message(BamMessage{std::move(rec), client_info});
+                    }
+                }
+            }
+
+            pipeline->terminate(DefaultFlushOptions());
+            demux_writer_ref.finalise_hts_files([](size_t) { /* noop */ });
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cerr << num_writers << " writers: "
+                  << num_barcodes * reads_per_barcode / elapsed.count() << " reads/s\n";
+    }
+}
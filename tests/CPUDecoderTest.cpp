@@ -0,0 +1,146 @@
+#include "basecall/decode/CPUDecoder.h"
+#include "basecall/decode/beam_search.h"
+
+#include "TestUtils.h"
+
+#include <ATen/ATen.h>
+#include <torch/torch.h>
+// Catch2 must come after torch since both define CHECK()
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <iostream>
+
+#define CUT_TAG "[CPUDecoder]"
+
+namespace {
+
+// The raw-buffer kernels use their own exp/log approximations, so we can't expect bitwise
+// equality with ATen, just agreement to within float rounding of the accumulated scores.
+constexpr double kRelTolerance = 1e-5;
+constexpr double kAbsTolerance = 1e-4;
+
+}  // namespace
+
+TEST_CASE(CUT_TAG ": forward/backward scores match ATen scan", CUT_TAG) {
+    using namespace dorado::basecall::decode;
+
+    torch::manual_seed(42);
+    const auto state_len = GENERATE(3, 4, 5);
+    const int num_trans_states = 1 << (2 * (state_len + 1));
+    const float fixed_stay_score = 2.0f;
+
+    const auto scores_TNC = at::randn({200, 3, num_trans_states}, at::kFloat) * 5.0f;
+
+    SECTION("forward") {
+        const auto expected = inner::forward_scores_aten(scores_TNC, fixed_stay_score);
+        const auto computed = inner::forward_scores(scores_TNC, fixed_stay_score);
+        REQUIRE(computed.sizes() == expected.sizes());
+        CHECK(at::allclose(computed, expected, kRelTolerance, kAbsTolerance));
+    }
+
+    SECTION("backward") {
+        const auto expected = inner::backward_scores_aten(scores_TNC, fixed_stay_score);
+        const auto computed = inner::backward_scores(scores_TNC, fixed_stay_score);
+        REQUIRE(computed.sizes() == expected.sizes());
+        CHECK(at::allclose(computed, expected, kRelTolerance, kAbsTolerance));
+    }
+}
+
+TEST_CASE(CUT_TAG ": forward/backward scores on a chunk slice", CUT_TAG) {
+    using namespace dorado::basecall::decode;
+    using Slice = at::indexing::Slice;
+
+    // CPUDecoder hands each thread a non-contiguous slice of the chunks.
+    torch::manual_seed(42);
+    const auto scores_TNC = at::randn({100, 8, 1024}, at::kFloat);
+    const auto sliced_TNC = scores_TNC.index({Slice(), Slice(2, 5)});
+    const auto contiguous_TNC = sliced_TNC.contiguous();
+
+    CHECK(at::allclose(inner::forward_scores(sliced_TNC, 2.0f),
+                       inner::forward_scores_aten(contiguous_TNC, 2.0f), kRelTolerance,
+                       kAbsTolerance));
+    CHECK(at::allclose(inner::backward_scores(sliced_TNC, 2.0f),
+                       inner::backward_scores_aten(contiguous_TNC, 2.0f), kRelTolerance,
+                       kAbsTolerance));
+}
+
+TEST_CASE(CUT_TAG ": beam_search_part_2 matches decoding the whole batch at once", CUT_TAG) {
+    using namespace dorado::basecall::decode;
+
+    // Threads take chunks one at a time, which mustn't change the decoded output.
+    torch::manual_seed(42);
+    const int num_chunks = GENERATE(1, 3, 9);
+    const auto beam_width = GENERATE(size_t(5), size_t(32));
+    CAPTURE(num_chunks, beam_width);
+    const auto scores_TNC = at::randn({300, num_chunks, 1024}, at::kFloat) * 3.0f;
+
+    DecoderOptions options;
+    options.beam_width = beam_width;
+    const auto results = CPUDecoder().beam_search_part_2({scores_TNC, num_chunks, options});
+    REQUIRE(results.size() == size_t(num_chunks));
+
+    const auto fwd = inner::forward_scores(scores_TNC, options.blank_score);
+    const auto bwd = inner::backward_scores(scores_TNC, options.blank_score);
+    const auto posts = at::softmax(fwd + bwd, -1);
+    for (int chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx) {
+        CAPTURE(chunk_idx);
+        const auto [sequence, qstring, moves] = beam_search_decode(
+                scores_TNC.select(1, chunk_idx), bwd.select(1, chunk_idx).contiguous(),
+                posts.select(1, chunk_idx).contiguous(), options.beam_width, options.beam_cut,
+                options.blank_score, options.q_shift, options.q_scale, 1.0f);
+        CHECK(results[chunk_idx].sequence == sequence);
+        CHECK(results[chunk_idx].qstring == qstring);
+        CHECK(results[chunk_idx].moves == moves);
+    }
+}
+
+TEST_CASE(CUT_TAG ": forward/backward scan timings", BENCHMARK_TAG) {
+    using namespace dorado::basecall::decode;
+
+    // Chunk shapes representative of fast (state_len 4) and hac/sup (state_len 5) models.
+    const int T = 1666;
+    const int N = 4;
+    const float fixed_stay_score = 2.0f;
+    for (int state_len : {4, 5}) {
+        const int num_trans_states = 1 << (2 * (state_len + 1));
+        const auto scores_TNC = at::randn({T, N, num_trans_states}, at::kFloat);
+
+        auto start = std::chrono::steady_clock::now();
+        inner::forward_scores_aten(scores_TNC, fixed_stay_score);
+        inner::backward_scores_aten(scores_TNC, fixed_stay_score);
+        const std::chrono::duration<double, std::micro> aten_duration =
+                std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        inner::forward_scores(scores_TNC, fixed_stay_score);
+        inner::backward_scores(scores_TNC, fixed_stay_score);
+        const std::chrono::duration<double, std::micro> raw_duration =
+                std::chrono::steady_clock::now() - start;
+
+        std::cerr << "state_len=" << state_len << ": ATen scan " << aten_duration.count()
+                  << "us, raw scan " << raw_duration.count() << "us" << '\n';
+    }
+}
+
+TEST_CASE(CUT_TAG ": beam_search_part_2 chunks/s by beam width", BENCHMARK_TAG) {
+    using namespace dorado::basecall::decode;
+
+    // A batch of hac-sized chunks: 10000 samples at stride 6, state_len 5.
+    const int T = 1666;
+    const int N = 16;
+    const int C = 4096;
+    const auto scores_TNC = at::randn({T, N, C}, at::kFloat) * 3.0f;
+
+    const CPUDecoder decoder;
+    for (size_t beam_width : {5, 16, 32, 64, 128}) {
+        DecoderOptions options;
+        options.beam_width = beam_width;
+        const auto start = std::chrono::steady_clock::now();
+        const auto results = decoder.beam_search_part_2({scores_TNC, N, options});
+        const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        CHECK(results.size() == size_t(N));
+        std::cerr << "beam_width=" << beam_width << ": " << N / duration.count() << " chunks/s"
+                  << '\n';
+    }
+}
@@ -0,0 +1,179 @@
+#include "basecall/CRFModelConfig.h"
+#include "basecall/nn/CRFModel.h"
+
+#include "TestUtils.h"
+
+#include <torch/torch.h>
+// Catch2 must come after torch since both define CHECK()
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#define CUT_TAG "[CRFModelCpuLstm]"
+
+using namespace dorado::basecall;
+using nn::CpuLstmMode;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+CRFModelConfig load_test_config(const std::string& name) {
+    const fs::path path = fs::path(get_data_dir("model_configs/" + name));
+    return load_crf_model_config(path);
+}
+
+// Mean absolute difference from reference, relative to the mean magnitude of reference.
+float relative_error(const at::Tensor& output, const at::Tensor& reference) {
+    return (output - reference).abs().mean().item<float>() /
+           reference.abs().mean().item<float>();
+}
+
+// Chunks of real signal from the split test read, standardised by median and MAD as ScalerNode
+// would.  Always the same chunks, so results are comparable between runs.
+at::Tensor load_reference_chunks(int num_features) {
+    constexpr int num_chunks = 8;
+    constexpr int chunk_size = 1200;
+    at::Tensor signal;
+    torch::load(signal, (fs::path(get_data_dir("split")) / "raw.tensor").string());
+    signal = signal.to(torch::kFloat32);
+    const auto med = signal.median();
+    const auto mad = (signal - med).abs().median() * 1.4826f;
+    signal = (signal - med) / mad;
+
+    // Skip the start of the read, which is mostly open pore and adapter.
+    constexpr int64_t offset = 10000;
+    return signal.slice(0, offset, offset + num_chunks * chunk_size)
+            .view({num_chunks, 1, chunk_size})
+            .expand({num_chunks, num_features, chunk_size})
+            .contiguous();
+}
+
+const char* mode_name(CpuLstmMode mode) {
+    switch (mode) {
+    case CpuLstmMode::TORCH:
+        return "torch";
+    case CpuLstmMode::FP32:
+        return "fp32";
+    case CpuLstmMode::BF16:
+        return "bf16";
+    case CpuLstmMode::INT8:
+        return "int8";
+    }
+    return "unknown";
+}
+
+}  // namespace
+
+TEST_CASE(CUT_TAG ": LSTM mode can be set per model", CUT_TAG) {
+    const std::string simplex = "dna_r10.4.1_e8.2_400bps_hac@v4.2.0";
+    const std::string stereo = "dna_r10.4.1_e8.2_5khz_stereo@v1.1";
+
+    CHECK(nn::parse_cpu_lstm_mode("", simplex) == CpuLstmMode::TORCH);
+    CHECK(nn::parse_cpu_lstm_mode("bf16", simplex) == CpuLstmMode::BF16);
+    CHECK(nn::parse_cpu_lstm_mode("bf16", stereo) == CpuLstmMode::BF16);
+
+    // A model's own entry takes precedence over the default, wherever it is.
+    const std::string setting = stereo + "=fp32,int8";
+    CHECK(nn::parse_cpu_lstm_mode(setting, simplex) == CpuLstmMode::INT8);
+    CHECK(nn::parse_cpu_lstm_mode(setting, stereo) == CpuLstmMode::FP32);
+
+    // Unrecognised modes are ignored.
+    CHECK(nn::parse_cpu_lstm_mode("fp32," + simplex + "=fp64", simplex) == CpuLstmMode::FP32);
+}
+
+TEST_CASE(CUT_TAG ": FP32 fused LSTM matches torch", CUT_TAG) {
+    torch::NoGradGuard no_grad;
+    torch::manual_seed(42);
+    const int layer_size = GENERATE(96, 384);
+    CAPTURE(layer_size);
+
+    nn::LSTMStack stack(5, layer_size);
+    const auto x = torch::randn({3, 50, layer_size});
+    const auto reference = stack->forward(x);
+
+    stack->set_cpu_mode(CpuLstmMode::FP32);
+    REQUIRE(stack->get_cpu_mode() == CpuLstmMode::FP32);
+    const auto output = stack->forward(x);
+    REQUIRE(output.sizes() == reference.sizes());
+    CHECK(torch::allclose(output, reference, 1e-4, 1e-5));
+
+    // The FP32 weights are the LSTM parameters rather than a copy of them.
+    const auto params = stack->rnns.front()->named_parameters();
+    CHECK(stack->cpu_weights.front().w_ih.data_ptr() == params["weight_ih_l0"].data_ptr());
+    CHECK(stack->cpu_weights.front().w_hh.data_ptr() == params["weight_hh_l0"].data_ptr());
+
+    // And back again.
+    stack->set_cpu_mode(CpuLstmMode::TORCH);
+    CHECK(torch::equal(stack->forward(x), reference));
+}
+
+TEST_CASE(CUT_TAG ": reduced precision LSTM agrees with FP32 on reference chunks", CUT_TAG) {
+    torch::NoGradGuard no_grad;
+    const auto model_name = GENERATE(std::string("dna_r10.4.1_e8.2_260bps_fast@v4.0.0"),
+                                     std::string("dna_r10.4.1_e8.2_400bps_hac@v4.2.0"));
+    const auto mode = GENERATE(CpuLstmMode::BF16, CpuLstmMode::INT8);
+    CAPTURE(model_name, mode_name(mode));
+
+    // The model has random weights so that the test doesn't need the weight files, but the
+    // chunks are real signal.
+    torch::manual_seed(42);
+    const auto config = load_test_config(model_name);
+    auto model = nn::CRFModel(config);
+    model->eval();
+    const auto chunks = load_reference_chunks(config.num_features);
+
+    model->set_cpu_lstm_mode(CpuLstmMode::FP32);
+    const auto reference = model->forward(chunks);
+
+    model->set_cpu_lstm_mode(mode);
+    if (model->rnns->get_cpu_mode() != mode) {
+        // INT8 falls back to FP32 on CPUs without FBGEMM support.
+        CHECK(model->rnns->get_cpu_mode() == CpuLstmMode::FP32);
+        return;
+    }
+    const auto scores = model->forward(chunks);
+    REQUIRE(scores.sizes() == reference.sizes());
+    CHECK(relative_error(scores, reference) < 0.05f);
+
+    // The most likely transition at each position, which is what decoding follows, should mostly
+    // be the same as with FP32.
+    const auto agreement =
+            (scores.argmax(-1) == reference.argmax(-1)).to(torch::kFloat32).mean().item<float>();
+    CAPTURE(agreement);
+    CHECK(agreement > 0.9f);
+}
+
+TEST_CASE(CUT_TAG ": LSTM modes throughput", BENCHMARK_TAG) {
+    torch::NoGradGuard no_grad;
+    torch::manual_seed(42);
+    const auto config = load_test_config("dna_r10.4.1_e8.2_400bps_hac@v4.2.0");
+    auto model = nn::CRFModel(config);
+    model->eval();
+
+    constexpr int batch_size = 32;
+    constexpr int chunk_size = 4000;
+    constexpr int iterations = 3;
+    const auto chunks = torch::randn({batch_size, config.num_features, chunk_size});
+
+    for (const auto mode :
+         {CpuLstmMode::TORCH, CpuLstmMode::FP32, CpuLstmMode::BF16, CpuLstmMode::INT8}) {
+        model->set_cpu_lstm_mode(mode);
+        if (model->rnns->get_cpu_mode() != mode) {
+            std::cerr << mode_name(mode) << ": not supported\n";
+            continue;
+        }
+        model->forward(chunks);
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            model->forward(chunks);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const double samples_per_second =
+                double(batch_size) * chunk_size * iterations / elapsed.count();
+        std::cerr << mode_name(mode) << ": " << samples_per_second << " samples/s\n";
+    }
+}
@@ -0,0 +1,151 @@
+#include "basecall/CpuChunkBenchmarks.h"
+
+#include "TestUtils.h"
+#include "basecall/CRFModelConfig.h"
+#include "basecall/nn/CRFModel.h"
+#include "basecall/nn/TxModel.h"
+
+#include <torch/torch.h>
+// Catch2 must come after torch since both define CHECK()
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#define CUT_TAG "[CpuChunkBenchmarks]"
+
+using namespace dorado::basecall;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+bool contains(const std::vector<CpuRunnerSetup>& setups, const CpuRunnerSetup& setup) {
+    return std::find(setups.begin(), setups.end(), setup) != setups.end();
+}
+
+}  // namespace
+
+TEST_CASE(CUT_TAG ": setups tune everything that isn't requested", CUT_TAG) {
+    constexpr int num_threads = 8;
+
+    SECTION("Plenty of memory") {
+        const auto setups = get_cpu_benchmark_setups(num_threads, 0, 0, [](int) { return 100; });
+        for (const int batch_size : {64, 128, 256}) {
+            CAPTURE(batch_size);
+            CHECK(contains(setups, {8, batch_size, 1}));
+            CHECK(contains(setups, {4, batch_size, 2}));
+            CHECK(contains(setups, {2, batch_size, 4}));
+        }
+        for (const auto& setup : setups) {
+            CHECK(setup.num_runners * setup.intra_op_threads <= num_threads);
+        }
+    }
+
+    SECTION("Memory for 2 runners gives the spare cores to them") {
+        const auto setups = get_cpu_benchmark_setups(num_threads, 0, 0, [](int) { return 2; });
+        CHECK(contains(setups, {2, 128, 4}));
+        CHECK(contains(setups, {2, 128, 1}));
+        for (const auto& setup : setups) {
+            CHECK(setup.num_runners <= 2);
+        }
+    }
+
+    SECTION("Requested batch size and runners are kept") {
+        const auto setups = get_cpu_benchmark_setups(num_threads, 96, 3, [](int) { return 100; });
+        REQUIRE_FALSE(setups.empty());
+        for (const auto& setup : setups) {
+            CHECK(setup.batch_size == 96);
+            CHECK(setup.num_runners == 3);
+        }
+        CHECK(contains(setups, {3, 96, 2}));
+        // Runners aren't given more threads than there are to go round.
+        CHECK_FALSE(contains(setups, {3, 96, 4}));
+    }
+
+    SECTION("Single core") {
+        const auto setups = get_cpu_benchmark_setups(1, 128, 0, [](int) { return 100; });
+        REQUIRE(setups.size() == 1);
+        CHECK(setups.front() == CpuRunnerSetup{1, 128, 1});
+    }
+}
+
+TEST_CASE(CUT_TAG ": the fastest setup is selected", CUT_TAG) {
+    CHECK_THROWS(select_best_cpu_setup({}));
+
+    const std::vector<CpuBenchmarkResult> results{
+            {{8, 64, 1}, 100.f}, {{4, 128, 2}, 250.f}, {{2, 256, 4}, 150.f}};
+    CHECK(select_best_cpu_setup(results).setup == CpuRunnerSetup{4, 128, 2});
+}
+
+TEST_CASE(CUT_TAG ": benchmarks are cached per CPU and model", CUT_TAG) {
+    auto temp_dir = make_temp_dir("cpu_benchmarks");
+
+    const auto path =
+            get_cpu_benchmark_cache_path(temp_dir.m_path, "Some CPU(R) 2.0GHz (8 threads)",
+                                         "/models/dna_r10.4.1_e8.2_400bps_hac@v4.2.0");
+    CHECK(path.parent_path().string() == temp_dir.m_path.string());
+    CHECK(path.filename().string() ==
+          "cpu_benchmarks__Some_CPU_R__2.0GHz__8_threads___dna_r10.4.1_e8.2_400bps_hac@v4.2.0.csv");
+
+    CHECK(load_cpu_benchmarks(path).empty());
+
+    const std::vector<CpuBenchmarkResult> results{{{8, 64, 1}, 100.5f}, {{4, 128, 2}, 250.25f}};
+    REQUIRE(save_cpu_benchmarks(path, results));
+    const auto loaded = load_cpu_benchmarks(path);
+    REQUIRE(loaded.size() == results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        CHECK(loaded[i].setup == results[i].setup);
+        CHECK(loaded[i].chunks_per_second == results[i].chunks_per_second);
+    }
+
+    SECTION("Malformed files are ignored") {
+        std::ofstream(path) << "num_runners,batch_size,intra_op_threads,chunks_per_second\n"
+                               "8;64;1;100\n";
+        CHECK(load_cpu_benchmarks(path).empty());
+    }
+}
+
+TEST_CASE(CUT_TAG ": benchmarking a setup measures its throughput", CUT_TAG) {
+    const fs::path path =
+            fs::path(get_data_dir("model_configs/dna_r10.4.1_e8.2_260bps_fast@v4.0.0"));
+    auto config = load_crf_model_config(path);
+    config.normalise_basecaller_params();
+
+    // Random weights are as good as real ones for timing.
+    auto model = nn::CRFModel(config);
+    model->eval();
+    const torch::nn::ModuleHolder<torch::nn::AnyModule> module{torch::nn::AnyModule(model)};
+
+    const float chunks_per_second = benchmark_cpu_setup(config, module, {2, 4, 1}, 1200);
+    CHECK(chunks_per_second > 0);
+}
+
+TEST_CASE(CUT_TAG ": benchmarking a transformer model leaves the shared weights alone", CUT_TAG) {
+    const fs::path path =
+            fs::path(get_data_dir("model_configs/dna_r10.4.1_e8.2_400bps_sup@v5.0.0"));
+    auto config = load_crf_model_config(path);
+    config.normalise_basecaller_params();
+
+    const auto options = at::TensorOptions().dtype(torch::kFloat32).device(torch::kCPU);
+    auto model = nn::TxModel(config, options);
+    model->eval();
+    const torch::nn::ModuleHolder<torch::nn::AnyModule> module{torch::nn::AnyModule(model)};
+
+    std::vector<at::Tensor> weights_before;
+    for (const auto& parameter : model->parameters()) {
+        weights_before.push_back(parameter.detach().clone());
+    }
+
+    // Several runners share the module and call it concurrently.
+    const float chunks_per_second = benchmark_cpu_setup(config, module, {3, 2, 1}, 1200);
+    CHECK(chunks_per_second > 0);
+
+    const auto weights_after = model->parameters();
+    REQUIRE(weights_after.size() == weights_before.size());
+    for (size_t i = 0; i < weights_before.size(); ++i) {
+        CHECK(torch::equal(weights_after[i], weights_before[i]));
+    }
+}
@@ -6,6 +6,7 @@
 #include "read_pipeline/ReadSplitNode.h"
 #include "read_pipeline/StereoDuplexEncoderNode.h"
 #include "read_pipeline/SubreadTaggerNode.h"
+#include "read_pipeline/read_utils.h"
 #include "splitter/DuplexReadSplitter.h"
 #include "splitter/ReadSplitter.h"
 
@@ -14,7 +15,9 @@
 #include <catch2/catch.hpp>
 
 #include <algorithm>
+#include <chrono>
 #include <filesystem>
+#include <iostream>
 #include <vector>
 
 #define TEST_GROUP "[DuplexSplitTest]"
@@ -249,3 +252,20 @@ TEST_CASE("Test split where only one subread is generated", TEST_GROUP) {
     const auto &read_common = get_read_common_data(messages[0]);
     CHECK(read_common.parent_read_id != read_common.read_id);
 }
+
+TEST_CASE("Splitting throughput", BENCHMARK_TAG) {
+    const auto read = make_read();
+    dorado::splitter::DuplexReadSplitter splitter(dorado::splitter::DuplexSplitSettings(false));
+
+    const int num_reads = 50;
+    std::chrono::duration<double> duration{0};
+    for (int i = 0; i < num_reads; ++i) {
+        auto copy = dorado::utils::shallow_copy_read(*read);
+        const auto start = std::chrono::steady_clock::now();
+        const auto split_res = splitter.split(std::move(copy));
+        duration += std::chrono::steady_clock::now() - start;
+        REQUIRE(split_res.size() == 4);
+    }
+    std::cerr << "duplex split: " << num_reads / duration.count() << " reads/s ("
+              << read->read_common.seq.size() << " bases per read)" << '\n';
+}
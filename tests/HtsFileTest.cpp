@@ -9,6 +9,8 @@
 #include <memory>
 #include <numeric>
 #include <random>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #define TEST_GROUP "[hts_file]"
@@ -71,15 +73,28 @@ struct Tester {
     void check_output(bool is_sorted) {
         file_in.reset(hts_open(file_out_path.string().c_str(), "r"));
         header_in.reset(sam_hdr_read(file_in.get()));
+        // Position at which each record was written, so we can check that records with
+        // equal sorting keys stay in that order.
+        std::unordered_map<std::string, size_t> write_positions;
+        for (size_t i = 0; i < records.size(); ++i) {
+            write_positions[bam_get_qname(records[indices[i]].get())] = i;
+        }
+
         BamPtr record(bam_init1());
         size_t index = 0;
         uint64_t last_sorting_key = 0;
+        size_t last_write_position = 0;
         while (sam_read1(file_in.get(), header_in.get(), record.get()) >= 0) {
             REQUIRE(index < records.size());
             if (is_sorted) {
                 auto sorting_key = HtsFile::calculate_sorting_key(record.get());
                 REQUIRE(sorting_key >= last_sorting_key);
+                const auto write_position = write_positions.at(bam_get_qname(record.get()));
+                if (index > 0 && sorting_key == last_sorting_key) {
+                    REQUIRE(write_position > last_write_position);
+                }
                 last_sorting_key = sorting_key;
+                last_write_position = write_position;
             } else {
                 // Output records should be in the order they were written.
                 auto expected_record = records[indices[index]].get();
@@ -90,6 +105,7 @@ struct Tester {
             ++index;
             record.reset(bam_init1());
         }
+        CHECK(index == records.size());
         file_in.reset();
         header_in.reset();
     }
@@ -2,6 +2,7 @@
 
 #include "TestUtils.h"
 #include "alignment/Minimap2Index.h"
+#include "alignment/index_cache.h"
 #include "alignment/minimap2_wrappers.h"
 #include "utils/stream_utils.h"
 
@@ -266,4 +267,69 @@ TEST_CASE(TEST_GROUP
     REQUIRE(header == EXPECTED_2READ_REF_FILE_HEADER);
 }
 
-}  // namespace dorado::alignment::index_file_access
\ No newline at end of file
+TEST_CASE(TEST_GROUP " load_index with cache dir writes and reuses the cached index", TEST_GROUP) {
+    auto cache_dir = make_temp_dir("index_cache_test");
+    const auto cached_index = get_cached_index_path(cache_dir.m_path, valid_2read_reference_file(),
+                                                    create_dflt_options());
+    REQUIRE_FALSE(cached_index.empty());
+    REQUIRE_FALSE(std::filesystem::exists(cached_index));
+
+    {
+        IndexFileAccess cut{};
+        cut.set_index_cache_dir(cache_dir.m_path);
+        REQUIRE(cut.load_index(valid_2read_reference_file(), create_dflt_options(), 1) ==
+                IndexLoadResult::success);
+        REQUIRE(std::filesystem::exists(cached_index));
+        CHECK(get_cached_index_build_seconds(cached_index).has_value());
+    }
+
+    SECTION("A second instance loads the cached index") {
+        IndexFileAccess cut{};
+        cut.set_index_cache_dir(cache_dir.m_path);
+        REQUIRE(cut.load_index(valid_2read_reference_file(), create_dflt_options(), 1) ==
+                IndexLoadResult::success);
+        CHECK(cut.generate_sequence_records_header(valid_2read_reference_file(),
+                                                   create_dflt_options()) ==
+              EXPECTED_2READ_REF_FILE_HEADER);
+    }
+
+    SECTION("A second instance doesn't rebuild from the reference") {
+        // Swap in the cached index of a different reference: it's only what gets loaded if the
+        // cache is used.
+        {
+            IndexFileAccess other{};
+            other.set_index_cache_dir(cache_dir.m_path);
+            REQUIRE(other.load_index(valid_reference_file(), create_dflt_options(), 1) ==
+                    IndexLoadResult::success);
+        }
+        const auto other_cached_index = get_cached_index_path(
+                cache_dir.m_path, valid_reference_file(), create_dflt_options());
+        REQUIRE(std::filesystem::exists(other_cached_index));
+        std::filesystem::copy_file(other_cached_index, cached_index,
+                                   std::filesystem::copy_options::overwrite_existing);
+
+        IndexFileAccess cut{};
+        cut.set_index_cache_dir(cache_dir.m_path);
+        REQUIRE(cut.load_index(valid_2read_reference_file(), create_dflt_options(), 1) ==
+                IndexLoadResult::success);
+        CHECK(cut.generate_sequence_records_header(valid_2read_reference_file(),
+                                                   create_dflt_options()) ==
+              EXPECTED_REF_FILE_HEADER);
+    }
+}
+
+TEST_CASE(TEST_GROUP " get_cached_index_path depends on the indexing options", TEST_GROUP) {
+    const std::filesystem::path cache_dir{"cache"};
+    Minimap2Options other_options{create_dflt_options()};
+    ++other_options.index_options->get().k;
+
+    const auto cached_index =
+            get_cached_index_path(cache_dir, valid_reference_file(), create_dflt_options());
+    CHECK(cached_index.parent_path() == cache_dir);
+    CHECK(cached_index ==
+          get_cached_index_path(cache_dir, valid_reference_file(), create_dflt_options()));
+    CHECK(cached_index != get_cached_index_path(cache_dir, valid_reference_file(), other_options));
+    CHECK(get_cached_index_path(cache_dir, "invalid_file_path", create_dflt_options()).empty());
+}
+
+}  // namespace dorado::alignment::index_file_access
@@ -0,0 +1,113 @@
+#include "utils/minimizer_sketch.h"
+
+#include "TestUtils.h"
+#include "utils/sequence_utils.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <random>
+#include <string>
+
+#define CUT_TAG "[MinimizerSketch]"
+
+using dorado::utils::MinimizerSketch;
+
+namespace {
+
+std::string random_sequence(std::mt19937& rng, size_t length) {
+    std::uniform_int_distribution<int> base(0, 3);
+    std::string seq(length, 'A');
+    for (auto& b : seq) {
+        b = "ACGT"[base(rng)];
+    }
+    return seq;
+}
+
+// Applies substitutions, insertions and deletions, each at error_rate / 3 per base.
+std::string add_errors(std::mt19937& rng, const std::string& seq, float error_rate) {
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+    std::uniform_int_distribution<int> base(0, 3);
+    std::string result;
+    result.reserve(seq.size() * 2);
+    for (char b : seq) {
+        const float r = uniform(rng);
+        if (r < error_rate / 3) {
+            result += "ACGT"[base(rng)];
+        } else if (r < 2 * error_rate / 3) {
+            result += b;
+            result += "ACGT"[base(rng)];
+        } else if (r >= error_rate) {
+            result += b;
+        }
+    }
+    return result;
+}
+
+std::string load_long_target() {
+    const auto contents = ReadFileIntoString(std::filesystem::path(get_aligner_data_dir()) /
+                                             "long_target.fa");
+    std::string seq = contents.substr(contents.find('\n') + 1);
+    seq.erase(std::remove(seq.begin(), seq.end(), '\n'), seq.end());
+    return seq;
+}
+
+}  // namespace
+
+TEST_CASE(CUT_TAG ": sketch is strand independent", CUT_TAG) {
+    const auto seq = load_long_target();
+    const MinimizerSketch forward(seq);
+    const MinimizerSketch reverse(dorado::utils::reverse_complement(seq));
+    REQUIRE(!forward.empty());
+    CHECK(forward.size() == reverse.size());
+    CHECK(forward.count_shared(reverse) == forward.size());
+}
+
+TEST_CASE(CUT_TAG ": duplex-like pairs share minimizers", CUT_TAG) {
+    // The complement is a noisy, truncated reverse complement of the template, as in
+    // PairingNodeTest.
+    const auto error_rate = GENERATE(0.02f, 0.05f, 0.1f, 0.15f);
+    CAPTURE(error_rate);
+    std::mt19937 rng(42);
+
+    const auto seq = load_long_target();
+    for (int i = 0; i < 20; ++i) {
+        auto seq_rc = dorado::utils::reverse_complement(seq);
+        seq_rc = seq_rc.substr(0, size_t(seq.length() * 0.8f));
+        const MinimizerSketch temp(add_errors(rng, seq, error_rate));
+        const MinimizerSketch comp(add_errors(rng, seq_rc, error_rate));
+        // PairingNode only needs a handful of shared minimizers to try aligning the pair.
+        CHECK(temp.count_shared(comp) >= 20);
+    }
+}
+
+TEST_CASE(CUT_TAG ": unrelated reads share few minimizers", CUT_TAG) {
+    std::mt19937 rng(42);
+    for (int i = 0; i < 20; ++i) {
+        const MinimizerSketch lhs(random_sequence(rng, 10000));
+        const MinimizerSketch rhs(random_sequence(rng, 10000));
+        CHECK(lhs.count_shared(rhs) < 3);
+    }
+}
+
+TEST_CASE(CUT_TAG ": shared exact match always gives a shared minimizer", CUT_TAG) {
+    std::mt19937 rng(42);
+    const size_t match_len = MinimizerSketch::kKmerSize + MinimizerSketch::kWindowSize - 1;
+    for (int i = 0; i < 1000; ++i) {
+        const auto match = random_sequence(rng, match_len);
+        const auto lhs = random_sequence(rng, 500) + match + random_sequence(rng, 500);
+        const auto rhs = random_sequence(rng, 300) + dorado::utils::reverse_complement(match) +
+                         random_sequence(rng, 300);
+        CHECK(MinimizerSketch(lhs).count_shared(MinimizerSketch(rhs)) >= 1);
+    }
+}
+
+TEST_CASE(CUT_TAG ": short and ambiguous sequences", CUT_TAG) {
+    CHECK(MinimizerSketch("").empty());
+    CHECK(MinimizerSketch("ACGTACGTACGTAC").empty());
+    CHECK(MinimizerSketch("ACGTACGTACGTACG").size() == 1);
+    CHECK(MinimizerSketch("ACGTACGTNACGTACGTACG").empty());
+    CHECK(MinimizerSketch("acgtacgtacgtacg").count_shared(MinimizerSketch("CGTACGTACGTACGT")) ==
+          1);
+}
@@ -0,0 +1,177 @@
+#include "basecall/CRFModelConfig.h"
+#include "basecall/ModelRunner.h"
+#include "basecall/nn/CRFModel.h"
+#include "basecall/nn/TxModel.h"
+
+#include "TestUtils.h"
+
+#include <ATen/Parallel.h>
+#include <torch/torch.h>
+// Catch2 must come after torch since both define CHECK()
+#include <catch2/catch.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#define CUT_TAG "[ModelRunner]"
+
+using namespace dorado::basecall;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using ModuleHolder = torch::nn::ModuleHolder<torch::nn::AnyModule>;
+
+CRFModelConfig load_test_config(
+        const std::string& model_name = "dna_r10.4.1_e8.2_260bps_fast@v4.0.0") {
+    const fs::path path = fs::path(get_data_dir("model_configs")) / model_name;
+    auto config = load_crf_model_config(path);
+    config.basecaller.set_batch_size(2);
+    config.basecaller.set_chunk_size(1200);
+    config.normalise_basecaller_params();
+    return config;
+}
+
+// A model with random weights, so that the test doesn't need the weight files.
+ModuleHolder make_module(const CRFModelConfig& config) {
+    auto model = nn::CRFModel(config);
+    model->eval();
+    return ModuleHolder(torch::nn::AnyModule(model));
+}
+
+// As make_module(), but for a transformer model.  The random weights are loaded back in so that
+// the model goes through the same load-time preparation as a model read from disk.
+ModuleHolder make_tx_module(const CRFModelConfig& config) {
+    const auto options = at::TensorOptions().dtype(torch::kFloat32).device(torch::kCPU);
+    auto model = nn::TxModel(config, options);
+    std::vector<at::Tensor> weights;
+    for (const auto& parameter : model->parameters()) {
+        weights.push_back(parameter.detach().clone());
+    }
+    model->load_state_dict(weights);
+    model->crf->scale_weights();
+    model->eval();
+    return ModuleHolder(torch::nn::AnyModule(model));
+}
+
+// Bytes of distinct parameter and buffer storage held by the runners' models.
+size_t model_bytes(const std::vector<std::unique_ptr<ModelRunner>>& runners) {
+    std::unordered_set<const void*> seen_storage;
+    size_t bytes = 0;
+    for (const auto& runner : runners) {
+        const auto module = runner->module()->ptr();
+        auto tensors = module->parameters();
+        const auto buffers = module->buffers();
+        tensors.insert(tensors.end(), buffers.begin(), buffers.end());
+        for (const auto& tensor : tensors) {
+            const auto& storage = tensor.storage();
+            if (seen_storage.insert(storage.data()).second) {
+                bytes += storage.nbytes();
+            }
+        }
+    }
+    return bytes;
+}
+
+// Calls a batch on several runners sharing |module| at once, checks they agree with each other,
+// and that calling again afterwards still gives the same results.
+void check_concurrent_calls(const CRFModelConfig& config, const ModuleHolder& module) {
+    constexpr int num_runners = 3;
+
+    std::vector<std::unique_ptr<ModelRunner>> runners;
+    for (int i = 0; i < num_runners; ++i) {
+        runners.push_back(std::make_unique<ModelRunner>(config, "cpu", module));
+    }
+
+    torch::manual_seed(42);
+    const auto batch_size = static_cast<int>(runners.front()->batch_size());
+    const auto chunk_size = static_cast<int64_t>(runners.front()->chunk_size());
+    const auto input = torch::randn({batch_size, config.num_features, chunk_size});
+    for (auto& runner : runners) {
+        for (int i = 0; i < batch_size; ++i) {
+            runner->accept_chunk(i, input[i]);
+        }
+    }
+
+    std::vector<std::vector<dorado::basecall::decode::DecodedChunk>> results(num_runners);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_runners; ++i) {
+        threads.emplace_back([&results, &runners, i, batch_size] {
+            results[i] = runners[i]->call_chunks(batch_size);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // Calling forward() must not have changed the shared model.
+    results.push_back(runners.front()->call_chunks(batch_size));
+
+    REQUIRE(results.front().size() == size_t(batch_size));
+    for (size_t i = 1; i < results.size(); ++i) {
+        REQUIRE(results[i].size() == results.front().size());
+        for (int j = 0; j < batch_size; ++j) {
+            CHECK(results[i][j].sequence == results.front()[j].sequence);
+            CHECK(results[i][j].qstring == results.front()[j].qstring);
+            CHECK(results[i][j].moves == results.front()[j].moves);
+        }
+    }
+}
+
+}  // namespace
+
+TEST_CASE(CUT_TAG ": runners share the weights of their module", CUT_TAG) {
+    const auto config = load_test_config();
+    constexpr size_t num_runners = 4;
+
+    std::vector<std::unique_ptr<ModelRunner>> first_runner;
+    first_runner.push_back(std::make_unique<ModelRunner>(config, "cpu", make_module(config)));
+    const auto single_runner_bytes = model_bytes(first_runner);
+    REQUIRE(single_runner_bytes > 0);
+
+    std::vector<std::unique_ptr<ModelRunner>> shared_runners;
+    const auto module = first_runner.front()->module();
+    for (size_t i = 0; i < num_runners; ++i) {
+        shared_runners.push_back(std::make_unique<ModelRunner>(config, "cpu", module));
+    }
+    CHECK(model_bytes(shared_runners) == single_runner_bytes);
+
+    // Whereas runners with their own modules hold a copy each.
+    std::vector<std::unique_ptr<ModelRunner>> separate_runners;
+    for (size_t i = 0; i < num_runners; ++i) {
+        separate_runners.push_back(
+                std::make_unique<ModelRunner>(config, "cpu", make_module(config)));
+    }
+    CHECK(model_bytes(separate_runners) == num_runners * single_runner_bytes);
+}
+
+TEST_CASE(CUT_TAG ": runners sharing a module can call chunks concurrently", CUT_TAG) {
+    const auto config = load_test_config();
+    check_concurrent_calls(config, make_module(config));
+}
+
+TEST_CASE(CUT_TAG ": runners sharing a transformer module can call chunks concurrently", CUT_TAG) {
+    const auto config = load_test_config("dna_r10.4.1_e8.2_400bps_sup@v5.0.0");
+    check_concurrent_calls(config, make_tx_module(config));
+}
+
+TEST_CASE(CUT_TAG ": runners use their own number of intra-op threads", CUT_TAG) {
+    const auto config = load_test_config();
+    const auto module = make_module(config);
+
+    // Runners for two models called from their own threads, as in duplex basecalling.
+    std::vector<int> threads_used;
+    for (const int intra_op_threads : {1, 2}) {
+        ModelRunner runner(config, "cpu", module);
+        runner.set_intra_op_threads(intra_op_threads);
+        std::thread([&runner, &threads_used] {
+            runner.call_chunks(int(runner.batch_size()));
+            threads_used.push_back(at::get_num_threads());
+        }).join();
+    }
+    CHECK(threads_used == std::vector<int>{1, 2});
+}
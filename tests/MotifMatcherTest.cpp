@@ -4,6 +4,12 @@
 
 #include <catch2/catch.hpp>
 
+#include <iterator>
+#include <random>
+#include <regex>
+#include <stdexcept>
+#include <unordered_map>
+
 #define TEST_GROUP "[modbase_motif_matcher]"
 
 using std::make_tuple;
@@ -42,3 +48,92 @@ TEST_CASE(TEST_GROUP ": test motifs", TEST_GROUP) {
     auto hits = matcher.get_motif_hits(SEQ);
     CHECK(hits == expected_results);
 }
+
+TEST_CASE(TEST_GROUP ": test IUPAC codes", TEST_GROUP) {
+    // Each base of SEQ, plus an N which should never match.
+    const std::string seq = "ACGTN";
+    auto [code, expected_results] = GENERATE(table<std::string, std::vector<size_t>>({
+            // clang-format off
+            make_tuple("A", std::vector<size_t>{0}),
+            make_tuple("C", std::vector<size_t>{1}),
+            make_tuple("G", std::vector<size_t>{2}),
+            make_tuple("T", std::vector<size_t>{3}),
+            make_tuple("U", std::vector<size_t>{3}),
+            make_tuple("R", std::vector<size_t>{0, 2}),
+            make_tuple("Y", std::vector<size_t>{1, 3}),
+            make_tuple("S", std::vector<size_t>{1, 2}),
+            make_tuple("W", std::vector<size_t>{0, 3}),
+            make_tuple("K", std::vector<size_t>{2, 3}),
+            make_tuple("M", std::vector<size_t>{0, 1}),
+            make_tuple("B", std::vector<size_t>{1, 2, 3}),
+            make_tuple("D", std::vector<size_t>{0, 2, 3}),
+            make_tuple("H", std::vector<size_t>{0, 1, 3}),
+            make_tuple("V", std::vector<size_t>{0, 1, 2}),
+            make_tuple("N", std::vector<size_t>{0, 1, 2, 3}),
+            // clang-format on
+    }));
+
+    CAPTURE(code);
+    dorado::modbase::MotifMatcher matcher(code, 0);
+    CHECK(matcher.get_motif_hits(seq) == expected_results);
+}
+
+TEST_CASE(TEST_GROUP ": invalid motif", TEST_GROUP) {
+    CHECK_THROWS_AS(dorado::modbase::MotifMatcher("CX", 0), std::runtime_error);
+    CHECK_THROWS_AS(dorado::modbase::MotifMatcher("cg", 0), std::runtime_error);
+}
+
+TEST_CASE(TEST_GROUP ": short sequences", TEST_GROUP) {
+    dorado::modbase::MotifMatcher matcher("DRACH", 2);
+    CHECK(matcher.get_motif_hits("").empty());
+    CHECK(matcher.get_motif_hits("GGAC").empty());
+    CHECK(matcher.get_motif_hits("GGACA") == std::vector<size_t>{2});
+}
+
+// Checks hits match those found by the equivalent regex, which is how motifs used to be
+// matched, including for motifs too long for the bit-parallel matcher.
+TEST_CASE(TEST_GROUP ": matches regex", TEST_GROUP) {
+    const std::string codes = "ACGTRYSWKMBDHVN";
+    const std::unordered_map<char, std::string> code_regexes = {
+            {'A', "A"},      {'C', "C"},      {'G', "G"},      {'T', "T"},
+            {'R', "[AG]"},   {'Y', "[CT]"},   {'S', "[GC]"},   {'W', "[AT]"},
+            {'K', "[GT]"},   {'M', "[AC]"},   {'B', "[CGT]"},  {'D', "[AGT]"},
+            {'H', "[ACT]"},  {'V', "[ACG]"},  {'N', "[ACGT]"},
+    };
+
+    const size_t motif_len = GENERATE(1, 2, 5, 64, 65, 80);
+    CAPTURE(motif_len);
+
+    std::mt19937 gen(42);
+    // Mostly fully degenerate positions, so long motifs still get hits.
+    std::discrete_distribution<size_t> code_dist({1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 100});
+    // Occasional Ns in the sequence, which never match.
+    std::uniform_int_distribution<size_t> base_dist(0, 99);
+    for (int trial = 0; trial < 20; ++trial) {
+        std::string motif, motif_regex;
+        for (size_t i = 0; i < motif_len; ++i) {
+            motif += codes[code_dist(gen)];
+            motif_regex += code_regexes.at(motif.back());
+        }
+        std::string seq;
+        for (int i = 0; i < 1000; ++i) {
+            const auto base = base_dist(gen);
+            seq += base == 99 ? 'N' : "ACGT"[base % 4];
+        }
+
+        std::vector<size_t> expected_results;
+        const std::regex regex(motif_regex);
+        for (auto pos = seq.cbegin(); pos != seq.cend(); ++pos) {
+            std::smatch match;
+            if (!std::regex_search(pos, seq.cend(), match, regex)) {
+                break;
+            }
+            pos += match.position(0);
+            expected_results.push_back(std::distance(seq.cbegin(), pos) + 1);
+        }
+
+        CAPTURE(motif);
+        dorado::modbase::MotifMatcher matcher(motif, 1);
+        CHECK(matcher.get_motif_hits(seq) == expected_results);
+    }
+}
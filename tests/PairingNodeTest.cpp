@@ -10,6 +10,7 @@
 #include <catch2/catch.hpp>
 
 #include <filesystem>
+#include <random>
 
 #define TEST_GROUP "[PairingNodeTest]"
 
@@ -97,3 +98,53 @@ TEST_CASE("Split read pairing", TEST_GROUP) {
             });
     CHECK(num_pairs == 2);
 }
+
+TEST_CASE("Sketch prefilter rejects unrelated reads", TEST_GROUP) {
+    // Unrelated reads that meet the time and length criteria must be rejected by the minimizer
+    // sketch without being aligned, while the genuine pair is still found.
+    const std::string seq =
+            ReadFileIntoString(std::filesystem::path(get_aligner_data_dir()) / "long_target.fa");
+    auto seq_rc = dorado::utils::reverse_complement(seq);
+    seq_rc = seq_rc.substr(0, size_t(seq.length() * 0.8f));
+
+    std::mt19937 rng(42);
+    auto random_seq = [&rng](size_t len) {
+        std::uniform_int_distribution<int> base(0, 3);
+        std::string result(len, 'A');
+        for (auto& b : result) {
+            b = "ACGT"[base(rng)];
+        }
+        return result;
+    };
+
+    std::array reads{
+            make_read(0, random_seq(6000)),     //
+            make_read(3000, random_seq(5000)),  // unrelated to {0}
+            make_read(6000, seq),               // unrelated to {1}
+            make_read(8500, seq_rc)             // truncated reverse complement of {2}
+    };
+
+    dorado::PipelineDescriptor pipeline_desc;
+    std::vector<dorado::Message> messages;
+    auto sink = pipeline_desc.add_node<MessageSinkToVector>({}, 5, messages);
+    pipeline_desc.add_node<dorado::PairingNode>(
+            {sink},
+            dorado::DuplexPairingParameters{dorado::ReadOrder::BY_CHANNEL,
+                                            dorado::DEFAULT_DUPLEX_CACHE_DEPTH},
+            1, 1);
+    auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+    for (auto& read : reads) {
+        pipeline->push_message(std::move(read));
+    }
+    auto stats = pipeline->terminate(dorado::DefaultFlushOptions());
+    pipeline.reset();
+
+    CHECK(stats.at("PairingNode.sketch_rejected_pairs") == 2);
+    CHECK(stats.at("PairingNode.sketch_passed_pairs") == 1);
+    auto num_pairs =
+            std::count_if(messages.begin(), messages.end(), [](const dorado::Message& message) {
+                return std::holds_alternative<dorado::ReadPair>(message);
+            });
+    CHECK(num_pairs == 1);
+}
@@ -1,11 +1,17 @@
 #include "MessageSinkUtils.h"
+#include "TestUtils.h"
 #include "read_pipeline/NullNode.h"
 #include "read_pipeline/ReadPipeline.h"
 
 #include <catch2/catch.hpp>
 
+#include <chrono>
+#include <iostream>
+
 #define TEST_GROUP "[Pipeline]"
 
+using dorado::CacheFlushMessage;
+using dorado::Message;
 using dorado::MessageSink;
 using dorado::NodeHandle;
 using dorado::NullNode;
@@ -187,4 +193,126 @@ TEST_CASE("TerminateRestart", TEST_GROUP) {
     pipeline->push_message(std::make_unique<dorado::SimplexRead>());
     pipeline.reset();
     CHECK(messages.size() == 2);
-}
\ No newline at end of file
+}
+
+namespace {
+
+// Node that passes messages straight through, popping and sending them either one at
+// a time or in batches.
+class PassThroughNode : public MessageSink {
+public:
+    PassThroughNode(bool batched, size_t max_messages)
+            : MessageSink(max_messages, 1), m_batched(batched) {}
+    ~PassThroughNode() { stop_input_processing(); }
+    std::string get_name() const override { return "PassThroughNode"; }
+    void terminate(const dorado::FlushOptions&) override { stop_input_processing(); }
+    void restart() override {
+        start_input_processing([this] { input_thread_fn(); }, "pass_through");
+    }
+
+private:
+    void input_thread_fn() {
+        if (m_batched) {
+            std::vector<Message> messages;
+            while (get_input_messages(messages, MAX_INPUT_BATCH_SIZE)) {
+                send_messages_to_sink(std::move(messages));
+            }
+        } else {
+            Message message;
+            while (get_input_message(message)) {
+                send_message_to_sink(std::move(message));
+            }
+        }
+    }
+
+    const bool m_batched;
+};
+
+// Pushes num_messages through a chain of num_nodes PassThroughNodes, terminating the
+// pipeline once done.  Returns the elapsed time.
+template <class Sink, class... SinkArgs>
+std::chrono::duration<double> run_pass_through_chain(bool batched,
+                                                     int num_nodes,
+                                                     int num_messages,
+                                                     SinkArgs&&... sink_args) {
+    PipelineDescriptor pipeline_desc;
+    auto last = pipeline_desc.add_node<Sink>({}, std::forward<SinkArgs>(sink_args)...);
+    for (int i = 0; i < num_nodes; ++i) {
+        last = pipeline_desc.add_node<PassThroughNode>({last}, batched, 1000);
+    }
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
+    REQUIRE(pipeline != nullptr);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_messages; ++i) {
+        pipeline->push_message(CacheFlushMessage{i});
+    }
+    pipeline->terminate(dorado::DefaultFlushOptions());
+    return std::chrono::steady_clock::now() - start;
+}
+
+}  // namespace
+
+// Test messages are passed on intact and in order with batched hand-off.
+TEST_CASE("BatchedFlow", TEST_GROUP) {
+    const bool batched = GENERATE(false, true);
+    CAPTURE(batched);
+
+    const int kNumMessages = 10000;
+    std::vector<Message> messages;
+    run_pass_through_chain<MessageSinkToVector>(batched, 3, kNumMessages, 100, messages);
+
+    REQUIRE(messages.size() == size_t(kNumMessages));
+    auto flush_messages = ConvertMessages<CacheFlushMessage>(std::move(messages));
+    for (int i = 0; i < kNumMessages; ++i) {
+        CHECK(flush_messages.at(i).client_id == i);
+    }
+}
+
+namespace {
+
+// Node whose input thread handles a single message and then stops.
+class SingleMessageNode : public MessageSink {
+public:
+    SingleMessageNode() : MessageSink(10, 1) {}
+    ~SingleMessageNode() { stop_input_processing(); }
+    std::string get_name() const override { return "SingleMessageNode"; }
+    void terminate(const dorado::FlushOptions&) override { stop_input_processing(); }
+    void restart() override {
+        start_input_processing(
+                [this] {
+                    Message message;
+                    get_input_message(message);
+                },
+                "single_message");
+    }
+};
+
+}  // namespace
+
+// Test the processing time of an input thread's last message is recorded.
+TEST_CASE("LatencyStatsOnTermination", TEST_GROUP) {
+    PipelineDescriptor pipeline_desc;
+    auto node = pipeline_desc.add_node<SingleMessageNode>({});
+    auto pipeline = Pipeline::create(std::move(pipeline_desc), nullptr);
+    REQUIRE(pipeline != nullptr);
+
+    pipeline->push_message(CacheFlushMessage{0});
+    pipeline->terminate(dorado::DefaultFlushOptions());
+
+    const auto stats = pipeline->get_node_ref(node).sample_latency_stats();
+    CHECK(stats.at("wait_time.count") == 1);
+    CHECK(stats.at("processing_time.count") == 1);
+}
+
+// Compares per-message hand-off overhead of single and batched nodes.
+TEST_CASE("Throughput", BENCHMARK_TAG) {
+    const int kNumMessages = 1000000;
+    const int kNumNodes = 4;
+    for (bool batched : {false, true}) {
+        const auto duration =
+                run_pass_through_chain<NullNode>(batched, kNumNodes, kNumMessages);
+        std::cerr << (batched ? "batched " : "single  ") << kNumNodes << " nodes: "
+                  << kNumMessages / duration.count() / 1e6 << "M messages/s" << '\n';
+    }
+}
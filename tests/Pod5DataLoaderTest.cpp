@@ -183,3 +183,41 @@ TEST_CASE(TEST_GROUP "  get_unique_sequencing_chemisty", TEST_GROUP) {
                              "Could not uniquely resolve chemistry from inhomogeneous data"));
     }
 }
+
+TEST_CASE(TEST_GROUP "Prefetch limits don't change the reads loaded", TEST_GROUP) {
+    auto data_path = get_data_dir("multi_read_pod5");
+
+    auto load_read_ids = [&data_path](size_t max_batches, size_t max_signal_bytes,
+                                      size_t max_reads) {
+        dorado::PipelineDescriptor pipeline_desc;
+        std::vector<dorado::Message> messages;
+        pipeline_desc.add_node<MessageSinkToVector>({}, 100, messages);
+        auto pipeline = dorado::Pipeline::create(std::move(pipeline_desc), nullptr);
+
+        dorado::DataLoader loader(*pipeline, "cpu", 2, max_reads, std::nullopt, {});
+        loader.set_pod5_prefetch_limits(max_batches, max_signal_bytes);
+        loader.load_reads(data_path, false, dorado::ReadOrder::UNRESTRICTED);
+        const auto stats = loader.sample_stats();
+        CHECK(stats.at("pod5_batches_loaded") > 0);
+        CHECK(stats.at("pod5_batch_wait_ms") >= 0);
+        pipeline.reset();
+
+        std::vector<std::string> read_ids;
+        for (auto& read : ConvertMessages<dorado::SimplexReadPtr>(std::move(messages))) {
+            read_ids.push_back(read->read_common.read_id);
+        }
+        return read_ids;
+    };
+
+    const auto default_read_ids =
+            load_read_ids(dorado::DataLoader::DEFAULT_POD5_PREFETCH_BATCHES,
+                          dorado::DataLoader::DEFAULT_POD5_PREFETCH_MB << 20, 0);
+    CHECK(default_read_ids.size() == 4);
+    // A single batch at a time, and a cap smaller than any batch.
+    CHECK(load_read_ids(1, 1, 0) == default_read_ids);
+
+    // The read limit is still respected.
+    const auto limited_read_ids = load_read_ids(1, 1, 2);
+    CHECK(limited_read_ids ==
+          std::vector<std::string>(default_read_ids.begin(), default_read_ids.begin() + 2));
+}
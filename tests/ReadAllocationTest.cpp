@@ -0,0 +1,154 @@
+#include "read_pipeline/ReadPipeline.h"
+#include "read_pipeline/stitch.h"
+
+#include <ATen/Functions.h>
+#include <catch2/catch.hpp>
+
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#define TEST_GROUP "[ReadAllocationTest]"
+
+// Count heap allocations made by the current thread while |t_count_allocations| is set, so that
+// tests can check how many allocations a piece of code makes.  Replacing operator new affects
+// the whole binary, so this file is built into dorado_allocation_tests rather than dorado_tests.
+namespace {
+thread_local bool t_count_allocations = false;
+thread_local std::size_t t_num_allocations = 0;
+}  // namespace
+
+void* operator new(std::size_t size) {
+    if (t_count_allocations) {
+        t_num_allocations++;
+    }
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+// GCC doesn't know that the replaced operator new uses malloc(), so it flags these free()s once
+// they've been inlined.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+template <typename Func>
+std::size_t count_allocations(Func&& func) {
+    t_num_allocations = 0;
+    t_count_allocations = true;
+    func();
+    t_count_allocations = false;
+    return t_num_allocations;
+}
+
+// Long enough to not fit in the small string buffer.
+const std::string RUN_ID = "d2b7a5e0c1a4f6e8b9a1c3d5e7f90123456789ab";
+const std::string FLOWCELL_ID = "PAQ12345_flowcell_with_a_long_name";
+const std::string POSITION_ID = "P2S_00001-A_position_with_a_long_name";
+const std::string EXPERIMENT_ID = "experiment_with_a_very_long_name_0001";
+const std::string MODEL_NAME = "dna_r10.4.1_e8.2_400bps_hac@v5.0.0";
+
+}  // namespace
+
+TEST_CASE(TEST_GROUP ": Run-level strings are shared between reads", TEST_GROUP) {
+    constexpr std::size_t NUM_READS = 100;
+
+    dorado::ReadCommon source;
+    source.run_id = RUN_ID;
+    source.flowcell_id = FLOWCELL_ID;
+    source.position_id = POSITION_ID;
+    source.experiment_id = EXPERIMENT_ID;
+    source.model_name = MODEL_NAME;
+    std::vector<dorado::ReadCommon> reads(NUM_READS);
+
+    SECTION("Copying between reads doesn't allocate") {
+        const auto num_allocations = count_allocations([&] {
+            for (auto& read : reads) {
+                read.run_id = source.run_id;
+                read.flowcell_id = source.flowcell_id;
+                read.position_id = source.position_id;
+                read.experiment_id = source.experiment_id;
+                read.model_name = source.model_name;
+            }
+        });
+        CHECK(num_allocations == 0);
+        CHECK(reads.back().run_id.c_str() == source.run_id.c_str());
+        CHECK(reads.back().model_name == MODEL_NAME);
+    }
+
+    SECTION("Assigning an already interned value doesn't allocate") {
+        // This is what the data loaders do for every read.
+        const auto num_allocations = count_allocations([&] {
+            for (auto& read : reads) {
+                read.run_id = RUN_ID;
+                read.flowcell_id = FLOWCELL_ID;
+                read.position_id = POSITION_ID;
+                read.experiment_id = EXPERIMENT_ID;
+                read.model_name = MODEL_NAME;
+            }
+        });
+        CHECK(num_allocations == 0);
+        CHECK(reads.front().flowcell_id == source.flowcell_id);
+    }
+
+    SECTION("Plain strings allocate for every copy") {
+        std::vector<std::string> copies(NUM_READS);
+        const auto num_allocations = count_allocations([&] {
+            for (auto& copy : copies) {
+                copy = RUN_ID;
+            }
+        });
+        CHECK(num_allocations == NUM_READS);
+    }
+}
+
+TEST_CASE(TEST_GROUP ": Stitching allocates each output once", TEST_GROUP) {
+    constexpr std::size_t MODEL_STRIDE = 5;
+    constexpr std::size_t CHUNK_SIZE = 50;
+    constexpr std::size_t CHUNK_STEP = 35;
+    auto num_chunks = GENERATE(1, 2, 10, 100);
+
+    std::vector<std::unique_ptr<dorado::utils::Chunk>> called_chunks;
+    for (int i = 0; i < num_chunks; i++) {
+        auto chunk = std::make_unique<dorado::utils::Chunk>(i * CHUNK_STEP, CHUNK_SIZE);
+        for (std::size_t j = 0; j < CHUNK_SIZE / MODEL_STRIDE; j++) {
+            const bool move = j % 2 == 0;
+            chunk->moves.push_back(move);
+            if (move) {
+                chunk->seq += "ACGT"[j % 4];
+                chunk->qstring += '5';
+            }
+        }
+        called_chunks.push_back(std::move(chunk));
+    }
+
+    dorado::ReadCommon read_common;
+    read_common.model_stride = MODEL_STRIDE;
+    read_common.raw_data = at::empty(int64_t((num_chunks - 1) * CHUNK_STEP + CHUNK_SIZE));
+
+    const auto num_allocations =
+            count_allocations([&] { dorado::utils::stitch_chunks(read_common, called_chunks); });
+    CAPTURE(num_chunks);
+    // One for the chunk offsets, then one each for the sequence, qstring and moves.
+    CHECK(num_allocations <= 4);
+    CHECK(read_common.seq.size() == read_common.qstring.size());
+    CHECK(read_common.moves.size() == read_common.get_raw_data_samples() / MODEL_STRIDE);
+    if (num_chunks >= 10) {
+        // The bases are reserved from the chunks' bases per move (half here), rather than one per
+        // move.  Shorter reads fit in the small string buffer.
+        CHECK(read_common.seq.capacity() < read_common.moves.size() * 3 / 4);
+        CHECK(read_common.qstring.capacity() < read_common.moves.size() * 3 / 4);
+    }
+}
@@ -67,3 +67,30 @@ TEST_CASE(TEST_TAG " Test Scaled Dot Product Attention", TEST_TAG) {
     }
 #endif  // #if TORCH_VERSION_MAJOR < 2
 }
+
+TEST_CASE(TEST_TAG " Windowed attention with rotary embedding on CPU", TEST_TAG) {
+    torch::manual_seed(42);
+    const auto options = at::TensorOptions().dtype(torch::kFloat32).device(c10::kCPU);
+    constexpr int64_t N = 2, T = 150, H = 4, D = 16;
+    const auto [win_upper, win_lower] =
+            GENERATE(table<int, int>({{3, 5}, {0, 7}, {20, 20}, {127, 128}, {5, 0}, {200, 1}}));
+    CAPTURE(win_upper, win_lower);
+
+    const auto qkv = torch::randn({N, T, 3, H, D}, options);
+    RotaryEmbedding rotary_emb(D, 10000.0f, 2048, options);
+    auto rotary_input = qkv;
+    const auto rotated = rotary_emb->forward(rotary_input);
+
+    // Query t attends to keys [t - win_upper, t + win_lower], as in build_attn_window_mask.
+    const auto mask = torch::ones({T, T}, options).triu_(-win_upper).tril_(win_lower).to(at::kBool);
+    const auto naive_res = scaled_dot_product_attention_naive(rotated[0], rotated[1], rotated[2],
+                                                              mask)
+                                   .transpose(1, 2);
+
+    auto buffers = rotary_emb->named_buffers();
+    const auto windowed_res = windowed_attention_rotary_cpu(qkv, buffers["cos_freqs"],
+                                                            buffers["sin_freqs"], win_upper,
+                                                            win_lower);
+    REQUIRE(windowed_res.sizes() == naive_res.sizes());
+    CHECK(at::allclose(windowed_res, naive_res, 1e-4, 1e-5));
+}
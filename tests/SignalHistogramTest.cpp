@@ -0,0 +1,85 @@
+#include "torch_utils/tensor_utils.h"
+#include "utils/signal_histogram.h"
+
+#include "TestUtils.h"
+
+#include <ATen/ATen.h>
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#define CUT_TAG "[SignalHistogram]"
+
+TEST_CASE(CUT_TAG ": quantiles match a sorted signal", CUT_TAG) {
+    auto size = GENERATE(1, 2, 15, 16, 17, 1000, 40001);
+    auto [min_value, max_value] = GENERATE(table<int16_t, int16_t>(
+            {{7, 7}, {-5, 5}, {0, 2047}, {-500, 3000}, {-32768, 32767}}));
+    CAPTURE(size, min_value, max_value);
+
+    auto signal = random_signal(size, min_value, max_value);
+    const dorado::utils::SignalHistogram histogram(signal.data(), signal.size());
+
+    auto sorted = signal;
+    std::sort(sorted.begin(), sorted.end());
+    CHECK(histogram.size() == signal.size());
+    CHECK(histogram.min() == sorted.front());
+    CHECK(histogram.max() == sorted.back());
+
+    for (float q : {0.f, 0.1f, 0.2f, 0.25f, 0.5f, 0.75f, 0.9f, 0.99f, 1.f}) {
+        CAPTURE(q);
+        // `interpolation='lower'`, rounded the same way as quantile_counting().
+        const auto index = static_cast<size_t>(q * (signal.size() - 1));
+        CHECK(histogram.quantile(q) == sorted[index]);
+    }
+
+    const auto rank = (signal.size() - 1) / 2;
+    const int median = sorted[rank];
+    CHECK(histogram.median() == median);
+
+    std::vector<int> deviations(signal.size());
+    std::transform(signal.begin(), signal.end(), deviations.begin(),
+                   [median](int16_t value) { return std::abs(value - median); });
+    std::nth_element(deviations.begin(), deviations.begin() + rank, deviations.end());
+    CHECK(histogram.mad() == deviations[rank]);
+}
+
+TEST_CASE(CUT_TAG ": empty signal throws", CUT_TAG) {
+    const int16_t signal[1]{};
+    CHECK_THROWS_AS(dorado::utils::SignalHistogram(signal, 0), std::runtime_error);
+}
+
+TEST_CASE(CUT_TAG ": quantile and med/mad timings", BENCHMARK_TAG) {
+    for (size_t size : {1000, 10000, 100000, 1000000, 10000000}) {
+        const auto signal = random_signal(size, -500, 3000);
+        const auto x = at::from_blob(const_cast<int16_t*>(signal.data()), {int64_t(size)},
+                                     at::TensorOptions().dtype(at::kShort));
+        const auto q = at::tensor({0.2f, 0.9f});
+
+        const auto time = [size](const char* name, auto&& func) {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            const std::chrono::duration<double, std::micro> duration =
+                    std::chrono::steady_clock::now() - start;
+            std::cerr << size << " samples, " << name << ": " << duration.count() << "us" << '\n';
+        };
+        time("quantile_counting", [&] { dorado::utils::quantile_counting(x, q); });
+        time("histogram quantiles", [&] {
+            const dorado::utils::SignalHistogram histogram(signal.data(), size);
+            histogram.quantile(0.2f);
+            histogram.quantile(0.9f);
+        });
+        time("at::median med/mad", [&] {
+            const auto med = x.median();
+            at::median(at::abs(x - med));
+        });
+        time("histogram med/mad", [&] {
+            const dorado::utils::SignalHistogram histogram(signal.data(), size);
+            histogram.mad();
+        });
+    }
+}
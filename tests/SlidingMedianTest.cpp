@@ -0,0 +1,91 @@
+#include "utils/sliding_median.h"
+
+#include "TestUtils.h"
+
+#include <ATen/ATen.h>
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#define CUT_TAG "[SlidingMedian]"
+
+namespace {
+
+// Lower median and median absolute deviation, the same as at::median().
+std::pair<int16_t, int> naive_median_and_mad(const int16_t* signal, size_t size) {
+    std::vector<int> values(signal, signal + size);
+    const auto rank = (size - 1) / 2;
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    const int median = values[rank];
+    for (auto& value : values) {
+        value = std::abs(value - median);
+    }
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return {static_cast<int16_t>(median), values[rank]};
+}
+
+}  // namespace
+
+TEST_CASE(CUT_TAG ": SlidingMedian matches naive implementation", CUT_TAG) {
+    auto window_size = GENERATE(1, 2, 7, 250);
+    auto stride = GENERATE(1, 3, 50, 300);
+    CAPTURE(window_size, stride);
+
+    const auto signal = random_signal(3000, -500, 3000);
+    dorado::utils::SlidingMedian sliding_median(window_size);
+    for (size_t begin = 0; begin < signal.size(); begin += stride) {
+        // The window shrinks at the end of the signal.
+        const size_t end = std::min(begin + window_size, signal.size());
+        CAPTURE(begin, end);
+        sliding_median.move_to(signal.data(), begin, end);
+        REQUIRE(sliding_median.size() == end - begin);
+
+        const auto [median, mad] = naive_median_and_mad(signal.data() + begin, end - begin);
+        REQUIRE(sliding_median.median() == median);
+        REQUIRE(sliding_median.mad() == mad);
+    }
+
+    SECTION("reset") {
+        sliding_median.reset();
+        sliding_median.move_to(signal.data(), 0, 5);
+        CHECK(sliding_median.median() == naive_median_and_mad(signal.data(), 5).first);
+    }
+}
+
+TEST_CASE(CUT_TAG ": RNA adapter window timings", BENCHMARK_TAG) {
+    // Windows as used for RNA adapter detection, over typical RNA004 read lengths.
+    constexpr size_t window_size = 250;
+    constexpr size_t stride = 50;
+    for (size_t size : {4000, 20000, 100000, 1000000, 4000000}) {
+        const auto signal = random_signal(size, -500, 3000);
+        const auto x = at::from_blob(const_cast<int16_t*>(signal.data()), {int64_t(size)},
+                                     at::TensorOptions().dtype(at::kShort));
+
+        auto start = std::chrono::steady_clock::now();
+        int64_t torch_sum = 0;
+        for (size_t i = 0; i < size; i += stride) {
+            const auto end = std::min(i + window_size, size);
+            torch_sum += x.slice(0, int64_t(i), int64_t(end)).median().item<int16_t>();
+        }
+        const std::chrono::duration<double, std::micro> torch_duration =
+                std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        int64_t sliding_sum = 0;
+        dorado::utils::SlidingMedian window(window_size);
+        for (size_t i = 0; i < size; i += stride) {
+            window.move_to(signal.data(), i, std::min(i + window_size, size));
+            sliding_sum += window.median();
+        }
+        const std::chrono::duration<double, std::micro> sliding_duration =
+                std::chrono::steady_clock::now() - start;
+
+        CHECK(sliding_sum == torch_sum);
+        std::cerr << size << " samples: at::median " << torch_duration.count()
+                  << "us, SlidingMedian " << sliding_duration.count() << "us" << '\n';
+    }
+}
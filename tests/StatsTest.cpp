@@ -0,0 +1,119 @@
+#include "utils/latency_histogram.h"
+#include "utils/stats.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#define CUT_TAG "[Stats]"
+
+using namespace std::chrono_literals;
+
+TEST_CASE(CUT_TAG ": LatencyHistogram with no durations", CUT_TAG) {
+    dorado::stats::LatencyHistogram histogram;
+    CHECK(histogram.count() == 0);
+    CHECK(histogram.mean() == 0ns);
+    CHECK(histogram.max() == 0ns);
+    CHECK(histogram.quantile(0.5) == 0ns);
+}
+
+TEST_CASE(CUT_TAG ": LatencyHistogram small durations are exact", CUT_TAG) {
+    dorado::stats::LatencyHistogram histogram;
+    for (int i = 1; i <= 10; ++i) {
+        histogram.record(std::chrono::nanoseconds(i));
+    }
+    CHECK(histogram.count() == 10);
+    CHECK(histogram.quantile(0.0) == 1ns);
+    CHECK(histogram.quantile(0.5) == 5ns);
+    CHECK(histogram.quantile(1.0) == 10ns);
+    CHECK(histogram.max() == 10ns);
+    CHECK(histogram.mean() == 5ns);
+}
+
+TEST_CASE(CUT_TAG ": LatencyHistogram quantiles are within bucket precision", CUT_TAG) {
+    std::mt19937 rng(42);
+    std::lognormal_distribution<double> dist(12.0, 2.0);
+    std::vector<int64_t> durations(10000);
+    for (auto& duration : durations) {
+        duration = static_cast<int64_t>(dist(rng));
+    }
+
+    dorado::stats::LatencyHistogram histogram;
+    for (auto duration : durations) {
+        histogram.record(std::chrono::nanoseconds(duration));
+    }
+    std::sort(durations.begin(), durations.end());
+
+    CHECK(histogram.count() == durations.size());
+    CHECK(histogram.max().count() == durations.back());
+    for (double fraction : {0.1, 0.5, 0.9, 0.99}) {
+        CAPTURE(fraction);
+        const auto expected =
+                double(durations[static_cast<size_t>(fraction * durations.size()) - 1]);
+        // Buckets are 1/16th of a power of two wide.
+        CHECK(double(histogram.quantile(fraction).count()) == Approx(expected).epsilon(1.0 / 16));
+    }
+}
+
+TEST_CASE(CUT_TAG ": LatencyHistogram records from multiple threads", CUT_TAG) {
+    constexpr int NUM_THREADS = 4;
+    constexpr int NUM_RECORDS = 10000;
+    dorado::stats::LatencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&histogram, t] {
+            for (int i = 0; i < NUM_RECORDS; ++i) {
+                histogram.record(std::chrono::microseconds(t + 1), 2);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK(histogram.count() == 2 * NUM_THREADS * NUM_RECORDS);
+    CHECK(histogram.max() == std::chrono::microseconds(NUM_THREADS));
+    CHECK(histogram.mean() == 2500ns);
+}
+
+TEST_CASE(CUT_TAG ": LatencyHistogram add_to_stats", CUT_TAG) {
+    dorado::stats::LatencyHistogram histogram;
+    histogram.record(3us, 4);
+
+    dorado::stats::NamedStats stats;
+    histogram.add_to_stats(stats, "wait_time");
+    CHECK(stats.at("wait_time.count") == 4);
+    CHECK(stats.at("wait_time.mean_us") == Approx(3.0));
+    CHECK(stats.at("wait_time.p50_us") == Approx(3.0).epsilon(1.0 / 16));
+    CHECK(stats.at("wait_time.max_us") == Approx(3.0));
+}
+
+TEST_CASE(CUT_TAG ": StatsSampler dump_chrome_trace", CUT_TAG) {
+    std::vector<dorado::stats::StatsReporter> reporters{[] {
+        dorado::stats::NamedStats stats{{"queue.items", 3}, {"wait_time.p50_us", 1.5}};
+        return std::make_tuple(std::string("node"), stats);
+    }};
+    dorado::stats::StatsSampler sampler(1ms, reporters, {}, 100);
+    std::this_thread::sleep_for(20ms);
+    sampler.terminate();
+
+    std::ostringstream trace;
+    sampler.dump_chrome_trace(trace, std::nullopt);
+    const auto trace_str = trace.str();
+    CHECK(trace_str.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0);
+    CHECK(trace_str.find("{\"name\":\"node.queue\",\"ph\":\"C\"") != std::string::npos);
+    CHECK(trace_str.find("\"args\":{\"items\":3}") != std::string::npos);
+    CHECK(trace_str.find("\"args\":{\"p50_us\":1.5}") != std::string::npos);
+    CHECK(trace_str.substr(trace_str.size() - 3) == "]}\n");
+
+    SECTION("Filtered") {
+        std::ostringstream filtered_trace;
+        sampler.dump_chrome_trace(filtered_trace, std::regex("node\\.queue\\..*"));
+        CHECK(filtered_trace.str().find("node.queue") != std::string::npos);
+        CHECK(filtered_trace.str().find("node.wait_time") == std::string::npos);
+    }
+}
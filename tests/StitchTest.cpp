@@ -39,10 +39,12 @@ A        C        G     T     C           G        C     G  T           C
 1, 0, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0, 0, 0, 1, 0, 0, 1, 0, 1, 1, 0, 0, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0, 0, 1, 0, 1, 0, 0, 0, 0, 1, 0, 1, 0, 0, 1, 0, 1, 0
 */
 // clang-format on
-TEST_CASE("Test stitch_chunks", TEST_GROUP) {
-    constexpr size_t CHUNK_SIZE = 10;
-    constexpr size_t OVERLAP = 3;
+namespace {
+
+constexpr size_t CHUNK_SIZE = 10;
+constexpr size_t OVERLAP = 3;
 
+std::vector<std::unique_ptr<dorado::utils::Chunk>> make_called_chunks() {
     std::vector<std::unique_ptr<dorado::utils::Chunk>> called_chunks;
 
     size_t offset = 0;
@@ -64,18 +66,56 @@ TEST_CASE("Test stitch_chunks", TEST_GROUP) {
         chunk->moves = MOVES[chunk_idx];
         called_chunks.push_back(std::move(chunk));
     }
+    return called_chunks;
+}
+
+const std::string expected_sequence = "ACGTCGCGTCGTCGTCCGT";
+const std::string expected_qstring = "!&.-&.&.-&.-&.-&&.-";
+const std::vector<uint8_t> expected_moves = {1, 0, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0, 0, 0, 1, 0, 0,
+                                             1, 0, 1, 1, 0, 0, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0, 0,
+                                             1, 0, 1, 0, 0, 0, 0, 1, 0, 1, 0, 0, 1, 0, 1};
+
+}  // namespace
+
+TEST_CASE("Test stitch_chunks", TEST_GROUP) {
+    auto called_chunks = make_called_chunks();
 
     dorado::ReadCommon read_common;
     read_common.model_stride = static_cast<int>(dorado::utils::div_round_closest(
             called_chunks[0]->raw_chunk_size, called_chunks[0]->moves.size()));
     REQUIRE_NOTHROW(dorado::utils::stitch_chunks(read_common, called_chunks));
 
-    const std::string expected_sequence = "ACGTCGCGTCGTCGTCCGT";
-    const std::string expected_qstring = "!&.-&.&.-&.-&.-&&.-";
-    const std::vector<uint8_t> expected_moves = {1, 0, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0, 0, 0, 1, 0, 0,
-                                                 1, 0, 1, 1, 0, 0, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0, 0,
-                                                 1, 0, 1, 0, 0, 0, 0, 1, 0, 1, 0, 0, 1, 0, 1};
+    REQUIRE(read_common.seq == expected_sequence);
+    REQUIRE(read_common.qstring == expected_qstring);
+    REQUIRE(read_common.moves == expected_moves);
+}
+
+TEST_CASE("Test ChunkStitcher with chunks out of order", TEST_GROUP) {
+    auto called_chunks = make_called_chunks();
+    const int model_stride = static_cast<int>(dorado::utils::div_round_closest(
+            called_chunks[0]->raw_chunk_size, called_chunks[0]->moves.size()));
+    std::vector<size_t> chunk_offsets;
+    for (const auto& chunk : called_chunks) {
+        chunk_offsets.push_back(chunk->input_offset);
+    }
+
+    dorado::ReadCommon read_common;
+    read_common.model_stride = model_stride;
+    dorado::utils::ChunkStitcher stitcher(std::move(chunk_offsets), model_stride,
+                                          read_common.get_raw_data_samples());
+
+    // Chunk 0 can be stitched immediately, the rest arrive in reverse and have to wait for 1.
+    const size_t num_chunks = called_chunks.size();
+    CHECK_FALSE(stitcher.add_chunk(0, std::move(called_chunks[0])));
+    for (size_t idx = num_chunks - 1; idx > 1; --idx) {
+        CHECK_FALSE(stitcher.add_chunk(idx, std::move(called_chunks[idx])));
+        CHECK_FALSE(stitcher.complete());
+    }
+    CHECK(stitcher.add_chunk(1, std::move(called_chunks[1])));
+    CHECK(stitcher.complete());
+    CHECK_THROWS(stitcher.add_chunk(1, std::make_unique<dorado::utils::Chunk>(0, CHUNK_SIZE)));
 
+    stitcher.finish(read_common);
     REQUIRE(read_common.seq == expected_sequence);
     REQUIRE(read_common.qstring == expected_qstring);
     REQUIRE(read_common.moves == expected_moves);
@@ -4,6 +4,7 @@
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <random>
 
 #ifdef __APPLE__
 #include <CoreFoundation/CoreFoundation.h>
@@ -87,4 +88,14 @@ std::string generate_random_sequence_string(int len) {
     return read;
 }
 
+std::vector<int16_t> random_signal(size_t size, int16_t min_value, int16_t max_value) {
+    std::mt19937 rng(static_cast<std::mt19937::result_type>(size));
+    std::uniform_int_distribution<int> dist(min_value, max_value);
+    std::vector<int16_t> signal(size);
+    for (auto& sample : signal) {
+        sample = static_cast<int16_t>(dist(rng));
+    }
+    return signal;
+}
+
 }  // namespace dorado::tests
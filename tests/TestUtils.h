@@ -2,6 +2,7 @@
 
 #include <spdlog/spdlog.h>
 
+#include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <string>
@@ -29,6 +30,10 @@ std::vector<uint8_t> ReadFileIntoVector(const std::filesystem::path& path);
 
 #define get_aligner_data_dir() get_data_dir("aligner_test")
 
+// Micro-benchmarks are test cases with this tag, which hides them from the normal test run.
+// Run them with: dorado_tests "[.benchmark]"
+#define BENCHMARK_TAG "[.benchmark]"
+
 // Wrapper around a temporary directory since one doesn't exist in the standard
 struct TempDir {
 private:
@@ -76,6 +81,9 @@ public:
 
 std::string generate_random_sequence_string(int len);
 
+// Uniformly distributed samples in [min_value, max_value].  The same for a given size.
+std::vector<int16_t> random_signal(size_t size, int16_t min_value, int16_t max_value);
+
 }  // namespace dorado::tests
 
 using namespace dorado::tests;
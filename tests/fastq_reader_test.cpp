@@ -1,8 +1,18 @@
 #include "utils/fastq_reader.h"
 
+#include "TestUtils.h"
+
 #include <catch2/catch.hpp>
+#include <htslib/bgzf.h>
 
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
 #include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
 
 #define CUT_TAG "[dorado::utils::fastq_reader]"
 #define DEFINE_TEST(name) TEST_CASE(CUT_TAG " " name, CUT_TAG)
@@ -42,14 +52,45 @@ const std::string VALID_FASTQ_U_RECORD{VALID_ID_LINE + VALID_SEQ_LINE_WITH_U +
                                        VALID_SEPARATOR_LINE + VALID_QUAL_LINE};
 const std::string MISSING_QUAL_FIELD_RECORD{VALID_ID_LINE + VALID_SEQ_LINE + VALID_SEPARATOR_LINE};
 
-}  // namespace
+std::string write_temp_file(const std::filesystem::path& dir,
+                            const std::string& contents,
+                            bool compress = false) {
+    const auto path = (dir / (compress ? "input.fastq.gz" : "input.fastq")).string();
+    if (compress) {
+        BGZF* file = bgzf_open(path.c_str(), "w");
+        REQUIRE(file != nullptr);
+        CHECK(bgzf_write(file, contents.data(), contents.size()) == ssize_t(contents.size()));
+        CHECK(bgzf_close(file) == 0);
+    } else {
+        std::ofstream(path, std::ios::binary) << contents;
+    }
+    return path;
+}
 
-DEFINE_TEST("is_fastq with non existent file return false") {
-    REQUIRE_FALSE(is_fastq("non_existent_file.278y"));
+std::string random_fastq(std::size_t num_records, std::size_t read_length) {
+    std::minstd_rand gen(42);
+    std::uniform_int_distribution<int> base_dist(0, 3);
+    std::uniform_int_distribution<int> qscore_dist('!', '~');
+    std::string fastq;
+    fastq.reserve(num_records * (2 * read_length + 64));
+    for (std::size_t i = 0; i < num_records; ++i) {
+        fastq += "@read_" + std::to_string(i) + " runid=1\n";
+        for (std::size_t j = 0; j < read_length; ++j) {
+            fastq += "ACGT"[base_dist(gen)];
+        }
+        fastq += "\n+\n";
+        for (std::size_t j = 0; j < read_length; ++j) {
+            fastq += char(qscore_dist(gen));
+        }
+        fastq += '\n';
+    }
+    return fastq;
 }
 
-DEFINE_TEST("is_fastq parameterized testing") {
-    auto [input_text, is_valid, description] = GENERATE(table<std::string, bool, std::string>({
+// Inputs, whether they're valid FASTQ, and a description of the case.
+using ValidityCase = std::tuple<std::string, bool, std::string>;
+const std::vector<ValidityCase>& validity_cases() {
+    static const std::vector<ValidityCase> cases{
             {VALID_FASTQ_RECORD + VALID_FASTQ_RECORD_2, true, "valid fastq"},
 
             {"", false, "empty input returns false"},
@@ -142,7 +183,18 @@ DEFINE_TEST("is_fastq parameterized testing") {
             {VALID_ID_LINE + "ACGTACG\nTAC\nG\nTAC\n" + VALID_SEPARATOR_LINE +
                      "@read_0\nACT\n+\n!$#\n",
              true, "record with qstring equivalent to a valid fastq record returns true"},
-    }));
+    };
+    return cases;
+}
+
+}  // namespace
+
+DEFINE_TEST("is_fastq with non existent file return false") {
+    REQUIRE_FALSE(is_fastq("non_existent_file.278y"));
+}
+
+DEFINE_TEST("is_fastq parameterized testing") {
+    auto [input_text, is_valid, description] = GENERATE(from_range(validity_cases()));
     CAPTURE(description);
     CAPTURE(input_text);
     std::istringstream input_stream{input_text};
@@ -302,4 +354,105 @@ DEFINE_TEST("FastqReader::try_get_next_record with Us not Ts returns record with
     CHECK(record->qstring() == VALID_QUAL);
 }
 
+DEFINE_TEST("FastqBlockReader::is_valid constructed with invalid file returns false") {
+    FastqBlockReader cut("invalid_file");
+    REQUIRE_FALSE(cut.is_valid());
+    REQUIRE_FALSE(cut.try_get_next_record().has_value());
+}
+
+DEFINE_TEST("FastqBlockReader::is_valid parameterized testing") {
+    auto [input_text, is_valid, description] = GENERATE(from_range(validity_cases()));
+    CAPTURE(description);
+    CAPTURE(input_text);
+    auto temp_dir = make_temp_dir("fastq_block_reader");
+    REQUIRE(FastqBlockReader(write_temp_file(temp_dir.m_path, input_text)).is_valid() ==
+            is_valid);
+}
+
+DEFINE_TEST("FastqBlockReader returns the same records as FastqReader") {
+    const std::size_t block_size = GENERATE(std::size_t{1}, std::size_t{7}, std::size_t{64},
+                                            FastqBlockReader::DEFAULT_BLOCK_SIZE);
+    const bool compress = GENERATE(false, true);
+    CAPTURE(block_size, compress);
+    const std::string input_text =
+            VALID_FASTQ_RECORD + VALID_FASTQ_U_RECORD + VALID_ID_LINE_WITH_TABS +
+            VALID_LINE_WRAPPED_SEQ_LINE + VALID_SEPARATOR_LINE + VALID_LINE_WRAPPED_QUAL_LINE +
+            VALID_ID_LINE + "ACGTACG\nTAC\nG\nTAC\n" + VALID_SEPARATOR_LINE +
+            "@read_0\nACT\n+\n!$#\n" + random_fastq(100, 1000) + VALID_FASTQ_RECORD_2;
+    auto temp_dir = make_temp_dir("fastq_block_reader");
+    FastqBlockReader cut(write_temp_file(temp_dir.m_path, input_text, compress), 2, block_size);
+    REQUIRE(cut.is_valid());
+
+    FastqReader expected_reader(std::make_unique<std::istringstream>(input_text));
+    std::size_t num_records = 0;
+    while (auto expected = expected_reader.try_get_next_record()) {
+        CAPTURE(num_records);
+        auto record = cut.try_get_next_record();
+        REQUIRE(record.has_value());
+        CHECK(record->header == expected->header());
+        CHECK(record->sequence == expected->sequence());
+        CHECK(record->qstring == expected->qstring());
+        CHECK(record->read_id_view() == expected->read_id_view());
+        CHECK(record->get_bam_tags() == expected->get_bam_tags());
+        ++num_records;
+    }
+    CHECK(num_records == 105);
+    CHECK_FALSE(cut.try_get_next_record().has_value());
+}
+
+DEFINE_TEST("FastqBlockReader::read_block stops at the first invalid record") {
+    auto temp_dir = make_temp_dir("fastq_block_reader");
+    FastqBlockReader cut(write_temp_file(temp_dir.m_path, VALID_FASTQ_RECORD +
+                                                                  MISSING_QUAL_FIELD_RECORD +
+                                                                  VALID_FASTQ_RECORD_2));
+    REQUIRE(cut.is_valid());
+    std::vector<FastqRecordView> records;
+    REQUIRE(cut.read_block(records));
+    REQUIRE(records.size() == 1);
+    CHECK(records[0].header == VALID_ID);
+    CHECK_FALSE(cut.read_block(records));
+    CHECK(records.empty());
+}
+
+TEST_CASE(CUT_TAG " parsing throughput", BENCHMARK_TAG) {
+    const auto input_text = random_fastq(20000, 10000);
+    const double gigabytes = input_text.size() / 1e9;
+    auto temp_dir = make_temp_dir("fastq_block_reader");
+
+    const auto report = [gigabytes](const std::string& name, auto&& read_all) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto num_records = read_all();
+        const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+        CHECK(num_records == 20000);
+        std::cerr << name << ": " << gigabytes / duration.count() << " GB/s" << '\n';
+    };
+
+    const auto plain_file = write_temp_file(temp_dir.m_path, input_text);
+    report("FastqReader", [&plain_file] {
+        FastqReader reader(plain_file);
+        std::size_t num_records = 0;
+        while (reader.try_get_next_record()) {
+            ++num_records;
+        }
+        return num_records;
+    });
+
+    const auto read_blocks = [](const std::string& file, int threads) {
+        FastqBlockReader reader(file, threads);
+        std::vector<FastqRecordView> records;
+        std::size_t num_records = 0;
+        while (reader.read_block(records)) {
+            num_records += records.size();
+        }
+        return num_records;
+    };
+    report("FastqBlockReader", [&] { return read_blocks(plain_file, 1); });
+
+    const auto compressed_file = write_temp_file(temp_dir.m_path, input_text, true);
+    for (const int threads : {1, 4, 8}) {
+        report("FastqBlockReader, BGZF, " + std::to_string(threads) + " threads",
+               [&] { return read_blocks(compressed_file, threads); });
+    }
+}
+
 }  // namespace dorado::utils::fastq_reader::test
@@ -2,11 +2,17 @@
 
 #include <catch2/catch.hpp>
 
+#include <random>
+#include <string>
+#include <vector>
+
 #define CUT_TAG "[myers]"
 #define DEFINE_TEST(name) TEST_CASE(CUT_TAG " " name, CUT_TAG)
 
 using dorado::splitter::EdistResult;
 using dorado::splitter::myers_align;
+using dorado::splitter::myers_align_multi;
+using dorado::splitter::myers_edists;
 
 DEFINE_TEST("Basic alignment, single hit") {
     const std::string_view query = "AAA";
@@ -93,3 +99,69 @@ DEFINE_TEST("Complex alignment, doesn't crash when high edist near start") {
     const auto alignments = myers_align(query, seq, max_edist);
     CHECK(!alignments.empty());
 }
+
+DEFINE_TEST("Multi-pattern alignment matches single pattern alignment") {
+    // Cover partially filled groups of SIMD lanes as well as full ones.
+    const auto num_queries = GENERATE(1, 3, 4, 5, 9);
+    const auto max_edist = GENERATE(0, 3, 8);
+    CAPTURE(num_queries, max_edist);
+
+    std::mt19937 gen{42};
+    const std::string_view bases = "ACGT";
+    auto random_seq = [&](std::size_t len) {
+        std::uniform_int_distribution<std::size_t> base(0, 3);
+        std::string seq(len, 'A');
+        for (auto& c : seq) {
+            c = bases[base(gen)];
+        }
+        return seq;
+    };
+
+    // Queries of different lengths, up to the maximum supported.
+    std::vector<std::string> queries;
+    std::uniform_int_distribution<std::size_t> query_len(1, 63);
+    for (int i = 0; i < num_queries; i++) {
+        queries.push_back(random_seq(i == 0 ? 63 : query_len(gen)));
+    }
+
+    // Plant mutated copies of the queries in some random sequence.
+    std::string seq = random_seq(500);
+    std::uniform_int_distribution<int> edit(0, 9);
+    for (const auto& query : queries) {
+        auto copy = query;
+        for (auto& c : copy) {
+            if (edit(gen) == 0) {
+                c = bases[edit(gen) % 4];
+            }
+        }
+        seq += copy + random_seq(200);
+    }
+
+    const std::vector<std::string_view> query_views(queries.begin(), queries.end());
+    const auto edists = myers_edists(query_views, seq);
+    const auto multi_alignments = myers_align_multi(query_views, seq, max_edist);
+    REQUIRE(edists.size() == queries.size());
+    REQUIRE(multi_alignments.size() == queries.size());
+    for (std::size_t i = 0; i < queries.size(); i++) {
+        CAPTURE(i, queries[i]);
+        CHECK(edists[i].size() == seq.size() + 1);
+
+        const auto alignments = myers_align(queries[i], seq, max_edist);
+        REQUIRE(multi_alignments[i].size() == alignments.size());
+        for (std::size_t j = 0; j < alignments.size(); j++) {
+            CHECK(multi_alignments[i][j].begin == alignments[j].begin);
+            CHECK(multi_alignments[i][j].end == alignments[j].end);
+            CHECK(multi_alignments[i][j].edist == alignments[j].edist);
+        }
+    }
+}
+
+DEFINE_TEST("Multi-pattern alignment, sequence shorter than queries") {
+    const std::vector<std::string_view> queries{"TACTTCGTTCAGTT", "AAA"};
+    const std::string_view seq = "TACTTCG";
+
+    const auto alignments = myers_align_multi(queries, seq, 3);
+    REQUIRE(alignments.size() == 2);
+    CHECK(alignments[0].empty());
+    CHECK(alignments[1].size() == myers_align(queries[1], seq, 3).size());
+}